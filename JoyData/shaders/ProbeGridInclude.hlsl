@@ -0,0 +1,62 @@
+// Addressing of DDGI probe cascades, the same as ProbeCascades on cpu. Expects raytracedProbesData to be declared.
+// Probe index = cascade * probes per cascade + storage x * gridY * gridZ + storage y * gridZ + storage z,
+// storage coordinate = (grid coordinate + gridScroll) % grid size.
+// Probe textures hold cascades one under another: probe texture id = (storage x + gridX * storage y, storage z + gridZ * cascade)
+
+inline uint3 GetProbeGridSize()
+{
+	return uint3(raytracedProbesData.gridX, raytracedProbesData.gridY, raytracedProbesData.gridZ);
+}
+
+inline uint GetProbesPerCascade()
+{
+	return raytracedProbesData.gridX * raytracedProbesData.gridY * raytracedProbesData.gridZ;
+}
+
+inline uint GetProbeCascade(uint probeIndex)
+{
+	return probeIndex / GetProbesPerCascade();
+}
+
+inline uint3 GetProbeStorageId(uint probeIndex)
+{
+	const uint storage = probeIndex % GetProbesPerCascade();
+	return uint3(
+		storage / (raytracedProbesData.gridY * raytracedProbesData.gridZ),
+		(storage / raytracedProbesData.gridZ) % raytracedProbesData.gridY,
+		storage % raytracedProbesData.gridZ
+	);
+}
+
+inline uint GetProbeIndex(uint cascade, uint3 gridId)
+{
+	const uint3 storageId = (gridId + raytracedProbesData.cascades[cascade].gridScroll) % GetProbeGridSize();
+	return cascade * GetProbesPerCascade() +
+		storageId.x * raytracedProbesData.gridY * raytracedProbesData.gridZ +
+		storageId.y * raytracedProbesData.gridZ +
+		storageId.z;
+}
+
+// Position on the regular grid, without relocation offset
+inline float3 GetProbeGridPosition(uint probeIndex)
+{
+	const ProbeCascadeData cascade = raytracedProbesData.cascades[GetProbeCascade(probeIndex)];
+	const uint3 gridId = (GetProbeStorageId(probeIndex) + GetProbeGridSize() - cascade.gridScroll) % GetProbeGridSize();
+	return cascade.gridMin + float3(gridId) * cascade.cellSize;
+}
+
+inline uint2 GetProbeTextureId(uint probeIndex)
+{
+	const uint3 storageId = GetProbeStorageId(probeIndex);
+	return uint2(
+		storageId.x + raytracedProbesData.gridX * storageId.y,
+		storageId.z + raytracedProbesData.gridZ * GetProbeCascade(probeIndex)
+	);
+}
+
+inline float2 GetProbeTextureSize()
+{
+	return float2(
+		raytracedProbesData.gridX * raytracedProbesData.gridY * (DDGI_PROBE_DATA_RESOLUTION + 2),
+		raytracedProbesData.gridZ * DDGI_CASCADES_COUNT * (DDGI_PROBE_DATA_RESOLUTION + 2));
+}
@@ -14,6 +14,7 @@ StructuredBuffer<ClusterEntry> clusteredEntryData: register(t0);
 StructuredBuffer<UINT1> clusteredItemData : register(t1);
 StructuredBuffer<LightInfo> lightData : register(t2);
 StructuredBuffer<MAT4> objectMatricesData : register(t3);
+StructuredBuffer<ProbeRelocationData> probeRelocationData : register(t4); // size = probes count
 
 
 Texture2D<float4> colorTexture;
@@ -26,6 +27,8 @@ Texture2D<float> directionalLightShadowmap;
 Texture2D<float3> probeIrradianceTexture;
 Texture2D<float2> probeDepthTexture;
 
+#include "ProbeGridInclude.hlsl"
+
 SamplerState linearBlackBorderSampler;
 SamplerComparisonState PCFSampler;
 
@@ -81,15 +84,9 @@ float2 float32x3_to_oct(in float3 v)
 	return (v.z <= 0.0) ? ((1.0 - abs(p.yx)) * signNotZero(p)) : p;
 }
 
-float2 GetProbeTextureUV(float3 gridID, float3 worldNormal)
+float2 GetProbeTextureUV(uint2 probeId2D, float3 worldNormal)
 {
-	const float2 probeId2D = float2(
-		gridID.x + raytracedProbesData.gridX * gridID.y,
-		gridID.z
-	);
-
-	float2 probeTextureSize = float2(raytracedProbesData.gridX * raytracedProbesData.gridY * (DDGI_PROBE_DATA_RESOLUTION + 2),
-	                                 raytracedProbesData.gridZ * (DDGI_PROBE_DATA_RESOLUTION + 2));
+	const float2 probeTextureSize = GetProbeTextureSize();
 
 	const float2 probeUV = (float32x3_to_oct(worldNormal) + float2(1, 1)) / 2.0;
 
@@ -101,10 +98,24 @@ float2 GetProbeTextureUV(float3 gridID, float3 worldNormal)
 	return float2(textureUV.x / probeTextureSize.x, textureUV.y / probeTextureSize.y);
 }
 
-float3 SampleProbeGrid(float3 worldPosition, float3 worldNormal)
+// Position in cells of the cascade, the cascade covers it when it's in [0, grid size - 1] on every axis
+float3 GetCascadeGridPosition(uint cascade, float3 worldPosition)
+{
+	return (worldPosition - raytracedProbesData.cascades[cascade].gridMin) / raytracedProbesData.cascades[cascade].cellSize;
+}
+
+// Distance in cells to the closest side of the cascade, negative outside
+float GetCascadeBorderDistance(float3 gridPos)
+{
+	const float3 border = min(gridPos, float3(GetProbeGridSize() - 1) - gridPos);
+	return min(border.x, min(border.y, border.z));
+}
+
+float3 SampleProbeCascade(uint cascade, float3 worldPosition, float3 worldNormal)
 {
 	float3 ret = float3(0, 0, 0);
-	float3 gridPos = (worldPosition - raytracedProbesData.gridMin) / raytracedProbesData.cellSize;
+	const float3 gridPos = GetCascadeGridPosition(cascade, worldPosition);
+	const float cellSize = raytracedProbesData.cascades[cascade].cellSize;
 
 	const float3 gridCage[8] = {
 		float3(ceil(gridPos.x), ceil(gridPos.y), ceil(gridPos.z)),
@@ -123,12 +134,17 @@ float3 SampleProbeGrid(float3 worldPosition, float3 worldNormal)
 	for (int i = 0; i < 8; i++)
 	{
 		const float3 probeCoord = gridCage[i];
-		const float3 probeWorldPos = raytracedProbesData.gridMin + probeCoord * raytracedProbesData.cellSize;
+
+		// the cascade is picked so the whole cage is inside it
+		const uint probeIndex = GetProbeIndex(cascade, uint3(probeCoord));
+		const ProbeRelocationData relocation = probeRelocationData[probeIndex];
+
+		const float3 probeWorldPos = raytracedProbesData.cascades[cascade].gridMin + probeCoord * cellSize + relocation.offset;
 		const float distanceToProbe = length(worldPosition - probeWorldPos);
-		const float2 textureUV = GetProbeTextureUV(probeCoord, worldNormal);
+		const float2 textureUV = GetProbeTextureUV(GetProbeTextureId(probeIndex), worldNormal);
 		const float3 probeColor = probeIrradianceTexture.Sample(linearBlackBorderSampler, textureUV);
 
-		const float backProbeMultiplier = pow(max(0.000, dot(normalize(probeCoord - gridPos), worldNormal)), 1.2);
+		const float backProbeMultiplier = pow(max(0.000, dot(normalize(probeWorldPos - worldPosition), worldNormal)), 1.2);
 
 		const float2 temp = probeDepthTexture.Sample(linearBlackBorderSampler, textureUV);
 		const float mean = temp.x;
@@ -150,19 +166,47 @@ float3 SampleProbeGrid(float3 worldPosition, float3 worldNormal)
 
 		weight *= backProbeMultiplier * chebyshev_weight;
 
-		// Avoid zero weight
-		weight = max(0.000001, weight);
+		// Avoid zero weight, inactive probes are inside geometry or were never traced
+		weight = max(0.000001, weight) * relocation.isActive;
 
 		ret += probeColor * weight;
 
 		totalWeight += weight;
 	}
 
-	ret /= totalWeight;
+	ret /= max(totalWeight, 0.000001);
 
 	return ret;
 }
 
+// The finest cascade which has the position between its probes, blended into the next one
+// over the last cell before its border so cascade switches aren't visible
+float3 SampleProbeGrid(float3 worldPosition, float3 worldNormal)
+{
+	[loop]
+	for (uint cascade = 0; cascade < DDGI_CASCADES_COUNT; cascade++)
+	{
+		const float borderDistance = GetCascadeBorderDistance(GetCascadeGridPosition(cascade, worldPosition));
+		if (borderDistance < 0)
+		{
+			continue;
+		}
+
+		const float3 color = SampleProbeCascade(cascade, worldPosition, worldNormal);
+		const float blend = saturate(borderDistance);
+		if (blend >= 1 || cascade + 1 == DDGI_CASCADES_COUNT ||
+			GetCascadeBorderDistance(GetCascadeGridPosition(cascade + 1, worldPosition)) < 0)
+		{
+			return color;
+		}
+
+		return lerp(SampleProbeCascade(cascade + 1, worldPosition, worldNormal), color, blend);
+	}
+
+	// outside of every cascade
+	return float3(0, 0, 0);
+}
+
 float4 PSMain(PSInput input) : SV_Target
 {
 	const float4 color = colorTexture.Load(float3(input.position.xy, 0));
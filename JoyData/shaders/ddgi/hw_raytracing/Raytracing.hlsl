@@ -21,7 +21,9 @@ RaytracingAccelerationStructure g_SceneAccelerationStructure : register(t0, spac
 ConstantBuffer<EngineData> g_engineData : register(b0, space0);
 ConstantBuffer<RaytracedProbesData> raytracedProbesData : register(b1, space0);
 
-StructuredBuffer<MeshData> meshData : register(t1, space0); // size = THREADS_PER_BLOCK * BLOCK_SIZE
+StructuredBuffer<MeshData> meshData : register(t1, space0); // size = meshes count
+StructuredBuffer<uint> scheduledProbes : register(t2, space0); // size = scheduled probes count
+StructuredBuffer<ProbeRelocationData> probeRelocationData : register(t3, space0); // size = probes count
 StructuredBuffer<Vertex> objectVertices : register(t0, space1);
 StructuredBuffer<UINT1> objectIndices : register(t0, space2);
 
@@ -29,6 +31,8 @@ ConstantBuffer<StandardMaterialData> materials : register(b2, space0);
 Texture2D textures[] : register(t0, space3);
 SamplerState linearClampSampler : register(s0, space0);
 
+#include "ProbeGridInclude.hlsl"
+
 RWTexture2D<float4> colorTexture : register(u0, space0);
 RWTexture2D<float4> normalsTexture : register(u1, space0);
 RWTexture2D<float4> positionTexture : register(u2, space0);
@@ -63,13 +67,10 @@ void MyRaygenShader()
 	const float3 dir = mul(g_engineData.cameraInvView, float4(dirCamera, 0)).xyz;
 #else
 
+	// Dispatch width is scheduled probes count, rays of the probe go to the column of its place in the list
 	const uint3 id = DispatchRaysIndex();
-	const float3 probeId = float3(
-		(id.x / (raytracedProbesData.gridY * raytracedProbesData.gridZ)),
-		((id.x / raytracedProbesData.gridZ) % raytracedProbesData.gridY),
-		(id.x % raytracedProbesData.gridZ)
-	);
-	const float3 origin = raytracedProbesData.gridMin + probeId * raytracedProbesData.cellSize;
+	const uint probeIndex = scheduledProbes[id.x] & ~DDGI_PROBE_RESET_FLAG;
+	const float3 origin = GetProbeGridPosition(probeIndex) + probeRelocationData[probeIndex].offset;
 	const float3 dir = sphericalFibonacci(id.y, DDGI_RAYS_COUNT);
 
 #endif
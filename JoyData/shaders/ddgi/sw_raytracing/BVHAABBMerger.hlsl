@@ -3,14 +3,14 @@
 
 ConstantBuffer<BVHConstructorData> data : register(b0);
 
-StructuredBuffer<uint> sortedTriangleIndices; // size = THREADS_PER_BLOCK * BLOCK_SIZE
-StructuredBuffer<AABB> triangleAABB; // size = THREADS_PER_BLOCK * BLOCK_SIZE
+StructuredBuffer<uint> sortedTriangleIndices; // size = trianglesCount
+StructuredBuffer<AABB> triangleAABB; // size = trianglesCount
 
-StructuredBuffer<InternalNode> internalNodes; // size = THREADS_PER_BLOCK * BLOCK_SIZE - 1
-StructuredBuffer<LeafNode> leafNodes; // size = THREADS_PER_BLOCK * BLOCK_SIZE
+StructuredBuffer<InternalNode> internalNodes; // size = trianglesCount - 1
+StructuredBuffer<LeafNode> leafNodes; // size = trianglesCount
 
-RWStructuredBuffer<uint> atomicsData; // size = THREADS_PER_BLOCK * BLOCK_SIZE 
-RWStructuredBuffer<AABB> BVHData; // size = THREADS_PER_BLOCK * BLOCK_SIZE - 1
+RWStructuredBuffer<uint> atomicsData; // size = trianglesCount 
+RWStructuredBuffer<AABB> BVHData; // size = trianglesCount - 1
 
 
 inline AABB MergeAABB(AABB left, AABB right)
@@ -45,9 +45,12 @@ void CSMain(uint3 id : SV_DispatchThreadID)
         uint parent = leafNodes[threadId].parent;
         while (parent != 0xFFFFFFFF)
         {
+            // Every node is visited exactly twice per merge, so counters stay even between dispatches
+            // and the merge can be run again (refit, rebuild) without clearing them.
+            // The first thread coming to the node sees an even value and stops
             uint old = 0;
-            InterlockedCompareExchange(atomicsData[parent], 0, 1, old);
-            if (old == 0)
+            InterlockedAdd(atomicsData[parent], 1, old);
+            if ((old & 1) == 0)
             {
                 break;
             }
@@ -3,24 +3,33 @@
 
 ConstantBuffer<BVHConstructorData> data : register(b0);
 
-StructuredBuffer<uint> sortedMortonCodes; // size = THREADS_PER_BLOCK * BLOCK_SIZE
+StructuredBuffer<uint2> sortedMortonCodes; // 64 bit codes, x is low word. size = trianglesCount
 
-RWStructuredBuffer<InternalNode> internalNodes; // size = THREADS_PER_BLOCK * BLOCK_SIZE - 1
-RWStructuredBuffer<LeafNode> leafNodes; // size = THREADS_PER_BLOCK * BLOCK_SIZE
+RWStructuredBuffer<InternalNode> internalNodes; // size = trianglesCount - 1
+RWStructuredBuffer<LeafNode> leafNodes; // size = trianglesCount
 
 inline uint clz32(uint v)
 {
     return 31 - firstbithigh(v);
 }
 
+inline uint clz64(uint2 v)
+{
+    return v.y != 0 ? clz32(v.y) : 32 + clz32(v.x);
+}
+
+// Length of the common prefix of two keys. Codes may repeat, equal codes
+// are compared by their indices as if the index was appended to the code
 inline int delta(int x, int y, int numObjects)
 {
     if (x >= 0 && x <= numObjects - 1 && y >= 0 && y <= numObjects - 1)
     {
-        const uint x_code = sortedMortonCodes[x];
-        const uint y_code = sortedMortonCodes[y];
-        // we guarantee that x_code != y_code
-        return clz32(x_code ^ y_code);
+        const uint2 x_code = sortedMortonCodes[x];
+        const uint2 y_code = sortedMortonCodes[y];
+        const uint2 codeDifference = x_code ^ y_code;
+        if (any(codeDifference))
+            return clz64(codeDifference);
+        return 64 + clz32(x ^ y);
     }
     return -1;
 }
@@ -44,20 +53,13 @@ inline int2 DetermineRange(int numObjects, int idx)
     return range;
 }
 
-inline int FindSplit(int first, int last)
+inline int FindSplit(int first, int last, int numObjects)
 {
-    // Identical Morton codes => split the range in the middle.
-
-    const uint firstCode = sortedMortonCodes[first];
-    const uint lastCode = sortedMortonCodes[last];
-
-    if (firstCode == lastCode)
-        return (first + last) >> 1;
-
     // Calculate the number of highest bits that are the same
-    // for all objects, using the count-leading-zeros intrinsic.
+    // for all objects. Identical codes continue the prefix with index bits,
+    // so they are split by index the same way as any other keys.
 
-    const int commonPrefix = clz32(firstCode ^ lastCode);
+    const int commonPrefix = delta(first, last, numObjects);
 
     // Use binary search to find where the next bit differs.
     // Specifically, we are looking for the highest object that
@@ -73,8 +75,7 @@ inline int FindSplit(int first, int last)
 
         if (newSplit < last)
         {
-            const uint splitCode = sortedMortonCodes[newSplit];
-            const int splitPrefix = clz32(firstCode ^ splitCode);
+            const int splitPrefix = delta(first, newSplit, numObjects);
             if (splitPrefix > commonPrefix)
                 split = newSplit; // accept proposal
         }
@@ -104,7 +105,7 @@ void CSMain(uint3 id : SV_DispatchThreadID)
 
         // Determine where to split the range.
 
-        const int split = FindSplit(first, last);
+        const int split = FindSplit(first, last, _trianglesCount);
 
         internalNodes[threadId].index = threadId;
 
@@ -1,27 +1,22 @@
 // BLOCK SUM
 #include "CommonEngineStructs.h"
 
-RWStructuredBuffer<uint> data; // size = BUCKET_SIZE * BLOCK_SIZE
-RWStructuredBuffer<uint> blockSumsData; // size = BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE)
+// Exclusive scan of the last scan level, it always fits one group.
+// Levels below it are finished by GlobalScan, from the top level down
+ConstantBuffer<BufferScanData> scanData : register(b0);
+
+RWStructuredBuffer<uint> blockSumsData; // size = scanData.elementsCount <= THREADS_PER_BLOCK
 
 groupshared uint scanTile[THREADS_PER_BLOCK / WARP_SIZE];
-groupshared uint blockSumsTile[(BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE)) / WARP_SIZE];
 
-[numthreads(BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE),1,1)]
+[numthreads(THREADS_PER_BLOCK,1,1)]
 void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
 {
-    // our data has THREADS_PER_BLOCK * BLOCK_SIZE elements.
-    // each block in LocalRadixSort step produces 2 ^ RADIX = BUCKET_SIZE elements
-    // so, whole number of sizesData array will be BLOCK_SIZE * BUCKET_SIZE elements 
-    // here each block process THREADS_PER_BLOCK elements
-    // so, number of blocks will be BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE)
-    const uint blockSize = BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE);
-
     const uint threadId = tid.x;
     const uint warpId = threadId / WARP_SIZE;
     const uint laneId = threadId % WARP_SIZE;
 
-    const uint element = blockSumsData[threadId];
+    const uint element = threadId < scanData.elementsCount ? blockSumsData[threadId] : 0;
     AllMemoryBarrierWithGroupSync();
     const uint wavePrefix = WavePrefixSum(element);
 
@@ -31,7 +26,7 @@ void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
     }
     GroupMemoryBarrierWithGroupSync();
 
-    if (threadId < blockSize / WARP_SIZE)
+    if (threadId < THREADS_PER_BLOCK / WARP_SIZE)
     {
         const uint warpSum = scanTile[threadId];
         GroupMemoryBarrier();
@@ -40,5 +35,8 @@ void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
     }
 
     GroupMemoryBarrierWithGroupSync();
-    blockSumsData[threadId] = wavePrefix + scanTile[warpId];
+    if (threadId < scanData.elementsCount)
+    {
+        blockSumsData[threadId] = wavePrefix + scanTile[warpId];
+    }
 }
\ No newline at end of file
@@ -3,36 +3,46 @@
 
 ConstantBuffer<BufferSorterData> data : register(b0);
 
-StructuredBuffer<uint> sortedBlocksKeysData; // size = THREADS_PER_BLOCK * BLOCK_SIZE
-StructuredBuffer<uint> sortedBlocksValuesData; // size = THREADS_PER_BLOCK * BLOCK_SIZE
+StructuredBuffer<uint2> sortedBlocksKeysData; // size = THREADS_PER_BLOCK * blocksCount
+StructuredBuffer<uint> sortedBlocksValuesData; // size = THREADS_PER_BLOCK * blocksCount
 
-StructuredBuffer<uint> offsetsData; // size = BLOCK_SIZE * BUCKET_SIZE
-StructuredBuffer<uint> sizesData; // size = BLOCK_SIZE * BUCKET_SIZE
+StructuredBuffer<uint> offsetsData; // size = blocksCount * BUCKET_SIZE
+StructuredBuffer<uint> sizesData; // size = blocksCount * BUCKET_SIZE
 
-RWStructuredBuffer<uint> sortedKeysData; // size = THREADS_PER_BLOCK * BLOCK_SIZE
-RWStructuredBuffer<uint> sortedValuesData; // size = THREADS_PER_BLOCK * BLOCK_SIZE
+RWStructuredBuffer<uint2> sortedKeysData; // size = dataLength
+RWStructuredBuffer<uint> sortedValuesData; // size = dataLength
 
 groupshared uint offsetsTile[BUCKET_SIZE];
 groupshared uint sizesTile[BUCKET_SIZE];
 
+// Bits of the key starting from shift, same as in LocalRadixSort.hlsl
+inline uint ShiftKey(uint2 key, uint shift)
+{
+    return shift < 32 ? key.x >> shift : key.y >> (shift - 32);
+}
+
 [numthreads(THREADS_PER_BLOCK,1,1)]
 void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
 {
     const uint threadId = tid.x;
     const uint groupId = gid.x;
 
-    const uint key = sortedBlocksKeysData[groupId * THREADS_PER_BLOCK + threadId];
+    const uint2 key = sortedBlocksKeysData[groupId * THREADS_PER_BLOCK + threadId];
     const uint value = sortedBlocksValuesData[groupId * THREADS_PER_BLOCK + threadId];
     if (threadId < BUCKET_SIZE)
     {
         offsetsTile[threadId] = offsetsData[groupId * BUCKET_SIZE + threadId];
-        sizesTile[threadId] = sizesData[groupId + threadId * BLOCK_SIZE];
+        sizesTile[threadId] = sizesData[groupId + threadId * data.blocksCount];
     }
     AllMemoryBarrierWithGroupSync();
 
-    const uint radix = (key >> data.bitOffset) & (BUCKET_SIZE - 1);
+    const uint radix = ShiftKey(key, data.bitOffset) & (BUCKET_SIZE - 1);
     const uint indexOutput = sizesTile[radix] + threadId - offsetsTile[radix];
     
-    sortedKeysData[indexOutput] = key;
-    sortedValuesData[indexOutput] = value;
+    // Padding keys of the last block are the largest, so they are the only ones past dataLength
+    if (indexOutput < data.dataLength)
+    {
+        sortedKeysData[indexOutput] = key;
+        sortedValuesData[indexOutput] = value;
+    }
 }
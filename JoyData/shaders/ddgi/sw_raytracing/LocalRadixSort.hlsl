@@ -3,18 +3,18 @@
 
 ConstantBuffer<BufferSorterData> data : register(b0);
 
-StructuredBuffer<uint> keysData : register(t0); // size = THREADS_PER_BLOCK * BLOCK_SIZE
-StructuredBuffer<uint> valuesData : register(t1); // size = THREADS_PER_BLOCK * BLOCK_SIZE
+StructuredBuffer<uint2> keysData : register(t0); // 64 bit keys, x is low word. size = dataLength
+StructuredBuffer<uint> valuesData : register(t1); // size = dataLength
 
 
-RWStructuredBuffer<uint> sortedBlocksKeysData : register(u0); // size = THREADS_PER_BLOCK * BLOCK_SIZE
-RWStructuredBuffer<uint> sortedBlocksValuesData : register(u1); // size = THREADS_PER_BLOCK * BLOCK_SIZE
+RWStructuredBuffer<uint2> sortedBlocksKeysData : register(u0); // size = THREADS_PER_BLOCK * blocksCount
+RWStructuredBuffer<uint> sortedBlocksValuesData : register(u1); // size = THREADS_PER_BLOCK * blocksCount
 
-RWStructuredBuffer<uint> offsetsData : register(u2); // size = BLOCK_SIZE * BUCKET_SIZE
-RWStructuredBuffer<uint> sizesData : register(u3); // size = BLOCK_SIZE * BUCKET_SIZE
+RWStructuredBuffer<uint> offsetsData : register(u2); // size = blocksCount * BUCKET_SIZE
+RWStructuredBuffer<uint> sizesData : register(u3); // size = blocksCount * BUCKET_SIZE
 
 
-groupshared uint sortTile[THREADS_PER_BLOCK];
+groupshared uint2 sortTile[THREADS_PER_BLOCK];
 groupshared uint valuesTile[THREADS_PER_BLOCK];
 
 groupshared uint scanTile[THREADS_PER_BLOCK / WARP_SIZE];
@@ -25,6 +25,12 @@ groupshared uint offsetsTile[BUCKET_SIZE];
 groupshared uint sizesTile[BUCKET_SIZE];
 
 
+// Bits of the key starting from shift. RADIX divides 32, so a digit never crosses the words
+inline uint ShiftKey(uint2 key, uint shift)
+{
+	return shift < 32 ? key.x >> shift : key.y >> (shift - 32);
+}
+
 inline uint IntraBlockScan(uint threadId, bool pred0)
 {
 	const uint warpIdx = threadId / WARP_SIZE;
@@ -55,8 +61,11 @@ void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
 	const uint threadId = tid.x;
 	const uint groupId = gid.x;
 
-	sortTile[threadId] = keysData[groupId * THREADS_PER_BLOCK + threadId];
-	valuesTile[threadId] = valuesData[groupId * THREADS_PER_BLOCK + threadId];
+	// The last block is padded with the largest keys, they stay after all the data
+	const uint dataIndex = groupId * THREADS_PER_BLOCK + threadId;
+	const bool isData = dataIndex < data.dataLength;
+	sortTile[threadId] = isData ? keysData[dataIndex] : uint2(0xFFFFFFFF, 0xFFFFFFFF);
+	valuesTile[threadId] = isData ? valuesData[dataIndex] : 0xFFFFFFFF;
 
 	AllMemoryBarrierWithGroupSync();
 
@@ -64,10 +73,10 @@ void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
 	{
 		uint predResult = 0;
 
-		const uint key = sortTile[threadId];
+		const uint2 key = sortTile[threadId];
 		const uint value = valuesTile[threadId];
 
-		const bool pred = (key >> shift) & 1;
+		const bool pred = ShiftKey(key, shift) & 1;
 
 		predResult += pred;
 
@@ -91,14 +100,14 @@ void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
 
 	GroupMemoryBarrierWithGroupSync();
 
-	const uint key = sortTile[threadId];
+	const uint2 key = sortTile[threadId];
 	const uint value = valuesTile[threadId];
 	GroupMemoryBarrierWithGroupSync();
 
 	sortedBlocksKeysData[groupId * THREADS_PER_BLOCK + threadId] = key;
 	sortedBlocksValuesData[groupId * THREADS_PER_BLOCK + threadId] = value;
 
-	radixTile[threadId] = (key >> data.bitOffset) & (BUCKET_SIZE - 1);
+	radixTile[threadId] = ShiftKey(key, data.bitOffset) & (BUCKET_SIZE - 1);
 
 	if (threadId < BUCKET_SIZE)
 	{
@@ -128,6 +137,6 @@ void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
 	if (threadId < BUCKET_SIZE)
 	{
 		offsetsData[groupId * BUCKET_SIZE + threadId] = offsetsTile[threadId];
-		sizesData[groupId + threadId * BLOCK_SIZE] = sizesTile[threadId];
+		sizesData[groupId + threadId * data.blocksCount] = sizesTile[threadId];
 	}
 }
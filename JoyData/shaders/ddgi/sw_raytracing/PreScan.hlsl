@@ -1,11 +1,13 @@
 // PRE SCAN
 #include "CommonEngineStructs.h"
 
-RWStructuredBuffer<uint> data; // size = BUCKET_SIZE * BLOCK_SIZE
-RWStructuredBuffer<uint> blockSumsData; // size = BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE)
+// Exclusive scan of every THREADS_PER_BLOCK elements of one scan level, group totals go to the next level
+ConstantBuffer<BufferScanData> scanData : register(b0);
+
+RWStructuredBuffer<uint> data; // size = scanData.elementsCount
+RWStructuredBuffer<uint> blockSumsData; // size = scanData.elementsCount / THREADS_PER_BLOCK, rounded up
 
 groupshared uint scanTile[THREADS_PER_BLOCK / WARP_SIZE];
-groupshared uint blockSumsTile[(BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE)) / WARP_SIZE];
 
 
 [numthreads(THREADS_PER_BLOCK,1,1)]
@@ -16,7 +18,8 @@ void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
     const uint warpId = threadId / WARP_SIZE;
     const uint laneId = threadId % WARP_SIZE;
 
-    const uint element = data[groupId * THREADS_PER_BLOCK + threadId];
+    const uint elementIndex = groupId * THREADS_PER_BLOCK + threadId;
+    const uint element = elementIndex < scanData.elementsCount ? data[elementIndex] : 0;
     AllMemoryBarrierWithGroupSync();
     const uint wavePrefix = WavePrefixSum(element);
 
@@ -40,5 +43,8 @@ void CSMain(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID)
     }
 
     GroupMemoryBarrierWithGroupSync();
-    data[groupId * THREADS_PER_BLOCK + threadId] = wavePrefix + scanTile[warpId];
+    if (elementIndex < scanData.elementsCount)
+    {
+        data[elementIndex] = wavePrefix + scanTile[warpId];
+    }
 }
\ No newline at end of file
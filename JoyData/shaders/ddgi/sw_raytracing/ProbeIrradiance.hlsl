@@ -1,12 +1,19 @@
 #include "CommonEngineStructs.h"
 
 ConstantBuffer<RaytracedProbesData> raytracedProbesData;
+StructuredBuffer<uint> scheduledProbes; // size = scheduled probes count, one group per probe
+StructuredBuffer<ProbeRelocationData> probeRelocationData; // size = probes count
 
 Texture2D shadedColorTexture;
 Texture2D positionsTexture;
 
 RWTexture2D<float3> probeIrradianceTexture;
 RWTexture2D<float2> probeDepthTexture;
+RWStructuredBuffer<float> probeChangeData; // size = probes count
+
+#include "ProbeGridInclude.hlsl"
+
+groupshared float probeTexelChange[(DDGI_PROBE_DATA_RESOLUTION + 2) * (DDGI_PROBE_DATA_RESOLUTION + 2)];
 
 float2 signNotZero(float2 v)
 {
@@ -23,6 +30,11 @@ float3 oct_to_float32x3(float2 e)
 	return normalize(v);
 }
 
+inline float luminance(float3 color)
+{
+	return dot(color, float3(0.2126, 0.7152, 0.0722));
+}
+
 inline float sqr(float v)
 {
 	return v * v;
@@ -80,19 +92,17 @@ inline int2 GetPixelId(int2 realPixelId)
 }
 
 [numthreads(DDGI_PROBE_DATA_RESOLUTION + 2, DDGI_PROBE_DATA_RESOLUTION + 2, 1)]
-void CSMain(uint3 groupId : SV_GroupID, uint3 groupThreadId : SV_GroupThreadID)
+void CSMain(uint3 groupId : SV_GroupID, uint3 groupThreadId : SV_GroupThreadID, uint groupIndex : SV_GroupIndex)
 {
-	const float3 probePosition = raytracedProbesData.gridMin + float3(groupId) * raytracedProbesData.cellSize;
+	// Rays of the probe are in the column of its place in the scheduled list
+	const uint probeColumn = groupId.x;
+	// Probes which just entered their cascade hold irradiance of another place, it's replaced instead of blended
+	const bool isReset = (scheduledProbes[probeColumn] & DDGI_PROBE_RESET_FLAG) != 0;
+	const uint probeIndex = scheduledProbes[probeColumn] & ~DDGI_PROBE_RESET_FLAG;
 
-	const uint probeId1D =
-		groupId.x * raytracedProbesData.gridY * raytracedProbesData.gridZ +
-		groupId.y * raytracedProbesData.gridZ +
-		groupId.z;
+	const float3 probePosition = GetProbeGridPosition(probeIndex) + probeRelocationData[probeIndex].offset;
 
-	const uint2 probeId2D = uint2(
-		groupId.x + raytracedProbesData.gridX * groupId.y,
-		groupId.z
-	);
+	const uint2 probeId2D = GetProbeTextureId(probeIndex);
 
 	const uint2 probeRealPixelID = groupThreadId.xy;
 
@@ -109,8 +119,8 @@ void CSMain(uint3 groupId : SV_GroupID, uint3 groupThreadId : SV_GroupThreadID)
 	for (int i = 0; i < DDGI_RAYS_COUNT; i++)
 	{
 		const float3 rayDir = sphericalFibonacci(i, DDGI_RAYS_COUNT);
-		const float3 rayRadiance = shadedColorTexture.Load(int3(probeId1D, i, 0)).rgb;
-		const float3 rayPosition = positionsTexture.Load(int3(probeId1D, i, 0)).rgb;
+		const float3 rayRadiance = shadedColorTexture.Load(int3(probeColumn, i, 0)).rgb;
+		const float3 rayPosition = positionsTexture.Load(int3(probeColumn, i, 0)).rgb;
 
 		const float cosine = dot(direction, rayDir);
 		const float weight = max(0, cosine);
@@ -134,9 +144,24 @@ void CSMain(uint3 groupId : SV_GroupID, uint3 groupThreadId : SV_GroupThreadID)
 	}
 
 	const float3 prevIrradiance = probeIrradianceTexture[probeId2D * (DDGI_PROBE_DATA_RESOLUTION + 2) + probeRealPixelID];
-	const float3 newIrradiance = lerp(prevIrradiance, resultIrradiance, 0.25);
+	const float3 newIrradiance = isReset ? resultIrradiance : lerp(prevIrradiance, resultIrradiance, 0.25);
 
 	probeIrradianceTexture[probeId2D * (DDGI_PROBE_DATA_RESOLUTION + 2) + probeRealPixelID] = newIrradiance;
 
 	probeDepthTexture[probeId2D * (DDGI_PROBE_DATA_RESOLUTION + 2) + probeRealPixelID] = resultDepth;
+
+	// Mean relative change of texels drives the update priority of the probe on cpu
+	probeTexelChange[groupIndex] = isReset ? 0 : abs(luminance(resultIrradiance) - luminance(prevIrradiance)) / max(luminance(prevIrradiance), 0.001);
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if (groupIndex == 0)
+	{
+		float change = 0;
+		for (uint texel = 0; texel < (DDGI_PROBE_DATA_RESOLUTION + 2) * (DDGI_PROBE_DATA_RESOLUTION + 2); texel++)
+		{
+			change += probeTexelChange[texel];
+		}
+		probeChangeData[probeIndex] = change / ((DDGI_PROBE_DATA_RESOLUTION + 2) * (DDGI_PROBE_DATA_RESOLUTION + 2));
+	}
 }
@@ -4,14 +4,16 @@
 
 ConstantBuffer<EngineData> engineData;
 ConstantBuffer<RaytracedProbesData> raytracedProbesData;
+StructuredBuffer<uint> scheduledProbes; // size = scheduled probes count
+StructuredBuffer<ProbeRelocationData> probeRelocationData; // size = probes count
 
-StructuredBuffer<uint> sortedTriangleIndices; // size = THREADS_PER_BLOCK * BLOCK_SIZE
-StructuredBuffer<AABB> triangleAABB; // size = THREADS_PER_BLOCK * BLOCK_SIZE
-StructuredBuffer<InternalNode> internalNodes; // size = THREADS_PER_BLOCK * BLOCK_SIZE - 1
-StructuredBuffer<LeafNode> leafNodes; // size = THREADS_PER_BLOCK * BLOCK_SIZE
-StructuredBuffer<AABB> bvhData; // size = THREADS_PER_BLOCK * BLOCK_SIZE - 1
-StructuredBuffer<TrianglePayload> trianglePayloadData; // size = THREADS_PER_BLOCK * BLOCK_SIZE
-StructuredBuffer<MeshData> meshData; // size = THREADS_PER_BLOCK * BLOCK_SIZE
+StructuredBuffer<uint> sortedTriangleIndices; // size = trianglesCount
+StructuredBuffer<AABB> triangleAABB; // size = trianglesCount
+StructuredBuffer<InternalNode> internalNodes; // size = trianglesCount - 1
+StructuredBuffer<LeafNode> leafNodes; // size = trianglesCount
+StructuredBuffer<AABB> bvhData; // size = trianglesCount - 1
+StructuredBuffer<TrianglePayload> trianglePayloadData; // size = trianglesCount
+StructuredBuffer<MeshData> meshData; // size = meshes count
 
 StructuredBuffer<MAT4> objectMatricesData;
 
@@ -23,6 +25,8 @@ ConstantBuffer<StandardMaterialData> materials;
 Texture2D textures[] : register(t0, space3);
 SamplerState linearClampSampler;
 
+#include "ProbeGridInclude.hlsl"
+
 RWTexture2D<float4> colorTexture;
 RWTexture2D<float4> normalsTexture;
 RWTexture2D<float4> positionTexture;
@@ -207,16 +211,13 @@ void CSMain(uint3 id : SV_DispatchThreadID)
 
 #else
 
+// One group per scheduled probe, its rays go to the column of its place in the list
 [numthreads(DDGI_RAYS_COUNT,1,1)]
 void CSMain(uint3 groupId : SV_GroupID, uint3 groupThreadId : SV_GroupThreadID)
 {
-	const uint2 id = uint2(
-		groupId.x * raytracedProbesData.gridY * raytracedProbesData.gridZ +
-		groupId.y * raytracedProbesData.gridZ +
-		groupId.z,
-		groupThreadId.x
-	);
-	const float3 origin = raytracedProbesData.gridMin + float3(groupId) * raytracedProbesData.cellSize;
+	const uint2 id = uint2(groupId.x, groupThreadId.x);
+	const uint probeIndex = scheduledProbes[groupId.x] & ~DDGI_PROBE_RESET_FLAG;
+	const float3 origin = GetProbeGridPosition(probeIndex) + probeRelocationData[probeIndex].offset;
 	const float3 dir = sphericalFibonacci(groupThreadId.x, DDGI_RAYS_COUNT);
 
 #endif
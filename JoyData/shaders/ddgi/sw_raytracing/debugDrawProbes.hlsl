@@ -2,10 +2,12 @@
 
 ConstantBuffer<ViewProjectionMatrixData> viewProjectionData : register(b0);
 ConstantBuffer<RaytracedProbesData> raytracedProbesData: register(b1);
+StructuredBuffer<ProbeRelocationData> probeRelocationData; // size = probes count
 
 Texture2D irradianceTexture;
 SamplerState linearClampSampler;
 
+#include "ProbeGridInclude.hlsl"
 
 struct PSInput
 {
@@ -23,13 +25,13 @@ PSInput VSMain(float3 position : POSITION, float3 normal : NORMAL, uint instance
 {
 	PSInput result;
 
-	const float SCALE = 1;
+	// one instance per probe of every cascade, instance id is the probe index
+	const ProbeRelocationData relocation = probeRelocationData[instanceId];
 
-	const float3 worldPosition = raytracedProbesData.gridMin + float3(
-		(instanceId % raytracedProbesData.gridX),
-		(instanceId / raytracedProbesData.gridX) % raytracedProbesData.gridY,
-		(instanceId / raytracedProbesData.gridX / raytracedProbesData.gridY % raytracedProbesData.gridZ)
-	) * raytracedProbesData.cellSize;
+	// inactive probes are drawn small
+	const float SCALE = relocation.isActive ? 1 : 0.25;
+
+	const float3 worldPosition = GetProbeGridPosition(instanceId) + relocation.offset;
 
 	const float4x4 modelMatrix = {
 		SCALE, 0, 0, worldPosition.x,
@@ -64,19 +66,9 @@ PSOutput PSMain(PSInput input) // : SV_TARGET
 {
 	PSOutput output;
 
-	const uint3 probeId3D = uint3(
-		(input.instanceId % raytracedProbesData.gridX),
-		(input.instanceId / raytracedProbesData.gridX) % raytracedProbesData.gridY,
-		(input.instanceId / raytracedProbesData.gridX / raytracedProbesData.gridY % raytracedProbesData.gridZ)
-	);
-
-	const uint2 probeId2D = uint2(
-		probeId3D.x + raytracedProbesData.gridX * probeId3D.y,
-		probeId3D.z
-	);
+	const uint2 probeId2D = GetProbeTextureId(input.instanceId);
 
-	float2 probeTextureSize = float2(raytracedProbesData.gridX * raytracedProbesData.gridY * (DDGI_PROBE_DATA_RESOLUTION + 2),
-	                                 raytracedProbesData.gridZ * (DDGI_PROBE_DATA_RESOLUTION + 2));
+	const float2 probeTextureSize = GetProbeTextureSize();
 
 	const float2 probeUV = (float32x3_to_oct(input.worldNormal) + float2(1, 1)) / 2.0 ;
 
@@ -2,7 +2,7 @@
 
 ConstantBuffer<ViewProjectionMatrixData> viewProjectionData : register(b0);
 
-StructuredBuffer<AABB> BVHData; // size = THREADS_PER_BLOCK * BLOCK_SIZE - 1
+StructuredBuffer<AABB> BVHData; // size = trianglesCount - 1
 
 struct PSInput
 {
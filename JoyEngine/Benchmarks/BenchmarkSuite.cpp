@@ -0,0 +1,191 @@
+#include "BenchmarkSuite.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <rapidjson/document.h>
+
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		double GetItemsPerSecond(const BenchmarkResult& result)
+		{
+			return result.median > 0 ? static_cast<double>(result.itemsCount) / result.median * 1000.0 : 0;
+		}
+	}
+
+	void BenchmarkSuite::Add(const char* name, uint64_t itemsCount, std::function<void()> run, std::function<void()> prepare)
+	{
+		m_cases.push_back({name, itemsCount, std::move(run), std::move(prepare), false});
+	}
+
+	void BenchmarkSuite::AddEngineCase(const char* name, uint64_t itemsCount, std::function<void()> run, std::function<void()> prepare)
+	{
+		m_cases.push_back({name, itemsCount, std::move(run), std::move(prepare), true});
+	}
+
+	void BenchmarkSuite::Run(uint32_t runsCount, const char* filter)
+	{
+		runsCount = std::max(runsCount, 1u);
+		m_results.clear();
+
+		std::vector<double> times(runsCount);
+		for (const Case& benchmarkCase : m_cases)
+		{
+			if (!IsSelected(benchmarkCase, filter)) continue;
+
+			// Warm up. Short cases without prepare are called several times in one run, so timer resolution doesn't matter
+			if (benchmarkCase.prepare) benchmarkCase.prepare();
+			auto start = std::chrono::high_resolution_clock::now();
+			benchmarkCase.run();
+			const double warmUpTime = GetMilliseconds(start);
+			const uint32_t callsCount = benchmarkCase.prepare || warmUpTime >= MinRunTime
+				                            ? 1
+				                            : static_cast<uint32_t>(std::ceil(MinRunTime / std::max(warmUpTime, 1e-6)));
+
+			for (uint32_t i = 0; i < runsCount; i++)
+			{
+				if (benchmarkCase.prepare) benchmarkCase.prepare();
+
+				start = std::chrono::high_resolution_clock::now();
+				for (uint32_t call = 0; call < callsCount; call++)
+				{
+					benchmarkCase.run();
+				}
+				times[i] = GetMilliseconds(start) / callsCount;
+			}
+			std::sort(times.begin(), times.end());
+
+			const BenchmarkResult& result = m_results.emplace_back(BenchmarkResult{
+				.name = benchmarkCase.name,
+				.itemsCount = benchmarkCase.itemsCount,
+				.runsCount = runsCount,
+				.min = times.front(),
+				.median = times[runsCount / 2],
+				.max = times.back(),
+			});
+
+			Logger::LogFormat("%-32s median %9.3f ms, min %9.3f ms, max %9.3f ms, %10.2f M items/s\n",
+			                  result.name.c_str(),
+			                  result.median,
+			                  result.min,
+			                  result.max,
+			                  GetItemsPerSecond(result) / 1e6);
+		}
+	}
+
+	bool BenchmarkSuite::HasEngineCases(const char* filter) const
+	{
+		for (const Case& benchmarkCase : m_cases)
+		{
+			if (benchmarkCase.needsEngine && IsSelected(benchmarkCase, filter)) return true;
+		}
+		return false;
+	}
+
+	bool BenchmarkSuite::WriteJson(const std::string& path) const
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file)
+		{
+			Logger::LogFormat(LogLevel::Warning, "Cannot write benchmark results to %s\n", path.c_str());
+			return false;
+		}
+
+		// Case names are plain identifiers, they are written without escaping
+		file << "{\"benchmarks\":[\n";
+		file.precision(6);
+		for (size_t i = 0; i < m_results.size(); i++)
+		{
+			const BenchmarkResult& result = m_results[i];
+			file << (i == 0 ? "" : ",\n")
+				<< R"({"name":")" << result.name
+				<< R"(","items":)" << result.itemsCount
+				<< R"(,"runs":)" << result.runsCount
+				<< R"(,"minMs":)" << result.min
+				<< R"(,"medianMs":)" << result.median
+				<< R"(,"maxMs":)" << result.max
+				<< R"(,"itemsPerSecond":)" << GetItemsPerSecond(result) << "}";
+		}
+		file << "\n]}\n";
+
+		Logger::LogFormat("Benchmark results are written to %s\n", path.c_str());
+		return true;
+	}
+
+	uint32_t BenchmarkSuite::CompareWithBaseline(const std::string& path, double threshold) const
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			Logger::LogFormat(LogLevel::Warning, "Cannot read benchmark baseline %s\n", path.c_str());
+			return 0;
+		}
+		std::stringstream data;
+		data << file.rdbuf();
+
+		rapidjson::Document json;
+		json.Parse(data.str().c_str());
+		if (json.HasParseError() || !json.IsObject() || !json.HasMember("benchmarks") || !json["benchmarks"].IsArray())
+		{
+			Logger::LogFormat("Benchmark baseline %s is not a benchmark results file\n", path.c_str());
+			return 0;
+		}
+
+		std::map<std::string, double> baselineMedians;
+		for (const auto& result : json["benchmarks"].GetArray())
+		{
+			baselineMedians[result["name"].GetString()] = result["medianMs"].GetDouble();
+		}
+
+		uint32_t regressionsCount = 0;
+		for (const BenchmarkResult& result : m_results)
+		{
+			const auto it = baselineMedians.find(result.name);
+			if (it == baselineMedians.end())
+			{
+				Logger::LogFormat("%-32s %9.3f ms, not in baseline\n", result.name.c_str(), result.median);
+				continue;
+			}
+
+			const double change = it->second > 0 ? result.median / it->second - 1.0 : 0;
+			const bool isRegression = change > threshold;
+			regressionsCount += isRegression ? 1 : 0;
+			Logger::LogFormat("%-32s %9.3f ms, baseline %9.3f ms, %+7.1f%%%s\n",
+			                  result.name.c_str(),
+			                  result.median,
+			                  it->second,
+			                  change * 100.0,
+			                  isRegression ? "  REGRESSION" : "");
+			baselineMedians.erase(it);
+		}
+
+		for (const auto& [name, median] : baselineMedians)
+		{
+			Logger::LogFormat("%-32s baseline %9.3f ms, not run\n", name.c_str(), median);
+		}
+
+		Logger::LogFormat("%u of %zu benchmarks are slower than baseline by more than %.0f%%\n",
+		                  regressionsCount,
+		                  m_results.size(),
+		                  threshold * 100.0);
+		return regressionsCount;
+	}
+
+	bool BenchmarkSuite::IsSelected(const Case& benchmarkCase, const char* filter)
+	{
+		return filter == nullptr || benchmarkCase.name.find(filter) != std::string::npos;
+	}
+}
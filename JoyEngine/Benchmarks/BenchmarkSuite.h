@@ -0,0 +1,76 @@
+#ifndef BENCHMARK_SUITE_H
+#define BENCHMARK_SUITE_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace JoyEngine
+{
+	struct BenchmarkResult
+	{
+		std::string name;
+		uint64_t itemsCount; // processed by one run
+		uint32_t runsCount;
+		double min; // ms of one run
+		double median;
+		double max;
+	};
+
+	// Named cpu benchmarks of engine code, modules register their cases in AddEngineBenchmarks.
+	// Cases that need the engine are run on a headless one, the others don't need a window or a device.
+	// Every case is run once to warm up and then runsCount times, cases are compared by median run time
+	class BenchmarkSuite
+	{
+	public:
+		static constexpr double MinRunTime = 2.0; // ms, shorter cases without prepare are called several times per run
+
+		// prepare is called before every run and is not timed
+		void Add(const char* name, uint64_t itemsCount, std::function<void()> run, std::function<void()> prepare = nullptr);
+		// WorldManager and the other managers exist while the case runs
+		void AddEngineCase(const char* name, uint64_t itemsCount, std::function<void()> run, std::function<void()> prepare = nullptr);
+
+		// Runs cases which names contain filter, all of them when filter is nullptr
+		void Run(uint32_t runsCount = 15, const char* filter = nullptr);
+
+		// {"benchmarks":[{"name":"...","items":N,"runs":N,"minMs":T,"medianMs":T,"maxMs":T,"itemsPerSecond":N},...]}
+		bool WriteJson(const std::string& path) const;
+
+		// Logs median change of every case against results written by WriteJson before.
+		// Returns count of cases that became slower by more than threshold
+		uint32_t CompareWithBaseline(const std::string& path, double threshold = 0.1) const;
+
+		[[nodiscard]] const std::vector<BenchmarkResult>& GetResults() const noexcept { return m_results; }
+		[[nodiscard]] bool HasEngineCases(const char* filter = nullptr) const;
+
+		// Allocators, scene tree, transform hierarchy, light clusters, jmath kernels, hashing, scene JSON, log queue,
+		// radix sort and morton codes. Their sources don't include D3D12 headers
+		static void AddCpuBenchmarks(BenchmarkSuite& suite);
+		// Cpu cases and the cases of engine modules
+		static void AddEngineBenchmarks(BenchmarkSuite& suite);
+
+		// Entry point of JoyEngine.exe -benchmark and JoyEngineTests.exe -benchmark. Writes results to resultsPath
+		// and returns count of cases that are slower than in baselinePath, 0 when it is empty
+		static uint32_t RunEngineBenchmarks(const std::string& resultsPath, const std::string& baselinePath, const char* filter = nullptr);
+		// Same for the cpu cases only, entry point of JoyEngineCpuBenchmarks
+		static uint32_t RunCpuBenchmarks(const std::string& resultsPath, const std::string& baselinePath, const char* filter = nullptr);
+
+	private:
+		struct Case
+		{
+			std::string name;
+			uint64_t itemsCount;
+			std::function<void()> run;
+			std::function<void()> prepare;
+			bool needsEngine;
+		};
+
+		[[nodiscard]] static bool IsSelected(const Case& benchmarkCase, const char* filter);
+
+		std::vector<Case> m_cases;
+		std::vector<BenchmarkResult> m_results;
+	};
+}
+
+#endif // BENCHMARK_SUITE_H
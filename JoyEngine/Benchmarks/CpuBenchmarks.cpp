@@ -0,0 +1,433 @@
+#include "BenchmarkSuite.h"
+
+#include <atomic>
+#include <bit>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <rapidjson/document.h>
+
+#include "Common/HashDefs.h"
+#include "Common/Allocators/LinearAllocator.h"
+#include "Common/Allocators/PoolAllocator.h"
+#include "Common/Math/MathBatch.h"
+#include "RenderManager/LightSystems/LightClusters.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuBVHBuilder.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuRadixSorter.h"
+#include "SceneManager/TreeStorage.h"
+#include "Utils/Log.h"
+#include "Utils/LogQueue.h"
+
+// Only the sources that don't need D3D12 or Windows are used here, JoyEngineCpuBenchmarks of CMakeLists.txt
+// is built from them on any platform
+
+namespace JoyEngine
+{
+	namespace
+	{
+		// Results of the runs are added here, so the compiler can't drop the work
+		std::atomic<uint64_t> g_benchmarkSink = 0;
+
+		template <typename T>
+		void Consume(T value)
+		{
+			if constexpr (std::is_floating_point_v<T>)
+			{
+				g_benchmarkSink.fetch_add(std::bit_cast<uint32_t>(value), std::memory_order_relaxed);
+			}
+			else
+			{
+				g_benchmarkSink.fetch_add(static_cast<uint64_t>(value), std::memory_order_relaxed);
+			}
+		}
+
+		// Same world file as WorldManager loads, relative to the working directory like DataManager data path
+		constexpr const char* benchmarkScenePath = "JoyData/scenes/test_scene.scene";
+
+		class BenchmarkTreeNode : public TreeEntry<BenchmarkTreeNode>
+		{
+		public:
+			explicit BenchmarkTreeNode(BenchmarkTreeNode* parent)
+			{
+				m_parent = parent;
+				if (parent != nullptr)
+				{
+					m_nextSibling = parent->m_firstChild;
+					parent->m_firstChild = this;
+				}
+			}
+		};
+
+		void AddAllocatorBenchmarks(BenchmarkSuite& suite)
+		{
+			constexpr uint32_t allocationsCount = 1 << 16;
+			auto linearAllocator = std::make_shared<std::unique_ptr<LinearAllocator>>();
+			suite.Add("LinearAllocator/Allocate", allocationsCount, [linearAllocator]()
+			          {
+				          uint64_t offsets = 0;
+				          for (uint32_t i = 0; i < allocationsCount; i++)
+				          {
+					          offsets += (*linearAllocator)->Allocate(64 + (i & 7) * 32);
+				          }
+				          Consume(offsets);
+			          }, [linearAllocator]()
+			          {
+				          *linearAllocator = std::make_unique<LinearAllocator>(uint64_t(1) << 30, 256);
+			          });
+
+			constexpr uint32_t poolSize = 1 << 14;
+			auto poolAllocator = std::make_shared<PoolAllocator<poolSize>>();
+			auto poolIndices = std::make_shared<std::vector<uint32_t>>(poolSize);
+			suite.Add("PoolAllocator/AllocateFree", poolSize, [poolAllocator, poolIndices]()
+			{
+				for (uint32_t i = 0; i < poolSize; i++)
+				{
+					(*poolIndices)[i] = poolAllocator->Allocate();
+				}
+				for (uint32_t i = poolSize; i > 0; i--)
+				{
+					poolAllocator->Free((*poolIndices)[i - 1]);
+				}
+				Consume((*poolIndices)[poolSize / 2]);
+			});
+		}
+
+		void AddSceneBenchmarks(BenchmarkSuite& suite)
+		{
+			constexpr uint32_t nodesCount = 1 << 14;
+			constexpr uint32_t childrenCount = 4; // per node, parents are always before their children
+
+			suite.Add("TreeStorage/CreateClear", nodesCount, []()
+			{
+				TreeStorage<BenchmarkTreeNode, nodesCount> storage;
+				std::vector<BenchmarkTreeNode*> nodes(nodesCount);
+				for (uint32_t i = 0; i < nodesCount; i++)
+				{
+					nodes[i] = storage.Create<BenchmarkTreeNode>(i == 0 ? nullptr : nodes[(i - 1) / childrenCount]);
+				}
+				Consume(reinterpret_cast<uintptr_t>(nodes.back()->GetParent()));
+				storage.Clear();
+			});
+
+			// The same math as Transform::UpdateThisTransformMatrix over the whole hierarchy
+			struct TransformHierarchy
+			{
+				std::vector<jmath::xvec4> positions;
+				std::vector<jmath::quat> rotations;
+				std::vector<jmath::xvec4> scales;
+				std::vector<uint32_t> parents;
+				std::vector<jmath::mat4x4> matrices;
+			};
+			auto hierarchy = std::make_shared<TransformHierarchy>();
+			std::mt19937 generator(1);
+			std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+			for (uint32_t i = 0; i < nodesCount; i++)
+			{
+				hierarchy->positions.push_back(jmath::loadPosition(jmath::vec3(distribution(generator), distribution(generator), distribution(generator))));
+				hierarchy->rotations.push_back(jmath::eulerToQuat(jmath::vec3(distribution(generator), distribution(generator), distribution(generator))));
+				hierarchy->scales.push_back(jmath::xone);
+				hierarchy->parents.push_back(i == 0 ? UINT32_MAX : (i - 1) / childrenCount);
+			}
+			hierarchy->matrices.resize(nodesCount);
+
+			suite.Add("Transform/HierarchyUpdate", nodesCount, [hierarchy]()
+			{
+				for (uint32_t i = 0; i < nodesCount; i++)
+				{
+					jmath::mat4x4 mat = jmath::trs(hierarchy->positions[i], hierarchy->rotations[i], hierarchy->scales[i]);
+					if (hierarchy->parents[i] != UINT32_MAX)
+					{
+						mat = jmath::mul(mat, hierarchy->matrices[hierarchy->parents[i]]);
+					}
+					hierarchy->matrices[i] = mat;
+				}
+				Consume(jmath::toVec3(hierarchy->matrices.back().r[3]).x);
+			});
+
+			std::ifstream sceneFile(benchmarkScenePath, std::ios::binary);
+			if (!sceneFile)
+			{
+				Logger::LogFormat("Scene JSON benchmark is skipped, %s is not found\n", benchmarkScenePath);
+				return;
+			}
+			std::stringstream sceneData;
+			sceneData << sceneFile.rdbuf();
+			auto sceneJson = std::make_shared<std::string>(sceneData.str());
+
+			constexpr uint32_t parsesCount = 256;
+			suite.Add("Json/SceneParse", parsesCount * sceneJson->size(), [sceneJson]()
+			{
+				for (uint32_t i = 0; i < parsesCount; i++)
+				{
+					// Same flags as DataManager::GetSerializedData
+					rapidjson::Document json;
+					json.Parse<rapidjson::kParseStopWhenDoneFlag>(sceneJson->c_str());
+					Consume(json.MemberCount());
+				}
+			});
+		}
+
+		void AddLightClustersBenchmarks(BenchmarkSuite& suite)
+		{
+			struct LightClustersData
+			{
+				std::vector<ClusterBounds> bounds = std::vector<ClusterBounds>(ClustersCount);
+				std::vector<ClusterLight> lights;
+				std::vector<uint32_t> clusterLightIndices = std::vector<uint32_t>(ClustersCount * LIGHTS_PER_CLUSTER);
+			};
+			auto data = std::make_shared<LightClustersData>();
+
+			// No more lights than fit one cluster, so any placement is valid
+			std::mt19937 generator(2);
+			std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+			for (uint32_t i = 0; i < LIGHTS_PER_CLUSTER; i++)
+			{
+				data->lights.push_back({
+					.viewPosition = jmath::vec3(distribution(generator) * 40 - 20, distribution(generator) * 20 - 10, distribution(generator) * 100),
+					.radius = 1 + distribution(generator) * 4,
+					.index = i
+				});
+			}
+
+			suite.Add("LightClusters/Bounds", ClustersCount, [data]()
+			{
+				GetClusterBounds(0.1f, 1000.0f, 16.0f / 9.0f, 1.0f, data->bounds.data());
+				Consume(data->bounds.back().max.z);
+			});
+
+			suite.Add("LightClusters/Assign", ClustersCount, [data]()
+			{
+				AssignLightsToClusters(data->bounds.data(), data->lights.data(), static_cast<uint32_t>(data->lights.size()),
+				                       data->clusterLightIndices.data());
+				Consume(data->clusterLightIndices[0]);
+			}, [data]()
+			{
+				GetClusterBounds(0.1f, 1000.0f, 16.0f / 9.0f, 1.0f, data->bounds.data());
+			});
+		}
+
+		void AddMathBenchmarks(BenchmarkSuite& suite)
+		{
+			constexpr uint32_t batchesCount = 1 << 12;
+			constexpr uint32_t lanesCount = batchesCount * jmath::batchWidth;
+
+			struct MathData
+			{
+				std::vector<jmath::vec3x8> translations = std::vector<jmath::vec3x8>(batchesCount);
+				std::vector<jmath::quatx8> rotations = std::vector<jmath::quatx8>(batchesCount);
+				std::vector<jmath::vec3x8> scales = std::vector<jmath::vec3x8>(batchesCount);
+				std::vector<jmath::mat4x4x8> locals = std::vector<jmath::mat4x4x8>(batchesCount);
+				std::vector<jmath::mat4x4x8> parents = std::vector<jmath::mat4x4x8>(batchesCount);
+				std::vector<jmath::mat4x4x8> results = std::vector<jmath::mat4x4x8>(batchesCount);
+				std::vector<jmath::vec3x8> points = std::vector<jmath::vec3x8>(batchesCount);
+				std::vector<jmath::aabbx8> boxes = std::vector<jmath::aabbx8>(batchesCount);
+				std::vector<jmath::aabbx8> resultBoxes = std::vector<jmath::aabbx8>(batchesCount);
+				std::vector<jmath::spherex8> spheres = std::vector<jmath::spherex8>(batchesCount);
+				std::vector<uint8_t> visibleMasks = std::vector<uint8_t>(batchesCount);
+				jmath::vec4 planes[6];
+			};
+			auto data = std::make_shared<MathData>();
+
+			std::mt19937 generator(3);
+			std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+			auto FillRandom = [&](auto& values)
+			{
+				for (auto& value : values)
+				{
+					float* floats = reinterpret_cast<float*>(&value);
+					for (size_t i = 0; i < sizeof(value) / sizeof(float); i++)
+					{
+						floats[i] = distribution(generator);
+					}
+				}
+			};
+			FillRandom(data->translations);
+			FillRandom(data->rotations);
+			FillRandom(data->scales);
+			FillRandom(data->spheres);
+			for (uint32_t b = 0; b < batchesCount; b++)
+			{
+				for (uint32_t lane = 0; lane < jmath::batchWidth; lane++)
+				{
+					const jmath::vec3 translation = jmath::getLane(data->translations[b], lane);
+					const jmath::mat4x4 m = jmath::trs(jmath::loadPosition(translation), jmath::eulerToQuat(translation), jmath::xone);
+					jmath::setLane(data->locals[b], lane, m);
+					jmath::setLane(data->parents[b], lane, jmath::trs(jmath::loadPosition(translation * 10.0f), jmath::eulerToQuat(translation * 2.0f), jmath::xone));
+
+					const jmath::vec3 extent = jmath::getLane(data->scales[b], lane);
+					data->boxes[b].min.x[lane] = translation.x - std::abs(extent.x);
+					data->boxes[b].min.y[lane] = translation.y - std::abs(extent.y);
+					data->boxes[b].min.z[lane] = translation.z - std::abs(extent.z);
+					data->boxes[b].max.x[lane] = translation.x + std::abs(extent.x);
+					data->boxes[b].max.y[lane] = translation.y + std::abs(extent.y);
+					data->boxes[b].max.z[lane] = translation.z + std::abs(extent.z);
+				}
+			}
+			const jmath::mat4x4 view = jmath::lookAtLH(jmath::loadPosition(jmath::vec3(0, 0, -2)), jmath::xzero, jmath::xup);
+			jmath::getFrustumPlanes(jmath::mul(view, jmath::perspectiveFovLH_ZO(1.0f, 16.0f, 9.0f, 0.1f, 100.0f)), data->planes);
+
+			// Every kernel on every level the cpu supports, the level is restored after the run
+			for (const jmath::SimdLevel level : {jmath::SimdLevel::Scalar, jmath::SimdLevel::SSE, jmath::SimdLevel::AVX2})
+			{
+				if (level > jmath::getSupportedSimdLevel()) continue;
+
+				const auto AddKernel = [&suite, level](const char* kernelName, std::function<void()> kernel)
+				{
+					suite.Add((std::string("jmath/") + kernelName + "/" + jmath::toString(level)).c_str(), lanesCount,
+					          [level, kernel = std::move(kernel)]()
+					          {
+						          const jmath::SimdLevel savedLevel = jmath::getSimdLevel();
+						          jmath::setSimdLevel(level);
+						          kernel();
+						          jmath::setSimdLevel(savedLevel);
+					          });
+				};
+
+				AddKernel("trsBatch", [data]()
+				{
+					jmath::trsBatch(data->translations.data(), data->rotations.data(), data->scales.data(), data->results.data(), batchesCount);
+					Consume(data->results.back().m[3][0][0]);
+				});
+
+				AddKernel("mulBatch", [data]()
+				{
+					jmath::mulBatch(data->locals.data(), data->parents.data(), data->results.data(), batchesCount);
+					Consume(data->results.back().m[3][0][0]);
+				});
+
+				AddKernel("transformPointsBatch", [data]()
+				{
+					jmath::transformPointsBatch(data->locals.data(), data->translations.data(), data->points.data(), batchesCount);
+					Consume(data->points.back().x[0]);
+				});
+
+				AddKernel("transformVectorsBatch", [data]()
+				{
+					jmath::transformVectorsBatch(data->locals.data(), data->translations.data(), data->points.data(), batchesCount);
+					Consume(data->points.back().x[0]);
+				});
+
+				AddKernel("transformAABBBatch", [data]()
+				{
+					jmath::transformAABBBatch(data->locals.data(), data->boxes.data(), data->resultBoxes.data(), batchesCount);
+					Consume(data->resultBoxes.back().max.x[0]);
+				});
+
+				AddKernel("sphereFrustumBatch", [data]()
+				{
+					jmath::sphereFrustumBatch(data->planes, data->spheres.data(), data->visibleMasks.data(), batchesCount);
+					Consume(data->visibleMasks.back());
+				});
+			}
+
+			constexpr uint32_t stringsCount = 1 << 12;
+			auto strings = std::make_shared<std::vector<std::string>>();
+			for (uint32_t i = 0; i < stringsCount; i++)
+			{
+				strings->push_back("textures/sponza/material_" + std::to_string(i) + "_albedo.dds");
+			}
+			suite.Add("StrHash64", stringsCount, [strings]()
+			{
+				uint64_t hash = 0;
+				for (const std::string& s : *strings)
+				{
+					hash ^= StrHash64(s.c_str());
+				}
+				Consume(hash);
+			});
+		}
+
+		// Counts messages instead of writing them, so only the queue is measured
+		class CountingLogSink final : public LogSink
+		{
+		public:
+			explicit CountingLogSink(std::atomic<uint64_t>& count) :
+				m_count(count)
+			{
+			}
+
+			void Write(LogLevel level, const std::string& text) override
+			{
+				m_count.fetch_add(1, std::memory_order_relaxed);
+			}
+
+		private:
+			std::atomic<uint64_t>& m_count;
+		};
+
+		void AddLogBenchmarks(BenchmarkSuite& suite)
+		{
+			constexpr uint32_t producersCount = 4;
+			constexpr uint32_t messagesCount = 1 << 14; // per producer
+
+			struct LogData
+			{
+				std::unique_ptr<LogQueue> queue;
+				std::atomic<uint64_t> writtenCount = 0;
+			};
+			auto data = std::make_shared<LogData>();
+
+			// Info messages are dropped when the log thread falls behind, warnings wait for it
+			for (const auto& [name, level] : {
+				     std::pair{"LogQueue/4Producers", LogLevel::Info},
+				     std::pair{"LogQueue/4ProducersLossless", LogLevel::Warning}
+			     })
+			{
+				suite.Add(name, producersCount * messagesCount, [data, level]()
+				{
+					std::vector<std::thread> producers;
+					for (uint32_t producer = 0; producer < producersCount; producer++)
+					{
+						producers.emplace_back([&queue = *data->queue, level, producer]()
+						{
+							for (uint32_t i = 0; i < messagesCount; i++)
+							{
+								queue.WriteFormat(level, "Producer %u message %u value %.3f\n", producer, i, static_cast<float>(i) * 0.5f);
+							}
+						});
+					}
+					for (std::thread& producer : producers)
+					{
+						producer.join();
+					}
+					data->queue->Flush();
+					Consume(data->writtenCount.load(std::memory_order_relaxed));
+				}, [data]()
+				{
+					data->queue = std::make_unique<LogQueue>();
+					data->queue->AddSink(std::make_unique<CountingLogSink>(data->writtenCount));
+				});
+			}
+		}
+	}
+
+
+	void BenchmarkSuite::AddCpuBenchmarks(BenchmarkSuite& suite)
+	{
+		AddAllocatorBenchmarks(suite);
+		AddSceneBenchmarks(suite);
+		AddLightClustersBenchmarks(suite);
+		AddMathBenchmarks(suite);
+		AddLogBenchmarks(suite);
+
+		CpuRadixSorter<uint32_t>::AddBenchmarks(suite);
+		CpuRadixSorter<uint64_t>::AddBenchmarks(suite);
+		CpuBVHBuilder::AddBenchmarks(suite);
+	}
+
+	uint32_t BenchmarkSuite::RunCpuBenchmarks(const std::string& resultsPath, const std::string& baselinePath, const char* filter)
+	{
+		Logger::Log("=========== JOY ENGINE CPU BENCHMARKS ===========\n");
+
+		BenchmarkSuite suite;
+		AddCpuBenchmarks(suite);
+		suite.Run(15, filter);
+
+		suite.WriteJson(resultsPath.empty() ? "benchmark_results.json" : resultsPath);
+		return baselinePath.empty() ? 0 : suite.CompareWithBaseline(baselinePath);
+	}
+}
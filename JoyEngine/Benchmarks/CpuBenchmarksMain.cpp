@@ -0,0 +1,41 @@
+// Entry point of JoyEngineCpuBenchmarks, the CMake build of the sources that don't need D3D12 or Windows
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "Benchmarks/BenchmarkSuite.h"
+#include "Utils/Log.h"
+
+namespace
+{
+	// Argument after the option, empty if there is no option or no argument
+	std::string GetOptionValue(int argc, char** argv, const char* option)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (strcmp(argv[i], option) == 0)
+			{
+				return i + 1 < argc && argv[i + 1][0] != '-' ? argv[i + 1] : "";
+			}
+		}
+		return {};
+	}
+}
+
+// JoyEngineCpuBenchmarks [-benchmark results.json] [-baseline old_results.json] [-filter jmath] [-log log.txt]
+// takes the same options as JoyEngineTests.exe -benchmark, exit code is count of benchmarks that are slower than in baseline
+int main(int argc, char** argv)
+{
+	if (const std::string logPath = GetOptionValue(argc, argv, "-log"); !logPath.empty())
+	{
+		Logger::AddSink(std::make_unique<FileLogSink>(logPath.c_str()));
+	}
+
+	const std::string filter = GetOptionValue(argc, argv, "-filter");
+
+	return static_cast<int>(JoyEngine::BenchmarkSuite::RunCpuBenchmarks(
+		GetOptionValue(argc, argv, "-benchmark"),
+		GetOptionValue(argc, argv, "-baseline"),
+		filter.empty() ? nullptr : filter.c_str()));
+}
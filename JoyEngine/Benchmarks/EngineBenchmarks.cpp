@@ -0,0 +1,66 @@
+#include "BenchmarkSuite.h"
+
+#include <memory>
+
+#include "JoyEngine.h"
+#include "Common/JoyObject.h"
+#include "Common/Serialization.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuSAHBVHBuilder.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuTwoLevelBVH.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuWideBVH.h"
+#include "ResourceManager/ResourceTable.h"
+#include "ResourceManager/Pipelines/ShaderBindingTable.h"
+#include "Utils/Log.h"
+#include "Utils/Profiler.h"
+
+namespace JoyEngine
+{
+	void BenchmarkSuite::AddEngineBenchmarks(BenchmarkSuite& suite)
+	{
+		AddCpuBenchmarks(suite);
+
+		CpuSAHBVHBuilder::AddBenchmarks(suite);
+		CpuTwoLevelBVH::AddBenchmarks(suite);
+		CpuWideBVH<4>::AddBenchmarks(suite);
+		CpuWideBVH<8>::AddBenchmarks(suite);
+		ResourceTable::AddBenchmarks(suite);
+		ShaderBindingTable::AddBenchmarks(suite);
+		JoyTypeRegistry::AddBenchmarks(suite);
+		SerializableClassFactory::AddBenchmarks(suite);
+		Profiler::AddBenchmarks(suite);
+	}
+
+	uint32_t BenchmarkSuite::RunEngineBenchmarks(const std::string& resultsPath, const std::string& baselinePath, const char* filter)
+	{
+		Logger::Log("=========== JOY ENGINE BENCHMARKS ===========\n");
+		JoyTypeRegistry::GetInstance()->AssignIds();
+
+		// Cases keep engine objects, so the suite is destroyed before the engine stops
+		std::unique_ptr<JoyEngine> engine;
+		uint32_t slowerCount = 0;
+		{
+			BenchmarkSuite suite;
+			AddEngineBenchmarks(suite);
+
+			// One headless engine for all engine cases, it isn't created when the filter skips them
+			if (suite.HasEngineCases(filter))
+			{
+				engine = std::make_unique<JoyEngine>(nullptr);
+				engine->Init();
+			}
+
+			suite.Run(15, filter);
+
+			suite.WriteJson(resultsPath.empty() ? "benchmark_results.json" : resultsPath);
+			slowerCount = baselinePath.empty() ? 0 : suite.CompareWithBaseline(baselinePath);
+		}
+
+		if (engine != nullptr)
+		{
+			engine->Stop();
+			engine = nullptr;
+		}
+
+		return slowerCount;
+	}
+}
@@ -0,0 +1,126 @@
+#include "TestSuite.h"
+
+#include <memory>
+#include <vector>
+
+#include "JoyEngine.h"
+#include "Common/DeferredReleaseQueue.h"
+#include "Common/JoyObject.h"
+#include "Common/Serialization.h"
+#include "Common/Math/MathBatch.h"
+#include "DescriptorManager/DescriptorIndexAllocator.h"
+#include "RenderManager/RaytracedDDGIRenderer/ProbeCascades.h"
+#include "RenderManager/RaytracedDDGIRenderer/ProbeClassifier.h"
+#include "RenderManager/RaytracedDDGIRenderer/ProbeUpdateScheduler.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/BufferSorterPlan.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/BVHUtils.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuBVHBuilder.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuBVHRefitter.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuSAHBVHBuilder.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuTwoLevelBVH.h"
+#include "RenderManager/RaytracedDDGIRenderer/SW/CpuWideBVH.h"
+#include "ResourceManager/ResourceTable.h"
+#include "ResourceManager/ShaderCache.h"
+#include "SceneManager/GameObject.h"
+#include "SceneManager/WorldManager.h"
+#include "ThreadManager/WorkerPool.h"
+#include "Utils/Log.h"
+#include "Utils/LogQueue.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		constexpr uint32_t bvhTrianglesCount = 1 << 14;
+		constexpr uint32_t bvhRaysCount = 1 << 14;
+
+		// Wide trees are collapsed from SAH tree of random triangles, both traversals have to find the same hits
+		template <uint32_t Width>
+		bool TestWideBVH()
+		{
+			std::vector<jmath::vec3> vertices(bvhTrianglesCount * 3);
+			std::vector<AABB> triangleAABB(bvhTrianglesCount);
+			std::vector<uint32_t> sortedTriangleIndices(bvhTrianglesCount);
+			std::vector<InternalNode> internalNodes(bvhTrianglesCount - 1);
+			std::vector<LeafNode> leafNodes(bvhTrianglesCount);
+			std::vector<AABB> bvhData(bvhTrianglesCount - 1);
+
+			GenerateRandomTriangles(bvhTrianglesCount, 0.1f, 5.0f, bvhTrianglesCount, vertices.data(), triangleAABB.data());
+			CpuSAHBVHBuilder::Construct(triangleAABB.data(), bvhTrianglesCount,
+			                            sortedTriangleIndices.data(), internalNodes.data(), leafNodes.data(), bvhData.data());
+			return CpuWideBVH<Width>::CompareWithBinary(
+				vertices.data(), sortedTriangleIndices.data(), triangleAABB.data(), bvhTrianglesCount,
+				internalNodes.data(), leafNodes.data(), bvhData.data(),
+				bvhRaysCount);
+		}
+	}
+
+	void TestSuite::AddEngineTests(TestSuite& suite)
+	{
+		suite.Add("DescriptorIndexAllocator", &DescriptorIndexAllocator::Test);
+		suite.Add("DeferredReleaseQueue", &DeferredReleaseQueue::Test);
+		suite.Add("ResourceTable", &ResourceTable::Test);
+		suite.Add("ShaderCache", &ShaderCache::Test);
+		suite.Add("JoyTypeRegistry", &JoyTypeRegistry::Test);
+		suite.Add("jmath/BatchKernels", &jmath::testBatchKernels);
+		suite.Add("LogQueue", &LogQueue::Test);
+		suite.Add("WorkerPool", &WorkerPool::Test);
+
+		suite.Add("DDGI/ProbeCascades", &ProbeCascades::Test);
+		suite.Add("DDGI/ProbeUpdateScheduler", &ProbeUpdateScheduler::Test);
+		suite.Add("DDGI/ProbeClassifier", &ProbeClassifier::Test);
+
+		suite.Add("BVH/LBVHDuplicateKeys", []() { return CpuBVHBuilder::TestDuplicateKeys(bvhTrianglesCount); });
+		suite.Add("BVH/BufferSorterPlan", []() { return BufferSorterPlan::Test(1 << 14, 4097); });
+		suite.Add("BVH/Refitter", []() { return CpuBVHRefitter::Test(bvhTrianglesCount); });
+		suite.Add("BVH/SAHAgainstLBVH", []()
+		{
+			std::vector<jmath::vec3> vertices(bvhTrianglesCount * 3);
+			std::vector<AABB> triangleAABB(bvhTrianglesCount);
+			GenerateRandomTriangles(bvhTrianglesCount, 0.01f, 20.0f, bvhTrianglesCount, vertices.data(), triangleAABB.data());
+			return CpuSAHBVHBuilder::CompareWithLBVH(vertices.data(), triangleAABB.data(), bvhTrianglesCount, bvhRaysCount);
+		});
+		suite.Add("BVH/SAHDepthLimit", []() { return CpuSAHBVHBuilder::TestDepthLimit(bvhTrianglesCount); });
+		suite.Add("BVH/TwoLevelAgainstFlat", []()
+		{
+			return CpuTwoLevelBVH::CreateRandom(8, 1024, 64).CompareWithFlatBVH(bvhRaysCount);
+		});
+		suite.Add("BVH/Wide4AgainstBinary", &TestWideBVH<4>);
+		suite.Add("BVH/Wide8AgainstBinary", &TestWideBVH<8>);
+
+		// Objects are created on a game object outside of the scene, so the loaded world doesn't change
+		suite.AddEngineCase("Serialization/RoundTrip", []()
+		{
+			TransformProvider& transformProvider = WorldManager::Get()->GetTransformProvider();
+			GameObject go("Serialization test", transformProvider.Allocate(), transformProvider);
+			return SerializableClassFactory::Test(go);
+		});
+	}
+
+	uint32_t TestSuite::RunEngineTests(const char* filter)
+	{
+		Logger::Log("=========== JOY ENGINE TESTS ===========\n");
+		JoyTypeRegistry::GetInstance()->AssignIds();
+
+		TestSuite suite;
+		AddEngineTests(suite);
+
+		// One headless engine for all engine cases, it isn't created when the filter skips them
+		std::unique_ptr<JoyEngine> engine;
+		if (suite.HasEngineCases(filter))
+		{
+			engine = std::make_unique<JoyEngine>(nullptr);
+			engine->Init();
+		}
+
+		const uint32_t failedCount = suite.Run(filter);
+
+		if (engine != nullptr)
+		{
+			engine->Stop();
+			engine = nullptr;
+		}
+
+		return failedCount;
+	}
+}
@@ -0,0 +1,70 @@
+#include "TestSuite.h"
+
+#include <chrono>
+
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	void TestSuite::Add(const char* name, std::function<bool()> test)
+	{
+		m_cases.push_back({name, std::move(test), false});
+	}
+
+	void TestSuite::AddEngineCase(const char* name, std::function<bool()> test)
+	{
+		m_cases.push_back({name, std::move(test), true});
+	}
+
+	uint32_t TestSuite::Run(const char* filter) const
+	{
+		uint32_t runCount = 0;
+		uint32_t failedCount = 0;
+		for (const Case& testCase : m_cases)
+		{
+			if (!IsSelected(testCase, filter)) continue;
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			const bool isPassed = testCase.test();
+			const double time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+			Logger::LogFormat(isPassed ? LogLevel::Info : LogLevel::Error, "%-40s %s, %.1f ms\n",
+			                  testCase.name.c_str(),
+			                  isPassed ? "passed" : "FAILED",
+			                  time);
+			runCount++;
+			failedCount += isPassed ? 0 : 1;
+		}
+
+		Logger::LogFormat("%u of %u tests failed\n", failedCount, runCount);
+		return failedCount;
+	}
+
+	bool TestSuite::HasEngineCases(const char* filter) const
+	{
+		for (const Case& testCase : m_cases)
+		{
+			if (testCase.needsEngine && IsSelected(testCase, filter)) return true;
+		}
+		return false;
+	}
+
+	bool TestSuite::Check(bool condition, const char* description, const char* file, int line)
+	{
+		if (!condition)
+		{
+			const char* fileName = file;
+			for (const char* c = file; *c != '\0'; c++)
+			{
+				if (*c == '/' || *c == '\\') fileName = c + 1;
+			}
+			Logger::LogFormat(LogLevel::Error, "    check failed: %s (%s:%d)\n", description, fileName, line);
+		}
+		return condition;
+	}
+
+	bool TestSuite::IsSelected(const Case& testCase, const char* filter)
+	{
+		return filter == nullptr || testCase.name.find(filter) != std::string::npos;
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef TEST_SUITE_H
+#define TEST_SUITE_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Logs the failed condition with its place and returns it, so checks of one test can be chained with &=
+#define TEST_CHECK(condition, description) ::JoyEngine::TestSuite::Check((condition), (description), __FILE__, __LINE__)
+
+namespace JoyEngine
+{
+	// Named self-tests of engine modules. Cases that need the engine are run on a headless one,
+	// the others don't need a window or a device. Nothing runs them at engine start
+	class TestSuite
+	{
+	public:
+		void Add(const char* name, std::function<bool()> test);
+		// WorldManager and the other managers exist while the test runs
+		void AddEngineCase(const char* name, std::function<bool()> test);
+
+		// Runs cases which names contain filter, all of them when filter is nullptr. Returns count of failed cases
+		uint32_t Run(const char* filter = nullptr) const;
+
+		[[nodiscard]] bool HasEngineCases(const char* filter = nullptr) const;
+
+		static bool Check(bool condition, const char* description, const char* file, int line);
+
+		// Self-tests of descriptor heaps, release queue, resource table, shader cache, type registry, serialization, log queue, worker pool,
+		// math kernels, DDGI probe logic and cpu BVH builders checked against each other
+		static void AddEngineTests(TestSuite& suite);
+
+		// Entry point of JoyEngine.exe -test and JoyEngineTests.exe. Starts a headless engine when selected cases need it
+		static uint32_t RunEngineTests(const char* filter = nullptr);
+
+	private:
+		struct Case
+		{
+			std::string name;
+			std::function<bool()> test;
+			bool needsEngine;
+		};
+
+		[[nodiscard]] static bool IsSelected(const Case& testCase, const char* filter);
+
+		std::vector<Case> m_cases;
+	};
+}
+
+#endif // TEST_SUITE_H
@@ -0,0 +1,58 @@
+// Entry point of JoyEngineTests.exe, the console build of the engine sources without main.cpp
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "Benchmarks/BenchmarkSuite.h"
+#include "Benchmarks/TestSuite.h"
+#include "Utils/Log.h"
+
+namespace
+{
+	// Argument after the option, empty if there is no option or no argument
+	std::string GetOptionValue(int argc, char** argv, const char* option)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (strcmp(argv[i], option) == 0)
+			{
+				return i + 1 < argc && argv[i + 1][0] != '-' ? argv[i + 1] : "";
+			}
+		}
+		return {};
+	}
+
+	bool HasOption(int argc, char** argv, const char* option)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (strcmp(argv[i], option) == 0) return true;
+		}
+		return false;
+	}
+}
+
+// JoyEngineTests.exe [-filter Probe] runs the self-tests, exit code is count of failed tests.
+// JoyEngineTests.exe -benchmark results.json [-baseline old_results.json] [-filter jmath] runs the benchmarks,
+// exit code is count of benchmarks that are slower than in baseline
+int main(int argc, char** argv)
+{
+	if (const std::string logPath = GetOptionValue(argc, argv, "-log"); !logPath.empty())
+	{
+		Logger::AddSink(std::make_unique<FileLogSink>(logPath.c_str()));
+	}
+
+	const std::string filter = GetOptionValue(argc, argv, "-filter");
+	const char* filterValue = filter.empty() ? nullptr : filter.c_str();
+
+	if (HasOption(argc, argv, "-benchmark"))
+	{
+		return static_cast<int>(JoyEngine::BenchmarkSuite::RunEngineBenchmarks(
+			GetOptionValue(argc, argv, "-benchmark"),
+			GetOptionValue(argc, argv, "-baseline"),
+			filterValue));
+	}
+
+	return static_cast<int>(JoyEngine::TestSuite::RunEngineTests(filterValue));
+}
@@ -119,6 +119,11 @@ namespace JoyEngine
 		return m_queueEntries[frameIndex].commandList.Get();
 	}
 
+	uint64_t CommandQueue::GetCompletedFenceValue() const
+	{
+		return m_fence->GetCompletedValue();
+	}
+
 	ID3D12CommandQueue* CommandQueue::GetQueue() const noexcept
 	{
 		return m_commandQueue.Get();
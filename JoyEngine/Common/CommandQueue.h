@@ -25,6 +25,9 @@ namespace JoyEngine
 
 		[[nodiscard]] ID3D12CommandQueue* GetQueue() const noexcept;
 		[[nodiscard]] ID3D12GraphicsCommandList4* GetCommandList(uint32_t frameIndex) const noexcept;
+		// Value the next Execute signals
+		[[nodiscard]] uint64_t GetCurrentFenceValue() const noexcept { return m_currentFenceValue; }
+		[[nodiscard]] uint64_t GetCompletedFenceValue() const;
 	private:
 		struct QueueAllocatorEntry
 		{
@@ -0,0 +1,113 @@
+#include "DeferredReleaseQueue.h"
+
+#include <vector>
+
+#include "Benchmarks/TestSuite.h"
+
+namespace JoyEngine
+{
+	void DeferredReleaseQueue::BeginFrame(uint64_t frameFenceValue, uint64_t completedFenceValue)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_frameFenceValue = frameFenceValue;
+		}
+		Collect(completedFenceValue);
+	}
+
+	void DeferredReleaseQueue::Enqueue(Release release)
+	{
+		std::lock_guard lock(m_mutex);
+		m_entries.push_back({m_frameFenceValue, std::move(release)});
+	}
+
+	void DeferredReleaseQueue::Enqueue(uint64_t fenceValue, Release release)
+	{
+		std::lock_guard lock(m_mutex);
+		m_entries.push_back({fenceValue, std::move(release)});
+	}
+
+	uint32_t DeferredReleaseQueue::Collect(uint64_t completedFenceValue)
+	{
+		std::vector<Release> releases;
+		{
+			std::lock_guard lock(m_mutex);
+			while (!m_entries.empty() && m_entries.front().fenceValue <= completedFenceValue)
+			{
+				releases.push_back(std::move(m_entries.front().release));
+				m_entries.pop_front();
+			}
+		}
+
+		for (const Release& release : releases)
+		{
+			release();
+		}
+		return static_cast<uint32_t>(releases.size());
+	}
+
+	uint32_t DeferredReleaseQueue::CollectAll()
+	{
+		uint32_t releasedCount = 0;
+		while (const uint32_t count = Collect(UINT64_MAX))
+		{
+			releasedCount += count;
+		}
+		return releasedCount;
+	}
+
+	uint64_t DeferredReleaseQueue::GetFrameFenceValue() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_frameFenceValue;
+	}
+
+	size_t DeferredReleaseQueue::GetPendingCount() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_entries.size();
+	}
+
+	bool DeferredReleaseQueue::Test()
+	{
+		DeferredReleaseQueue queue;
+		std::vector<uint32_t> released;
+		const auto releaseOf = [&released](uint32_t id)
+		{
+			return [&released, id]() { released.push_back(id); };
+		};
+
+		// Two frames in flight, the GPU has completed nothing yet
+		queue.BeginFrame(1, 0);
+		queue.Enqueue(releaseOf(1));
+		queue.BeginFrame(2, 0);
+		queue.Enqueue(releaseOf(2));
+		queue.Enqueue(releaseOf(3));
+		bool isPassed = TEST_CHECK(released.empty() && queue.GetPendingCount() == 3, "released before the GPU passed the frame");
+
+		queue.BeginFrame(3, 1);
+		isPassed &= TEST_CHECK((released == std::vector<uint32_t>{1}), "frame 1 releases are not run after its fence");
+
+		// Release that enqueues another one, like a texture freeing its descriptors
+		queue.Enqueue([&queue, &released, releaseOf]()
+		{
+			released.push_back(4);
+			queue.Enqueue(releaseOf(5));
+		});
+		queue.BeginFrame(4, 2);
+		isPassed &= TEST_CHECK((released == std::vector<uint32_t>{1, 2, 3}), "frame 2 releases are not run in order");
+
+		queue.BeginFrame(5, 4);
+		isPassed &= TEST_CHECK((released == std::vector<uint32_t>{1, 2, 3, 4}), "nested release doesn't wait for the current frame");
+		isPassed &= TEST_CHECK(queue.GetPendingCount() == 1 && queue.GetFrameFenceValue() == 5, "nested release is not queued");
+
+		// Lower fence value waits for the releases before it
+		queue.Enqueue(3, releaseOf(6));
+		queue.Collect(4);
+		isPassed &= TEST_CHECK(released.size() == 4, "release overtook an earlier one");
+
+		isPassed &= TEST_CHECK(queue.CollectAll() == 2 && queue.GetPendingCount() == 0, "idle collect left releases");
+		isPassed &= TEST_CHECK((released == std::vector<uint32_t>{1, 2, 3, 4, 5, 6}), "idle collect broke the order");
+		return isPassed;
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef DEFERRED_RELEASE_QUEUE_H
+#define DEFERRED_RELEASE_QUEUE_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace JoyEngine
+{
+	// Releases of objects the GPU may still use wait here until the GPU passes the fence value of the last frame
+	// that could use them. The renderer tells which fence value the recorded frame signals and which one is completed,
+	// so the queue doesn't depend on D3D and can be driven by any counter
+	class DeferredReleaseQueue
+	{
+	public:
+		using Release = std::function<void()>;
+
+		// Releases enqueued from now on wait for frameFenceValue. Runs the releases completedFenceValue has passed
+		void BeginFrame(uint64_t frameFenceValue, uint64_t completedFenceValue);
+
+		// Waits for the fence value of the recorded frame
+		void Enqueue(Release release);
+		// Fence values are expected not to decrease, a release waits for the ones enqueued before it
+		void Enqueue(uint64_t fenceValue, Release release);
+
+		// Runs the releases in the order they were enqueued, returns their count
+		uint32_t Collect(uint64_t completedFenceValue);
+		// Only when the GPU is idle. Releases enqueued by the running releases are run too
+		uint32_t CollectAll();
+
+		[[nodiscard]] uint64_t GetFrameFenceValue() const;
+		[[nodiscard]] size_t GetPendingCount() const;
+
+		// Simulated fence: nothing is released early, order is kept, nested releases wait for the next frame
+		static bool Test();
+
+	private:
+		struct Entry
+		{
+			uint64_t fenceValue;
+			Release release;
+		};
+
+		std::deque<Entry> m_entries;
+		uint64_t m_frameFenceValue = 0;
+		mutable std::mutex m_mutex; // releases are run without the lock, they can enqueue more
+	};
+}
+
+#endif // DEFERRED_RELEASE_QUEUE_H
@@ -25,6 +25,16 @@ constexpr uint64_t StrnHash64(const char* str, size_t count, const uint64_t valu
 	return !*str || count == 0 ? value : StrnHash64(&str[1], count - 1, (value ^ static_cast<uint64_t>(static_cast<uint8_t>(str[0]))) * prime_64_const);
 }
 
+inline uint64_t MemHash64(const void* data, size_t size, uint64_t value = val_64_const) noexcept
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		value = (value ^ static_cast<uint64_t>(bytes[i])) * prime_64_const;
+	}
+	return value;
+}
+
 inline uint64_t RandomHash64()
 {
 	return generator(gen);
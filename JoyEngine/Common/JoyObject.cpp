@@ -0,0 +1,190 @@
+#include "JoyObject.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "Benchmarks/BenchmarkSuite.h"
+#include "Benchmarks/TestSuite.h"
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	JoyTypeRegistry* JoyTypeRegistry::m_instance = nullptr;
+
+	namespace
+	{
+		// What JoyCast did before the ranges
+		bool IsDerivedByParents(const TypeInfo* typeInfo, const TypeInfo* baseInfo)
+		{
+			while (typeInfo != nullptr)
+			{
+				if (typeInfo->typeId == baseInfo->typeId)
+				{
+					return true;
+				}
+				typeInfo = typeInfo->parentInfo;
+			}
+			return false;
+		}
+	}
+
+	void JoyTypeRegistry::Register(const TypeInfo* typeInfo)
+	{
+		ASSERT_DESC(!m_isIdsAssigned, "Type is registered after ids were assigned");
+		for (const TypeInfo* info = typeInfo; info != nullptr; info = info->parentInfo)
+		{
+			if (std::ranges::find(m_types, info) != m_types.end()) break;
+			m_types.push_back(info);
+		}
+	}
+
+	const TypeInfo* JoyTypeRegistry::FindType(const char* typeName) const
+	{
+		const auto it = std::ranges::find_if(m_types, [typeName](const TypeInfo* info)
+		{
+			return strcmp(info->typeName, typeName) == 0;
+		});
+		return it == m_types.end() ? nullptr : *it;
+	}
+
+	void JoyTypeRegistry::AssignIds()
+	{
+		if (m_isIdsAssigned) return;
+
+		// Children are visited by name, so ids don't depend on the order of static initialization
+		std::ranges::sort(m_types, [](const TypeInfo* a, const TypeInfo* b)
+		{
+			return strcmp(a->typeName, b->typeName) < 0;
+		});
+
+		// Ids start from 1, a type that is not registered yet has zero range and is derived from nothing
+		uint32_t nextId = 1;
+		auto visit = [this, &nextId](auto&& self, const TypeInfo* typeInfo) -> void
+		{
+			typeInfo->idRange->first = nextId++;
+			for (const TypeInfo* child : m_types)
+			{
+				if (child->parentInfo == typeInfo)
+				{
+					self(self, child);
+				}
+			}
+			typeInfo->idRange->last = nextId - 1;
+		};
+
+		for (const TypeInfo* typeInfo : m_types)
+		{
+			if (typeInfo->parentInfo == nullptr)
+			{
+				visit(visit, typeInfo);
+			}
+		}
+		m_isIdsAssigned = true;
+	}
+
+	bool JoyTypeRegistry::Test()
+	{
+		const JoyTypeRegistry* registry = GetInstance();
+		bool isCorrect = true;
+
+		for (const TypeInfo* typeInfo : registry->m_types)
+		{
+			for (const TypeInfo* baseInfo : registry->m_types)
+			{
+				if (IsDerived(typeInfo, baseInfo) != IsDerivedByParents(typeInfo, baseInfo))
+				{
+					Logger::LogFormat(LogLevel::Error, "    check failed: %s is derived from %s by parents, not by ranges\n",
+					                  typeInfo->typeName, baseInfo->typeName);
+					isCorrect = false;
+				}
+			}
+		}
+
+		TypeIdRange unregisteredRange;
+		const TypeInfo unregisteredInfo{nullptr, "Unregistered", StrHash64("Unregistered"), &unregisteredRange};
+		isCorrect &= TEST_CHECK(!IsDerived(&unregisteredInfo, &unregisteredInfo), "type without id is derived from itself");
+		isCorrect &= TEST_CHECK(!IsDerived(&unregisteredInfo, registry->FindType("JoyObject")), "type without id is derived from JoyObject");
+		isCorrect &= TEST_CHECK(!IsDerived(registry->FindType("JoyObject"), &unregisteredInfo), "JoyObject is derived from type without id");
+
+		struct Relation
+		{
+			const char* typeName;
+			const char* baseName;
+			bool isDerived;
+		};
+		constexpr Relation relations[] = {
+			{"Texture", "Resource", true},
+			{"Mesh", "Resource", true},
+			{"Material", "Resource", true},
+			{"SharedMaterial", "Resource", true},
+			{"Shader", "Resource", true},
+			{"Buffer", "Resource", true},
+			{"Resource", "JoyObject", true},
+			{"Resource", "Texture", false},
+			{"Texture", "Serializable", false},
+			{"Mesh", "Component", false},
+			{"Component", "Serializable", true},
+			{"Camera", "Component", true},
+			{"LightBase", "Component", true},
+			{"PointLight", "LightBase", true},
+			{"PointLight", "Component", true},
+			{"PointLight", "JoyObject", true},
+			{"PointLight", "Camera", false},
+			{"LightBase", "PointLight", false},
+			{"CameraBehaviour", "Component", true},
+			{"LightBehaviour", "Component", true},
+			{"RoomBehaviour", "Serializable", true},
+			{"RoomBehaviour", "Resource", false},
+			{"Component", "Resource", false},
+		};
+		for (const Relation& relation : relations)
+		{
+			const TypeInfo* typeInfo = registry->FindType(relation.typeName);
+			const TypeInfo* baseInfo = registry->FindType(relation.baseName);
+			if (typeInfo == nullptr || baseInfo == nullptr)
+			{
+				Logger::LogFormat(LogLevel::Error, "    check failed: %s or %s is not registered\n", relation.typeName, relation.baseName);
+				isCorrect = false;
+			}
+			else if (IsDerived(typeInfo, baseInfo) != relation.isDerived)
+			{
+				Logger::LogFormat(LogLevel::Error, "    check failed: %s %s derived from %s\n",
+				                  relation.typeName, relation.isDerived ? "is not" : "is", relation.baseName);
+				isCorrect = false;
+			}
+		}
+
+		return isCorrect;
+	}
+
+	void JoyTypeRegistry::AddBenchmarks(BenchmarkSuite& suite)
+	{
+		const std::vector<const TypeInfo*>& types = GetInstance()->m_types;
+		const uint64_t checksCount = static_cast<uint64_t>(types.size()) * types.size();
+		auto derivedCount = std::make_shared<uint64_t>(0);
+
+		suite.Add("JoyTypeRegistry/IsDerived", checksCount, [&types, derivedCount]()
+		{
+			for (const TypeInfo* typeInfo : types)
+			{
+				for (const TypeInfo* baseInfo : types)
+				{
+					*derivedCount += IsDerived(typeInfo, baseInfo);
+				}
+			}
+		});
+
+		suite.Add("JoyTypeRegistry/IsDerivedByParents", checksCount, [&types, derivedCount]()
+		{
+			for (const TypeInfo* typeInfo : types)
+			{
+				for (const TypeInfo* baseInfo : types)
+				{
+					*derivedCount += IsDerivedByParents(typeInfo, baseInfo);
+				}
+			}
+		});
+	}
+}
@@ -1,23 +1,59 @@
 ﻿#pragma once
 
+#include <type_traits>
+#include <vector>
+
 #include "Common/HashDefs.h"
 
+struct TypeIdRange
+{
+	uint32_t first = 0; // id of the type itself
+	uint32_t last = 0; // ids of all types derived from it are in [first, last]
+};
+
 struct TypeInfo
 {
 	const TypeInfo* parentInfo;
 
 	const char* typeName;
 	const uint64_t typeId;
+
+	TypeIdRange* idRange; // assigned by JoyTypeRegistry
 };
 
+namespace JoyEngine
+{
+	// REFLECT_FIELD numbering, see Serialization.h
+	template <uint32_t N>
+	struct FieldCounter : FieldCounter<N - 1>
+	{
+	};
+
+	template <>
+	struct FieldCounter<0>
+	{
+	};
+
+	template <typename T>
+	struct ReflectedFields;
+}
+
 #define DECLARE_JOY_OBJECT(T, BASE)                                                    \
 protected:																			   \
+template <typename> friend struct ::JoyEngine::ReflectedFields;					   \
+static std::integral_constant<uint32_t, 0> ReflectedFieldsCount(FieldCounter<0>);	   \
+static inline TypeIdRange typeIdRange{};											   \
 static constexpr TypeInfo typeInfo{		   											   \
 	.parentInfo = &(BASE##::typeInfo),				   								   \
 	.typeName = #T,						   											   \
-	.typeId = StrHash64(#T)				   											   \
+	.typeId = StrHash64(#T),			   											   \
+	.idRange = &typeIdRange				   											   \
 };										   											   \
+static inline const JoyTypeRegistrator typeRegistrator{&typeInfo};					   \
 public:																				   \
+using JoyObjectType = T;															   \
+using JoyObjectBaseType = BASE;														   \
+static constexpr const TypeInfo* GetStaticTypeInfo() { return &typeInfo; }			   \
 constexpr uint64_t GetClassId() override { return typeInfo.typeId; } 				   \
 constexpr const char* GetClassname() override { return typeInfo.typeName; } 		   \
 constexpr const TypeInfo* GetTypeInfo() override { return &typeInfo; }                 \
@@ -25,16 +61,74 @@ private:
 
 namespace JoyEngine
 {
+	class BenchmarkSuite;
+
+	// Numbers every registered type in depth first order of the hierarchy, so a type and all types derived from it
+	// get one contiguous range of ids and an is-a check is two compares
+	class JoyTypeRegistry
+	{
+	public:
+		// Parents are registered too. Types are registered during static initialization, ids are assigned after it
+		void Register(const TypeInfo* typeInfo);
+
+		// Numbers all registered types once, has to be called before the first JoyCast
+		void AssignIds();
+
+		[[nodiscard]] const TypeInfo* FindType(const char* typeName) const;
+		[[nodiscard]] const std::vector<const TypeInfo*>& GetTypes() const { return m_types; }
+
+		[[nodiscard]] static bool IsDerived(const TypeInfo* typeInfo, const TypeInfo* baseInfo)
+		{
+			// Zero id is a type without assigned id, it is derived from nothing and nothing is derived from it
+			const uint32_t id = typeInfo->idRange->first;
+			return id != 0 && id >= baseInfo->idRange->first && id <= baseInfo->idRange->last;
+		}
+
+		// Checks ranges of all registered types against their parent chains and some known relations of Resource and Component types
+		static bool Test();
+		// Is-a checks of all pairs of registered types by ranges and by walking parent chains
+		static void AddBenchmarks(BenchmarkSuite& suite);
+
+		// same as SerializableClassFactory, types register before main()
+		static JoyTypeRegistry* GetInstance()
+		{
+			if (m_instance == nullptr)
+			{
+				m_instance = new JoyTypeRegistry();
+			}
+			return m_instance;
+		}
+
+	private:
+		static JoyTypeRegistry* m_instance;
+		std::vector<const TypeInfo*> m_types;
+		bool m_isIdsAssigned = false;
+	};
+
+	struct JoyTypeRegistrator
+	{
+		explicit JoyTypeRegistrator(const TypeInfo* typeInfo)
+		{
+			JoyTypeRegistry::GetInstance()->Register(typeInfo);
+		}
+	};
+
 	class JoyObject
 	{
 	protected:
+		static inline TypeIdRange typeIdRange{};
 		static constexpr TypeInfo typeInfo{
 			.parentInfo = nullptr,
 			.typeName = "JoyObject",
-			.typeId = StrHash64("JoyObject")
+			.typeId = StrHash64("JoyObject"),
+			.idRange = &typeIdRange
 		};
+		static inline const JoyTypeRegistrator typeRegistrator{&typeInfo};
 
 	public:
+		using JoyObjectType = JoyObject;
+		static constexpr const TypeInfo* GetStaticTypeInfo() { return &typeInfo; }
+
 		constexpr virtual const char* GetClassname() { return typeInfo.typeName; }
 		constexpr virtual uint64_t GetClassId() = 0;
 		constexpr virtual const TypeInfo* GetTypeInfo() { return &typeInfo; }
@@ -43,37 +137,12 @@ namespace JoyEngine
 		virtual ~JoyObject() = default;
 	};
 
-	template <typename T>
-	constexpr std::string_view GetTypeName()
-	{
-#ifdef __clang__
-		std::string_view sv = __PRETTY_FUNCTION__;
-#elif defined(__GNUC__)
-		std::string_view sv = __PRETTY_FUNCTION__;
-#elif defined(_MSC_VER)
-		std::string_view sv = __FUNCSIG__;
-#else
-#error "Unsupported compiler"
-#endif
-		sv = sv.substr(sv.find("class JoyEngine::") + 17);
-		sv = sv.substr(0, sv.find('>'));
-		return sv;
-	}
-
 	template <typename T> requires std::is_base_of_v<JoyObject, T>
-	constexpr T* JoyCast(JoyObject* obj)
+	T* JoyCast(JoyObject* obj)
 	{
-		constexpr std::string_view sv = GetTypeName<T>();
+		static_assert(std::is_same_v<typename T::JoyObjectType, T>, "JoyCast needs DECLARE_JOY_OBJECT in the target type");
 
-		const TypeInfo* typeInfo = obj->GetTypeInfo();
-		while (typeInfo != nullptr)
-		{
-			if (typeInfo->typeId == StrnHash64(sv.data(), sv.length()))
-			{
-				return static_cast<T*>(obj);
-			}
-			typeInfo = typeInfo->parentInfo;
-		}
-		return nullptr;
+		if (obj == nullptr) return nullptr;
+		return JoyTypeRegistry::IsDerived(obj->GetTypeInfo(), T::GetStaticTypeInfo()) ? static_cast<T*>(obj) : nullptr;
 	}
 }
@@ -0,0 +1,742 @@
+#include "MathBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+// All levels live in one translation unit, the AVX2 one is called only after the cpu check
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+// Generic kernels get __m256 from AVX2Ops, but they are only ever inlined into runAVX2, so no call crosses the ABI change
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	namespace jmath
+	{
+		namespace
+		{
+			// One kernel body is compiled for every level, Ops hide the register width
+
+			struct ScalarOps
+			{
+				using V = float;
+				static constexpr uint32_t width = 1;
+
+				static V load(const float* p) { return *p; }
+				static void store(float* p, V v) { *p = v; }
+				static V set(float f) { return f; }
+				static V add(V a, V b) { return a + b; }
+				static V sub(V a, V b) { return a - b; }
+				static V mul(V a, V b) { return a * b; }
+				static V mulAdd(V a, V b, V c) { return a * b + c; }
+				static V min(V a, V b) { return a < b ? a : b; }
+				static V max(V a, V b) { return a > b ? a : b; }
+				static V abs(V a) { return std::abs(a); }
+				// Bit per lane
+				static uint32_t greaterEqualMask(V a, V b) { return a >= b ? 1u : 0u; }
+			};
+
+			struct SSEOps
+			{
+				using V = __m128;
+				static constexpr uint32_t width = 4;
+
+				static V load(const float* p) { return _mm_load_ps(p); }
+				static void store(float* p, V v) { _mm_store_ps(p, v); }
+				static V set(float f) { return _mm_set1_ps(f); }
+				static V add(V a, V b) { return _mm_add_ps(a, b); }
+				static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+				static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+				static V mulAdd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+				static V min(V a, V b) { return _mm_min_ps(a, b); }
+				static V max(V a, V b) { return _mm_max_ps(a, b); }
+				static V abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+				static uint32_t greaterEqualMask(V a, V b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(a, b))); }
+			};
+
+			struct AVX2Ops
+			{
+				using V = __m256;
+				static constexpr uint32_t width = 8;
+
+				JMATH_TARGET_AVX2 static V load(const float* p) { return _mm256_load_ps(p); }
+				JMATH_TARGET_AVX2 static void store(float* p, V v) { _mm256_store_ps(p, v); }
+				JMATH_TARGET_AVX2 static V set(float f) { return _mm256_set1_ps(f); }
+				JMATH_TARGET_AVX2 static V add(V a, V b) { return _mm256_add_ps(a, b); }
+				JMATH_TARGET_AVX2 static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+				JMATH_TARGET_AVX2 static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+				JMATH_TARGET_AVX2 static V mulAdd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+				JMATH_TARGET_AVX2 static V min(V a, V b) { return _mm256_min_ps(a, b); }
+				JMATH_TARGET_AVX2 static V max(V a, V b) { return _mm256_max_ps(a, b); }
+				JMATH_TARGET_AVX2 static V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+				JMATH_TARGET_AVX2 static uint32_t greaterEqualMask(V a, V b) { return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GE_OQ))); }
+			};
+
+			static_assert(batchWidth % AVX2Ops::width == 0 && batchWidth % SSEOps::width == 0);
+
+			SimdLevel& currentSimdLevel()
+			{
+				static SimdLevel level = getSupportedSimdLevel();
+				return level;
+			}
+
+			// Kernel body is inlined here, so AVX2Ops are compiled with the AVX2 target
+			template <typename Kernel>
+			JMATH_FLATTEN_AVX2 void runAVX2(Kernel& kernel)
+			{
+				kernel(AVX2Ops());
+			}
+
+			template <typename Kernel>
+			void dispatch(Kernel&& kernel)
+			{
+				switch (currentSimdLevel())
+				{
+				case SimdLevel::AVX2:
+					runAVX2(kernel);
+					break;
+				case SimdLevel::SSE:
+					kernel(SSEOps());
+					break;
+				default:
+					kernel(ScalarOps());
+					break;
+				}
+			}
+
+			template <typename Ops>
+			void trsKernel(const vec3x8* translation, const quatx8* rotation, const vec3x8* scale, mat4x4x8* result, uint32_t count)
+			{
+				using V = typename Ops::V;
+				const V zero = Ops::set(0);
+				const V one = Ops::set(1);
+				const V two = Ops::set(2);
+
+				for (uint32_t b = 0; b < count; b++)
+				{
+					float (&m)[4][4][batchWidth] = result[b].m;
+					for (uint32_t l = 0; l < batchWidth; l += Ops::width)
+					{
+						const V x = Ops::load(rotation[b].x + l);
+						const V y = Ops::load(rotation[b].y + l);
+						const V z = Ops::load(rotation[b].z + l);
+						const V w = Ops::load(rotation[b].w + l);
+
+						const V x2 = Ops::mul(x, two);
+						const V y2 = Ops::mul(y, two);
+						const V z2 = Ops::mul(z, two);
+						const V xx = Ops::mul(x, x2);
+						const V yy = Ops::mul(y, y2);
+						const V zz = Ops::mul(z, z2);
+						const V xy = Ops::mul(x, y2);
+						const V xz = Ops::mul(x, z2);
+						const V yz = Ops::mul(y, z2);
+						const V wx = Ops::mul(w, x2);
+						const V wy = Ops::mul(w, y2);
+						const V wz = Ops::mul(w, z2);
+
+						// Rows of the rotation scaled by the scale axes, like XMMatrixAffineTransformation
+						const V sx = Ops::load(scale[b].x + l);
+						const V sy = Ops::load(scale[b].y + l);
+						const V sz = Ops::load(scale[b].z + l);
+
+						Ops::store(m[0][0] + l, Ops::mul(Ops::sub(one, Ops::add(yy, zz)), sx));
+						Ops::store(m[0][1] + l, Ops::mul(Ops::add(xy, wz), sx));
+						Ops::store(m[0][2] + l, Ops::mul(Ops::sub(xz, wy), sx));
+						Ops::store(m[0][3] + l, zero);
+
+						Ops::store(m[1][0] + l, Ops::mul(Ops::sub(xy, wz), sy));
+						Ops::store(m[1][1] + l, Ops::mul(Ops::sub(one, Ops::add(xx, zz)), sy));
+						Ops::store(m[1][2] + l, Ops::mul(Ops::add(yz, wx), sy));
+						Ops::store(m[1][3] + l, zero);
+
+						Ops::store(m[2][0] + l, Ops::mul(Ops::add(xz, wy), sz));
+						Ops::store(m[2][1] + l, Ops::mul(Ops::sub(yz, wx), sz));
+						Ops::store(m[2][2] + l, Ops::mul(Ops::sub(one, Ops::add(xx, yy)), sz));
+						Ops::store(m[2][3] + l, zero);
+
+						Ops::store(m[3][0] + l, Ops::load(translation[b].x + l));
+						Ops::store(m[3][1] + l, Ops::load(translation[b].y + l));
+						Ops::store(m[3][2] + l, Ops::load(translation[b].z + l));
+						Ops::store(m[3][3] + l, one);
+					}
+				}
+			}
+
+			template <typename Ops>
+			void mulKernel(const mat4x4x8* local, const mat4x4x8* parent, mat4x4x8* result, uint32_t count)
+			{
+				using V = typename Ops::V;
+
+				for (uint32_t b = 0; b < count; b++)
+				{
+					const float (&a)[4][4][batchWidth] = local[b].m;
+					const float (&p)[4][4][batchWidth] = parent[b].m;
+					float (&m)[4][4][batchWidth] = result[b].m;
+					for (uint32_t l = 0; l < batchWidth; l += Ops::width)
+					{
+						// result may be one of the inputs, parent rows are kept in registers
+						V pr[4][4];
+						for (uint32_t k = 0; k < 4; k++)
+						{
+							for (uint32_t c = 0; c < 4; c++)
+							{
+								pr[k][c] = Ops::load(p[k][c] + l);
+							}
+						}
+
+						for (uint32_t r = 0; r < 4; r++)
+						{
+							const V a0 = Ops::load(a[r][0] + l);
+							const V a1 = Ops::load(a[r][1] + l);
+							const V a2 = Ops::load(a[r][2] + l);
+							const V a3 = Ops::load(a[r][3] + l);
+							for (uint32_t c = 0; c < 4; c++)
+							{
+								V v = Ops::mul(a0, pr[0][c]);
+								v = Ops::mulAdd(a1, pr[1][c], v);
+								v = Ops::mulAdd(a2, pr[2][c], v);
+								v = Ops::mulAdd(a3, pr[3][c], v);
+								Ops::store(m[r][c] + l, v);
+							}
+						}
+					}
+				}
+			}
+
+			template <typename Ops, bool IsPoint>
+			void transformKernel(const mat4x4x8* matrices, const vec3x8* vectors, vec3x8* result, uint32_t count)
+			{
+				using V = typename Ops::V;
+
+				for (uint32_t b = 0; b < count; b++)
+				{
+					const float (&m)[4][4][batchWidth] = matrices[b].m;
+					float* out[3] = {result[b].x, result[b].y, result[b].z};
+					for (uint32_t l = 0; l < batchWidth; l += Ops::width)
+					{
+						const V x = Ops::load(vectors[b].x + l);
+						const V y = Ops::load(vectors[b].y + l);
+						const V z = Ops::load(vectors[b].z + l);
+
+						V v[3];
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							v[c] = IsPoint ? Ops::mulAdd(x, Ops::load(m[0][c] + l), Ops::load(m[3][c] + l)) : Ops::mul(x, Ops::load(m[0][c] + l));
+							v[c] = Ops::mulAdd(y, Ops::load(m[1][c] + l), v[c]);
+							v[c] = Ops::mulAdd(z, Ops::load(m[2][c] + l), v[c]);
+						}
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							Ops::store(out[c] + l, v[c]);
+						}
+					}
+				}
+			}
+
+			template <typename Ops>
+			void transformAABBKernel(const mat4x4x8* matrices, const aabbx8* boxes, aabbx8* result, uint32_t count)
+			{
+				using V = typename Ops::V;
+				const V half = Ops::set(0.5f);
+
+				for (uint32_t b = 0; b < count; b++)
+				{
+					const float (&m)[4][4][batchWidth] = matrices[b].m;
+					const vec3x8& boxMin = boxes[b].min;
+					const vec3x8& boxMax = boxes[b].max;
+					float* outMin[3] = {result[b].min.x, result[b].min.y, result[b].min.z};
+					float* outMax[3] = {result[b].max.x, result[b].max.y, result[b].max.z};
+					for (uint32_t l = 0; l < batchWidth; l += Ops::width)
+					{
+						// Center is transformed as a point, extents by absolute values of the matrix
+						const V minX = Ops::load(boxMin.x + l);
+						const V minY = Ops::load(boxMin.y + l);
+						const V minZ = Ops::load(boxMin.z + l);
+						const V maxX = Ops::load(boxMax.x + l);
+						const V maxY = Ops::load(boxMax.y + l);
+						const V maxZ = Ops::load(boxMax.z + l);
+						const V cx = Ops::mul(Ops::add(minX, maxX), half);
+						const V cy = Ops::mul(Ops::add(minY, maxY), half);
+						const V cz = Ops::mul(Ops::add(minZ, maxZ), half);
+						const V ex = Ops::mul(Ops::sub(maxX, minX), half);
+						const V ey = Ops::mul(Ops::sub(maxY, minY), half);
+						const V ez = Ops::mul(Ops::sub(maxZ, minZ), half);
+
+						V center[3];
+						V extent[3];
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							const V m0 = Ops::load(m[0][c] + l);
+							const V m1 = Ops::load(m[1][c] + l);
+							const V m2 = Ops::load(m[2][c] + l);
+							center[c] = Ops::mulAdd(cz, m2, Ops::mulAdd(cy, m1, Ops::mulAdd(cx, m0, Ops::load(m[3][c] + l))));
+							extent[c] = Ops::mulAdd(ez, Ops::abs(m2), Ops::mulAdd(ey, Ops::abs(m1), Ops::mul(ex, Ops::abs(m0))));
+						}
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							Ops::store(outMin[c] + l, Ops::sub(center[c], extent[c]));
+							Ops::store(outMax[c] + l, Ops::add(center[c], extent[c]));
+						}
+					}
+				}
+			}
+
+			template <typename Ops>
+			void sphereFrustumKernel(const vec4 planes[6], const spherex8* spheres, uint8_t* visibleMasks, uint32_t count)
+			{
+				using V = typename Ops::V;
+
+				V planeX[6], planeY[6], planeZ[6], planeW[6];
+				for (uint32_t i = 0; i < 6; i++)
+				{
+					planeX[i] = Ops::set(planes[i].x);
+					planeY[i] = Ops::set(planes[i].y);
+					planeZ[i] = Ops::set(planes[i].z);
+					planeW[i] = Ops::set(planes[i].w);
+				}
+
+				for (uint32_t b = 0; b < count; b++)
+				{
+					uint32_t mask = 0;
+					for (uint32_t l = 0; l < batchWidth; l += Ops::width)
+					{
+						const V x = Ops::load(spheres[b].center.x + l);
+						const V y = Ops::load(spheres[b].center.y + l);
+						const V z = Ops::load(spheres[b].center.z + l);
+						const V negativeRadius = Ops::sub(Ops::set(0), Ops::load(spheres[b].radius + l));
+
+						// The sphere is outside when it's behind any plane by more than its radius
+						V minDistance = Ops::set(std::numeric_limits<float>::max());
+						for (uint32_t i = 0; i < 6; i++)
+						{
+							const V distance = Ops::mulAdd(x, planeX[i], Ops::mulAdd(y, planeY[i], Ops::mulAdd(z, planeZ[i], planeW[i])));
+							minDistance = Ops::min(minDistance, distance);
+						}
+						mask |= Ops::greaterEqualMask(minDistance, negativeRadius) << l;
+					}
+					visibleMasks[b] = static_cast<uint8_t>(mask);
+				}
+			}
+
+			bool isNear(float a, float b, float tolerance)
+			{
+				return std::abs(a - b) <= tolerance * std::max({1.0f, std::abs(a), std::abs(b)});
+			}
+
+			bool isNear(const mat4x4x8& a, const mat4x4x8& b, float tolerance)
+			{
+				for (uint32_t r = 0; r < 4; r++)
+					for (uint32_t c = 0; c < 4; c++)
+						for (uint32_t l = 0; l < batchWidth; l++)
+							if (!isNear(a.m[r][c][l], b.m[r][c][l], tolerance)) return false;
+				return true;
+			}
+
+			bool isNear(const vec3x8& a, const vec3x8& b, float tolerance)
+			{
+				for (uint32_t l = 0; l < batchWidth; l++)
+				{
+					if (!isNear(a.x[l], b.x[l], tolerance) ||
+						!isNear(a.y[l], b.y[l], tolerance) ||
+						!isNear(a.z[l], b.z[l], tolerance))
+						return false;
+				}
+				return true;
+			}
+
+			bool isNear(const mat4x4& a, const mat4x4& b, float tolerance)
+			{
+				DirectX::XMFLOAT4X4 fa, fb;
+				DirectX::XMStoreFloat4x4(&fa, a);
+				DirectX::XMStoreFloat4x4(&fb, b);
+				for (uint32_t r = 0; r < 4; r++)
+					for (uint32_t c = 0; c < 4; c++)
+						if (!isNear(fa.m[r][c], fb.m[r][c], tolerance)) return false;
+				return true;
+			}
+
+			bool isNear(const vec3& a, const vec3& b, float tolerance)
+			{
+				return isNear(a.x, b.x, tolerance) && isNear(a.y, b.y, tolerance) && isNear(a.z, b.z, tolerance);
+			}
+
+			// Random transforms, boxes and spheres around the camera, filled the same for the test and the benchmark
+			struct BatchData
+			{
+				explicit BatchData(uint32_t count) :
+					translation(count),
+					rotation(count),
+					scale(count),
+					local(count),
+					parent(count),
+					points(count),
+					boxes(count),
+					spheres(count)
+				{
+					std::mt19937 generator(count);
+					std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+					std::uniform_real_distribution<float> angle(0.0f, 6.28f);
+					std::uniform_real_distribution<float> scaleValue(0.5f, 3.0f);
+					std::uniform_real_distribution<float> size(0.1f, 10.0f);
+
+					for (uint32_t b = 0; b < count; b++)
+					{
+						for (uint32_t l = 0; l < batchWidth; l++)
+						{
+							setLane(translation[b], l, vec3(position(generator), position(generator), position(generator)));
+							setLane(rotation[b], l, eulerToQuat(vec3(angle(generator), angle(generator), angle(generator))));
+							setLane(scale[b], l, vec3(scaleValue(generator), scaleValue(generator), scaleValue(generator)));
+							setLane(points[b], l, vec3(position(generator), position(generator), position(generator)));
+
+							const vec3 boxMin(position(generator), position(generator), position(generator));
+							setLane(boxes[b].min, l, boxMin);
+							setLane(boxes[b].max, l, vec3(boxMin.x + size(generator), boxMin.y + size(generator), boxMin.z + size(generator)));
+
+							setLane(spheres[b].center, l, vec3(position(generator), position(generator), position(generator)));
+							spheres[b].radius[l] = size(generator);
+						}
+					}
+
+					// Local and parent matrices are the same kind of transforms
+					trsBatch(translation.data(), rotation.data(), scale.data(), local.data(), count);
+					parent.assign(local.rbegin(), local.rend());
+				}
+
+				std::vector<vec3x8> translation;
+				std::vector<quatx8> rotation;
+				std::vector<vec3x8> scale;
+				std::vector<mat4x4x8> local;
+				std::vector<mat4x4x8> parent;
+				std::vector<vec3x8> points;
+				std::vector<aabbx8> boxes;
+				std::vector<spherex8> spheres;
+			};
+
+			void getTestFrustum(vec4 planes[6])
+			{
+				const mat4x4 view = lookAtLH(loadPosition(vec3(10, 5, -20)), loadPosition(vec3(0, 0, 40)), xup);
+				const mat4x4 projection = perspectiveFovLH_ZO(toRadians(60), 16, 9, 0.1f, 150.0f);
+				getFrustumPlanes(mul(view, projection), planes);
+			}
+		}
+
+		SimdLevel getSupportedSimdLevel()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) return SimdLevel::SSE;
+
+			__cpuid(info, 1);
+			const bool hasFMA = info[2] & (1 << 12);
+			const bool hasOSXSAVE = info[2] & (1 << 27);
+			const bool hasAVX = info[2] & (1 << 28);
+			if (!hasFMA || !hasOSXSAVE || !hasAVX) return SimdLevel::SSE;
+
+			// OS saves ymm registers
+			if ((_xgetbv(0) & 6) != 6) return SimdLevel::SSE;
+
+			__cpuidex(info, 7, 0);
+			return info[1] & (1 << 5) ? SimdLevel::AVX2 : SimdLevel::SSE;
+#else
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? SimdLevel::AVX2 : SimdLevel::SSE;
+#endif
+		}
+
+		SimdLevel getSimdLevel()
+		{
+			return currentSimdLevel();
+		}
+
+		void setSimdLevel(SimdLevel level)
+		{
+			currentSimdLevel() = std::min(level, getSupportedSimdLevel());
+		}
+
+		const char* toString(SimdLevel level)
+		{
+			switch (level)
+			{
+			case SimdLevel::AVX2: return "AVX2";
+			case SimdLevel::SSE: return "SSE";
+			default: return "Scalar";
+			}
+		}
+
+		void setLane(vec3x8& batch, uint32_t lane, const vec3& v)
+		{
+			batch.x[lane] = v.x;
+			batch.y[lane] = v.y;
+			batch.z[lane] = v.z;
+		}
+
+		void setLane(quatx8& batch, uint32_t lane, const quat& q)
+		{
+			vec4 v;
+			DirectX::XMStoreFloat4(&v, q);
+			batch.x[lane] = v.x;
+			batch.y[lane] = v.y;
+			batch.z[lane] = v.z;
+			batch.w[lane] = v.w;
+		}
+
+		void setLane(mat4x4x8& batch, uint32_t lane, const mat4x4& m)
+		{
+			DirectX::XMFLOAT4X4 data;
+			DirectX::XMStoreFloat4x4(&data, m);
+			for (uint32_t r = 0; r < 4; r++)
+			{
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					batch.m[r][c][lane] = data.m[r][c];
+				}
+			}
+		}
+
+		vec3 getLane(const vec3x8& batch, uint32_t lane)
+		{
+			return vec3(batch.x[lane], batch.y[lane], batch.z[lane]);
+		}
+
+		mat4x4 getLane(const mat4x4x8& batch, uint32_t lane)
+		{
+			DirectX::XMFLOAT4X4 data;
+			for (uint32_t r = 0; r < 4; r++)
+			{
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					data.m[r][c] = batch.m[r][c][lane];
+				}
+			}
+			return DirectX::XMLoadFloat4x4(&data);
+		}
+
+		void trsBatch(const vec3x8* translation, const quatx8* rotation, const vec3x8* scale, mat4x4x8* result, uint32_t count)
+		{
+			dispatch([&]<typename Ops>(Ops) { trsKernel<Ops>(translation, rotation, scale, result, count); });
+		}
+
+		void mulBatch(const mat4x4x8* local, const mat4x4x8* parent, mat4x4x8* result, uint32_t count)
+		{
+			dispatch([&]<typename Ops>(Ops) { mulKernel<Ops>(local, parent, result, count); });
+		}
+
+		void transformPointsBatch(const mat4x4x8* matrices, const vec3x8* points, vec3x8* result, uint32_t count)
+		{
+			dispatch([&]<typename Ops>(Ops) { transformKernel<Ops, true>(matrices, points, result, count); });
+		}
+
+		void transformVectorsBatch(const mat4x4x8* matrices, const vec3x8* vectors, vec3x8* result, uint32_t count)
+		{
+			dispatch([&]<typename Ops>(Ops) { transformKernel<Ops, false>(matrices, vectors, result, count); });
+		}
+
+		void transformAABBBatch(const mat4x4x8* matrices, const aabbx8* boxes, aabbx8* result, uint32_t count)
+		{
+			dispatch([&]<typename Ops>(Ops) { transformAABBKernel<Ops>(matrices, boxes, result, count); });
+		}
+
+		void getFrustumPlanes(const mat4x4& viewProjection, vec4 planes[6])
+		{
+			// Clip position is v * M, so planes are combinations of the matrix columns (Gribb, Hartmann)
+			DirectX::XMFLOAT4X4 m;
+			DirectX::XMStoreFloat4x4(&m, viewProjection);
+			const auto column = [&m](uint32_t c) { return vec4(m.m[0][c], m.m[1][c], m.m[2][c], m.m[3][c]); };
+			const vec4 x = column(0);
+			const vec4 y = column(1);
+			const vec4 z = column(2);
+			const vec4 w = column(3);
+
+			planes[0] = vec4(w.x + x.x, w.y + x.y, w.z + x.z, w.w + x.w); // left
+			planes[1] = vec4(w.x - x.x, w.y - x.y, w.z - x.z, w.w - x.w); // right
+			planes[2] = vec4(w.x + y.x, w.y + y.y, w.z + y.z, w.w + y.w); // bottom
+			planes[3] = vec4(w.x - y.x, w.y - y.y, w.z - y.z, w.w - y.w); // top
+			planes[4] = z; // near, depth starts at zero
+			planes[5] = vec4(w.x - z.x, w.y - z.y, w.z - z.z, w.w - z.w); // far
+
+			for (uint32_t i = 0; i < 6; i++)
+			{
+				const float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+				planes[i] = planes[i] * (1.0f / length);
+			}
+		}
+
+		void sphereFrustumBatch(const vec4 planes[6], const spherex8* spheres, uint8_t* visibleMasks, uint32_t count)
+		{
+			dispatch([&]<typename Ops>(Ops) { sphereFrustumKernel<Ops>(planes, spheres, visibleMasks, count); });
+		}
+
+		bool testBatchKernels()
+		{
+			bool isSuccess = true;
+			constexpr float tolerance = 1e-4f;
+
+			const SimdLevel savedLevel = getSimdLevel();
+			constexpr uint32_t count = 64;
+			const BatchData data(count);
+
+			vec4 planes[6];
+			getTestFrustum(planes);
+
+			struct Results
+			{
+				explicit Results(uint32_t count) :
+					trs(count),
+					world(count),
+					points(count),
+					vectors(count),
+					boxes(count),
+					masks(count)
+				{
+				}
+
+				std::vector<mat4x4x8> trs;
+				std::vector<mat4x4x8> world;
+				std::vector<vec3x8> points;
+				std::vector<vec3x8> vectors;
+				std::vector<aabbx8> boxes;
+				std::vector<uint8_t> masks;
+			};
+
+			const auto run = [&](SimdLevel level, Results& results)
+			{
+				setSimdLevel(level);
+				trsBatch(data.translation.data(), data.rotation.data(), data.scale.data(), results.trs.data(), count);
+				mulBatch(data.local.data(), data.parent.data(), results.world.data(), count);
+				transformPointsBatch(data.local.data(), data.points.data(), results.points.data(), count);
+				transformVectorsBatch(data.local.data(), data.points.data(), results.vectors.data(), count);
+				transformAABBBatch(data.local.data(), data.boxes.data(), results.boxes.data(), count);
+				sphereFrustumBatch(planes, data.spheres.data(), results.masks.data(), count);
+			};
+
+			Results reference(count);
+			run(SimdLevel::Scalar, reference);
+
+			// Scalar reference against single value jmath. Spheres closer than the tolerance to a plane may go either way
+			std::vector<uint8_t> ambiguousMasks(count, 0);
+			for (uint32_t b = 0; b < count; b++)
+			{
+				for (uint32_t l = 0; l < batchWidth; l++)
+				{
+					const mat4x4 m = getLane(data.local[b], l);
+					const vec3 p = getLane(data.points[b], l);
+
+					const mat4x4 trsMatrix = trs(
+						loadPosition(getLane(data.translation[b], l)),
+						loadVec4(vec4(data.rotation[b].x[l], data.rotation[b].y[l], data.rotation[b].z[l], data.rotation[b].w[l])),
+						loadPosition(getLane(data.scale[b], l)));
+
+					// Box corners transformed one by one
+					vec3 boxMin(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+					vec3 boxMax(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+					for (uint32_t corner = 0; corner < 8; corner++)
+					{
+						const vec3 local(
+							(corner & 1 ? data.boxes[b].max : data.boxes[b].min).x[l],
+							(corner & 2 ? data.boxes[b].max : data.boxes[b].min).y[l],
+							(corner & 4 ? data.boxes[b].max : data.boxes[b].min).z[l]);
+						const vec3 world = toVec3(mul(m, loadPosition(local)));
+						boxMin = min(boxMin, world);
+						boxMax = max(boxMax, world);
+					}
+
+					bool isVisible = true;
+					for (uint32_t i = 0; i < 6; i++)
+					{
+						const vec3 c = getLane(data.spheres[b].center, l);
+						const float distance = c.x * planes[i].x + c.y * planes[i].y + c.z * planes[i].z + planes[i].w;
+						isVisible &= distance >= -data.spheres[b].radius[l];
+						if (std::abs(distance + data.spheres[b].radius[l]) < 1e-3f)
+						{
+							ambiguousMasks[b] |= 1 << l;
+						}
+					}
+
+					if (!isNear(getLane(reference.trs[b], l), trsMatrix, tolerance) ||
+						!isNear(getLane(reference.world[b], l), mul(m, getLane(data.parent[b], l)), tolerance) ||
+						!isNear(getLane(reference.points[b], l), toVec3(mul(m, loadPosition(p))), tolerance) ||
+						!isNear(getLane(reference.vectors[b], l), toVec3(mul(m, loadVec4(vec4(p.x, p.y, p.z, 0)))), tolerance) ||
+						!isNear(getLane(reference.boxes[b].min, l), boxMin, tolerance) ||
+						!isNear(getLane(reference.boxes[b].max, l), boxMax, tolerance) ||
+						((ambiguousMasks[b] >> l & 1) == 0 && (reference.masks[b] >> l & 1) != (isVisible ? 1 : 0)))
+					{
+						Logger::LogFormat("jmath batch: scalar kernels differ from jmath on element %u\n", b * batchWidth + l);
+						isSuccess = false;
+					}
+				}
+			}
+
+			// Frustum planes against clip space of the same matrix
+			{
+				const mat4x4 view = lookAtLH(loadPosition(vec3(10, 5, -20)), loadPosition(vec3(0, 0, 40)), xup);
+				const mat4x4 projection = perspectiveFovLH_ZO(toRadians(60), 16, 9, 0.1f, 150.0f);
+				const mat4x4 viewProjection = mul(view, projection);
+
+				uint32_t insideCount = 0;
+				for (uint32_t b = 0; b < count; b++)
+				{
+					for (uint32_t l = 0; l < batchWidth; l++)
+					{
+						const vec3 p = getLane(data.points[b], l);
+						vec4 clip;
+						DirectX::XMStoreFloat4(&clip, mul(viewProjection, loadPosition(p)));
+						const bool isInsideClip = std::abs(clip.x) <= clip.w && std::abs(clip.y) <= clip.w && clip.z >= 0 && clip.z <= clip.w;
+
+						float minDistance = std::numeric_limits<float>::max();
+						for (uint32_t i = 0; i < 6; i++)
+						{
+							minDistance = std::min(minDistance, p.x * planes[i].x + p.y * planes[i].y + p.z * planes[i].z + planes[i].w);
+						}
+						if (std::abs(minDistance) > 1e-3f && isInsideClip != (minDistance >= 0))
+						{
+							Logger::LogFormat("jmath batch: frustum planes disagree with clip space at %.2f %.2f %.2f\n", p.x, p.y, p.z);
+							isSuccess = false;
+						}
+						insideCount += isInsideClip;
+					}
+				}
+				if (insideCount == 0)
+				{
+					Logger::Log("jmath batch: no test point is inside the frustum\n");
+					isSuccess = false;
+				}
+			}
+
+			// Vector levels against the scalar reference
+			for (const SimdLevel level : {SimdLevel::SSE, SimdLevel::AVX2})
+			{
+				if (level > getSupportedSimdLevel()) continue;
+
+				Results results(count);
+				run(level, results);
+				for (uint32_t b = 0; b < count; b++)
+				{
+					if (!isNear(results.trs[b], reference.trs[b], tolerance) ||
+						!isNear(results.world[b], reference.world[b], tolerance) ||
+						!isNear(results.points[b], reference.points[b], tolerance) ||
+						!isNear(results.vectors[b], reference.vectors[b], tolerance) ||
+						!isNear(results.boxes[b].min, reference.boxes[b].min, tolerance) ||
+						!isNear(results.boxes[b].max, reference.boxes[b].max, tolerance) ||
+						((results.masks[b] ^ reference.masks[b]) & ~ambiguousMasks[b]) != 0)
+					{
+						Logger::LogFormat("jmath batch: %s kernels differ from scalar ones in batch %u\n", toString(level), b);
+						isSuccess = false;
+						break;
+					}
+				}
+			}
+
+			setSimdLevel(savedLevel);
+			return isSuccess;
+		}
+	}
+}
@@ -0,0 +1,105 @@
+#ifndef MATH_BATCH_H
+#define MATH_BATCH_H
+
+#include <cstdint>
+
+#include "MathTypes.h"
+
+// AVX2 code is compiled without /arch:AVX2 or -mavx2 and runs only after getSupportedSimdLevel() allows it.
+// MSVC emits AVX2 intrinsics in any function, GCC and Clang need the target on every function that uses them,
+// and JMATH_FLATTEN_AVX2 inlines generic kernels into such function
+#if defined(_MSC_VER)
+#define JMATH_TARGET_AVX2
+#define JMATH_FLATTEN_AVX2
+#else
+#define JMATH_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define JMATH_FLATTEN_AVX2 __attribute__((target("avx2,fma"), flatten))
+#endif
+
+namespace JoyEngine
+{
+	namespace jmath
+	{
+		// Batch kernels work on arrays of structures of arrays: every batch holds batchWidth values
+		// with one array per component, so a vector register loads one component of all of them.
+		// Kernels take count of batches, unused lanes are computed too and can hold anything finite.
+		inline constexpr uint32_t batchWidth = 8;
+
+		struct alignas(32) vec3x8
+		{
+			float x[batchWidth];
+			float y[batchWidth];
+			float z[batchWidth];
+		};
+
+		struct alignas(32) quatx8
+		{
+			float x[batchWidth];
+			float y[batchWidth];
+			float z[batchWidth];
+			float w[batchWidth];
+		};
+
+		// m[row][column][lane], row vector convention like mat4x4
+		struct alignas(32) mat4x4x8
+		{
+			float m[4][4][batchWidth];
+		};
+
+		struct alignas(32) aabbx8
+		{
+			vec3x8 min;
+			vec3x8 max;
+		};
+
+		struct alignas(32) spherex8
+		{
+			vec3x8 center;
+			float radius[batchWidth];
+		};
+
+		// Kernels use the level set here, by default the best one the cpu supports
+		enum class SimdLevel : uint32_t
+		{
+			Scalar,
+			SSE,
+			AVX2
+		};
+
+		SimdLevel getSupportedSimdLevel();
+		SimdLevel getSimdLevel();
+		// Clamped to the supported level, for tests and benchmarks
+		void setSimdLevel(SimdLevel level);
+		const char* toString(SimdLevel level);
+
+		void setLane(vec3x8& batch, uint32_t lane, const vec3& v);
+		void setLane(quatx8& batch, uint32_t lane, const quat& q);
+		void setLane(mat4x4x8& batch, uint32_t lane, const mat4x4& m);
+		vec3 getLane(const vec3x8& batch, uint32_t lane);
+		mat4x4 getLane(const mat4x4x8& batch, uint32_t lane);
+
+		// Same as trs for every lane
+		void trsBatch(const vec3x8* translation, const quatx8* rotation, const vec3x8* scale, mat4x4x8* result, uint32_t count);
+
+		// Same as mul(local, parent): world matrices of children from their local and parent world matrices
+		void mulBatch(const mat4x4x8* local, const mat4x4x8* parent, mat4x4x8* result, uint32_t count);
+
+		// Lane i is transformed by matrix i as a point (w = 1) or as a direction (w = 0), w of the result is dropped
+		void transformPointsBatch(const mat4x4x8* matrices, const vec3x8* points, vec3x8* result, uint32_t count);
+		void transformVectorsBatch(const mat4x4x8* matrices, const vec3x8* vectors, vec3x8* result, uint32_t count);
+
+		// Smallest world box around the transformed local box, matrices are affine
+		void transformAABBBatch(const mat4x4x8* matrices, const aabbx8* boxes, aabbx8* result, uint32_t count);
+
+		// Planes with normals pointing inside (x, y, z) and distance w, for the left handed zero to one depth projection
+		void getFrustumPlanes(const mat4x4& viewProjection, vec4 planes[6]);
+
+		// Bit i of visibleMasks[b] is set when sphere i of batch b is not completely outside of any plane
+		void sphereFrustumBatch(const vec4 planes[6], const spherex8* spheres, uint8_t* visibleMasks, uint32_t count);
+
+		// Checks every supported level against the scalar reference and the scalar reference against single value jmath,
+		// restores the level. Logs failures
+		bool testBatchKernels();
+	}
+}
+#endif // MATH_BATCH_H
@@ -27,9 +27,6 @@ namespace JoyEngine
 
 		float toRadians(float degree)
 		{
-			vec3 a;
-			vec3 b;
-			vec3 c = (a + b) * 0.5f;
 			return DirectX::XMConvertToRadians(degree);
 		}
 
@@ -3,7 +3,7 @@
 
 #include <utility>
 
-#include "directxmath.h"
+#include "DirectXMath.h"
 #include "DirectXPackedVector.h"
 
 namespace JoyEngine
@@ -27,7 +27,7 @@ namespace JoyEngine
 			PODVector<T> operator+(const PODVector<T>& a) const
 			{
 				T result;
-				for (int i = 0; i < sizeof(T) / sizeof(float); i++)
+				for (size_t i = 0; i < sizeof(T) / sizeof(float); i++)
 				{
 					*(reinterpret_cast<float*>(&result) + i) =
 						this->operator[](i) + a[i];
@@ -38,7 +38,7 @@ namespace JoyEngine
 			PODVector<T> operator*(const PODVector<T>& a) const
 			{
 				T result;
-				for (int i = 0; i < sizeof(T) / sizeof(float); i++)
+				for (size_t i = 0; i < sizeof(T) / sizeof(float); i++)
 				{
 					*(reinterpret_cast<float*>(&result) + i) =
 						this->operator[](i) * a[i];
@@ -49,7 +49,7 @@ namespace JoyEngine
 			PODVector<T> operator*(float val) const
 			{
 				T result;
-				for (int i = 0; i < sizeof(T) / sizeof(float); i++)
+				for (size_t i = 0; i < sizeof(T) / sizeof(float); i++)
 				{
 					*(reinterpret_cast<float*>(&result) + i) =
 						this->operator[](i) * val;
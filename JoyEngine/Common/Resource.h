@@ -23,18 +23,9 @@ namespace JoyEngine
 
 		~Resource() override = default;
 
-		[[nodiscard]] int32_t GetRefCount() const { return m_refCount; }
-
-		void AddRef() { m_refCount++; }
-
-		void RemoveRef() { m_refCount--; }
-
 		[[nodiscard]] virtual bool IsLoaded() const noexcept = 0;
 		[[nodiscard]] uint64_t GetResourceId() const noexcept { return m_resourceId; }
 
-	private:
-		int32_t m_refCount = 0;
-
 	protected:
 		const uint64_t m_resourceId;
 	};
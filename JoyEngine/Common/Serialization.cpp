@@ -1,54 +1,259 @@
 #include "Serialization.h"
 
+#include <memory>
+
 #include "SerializationUtils.h"
+#include "Benchmarks/BenchmarkSuite.h"
+#include "Benchmarks/TestSuite.h"
+#include "SceneManager/GameObject.h"
+#include "SceneManager/WorldManager.h"
+#include "Utils/Log.h"
 
 namespace JoyEngine
 {
 	SerializableClassFactory* SerializableClassFactory::m_instance = nullptr;
 
-	void SerializableClassFactory::RegisterClass(const std::string& className, SerializedObjectCreatorBase* creator)
-	{
-		GetInstance()->m_classCreatorStorage.insert(std::make_pair(className, creator));
-	}
-
-	void SerializableClassFactory::RegisterClassFieldOffset(const std::string& className, const std::string& filedName,
-	                                                        FieldInfo fieldInfo)
+	namespace
 	{
-		if (GetInstance()->m_fieldOffsetStorage.find(className) == GetInstance()->m_fieldOffsetStorage.end())
+		// Writes binary field data in the same form as JSON field value
+		void AddJsonField(rapidjson::Value& fieldsJson, const ReflectedField& field, const uint8_t* data,
+		                  rapidjson::Document::AllocatorType& allocator)
 		{
-			GetInstance()->m_fieldOffsetStorage.insert({className, std::map<std::string, FieldInfo>()});
+			rapidjson::Value value;
+			switch (field.typeHash)
+			{
+			case StrHash32("int"):
+				value.SetInt(*reinterpret_cast<const int32_t*>(data));
+				break;
+			case StrHash32("uint"):
+				value.SetUint(*reinterpret_cast<const uint32_t*>(data));
+				break;
+			case StrHash32("float"):
+				value.SetFloat(*reinterpret_cast<const float*>(data));
+				break;
+			default:
+				{
+					value.SetArray();
+					for (uint32_t i = 0; i < field.size / sizeof(float); i++)
+					{
+						value.PushBack(reinterpret_cast<const float*>(data)[i], allocator);
+					}
+					break;
+				}
+			}
+			fieldsJson.AddMember(rapidjson::StringRef(field.name), value, allocator);
 		}
-		if (GetInstance()->m_fieldOffsetStorage[className].find(filedName) == GetInstance()->m_fieldOffsetStorage[
-			className].end())
+
+		DECLARE_CLASS(SerializationTestBase)
+		DECLARE_CLASS(SerializationTestDerived)
+
+		// Classes of the round trip test, fields of the base class have to be serialized with the fields of the derived one
+		class SerializationTestBase : public Serializable
 		{
-			GetInstance()->m_fieldOffsetStorage[className].insert({filedName, fieldInfo});
-		}
-		else
+			DECLARE_JOY_OBJECT(SerializationTestBase, Serializable);
+
+		public:
+			REFLECT_FIELD(float, m_baseValue);
+			REFLECT_FIELD(uint32_t, m_baseCount);
+
+			explicit SerializationTestBase(GameObject&)
+			{
+			}
+		};
+
+		class SerializationTestDerived final : public SerializationTestBase
+		{
+			DECLARE_JOY_OBJECT(SerializationTestDerived, SerializationTestBase);
+
+		public:
+			REFLECT_FIELD(jmath::vec3, m_derivedPosition);
+
+			explicit SerializationTestDerived(GameObject& go) :
+				SerializationTestBase(go)
+			{
+			}
+		};
+
+		// Field bytes that are valid values of any serialized type
+		std::vector<uint8_t> GetFieldsPattern(uint32_t size, uint32_t seed)
 		{
-			GetInstance()->m_fieldOffsetStorage[className][filedName].fieldOffset = fieldInfo.fieldOffset;
+			std::vector<uint8_t> pattern(size);
+			for (uint32_t i = 0; i < size / sizeof(float); i++)
+			{
+				const float value = static_cast<float>((seed + i) % 100) / 100.0f;
+				memcpy(pattern.data() + i * sizeof(float), &value, sizeof(float));
+			}
+			return pattern;
 		}
 	}
 
+	void SerializableClassFactory::RegisterClass(const std::string& className, SerializedObjectCreatorBase* creator)
+	{
+		GetInstance()->m_classCreatorStorage.insert(std::make_pair(className, creator));
+		GetInstance()->m_classCreatorsByHash.insert(std::make_pair(StrHash32(className.c_str()), creator));
+	}
+
 	std::unique_ptr<Serializable> SerializableClassFactory::Deserialize(
 		GameObject& go,
-		rapidjson::Value& fieldsJson,
+		const rapidjson::Value& fieldsJson,
 		const std::string& className)
 	{
 		ASSERT(GetInstance()->m_classCreatorStorage.contains(className));
 
 		SerializedObjectCreatorBase* creator = GetInstance()->m_classCreatorStorage.find(className)->second;
 		std::unique_ptr<Serializable> object = creator->Create(go);
-		ASSERT(GetInstance()->m_fieldOffsetStorage.contains(className));
+		creator->ReadJson(object.get(), fieldsJson);
+		return std::move(object);
+	}
+
+	void SerializableClassFactory::Serialize(Serializable* object, BinaryWriter& writer)
+	{
+		const uint32_t classHash = StrHash32(object->GetClassname());
+		ASSERT(GetInstance()->m_classCreatorsByHash.contains(classHash));
+
+		SerializedObjectCreatorBase* creator = GetInstance()->m_classCreatorsByHash.find(classHash)->second;
+		writer.Write(classHash);
+		writer.Write(creator->GetSchemaHash());
+		creator->WriteBinary(object, writer);
+	}
+
+	std::unique_ptr<Serializable> SerializableClassFactory::Deserialize(GameObject& go, BinaryReader& reader)
+	{
+		const uint32_t classHash = reader.Read<uint32_t>();
+		ASSERT(GetInstance()->m_classCreatorsByHash.contains(classHash));
+
+		SerializedObjectCreatorBase* creator = GetInstance()->m_classCreatorsByHash.find(classHash)->second;
+		const uint32_t schemaHash = reader.Read<uint32_t>();
+		ASSERT_DESC(schemaHash == creator->GetSchemaHash(), "Binary data was written with other fields");
+		std::unique_ptr<Serializable> object = creator->Create(go);
+		creator->ReadBinary(object.get(), reader);
+		return std::move(object);
+	}
+
+	bool SerializableClassFactory::Test(GameObject& go)
+	{
+		bool isCorrect = true;
+		uint32_t seed = 0;
+		for (const auto& [className, creator] : GetInstance()->m_classCreatorStorage)
+		{
+			const std::vector<uint8_t> pattern = GetFieldsPattern(creator->GetBinarySize(), seed++);
+
+			std::unique_ptr<Serializable> object = creator->Create(go);
+			BinaryReader patternReader(pattern.data(), pattern.size());
+			creator->ReadBinary(object.get(), patternReader);
+
+			BinaryWriter writer;
+			GetInstance()->Serialize(object.get(), writer);
+			BinaryReader reader(writer.GetData().data(), writer.GetData().size());
+			const std::unique_ptr<Serializable> binaryObject = GetInstance()->Deserialize(go, reader);
+
+			rapidjson::Document document;
+			rapidjson::Value fieldsJson(rapidjson::kObjectType);
+			const uint8_t* fieldData = pattern.data();
+			for (const ReflectedField& field : creator->GetFields())
+			{
+				AddJsonField(fieldsJson, field, fieldData, document.GetAllocator());
+				fieldData += field.size;
+			}
+			const std::unique_ptr<Serializable> jsonObject = GetInstance()->Deserialize(go, fieldsJson, className);
 
-		auto fieldOffsetStorage = GetInstance()->m_fieldOffsetStorage[className];
-		for (auto member = fieldsJson.MemberBegin(); member != fieldsJson.MemberEnd(); ++member)
+			BinaryWriter binaryObjectWriter;
+			creator->WriteBinary(binaryObject.get(), binaryObjectWriter);
+			BinaryWriter jsonObjectWriter;
+			creator->WriteBinary(jsonObject.get(), jsonObjectWriter);
+
+			if (!reader.IsEnd() ||
+				binaryObjectWriter.GetData() != pattern ||
+				jsonObjectWriter.GetData() != pattern)
+			{
+				Logger::LogFormat(LogLevel::Error, "    check failed: %s fields are not the same after binary or JSON round trip\n",
+				                  className.c_str());
+				isCorrect = false;
+			}
+		}
+
+		isCorrect &= TEST_CHECK(ReflectedFields<SerializationTestDerived>::count == 3, "base class fields are not in the field table");
+
+		SerializationTestDerived object(go);
+		object.m_baseValue = 0.25f;
+		object.m_baseCount = 7;
+		object.m_derivedPosition = jmath::vec3(1.0f, 2.0f, 3.0f);
+
+		BinaryWriter writer;
+		GetInstance()->Serialize(&object, writer);
+		BinaryReader reader(writer.GetData().data(), writer.GetData().size());
+		const std::unique_ptr<Serializable> readObject = GetInstance()->Deserialize(go, reader);
+		const SerializationTestDerived* derived = JoyCast<SerializationTestDerived>(readObject.get());
+		isCorrect &= TEST_CHECK(derived != nullptr, "derived class is not created from binary data");
+		if (derived != nullptr)
 		{
-			const std::string fieldName = member->name.GetString();
-			uint32_t typeHash = fieldOffsetStorage[fieldName].typeHash;
-			void* fieldOffset = fieldOffsetStorage[fieldName].fieldOffset;
-			rapidjson::Value& val = member->value;
-			SerializationUtils::DeserializeAndWriteCppToPtr(typeHash, val, fieldOffset);
+			isCorrect &= TEST_CHECK(derived->m_baseValue == 0.25f && derived->m_baseCount == 7, "base class fields are lost in binary round trip");
+			isCorrect &= TEST_CHECK(derived->m_derivedPosition.x == 1.0f && derived->m_derivedPosition.z == 3.0f,
+			                        "derived class fields are lost in binary round trip");
 		}
-		return std::move(object);
+		return isCorrect;
+	}
+
+	void SerializableClassFactory::AddBenchmarks(BenchmarkSuite& suite, const char* className)
+	{
+		const auto it = GetInstance()->m_classCreatorStorage.find(className);
+		if (it == GetInstance()->m_classCreatorStorage.end()) return;
+		SerializedObjectCreatorBase* creator = it->second;
+
+		constexpr uint32_t count = 100000;
+
+		// Objects need a game object with a transform, so it is created by the first prepare when the engine is running
+		struct SerializationData
+		{
+			std::string className;
+			std::unique_ptr<GameObject> go;
+			rapidjson::Document document;
+			rapidjson::Value fieldsJson = rapidjson::Value(rapidjson::kObjectType);
+			BinaryWriter writer;
+		};
+		auto data = std::make_shared<SerializationData>();
+		data->className = className;
+
+		const std::vector<uint8_t> pattern = GetFieldsPattern(creator->GetBinarySize(), 1);
+		const uint8_t* fieldData = pattern.data();
+		for (const ReflectedField& field : creator->GetFields())
+		{
+			AddJsonField(data->fieldsJson, field, fieldData, data->document.GetAllocator());
+			fieldData += field.size;
+		}
+
+		const auto prepare = [data, creator, pattern]()
+		{
+			if (data->go != nullptr) return;
+
+			TransformProvider& transformProvider = WorldManager::Get()->GetTransformProvider();
+			data->go = std::make_unique<GameObject>("Serialization benchmark", transformProvider.Allocate(), transformProvider);
+
+			std::unique_ptr<Serializable> object = creator->Create(*data->go);
+			BinaryReader patternReader(pattern.data(), pattern.size());
+			creator->ReadBinary(object.get(), patternReader);
+			data->writer.Reserve(static_cast<size_t>(count) * (creator->GetBinarySize() + 2 * sizeof(uint32_t)));
+			for (uint32_t i = 0; i < count; i++)
+			{
+				GetInstance()->Serialize(object.get(), data->writer);
+			}
+		};
+
+		suite.AddEngineCase((std::string("Serialization/DeserializeJson/") + className).c_str(), count, [data]()
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const std::unique_ptr<Serializable> object = GetInstance()->Deserialize(*data->go, data->fieldsJson, data->className);
+			}
+		}, prepare);
+
+		suite.AddEngineCase((std::string("Serialization/DeserializeBinary/") + className).c_str(), count, [data]()
+		{
+			BinaryReader reader(data->writer.GetData().data(), data->writer.GetData().size());
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const std::unique_ptr<Serializable> object = GetInstance()->Deserialize(*data->go, reader);
+			}
+		}, prepare);
 	}
 }
@@ -1,13 +1,23 @@
 #ifndef SERIALIZATION_H
 #define SERIALIZATION_H
 
-#include <string>
+#include <array>
+#include <cstring>
 #include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <rapidjson/document.h>
 
 #include "Utils/Assert.h"
+#include "Color.h"
 #include "Serializable.h"
+#include "SerializationUtils.h"
 #include "HashDefs.h"
+#include "Math/MathTypes.h"
 
 //    =============== USAGE: ===================
 //	  DECLARE_CLASS(SomeClass)
@@ -27,15 +37,268 @@
 class className; \
 inline SerializedObjectCreator<className> className##_creator = SerializedObjectCreator<className>(#className);
 
-// TODO correct check for Serializable class !
-#define REFLECT_FIELD(T, v) FieldRegistrator v##_registrator = FieldRegistrator \
-(typeInfo.typeName, #v, FieldInfo(HASH(T) != HASH(Serializable)? HASH(T) : HASH(Serializable), &(v))); T v;
+// Declares the field and describes it at compile time. Every field declares ReflectedFieldsCount for the next counter value,
+// so the overload picked for FieldCounter<MaxReflectedFieldsCount> gives the number of fields declared above in this class.
+// Fields of base classes are added by ReflectedFields
+#define REFLECT_FIELD(T, v) T v; \
+static constexpr uint32_t v##_fieldIndex = decltype(ReflectedFieldsCount(FieldCounter<MaxReflectedFieldsCount>{}))::value; \
+static std::integral_constant<uint32_t, v##_fieldIndex + 1> ReflectedFieldsCount(FieldCounter<v##_fieldIndex + 1>); \
+template <typename Object> \
+static constexpr ReflectedField GetReflectedField(std::integral_constant<uint32_t, v##_fieldIndex>) \
+{ return ReflectedField::Create<Object, &JoyObjectType::v>(#v); }
 
 namespace JoyEngine
 {
+	class BenchmarkSuite;
 	class GameObject;
 	class SerializableClassFactory;
 
+	inline constexpr uint32_t MaxReflectedFieldsCount = 32;
+
+	// Serialized type name hash of a c++ field type, the same names as in SerializationUtils
+	template <typename T>
+	struct SerializedType;
+
+	template <>
+	struct SerializedType<int32_t>
+	{
+		static constexpr uint32_t typeHash = StrHash32("int");
+	};
+
+	template <>
+	struct SerializedType<uint32_t>
+	{
+		static constexpr uint32_t typeHash = StrHash32("uint");
+	};
+
+	template <>
+	struct SerializedType<float>
+	{
+		static constexpr uint32_t typeHash = StrHash32("float");
+	};
+
+	template <>
+	struct SerializedType<jmath::vec2>
+	{
+		static constexpr uint32_t typeHash = StrHash32("vec2");
+	};
+
+	template <>
+	struct SerializedType<jmath::vec3>
+	{
+		static constexpr uint32_t typeHash = StrHash32("vec3");
+	};
+
+	template <>
+	struct SerializedType<jmath::vec4>
+	{
+		static constexpr uint32_t typeHash = StrHash32("vec4");
+	};
+
+	template <>
+	struct SerializedType<Color>
+	{
+		static constexpr uint32_t typeHash = StrHash32("color");
+	};
+
+	struct ReflectedField
+	{
+		const char* name;
+		uint32_t nameHash;
+		uint32_t typeHash; // serialized type
+		uint32_t size;
+		uint8_t* (*getData)(void* object); // object is the class the field table is built for
+
+		// Member is a pointer to the field in Object or in one of its bases
+		template <typename Object, auto Member>
+		static constexpr ReflectedField Create(const char* name)
+		{
+			using T = std::remove_reference_t<decltype(std::declval<Object&>().*Member)>;
+			static_assert(std::is_trivially_copyable_v<T>, "Reflected fields are serialized as bytes");
+			return {
+				name, StrHash32(name), SerializedType<T>::typeHash, sizeof(T),
+				[](void* object) { return reinterpret_cast<uint8_t*>(&(static_cast<Object*>(object)->*Member)); }
+			};
+		}
+	};
+
+	// Bytes of neighbouring fields, copied with one memcpy
+	struct ReflectedFieldsRun
+	{
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	class BinaryWriter
+	{
+	public:
+		void Write(const void* data, size_t size)
+		{
+			const size_t offset = m_data.size();
+			m_data.resize(offset + size);
+			memcpy(m_data.data() + offset, data, size);
+		}
+
+		template <typename T>
+		void Write(const T& value)
+		{
+			Write(&value, sizeof(T));
+		}
+
+		void Reserve(size_t size) { m_data.reserve(size); }
+		[[nodiscard]] const std::vector<uint8_t>& GetData() const noexcept { return m_data; }
+
+	private:
+		std::vector<uint8_t> m_data;
+	};
+
+	class BinaryReader
+	{
+	public:
+		BinaryReader(const uint8_t* data, size_t size) :
+			m_data(data),
+			m_size(size)
+		{
+		}
+
+		void Read(void* data, size_t size)
+		{
+			ASSERT(m_offset + size <= m_size);
+			memcpy(data, m_data + m_offset, size);
+			m_offset += size;
+		}
+
+		template <typename T>
+		T Read()
+		{
+			T value;
+			Read(&value, sizeof(T));
+			return value;
+		}
+
+		[[nodiscard]] bool IsEnd() const noexcept { return m_offset == m_size; }
+
+	private:
+		const uint8_t* m_data;
+		const size_t m_size;
+		size_t m_offset = 0;
+	};
+
+	// Field table of a class built from REFLECT_FIELD declarations of the class and its bases, base fields go first.
+	// Binary data is the fields in declaration order without padding, fields that are neighbours in the object too
+	// are read and written as one run
+	template <typename T>
+	struct ReflectedFields
+	{
+		static_assert(std::is_same_v<typename T::JoyObjectType, T>, "Reflected class needs DECLARE_JOY_OBJECT");
+
+		using Base = typename T::JoyObjectBaseType;
+
+		static constexpr uint32_t ownCount = decltype(T::ReflectedFieldsCount(FieldCounter<MaxReflectedFieldsCount>{}))::value;
+		static_assert(ownCount < MaxReflectedFieldsCount);
+		static constexpr uint32_t count = ReflectedFields<Base>::count + ownCount;
+
+		// Fields of T and its bases accessed through Object, which is T or derived from it
+		template <typename Object>
+		static constexpr std::array<ReflectedField, count> GetFields()
+		{
+			std::array<ReflectedField, count> result = {};
+			const auto baseFields = ReflectedFields<Base>::template GetFields<Object>();
+			for (uint32_t i = 0; i < baseFields.size(); i++)
+			{
+				result[i] = baseFields[i];
+			}
+			if constexpr (ownCount > 0)
+			{
+				[&result]<uint32_t... I>(std::integer_sequence<uint32_t, I...>)
+				{
+					((result[ReflectedFields<Base>::count + I] = T::template GetReflectedField<Object>(std::integral_constant<uint32_t, I>{})), ...);
+				}(std::make_integer_sequence<uint32_t, ownCount>{});
+			}
+			return result;
+		}
+
+		static constexpr std::array<ReflectedField, count> fields = GetFields<T>();
+
+		static constexpr uint32_t binarySize = []()
+		{
+			uint32_t size = 0;
+			for (const ReflectedField& field : fields)
+			{
+				size += field.size;
+			}
+			return size;
+		}();
+
+		// Binary data is read only by the same field names, types and order
+		static constexpr uint32_t schemaHash = []()
+		{
+			uint32_t hash = 5381;
+			for (const ReflectedField& field : fields)
+			{
+				hash = static_cast<uint32_t>(hash * uint64_t(33) ^ field.nameHash);
+				hash = static_cast<uint32_t>(hash * uint64_t(33) ^ field.typeHash);
+			}
+			return hash;
+		}();
+
+		static void WriteBinary(const T* object, BinaryWriter& writer)
+		{
+			for (const ReflectedFieldsRun& run : GetRuns(object))
+			{
+				writer.Write(reinterpret_cast<const uint8_t*>(object) + run.offset, run.size);
+			}
+		}
+
+		static void ReadBinary(T* object, BinaryReader& reader)
+		{
+			for (const ReflectedFieldsRun& run : GetRuns(object))
+			{
+				reader.Read(reinterpret_cast<uint8_t*>(object) + run.offset, run.size);
+			}
+		}
+
+		static void ReadJson(T* object, const rapidjson::Value& fieldsJson);
+
+	private:
+		// Field offsets are not known at compile time, they are taken from the first object and are the same for every object of T
+		static const std::vector<ReflectedFieldsRun>& GetRuns(const T* object)
+		{
+			static const std::vector<ReflectedFieldsRun> runs = [object]()
+			{
+				std::vector<ReflectedFieldsRun> result;
+				uint8_t* objectData = reinterpret_cast<uint8_t*>(const_cast<T*>(object));
+				for (const ReflectedField& field : fields)
+				{
+					const uint32_t offset = static_cast<uint32_t>(field.getData(const_cast<T*>(object)) - objectData);
+					if (!result.empty() && result.back().offset + result.back().size == offset)
+					{
+						result.back().size += field.size;
+					}
+					else
+					{
+						result.push_back({offset, field.size});
+					}
+				}
+				return result;
+			}();
+			return runs;
+		}
+	};
+
+	// Root of the hierarchy has no fields
+	template <>
+	struct ReflectedFields<JoyObject>
+	{
+		static constexpr uint32_t count = 0;
+
+		template <typename Object>
+		static constexpr std::array<ReflectedField, 0> GetFields()
+		{
+			return {};
+		}
+	};
+
 	class SerializedObjectCreatorBase
 	{
 	public:
@@ -43,7 +306,14 @@ namespace JoyEngine
 
 		// TODO pass parameters as template arguments
 		// TODO not only Component can be Serializable
-		virtual std::unique_ptr<Serializable> Create(GameObject& go) = 0; 
+		virtual std::unique_ptr<Serializable> Create(GameObject& go) = 0;
+
+		virtual void ReadJson(Serializable* object, const rapidjson::Value& fieldsJson) = 0;
+		virtual void ReadBinary(Serializable* object, BinaryReader& reader) = 0;
+		virtual void WriteBinary(const Serializable* object, BinaryWriter& writer) = 0;
+		[[nodiscard]] virtual uint32_t GetSchemaHash() const = 0;
+		[[nodiscard]] virtual uint32_t GetBinarySize() const = 0;
+		[[nodiscard]] virtual std::span<const ReflectedField> GetFields() const = 0;
 	};
 
 	template <typename Type>
@@ -53,28 +323,42 @@ namespace JoyEngine
 		explicit SerializedObjectCreator(const std::string& className);
 
 		std::unique_ptr<Serializable> Create(GameObject& go) override;
-	};
 
-	struct FieldInfo
-	{
-		FieldInfo() = default;
+		void ReadJson(Serializable* object, const rapidjson::Value& fieldsJson) override
+		{
+			ReflectedFields<Type>::ReadJson(static_cast<Type*>(object), fieldsJson);
+		}
+
+		void ReadBinary(Serializable* object, BinaryReader& reader) override
+		{
+			ReflectedFields<Type>::ReadBinary(static_cast<Type*>(object), reader);
+		}
 
-		FieldInfo(uint32_t typeHash, void* fieldOffset) : typeHash(typeHash), fieldOffset(fieldOffset)
+		void WriteBinary(const Serializable* object, BinaryWriter& writer) override
 		{
+			ReflectedFields<Type>::WriteBinary(static_cast<const Type*>(object), writer);
 		}
 
-		uint32_t typeHash;
-		void* fieldOffset;
+		[[nodiscard]] uint32_t GetSchemaHash() const override { return ReflectedFields<Type>::schemaHash; }
+		[[nodiscard]] uint32_t GetBinarySize() const override { return ReflectedFields<Type>::binarySize; }
+		[[nodiscard]] std::span<const ReflectedField> GetFields() const override { return ReflectedFields<Type>::fields; }
 	};
 
+	// JSON is the authoring format, binary data is a class name hash, a schema hash and the fields
 	class SerializableClassFactory
 	{
 	public:
 		void RegisterClass(const std::string& className, SerializedObjectCreatorBase* creator);
 
-		void RegisterClassFieldOffset(const std::string& className, const std::string& filedName, FieldInfo fieldInfo);
+		std::unique_ptr<Serializable> Deserialize(GameObject& go, const rapidjson::Value& fieldsJson, const std::string& className);
+
+		void Serialize(Serializable* object, BinaryWriter& writer);
+		std::unique_ptr<Serializable> Deserialize(GameObject& go, BinaryReader& reader);
 
-		std::unique_ptr<Serializable> Deserialize(GameObject& go, rapidjson::Value& fieldsJson, const std::string& className);
+		// Round trips every registered class through binary data and checks the fields, objects are created on go
+		static bool Test(GameObject& go);
+		// Creating objects of the class from JSON and from binary data
+		static void AddBenchmarks(BenchmarkSuite& suite, const char* className = "LightBehaviour");
 
 		// don't want to make storages static because of exceptions before main()
 		static SerializableClassFactory* GetInstance()
@@ -88,18 +372,29 @@ namespace JoyEngine
 
 	private:
 		static SerializableClassFactory* m_instance;
-		std::map<std::string, std::map<std::string, FieldInfo>> m_fieldOffsetStorage;
 		std::map<std::string, SerializedObjectCreatorBase*> m_classCreatorStorage;
+		std::unordered_map<uint32_t, SerializedObjectCreatorBase*> m_classCreatorsByHash; // hash(className) -> creator
 	};
 
-	class FieldRegistrator
+	template <typename T>
+	void ReflectedFields<T>::ReadJson(T* object, const rapidjson::Value& fieldsJson)
 	{
-	public:
-		FieldRegistrator(const std::string& className, const std::string& filedName, FieldInfo fieldInfo)
+		for (auto member = fieldsJson.MemberBegin(); member != fieldsJson.MemberEnd(); ++member)
 		{
-			SerializableClassFactory::GetInstance()->RegisterClassFieldOffset(className, filedName, fieldInfo);
+			const uint32_t nameHash = StrHash32(member->name.GetString());
+			bool isFound = false;
+			for (const ReflectedField& field : fields)
+			{
+				if (field.nameHash == nameHash)
+				{
+					SerializationUtils::DeserializeToPtr(field.typeHash, member->value, field.getData(object));
+					isFound = true;
+					break;
+				}
+			}
+			ASSERT_DESC(isFound, member->name.GetString());
 		}
-	};
+	}
 
 	template <typename Type>
 	SerializedObjectCreator<Type>::SerializedObjectCreator(const std::string& className)
@@ -20,18 +20,6 @@ namespace JoyEngine
 
 	};
 
-	const std::map<uint32_t, uint32_t> SerializationUtils::m_typeMapping = {
-		{HASH(int32_t), StrHash32("int")},
-		{HASH(uint32_t), StrHash32("uint")},
-		{HASH(float), StrHash32("float")},
-		{HASH(glm::vec2), StrHash32("vec2")},
-		{HASH(glm::vec3), StrHash32("vec3")},
-		{HASH(glm::vec4), StrHash32("vec4")},
-		{HASH(glm::mat3), StrHash32("mat3")},
-		{HASH(glm::mat4), StrHash32("mat4")},
-		{HASH(Color), StrHash32("color")},
-	};
-
 	size_t SerializationUtils::GetTypeSize(const std::string& type)
 	{
 		return GetTypeSize(StrHash32(type.c_str()));
@@ -48,12 +36,6 @@ namespace JoyEngine
 		return m_typeSizes.find(typeHash)->second;
 	}
 
-	uint32_t SerializationUtils::GetType(uint32_t cppTypeHash)
-	{
-		ASSERT(m_typeMapping.contains(cppTypeHash));
-		return m_typeMapping.find(cppTypeHash)->second;
-	}
-
 	template <typename T>
 	inline void Read(const rapidjson::Value& val, void* ptr)
 	{
@@ -126,12 +108,6 @@ namespace JoyEngine
 		}
 	}
 
-	void SerializationUtils::DeserializeAndWriteCppToPtr(uint32_t typeHash, const rapidjson::Value& val,
-	                                                     void* ptr)
-	{
-		DeserializeToPtr(GetType(typeHash), val, ptr);
-	}
-
 	void SerializationUtils::DeserializeToPtr(uint32_t typeHash,
 	                                          const rapidjson::Value& val, void* ptr,
 	                                          uint32_t count)
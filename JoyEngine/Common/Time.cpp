@@ -29,7 +29,9 @@ namespace JoyEngine {
 		m_framesFromLastDeltaTimeCounter++;
 		if (m_timeFromLastDeltaTimeCounter >= m_deltaTimeCounterDelay)
 		{
-			m_deltaTimeHandler(m_timeFromLastDeltaTimeCounter / static_cast<float>(m_framesFromLastDeltaTimeCounter));
+			// headless engine has no window title to show it
+			if (m_deltaTimeHandler)
+				m_deltaTimeHandler(m_timeFromLastDeltaTimeCounter / static_cast<float>(m_framesFromLastDeltaTimeCounter));
 			m_timeFromLastDeltaTimeCounter = 0;
 			m_framesFromLastDeltaTimeCounter = 0;
 		}
@@ -43,6 +43,7 @@
 #define THREADS_PER_BLOCK 1024
 #define WARP_SIZE 32
 #define ELEM_PER_THREAD  1
+#define MORTON_CODE_BITS 63 // 21 bit per axis, padding keys of all ones always sort after triangles
 
 #define DATA_ARRAY_COUNT (ELEM_PER_THREAD * THREADS_PER_BLOCK * BLOCK_SIZE) // 1*512*1024 = 524288
 
@@ -60,6 +61,9 @@
 #define DDGI_PROBE_DATA_RESOLUTION 16
 #define DDGI_PROBE_IRRADIANCE_SAMPLES 4
 #define DDGI_WEIGHT_EPSILON 0.0001
+#define DDGI_MAX_PROBES_COUNT 4096 // size of per frame list of scheduled probes
+#define DDGI_CASCADES_COUNT 3
+#define DDGI_PROBE_RESET_FLAG 0x80000000 // set in scheduled probe index when the probe entered its volume and has no history
 
 #define NUM_CLUSTERS_X 10
 #define NUM_CLUSTERS_Y 10
@@ -270,12 +274,22 @@ struct HardwareRayPayload
 	VEC4 position;
 };
 
-struct RaytracedProbesData
+// Probe volume of one cascade. Probes are stored in toroidal order, so a volume scrolls by whole cells
+// and probes keep their place in buffers and textures while their world cell stays inside the volume
+struct ProbeCascadeData
 {
-	VEC3 gridMin;
+	VEC3 gridMin; // world position of the probe at grid coordinate 0
 	float cellSize;
 
-	UINT1 gridX;
+	UINT3 gridScroll; // storage coordinate of grid coordinate 0, storage = (grid + scroll) % grid size
+	UINT1 dummy_0;
+};
+
+struct RaytracedProbesData
+{
+	ProbeCascadeData cascades[DDGI_CASCADES_COUNT]; // from the finest one, all are centered on the camera
+
+	UINT1 gridX; // probes of every cascade
 	UINT1 gridY;
 	UINT1 gridZ;
 	UINT1 useDDGI;
@@ -286,9 +300,22 @@ struct RaytracedProbesData
 	UINT1 dummy_2;
 };
 
+struct ProbeRelocationData
+{
+	VEC3 offset; // from the regular grid position
+	UINT1 isActive; // inactive probes are never traced and get no weight in shading
+};
+
 struct BufferSorterData
 {
 	UINT1 bitOffset;
+	UINT1 dataLength; // keys past it are read as all ones and never written
+	UINT1 blocksCount; // row stride of bucket sizes
+};
+
+struct BufferScanData
+{
+	UINT1 elementsCount; // elements of the scanned level, past it read as 0
 };
 
 struct BVHConstructorData
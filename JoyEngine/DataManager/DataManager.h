@@ -37,6 +37,7 @@ namespace JoyEngine
 		void GetWFilename(const std::string& path, std::wstring& filename);
 		[[nodiscard]] std::ifstream GetFileStream(const std::string& path, bool shouldReadRawData = false) const;
 		[[nodiscard]] rapidjson::Document GetSerializedData(const std::string& path, AssetType) const;
+		[[nodiscard]] std::filesystem::path GetAbsolutePath(const std::string& path) const { return m_dataPath / path; }
 	private:
 		const std::filesystem::path m_dataPath;
 	};
@@ -0,0 +1,207 @@
+#include "DescriptorIndexAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "Benchmarks/TestSuite.h"
+#include "Utils/Assert.h"
+
+namespace JoyEngine
+{
+	DescriptorIndexAllocator::DescriptorIndexAllocator(uint32_t persistentCount, uint32_t transientCount) :
+		m_persistentCount(persistentCount),
+		m_transientCount(transientCount)
+	{
+		if (m_persistentCount > 0)
+		{
+			m_freeRanges.insert({0, m_persistentCount});
+		}
+	}
+
+	uint32_t DescriptorIndexAllocator::Allocate(uint32_t count)
+	{
+		ASSERT(count > 0);
+
+		// First fit keeps long lived descriptors at the start of the heap
+		for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it)
+		{
+			if (it->second < count) continue;
+
+			const uint32_t index = it->first;
+			const uint32_t restCount = it->second - count;
+			m_freeRanges.erase(it);
+			if (restCount > 0)
+			{
+				m_freeRanges.insert({index + count, restCount});
+			}
+
+			m_stats.persistentLiveCount += count;
+			m_stats.persistentPeakCount = std::max(m_stats.persistentPeakCount, m_stats.persistentLiveCount);
+			return index;
+		}
+
+		m_stats.failedCount++;
+		return InvalidIndex;
+	}
+
+	void DescriptorIndexAllocator::Free(uint32_t index, uint32_t count)
+	{
+		ASSERT(count > 0 && index + count <= m_persistentCount);
+
+		uint32_t rangeIndex = index;
+		uint32_t rangeCount = count;
+
+		auto next = m_freeRanges.lower_bound(index);
+		ASSERT_DESC(next == m_freeRanges.end() || index + count <= next->first, "Descriptor range is already free");
+		if (next != m_freeRanges.end() && index + count == next->first)
+		{
+			rangeCount += next->second;
+			next = m_freeRanges.erase(next);
+		}
+
+		if (next != m_freeRanges.begin())
+		{
+			const auto prev = std::prev(next);
+			ASSERT_DESC(prev->first + prev->second <= index, "Descriptor range is already free");
+			if (prev->first + prev->second == index)
+			{
+				rangeIndex = prev->first;
+				rangeCount += prev->second;
+				m_freeRanges.erase(prev);
+			}
+		}
+
+		m_freeRanges.insert({rangeIndex, rangeCount});
+		m_stats.persistentLiveCount -= count;
+	}
+
+	uint32_t DescriptorIndexAllocator::AllocateTransient(uint32_t count)
+	{
+		ASSERT(count > 0);
+		if (count > m_transientCount)
+		{
+			m_stats.failedCount++;
+			return InvalidIndex;
+		}
+
+		// Table can't wrap, the end of the ring is skipped instead
+		uint64_t start = m_ringHead;
+		const uint32_t position = static_cast<uint32_t>(start % m_transientCount);
+		if (position + count > m_transientCount)
+		{
+			start += m_transientCount - position;
+			if (m_ringHead == m_ringTail)
+			{
+				// Nothing is in flight, the skipped end is free too
+				m_ringTail = start;
+			}
+		}
+
+		if (start + count - m_ringTail > m_transientCount)
+		{
+			// Frames in flight still use the rest of the ring
+			m_stats.failedCount++;
+			return InvalidIndex;
+		}
+
+		m_ringHead = start + count;
+		m_stats.transientFrameCount += count;
+		m_stats.transientPeakCount = std::max(m_stats.transientPeakCount, m_stats.transientFrameCount);
+		return m_persistentCount + static_cast<uint32_t>(start % m_transientCount);
+	}
+
+	void DescriptorIndexAllocator::BeginFrame(uint64_t frameFenceValue, uint64_t completedFenceValue)
+	{
+		const uint64_t lastRingEnd = m_frames.empty() ? m_ringTail : m_frames.back().ringEnd;
+		if (m_ringHead != lastRingEnd)
+		{
+			m_frames.push_back({m_frameFenceValue, m_ringHead});
+		}
+
+		while (!m_frames.empty() && m_frames.front().fenceValue <= completedFenceValue)
+		{
+			m_ringTail = m_frames.front().ringEnd;
+			m_frames.pop_front();
+		}
+
+		m_frameFenceValue = frameFenceValue;
+		m_stats.transientFrameCount = 0;
+	}
+
+	bool DescriptorIndexAllocator::Test()
+	{
+		bool isPassed = true;
+
+		// Persistent region
+		{
+			DescriptorIndexAllocator allocator(16, 0);
+			const uint32_t a = allocator.Allocate();
+			const uint32_t b = allocator.Allocate();
+			const uint32_t c = allocator.Allocate();
+			const uint32_t table = allocator.Allocate(4);
+			isPassed &= TEST_CHECK(a == 0 && b == 1 && c == 2 && table == 3, "indices are not allocated in order");
+
+			allocator.Free(b);
+			isPassed &= TEST_CHECK(allocator.Allocate(2) == 7, "table is placed into a smaller hole");
+			isPassed &= TEST_CHECK(allocator.Allocate() == 1, "freed index is not reused");
+
+			allocator.Free(table, 4);
+			allocator.Free(c);
+			allocator.Free(b);
+			isPassed &= TEST_CHECK(allocator.GetStats().persistentLiveCount == 3, "live count is wrong");
+			isPassed &= TEST_CHECK(allocator.GetStats().persistentPeakCount == 9, "peak count is wrong");
+			isPassed &= TEST_CHECK(allocator.Allocate(6) == 1, "freed neighbour ranges are not merged");
+
+			isPassed &= TEST_CHECK(allocator.Allocate(8) == InvalidIndex, "allocated over the region");
+			isPassed &= TEST_CHECK(allocator.AllocateTransient() == InvalidIndex, "allocated from an empty ring");
+			isPassed &= TEST_CHECK(allocator.GetStats().failedCount == 2, "failures are not counted");
+		}
+
+		// Transient ring, two frames in flight
+		{
+			DescriptorIndexAllocator allocator(16, 8);
+			allocator.BeginFrame(1, 0);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(3) == 16, "ring doesn't start after the persistent region");
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(3) == 19, "ring allocations are not linear");
+
+			allocator.BeginFrame(2, 0);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(3) == InvalidIndex, "ring space of a frame in flight is reused");
+
+			allocator.BeginFrame(3, 1);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(3) == 16, "ring doesn't wrap after the frame fence");
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(6) == InvalidIndex, "ring overlaps the recorded frame");
+			isPassed &= TEST_CHECK(allocator.GetStats().transientFrameCount == 3, "frame count is wrong");
+			isPassed &= TEST_CHECK(allocator.GetStats().transientPeakCount == 6, "transient peak count is wrong");
+
+			allocator.BeginFrame(4, 3);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(8) == 16, "whole ring is not free when the GPU is idle");
+		}
+
+		// Transient tables over the ring end, fence gated reuse
+		{
+			DescriptorIndexAllocator allocator(4, 8);
+			allocator.BeginFrame(1, 0);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(5) == 4, "ring doesn't start after the persistent region");
+
+			allocator.BeginFrame(2, 0);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(2) == 9, "ring allocations are not linear across frames");
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(2) == InvalidIndex, "table wraps into a frame in flight");
+
+			allocator.BeginFrame(3, 1);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(2) == 4, "table doesn't skip the ring end");
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(3) == 6, "ring allocations are not linear after the wrap");
+			isPassed &= TEST_CHECK(allocator.AllocateTransient() == InvalidIndex, "wrapped ring overlaps a frame in flight");
+
+			allocator.BeginFrame(4, 1);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient() == InvalidIndex, "ring space is reused before the frame fence");
+
+			allocator.BeginFrame(5, 2);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(2) == 9, "ring space is not reused after the frame fence");
+
+			allocator.BeginFrame(6, 5);
+			isPassed &= TEST_CHECK(allocator.AllocateTransient(8) == 4, "whole ring is not free after the last frame fence");
+		}
+
+		return isPassed;
+	}
+}
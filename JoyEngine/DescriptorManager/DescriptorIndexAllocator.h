@@ -0,0 +1,67 @@
+#ifndef DESCRIPTOR_INDEX_ALLOCATOR_H
+#define DESCRIPTOR_INDEX_ALLOCATOR_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+
+namespace JoyEngine
+{
+	struct DescriptorIndexStats
+	{
+		uint32_t persistentLiveCount = 0;
+		uint32_t persistentPeakCount = 0;
+		uint32_t transientFrameCount = 0; // allocated in the recorded frame
+		uint32_t transientPeakCount = 0; // per frame
+		uint32_t failedCount = 0;
+	};
+
+	// Indices of one descriptor heap. The first persistentCount indices are a free list of contiguous ranges,
+	// the next transientCount indices are a ring of per frame descriptors. Ring space of a frame comes back
+	// when the GPU passes the frame fence value. Knows nothing about D3D, fence values come from BeginFrame
+	class DescriptorIndexAllocator
+	{
+	public:
+		static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+		DescriptorIndexAllocator(uint32_t persistentCount, uint32_t transientCount);
+
+		// Contiguous indices, returns the first one or InvalidIndex
+		[[nodiscard]] uint32_t Allocate(uint32_t count = 1);
+		void Free(uint32_t index, uint32_t count = 1);
+
+		// Contiguous indices for the recorded frame only. They are not freed
+		[[nodiscard]] uint32_t AllocateTransient(uint32_t count = 1);
+
+		// Transient allocations from now on belong to frameFenceValue. Frees ring space completedFenceValue has passed
+		void BeginFrame(uint64_t frameFenceValue, uint64_t completedFenceValue);
+
+		[[nodiscard]] uint32_t GetPersistentCount() const noexcept { return m_persistentCount; }
+		[[nodiscard]] uint32_t GetTransientCount() const noexcept { return m_transientCount; }
+		[[nodiscard]] const DescriptorIndexStats& GetStats() const noexcept { return m_stats; }
+
+		static bool Test();
+
+	private:
+		struct FrameMarker
+		{
+			uint64_t fenceValue;
+			uint64_t ringEnd;
+		};
+
+		const uint32_t m_persistentCount;
+		const uint32_t m_transientCount;
+
+		std::map<uint32_t, uint32_t> m_freeRanges; // first index -> count, neighbours are merged
+
+		// Ring positions only grow, index is persistentCount + position % transientCount
+		uint64_t m_ringHead = 0;
+		uint64_t m_ringTail = 0;
+		uint64_t m_frameFenceValue = 0;
+		std::deque<FrameMarker> m_frames;
+
+		DescriptorIndexStats m_stats;
+	};
+}
+
+#endif // DESCRIPTOR_INDEX_ALLOCATOR_H
@@ -8,6 +8,33 @@
 
 namespace JoyEngine
 {
+	namespace
+	{
+		const char* GetMemoryDomain(D3D12_DESCRIPTOR_HEAP_TYPE type)
+		{
+			switch (type)
+			{
+			case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
+				return "Descriptors CBV_SRV_UAV";
+			case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
+				return "Descriptors SAMPLER";
+			case D3D12_DESCRIPTOR_HEAP_TYPE_RTV:
+				return "Descriptors RTV";
+			case D3D12_DESCRIPTOR_HEAP_TYPE_DSV:
+				return "Descriptors DSV";
+			default:
+				ASSERT(false);
+				return "Descriptors";
+			}
+		}
+
+		uint32_t GetTransientDescriptorsCount(D3D12_DESCRIPTOR_HEAP_TYPE type)
+		{
+			// Shader visible sampler heap can't have more than 2048 descriptors
+			return type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? 0 : TRANSIENT_DESCRIPTORS_COUNT;
+		}
+	}
+
 	DescriptorManager::DescriptorManager()
 	{
 		TIME_PERF("DescriptorManager ctor")
@@ -17,9 +44,10 @@ namespace JoyEngine
 		     typeIndex++)
 		{
 			const auto type = static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(typeIndex);
+			const uint32_t transientCount = GetTransientDescriptorsCount(type);
 			D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {
 				type,
-				DESCRIPTORS_COUNT,
+				DESCRIPTORS_COUNT + transientCount,
 				type == D3D12_DESCRIPTOR_HEAP_TYPE_RTV || type == D3D12_DESCRIPTOR_HEAP_TYPE_DSV
 					? D3D12_DESCRIPTOR_HEAP_FLAG_NONE
 					: D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
@@ -27,14 +55,20 @@ namespace JoyEngine
 			};
 
 			ComPtr<ID3D12DescriptorHeap> heap;
-			ASSERT_SUCC(GraphicsManager::Get()->GetDevice()-> CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&heap)));
-
-			const auto descriptorSize = GraphicsManager::Get()->GetDevice()->GetDescriptorHandleIncrementSize(type);
-			const D3D12_CPU_DESCRIPTOR_HANDLE cpuHeapStart = heap->GetCPUDescriptorHandleForHeapStart();
+			uint32_t descriptorSize = 0;
+			D3D12_CPU_DESCRIPTOR_HANDLE cpuHeapStart = {};
 			D3D12_GPU_DESCRIPTOR_HANDLE gpuHeapStart = {};
-			if (type != D3D12_DESCRIPTOR_HEAP_TYPE_RTV && type != D3D12_DESCRIPTOR_HEAP_TYPE_DSV)
+			// Headless engine has no heaps, indices are still allocated so views keep their bookkeeping
+			if (!GraphicsManager::Get()->IsHeadless())
 			{
-				gpuHeapStart = heap->GetGPUDescriptorHandleForHeapStart();
+				ASSERT_SUCC(GraphicsManager::Get()->GetDevice()-> CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&heap)));
+
+				descriptorSize = GraphicsManager::Get()->GetDevice()->GetDescriptorHandleIncrementSize(type);
+				cpuHeapStart = heap->GetCPUDescriptorHandleForHeapStart();
+				if (type != D3D12_DESCRIPTOR_HEAP_TYPE_RTV && type != D3D12_DESCRIPTOR_HEAP_TYPE_DSV)
+				{
+					gpuHeapStart = heap->GetGPUDescriptorHandleForHeapStart();
+				}
 			}
 
 			m_heapStorage.insert({
@@ -43,28 +77,63 @@ namespace JoyEngine
 				          descriptorSize,
 				          cpuHeapStart,
 				          gpuHeapStart,
-				          DESCRIPTORS_COUNT)
+				          DESCRIPTORS_COUNT,
+				          transientCount)
 			});
+			m_heapStorage.at(type).m_transientMemory = MemoryTracker::Track(GetMemoryDomain(type), transientCount * descriptorSize);
 		}
 	}
 
 
+	DescriptorManager::~DescriptorManager()
+	{
+		// Views destroyed after the manager have nothing to free
+		m_instance = nullptr;
+	}
+
 	void DescriptorManager::AllocateDescriptor(
 		const D3D12_DESCRIPTOR_HEAP_TYPE type,
 		_Out_ uint32_t& index,
 		_Out_ D3D12_CPU_DESCRIPTOR_HANDLE& cpuHandle,
 		_Out_ D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle
 	)
+	{
+		AllocateDescriptors(type, 1, index, cpuHandle, gpuHandle);
+	}
+
+	void DescriptorManager::AllocateDescriptors(
+		const D3D12_DESCRIPTOR_HEAP_TYPE type,
+		const uint32_t count,
+		_Out_ uint32_t& index,
+		_Out_ D3D12_CPU_DESCRIPTOR_HANDLE& cpuHandle,
+		_Out_ D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle
+	)
 	{
 		auto& entry = m_heapStorage.at(type);
 
-		ASSERT((entry.m_currentDescriptorIndex + 1) < entry.m_descriptorsCount)
+		index = entry.m_allocator.Allocate(count);
+		ASSERT_DESC(index != DescriptorIndexAllocator::InvalidIndex, "Descriptor heap is full");
 
-		cpuHandle.ptr = entry.m_cpuHeapStart.ptr + entry.m_currentDescriptorIndex * entry.m_descriptorSize;
-		gpuHandle.ptr = entry.m_gpuHeapStart.ptr + entry.m_currentDescriptorIndex * entry.m_descriptorSize;
-		index = entry.m_currentDescriptorIndex;
+		cpuHandle.ptr = entry.m_cpuHeapStart.ptr + index * entry.m_descriptorSize;
+		gpuHandle.ptr = entry.m_gpuHeapStart.ptr + index * entry.m_descriptorSize;
+		entry.m_memoryAllocations[index] = MemoryTracker::Track(GetMemoryDomain(type), count * entry.m_descriptorSize);
+	}
+
+	void DescriptorManager::AllocateTransientDescriptors(
+		const D3D12_DESCRIPTOR_HEAP_TYPE type,
+		const uint32_t count,
+		_Out_ uint32_t& index,
+		_Out_ D3D12_CPU_DESCRIPTOR_HANDLE& cpuHandle,
+		_Out_ D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle
+	)
+	{
+		auto& entry = m_heapStorage.at(type);
 
-		entry.m_currentDescriptorIndex++;
+		index = entry.m_allocator.AllocateTransient(count);
+		ASSERT_DESC(index != DescriptorIndexAllocator::InvalidIndex, "Transient descriptor ring is full");
+
+		cpuHandle.ptr = entry.m_cpuHeapStart.ptr + index * entry.m_descriptorSize;
+		gpuHandle.ptr = entry.m_gpuHeapStart.ptr + index * entry.m_descriptorSize;
 	}
 
 	void DescriptorManager::GetDescriptorHandleAtIndex(
@@ -76,7 +145,7 @@ namespace JoyEngine
 	{
 		const auto& entry = m_heapStorage.at(type);
 
-		ASSERT((entry.m_currentDescriptorIndex + 1) < entry.m_descriptorsCount)
+		ASSERT(index < entry.m_descriptorsCount)
 
 		cpuHandle.ptr = entry.m_cpuHeapStart.ptr + index * entry.m_descriptorSize;
 		gpuHandle.ptr = entry.m_gpuHeapStart.ptr + index * entry.m_descriptorSize;
@@ -84,17 +153,43 @@ namespace JoyEngine
 
 	void DescriptorManager::FreeDescriptor(
 		D3D12_DESCRIPTOR_HEAP_TYPE type,
-		uint32_t index)
+		uint32_t index,
+		uint32_t count)
 	{
-		// TODO
+		GraphicsManager::Get()->GetReleaseQueue().Enqueue([this, type, index, count]()
+		{
+			auto& entry = m_heapStorage.at(type);
+			entry.m_memoryAllocations[index] = {};
+			entry.m_allocator.Free(index, count);
+		});
+	}
+
+	void DescriptorManager::BeginFrame(uint64_t frameFenceValue, uint64_t completedFenceValue)
+	{
+		for (auto& [type, entry] : m_heapStorage)
+		{
+			entry.m_allocator.BeginFrame(frameFenceValue, completedFenceValue);
+		}
 	}
 
 	void DescriptorManager::PrintStats() const
 	{
-		Logger::LogFormat("Heap CBV_SRV_UAV allocated %d descriptors\n", m_heapStorage.at(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV).m_currentDescriptorIndex);
-		Logger::LogFormat("Heap SAMPLER allocated %d descriptors\n", m_heapStorage.at(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER).m_currentDescriptorIndex);
-		Logger::LogFormat("Heap RTV allocated %d descriptors\n", m_heapStorage.at(D3D12_DESCRIPTOR_HEAP_TYPE_RTV).m_currentDescriptorIndex);
-		Logger::LogFormat("Heap DSV allocated %d descriptors\n", m_heapStorage.at(D3D12_DESCRIPTOR_HEAP_TYPE_DSV).m_currentDescriptorIndex);
+		for (const auto& [type, entry] : m_heapStorage)
+		{
+			const DescriptorIndexStats& stats = entry.m_allocator.GetStats();
+			Logger::LogFormat("%s: %d of %d persistent live, %d peak, %d transient per frame peak of %d\n",
+			                  GetMemoryDomain(type),
+			                  stats.persistentLiveCount,
+			                  entry.m_allocator.GetPersistentCount(),
+			                  stats.persistentPeakCount,
+			                  stats.transientPeakCount,
+			                  entry.m_allocator.GetTransientCount());
+		}
+	}
+
+	const DescriptorIndexStats& DescriptorManager::GetStats(D3D12_DESCRIPTOR_HEAP_TYPE type) const
+	{
+		return m_heapStorage.at(type).m_allocator.GetStats();
 	}
 
 	ID3D12DescriptorHeap* DescriptorManager::GetHeapByType(D3D12_DESCRIPTOR_HEAP_TYPE type) const
@@ -3,8 +3,11 @@
 
 #include <array>
 #include <map>
+#include <vector>
 
+#include "DescriptorIndexAllocator.h"
 #include "Common/Singleton.h"
+#include "Utils/MemoryTracker.h"
 
 
 #include <d3d12.h>
@@ -12,7 +15,8 @@
 #include <wrl.h>
 using Microsoft::WRL::ComPtr;
 
-#define DESCRIPTORS_COUNT 2048
+#define DESCRIPTORS_COUNT 2048 // persistent descriptors per heap
+#define TRANSIENT_DESCRIPTORS_COUNT 1024 // per frame descriptors, after the persistent ones
 
 namespace JoyEngine
 {
@@ -20,22 +24,43 @@ namespace JoyEngine
 	{
 	public:
 		DescriptorManager();
+		~DescriptorManager();
 
 		void AllocateDescriptor(
 			D3D12_DESCRIPTOR_HEAP_TYPE type,
 			uint32_t& index,
 			D3D12_CPU_DESCRIPTOR_HANDLE& cpuHandle,
 			D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
+		// Contiguous table, handles are of the first descriptor
+		void AllocateDescriptors(
+			D3D12_DESCRIPTOR_HEAP_TYPE type,
+			uint32_t count,
+			uint32_t& index,
+			D3D12_CPU_DESCRIPTOR_HANDLE& cpuHandle,
+			D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
+		// Contiguous table valid for the recorded frame only, not freed
+		void AllocateTransientDescriptors(
+			D3D12_DESCRIPTOR_HEAP_TYPE type,
+			uint32_t count,
+			uint32_t& index,
+			D3D12_CPU_DESCRIPTOR_HANDLE& cpuHandle,
+			D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
 		void GetDescriptorHandleAtIndex(
 			const D3D12_DESCRIPTOR_HEAP_TYPE type,
 			const uint32_t index,
 			D3D12_CPU_DESCRIPTOR_HANDLE& cpuHandle,
 			D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle) const;
+		// The index is reused after the frames in flight that could use it have finished
 		void FreeDescriptor(
 			D3D12_DESCRIPTOR_HEAP_TYPE type,
-			uint32_t index);
+			uint32_t index,
+			uint32_t count = 1);
+
+		// Called by the renderer with the fence value of the recorded frame and the completed one
+		void BeginFrame(uint64_t frameFenceValue, uint64_t completedFenceValue);
 
 		void PrintStats() const;
+		[[nodiscard]] const DescriptorIndexStats& GetStats(D3D12_DESCRIPTOR_HEAP_TYPE type) const;
 
 		[[nodiscard]] ID3D12DescriptorHeap* GetHeapByType(D3D12_DESCRIPTOR_HEAP_TYPE) const;
 		[[nodiscard]] D3D12_GPU_DESCRIPTOR_HANDLE GetSRVHeapStartDescriptorHandle() const;
@@ -49,12 +74,15 @@ namespace JoyEngine
 			          const uint32_t descriptorSize,
 			          const D3D12_CPU_DESCRIPTOR_HANDLE cpuHeapStart,
 			          const D3D12_GPU_DESCRIPTOR_HANDLE gpuHeapStart,
-			          const uint32_t descriptorsCount) :
+			          const uint32_t persistentCount,
+			          const uint32_t transientCount) :
 				m_heap(heap),
 				m_descriptorSize(descriptorSize),
 				m_cpuHeapStart(cpuHeapStart),
 				m_gpuHeapStart(gpuHeapStart),
-				m_descriptorsCount(descriptorsCount)
+				m_descriptorsCount(persistentCount + transientCount),
+				m_allocator(persistentCount, transientCount),
+				m_memoryAllocations(persistentCount)
 			{
 			}
 
@@ -63,7 +91,9 @@ namespace JoyEngine
 			const D3D12_CPU_DESCRIPTOR_HANDLE m_cpuHeapStart = {};
 			const D3D12_GPU_DESCRIPTOR_HANDLE m_gpuHeapStart = {};
 			const uint32_t m_descriptorsCount = 0;
-			uint32_t m_currentDescriptorIndex = 0;
+			DescriptorIndexAllocator m_allocator;
+			std::vector<MemoryAllocation> m_memoryAllocations; // per first index of a persistent table
+			MemoryAllocation m_transientMemory; // whole ring
 		};
 
 		std::map<D3D12_DESCRIPTOR_HEAP_TYPE, HeapEntry> m_heapStorage;
@@ -5,6 +5,7 @@
 #include "d3dx12.h"
 #include "DescriptorManager/DescriptorManager.h"
 #include "GraphicsManager/GraphicsManager.h"
+#include "Utils/MemoryTracker.h"
 #include "Utils/TimeCounter.h"
 #include "ResourceManager/ResourceManager.h"
 #include "SceneManager/WorldManager.h"
@@ -14,6 +15,7 @@ namespace JoyEngine
 	void EngineDataProvider::Init()
 	{
 		TIME_PERF("EngineDataProvider init")
+		MEMORY_TAG_SCOPE("EngineDataProvider")
 
 		EngineSamplersProvider::InitSamplers();
 		DXGI_FORMAT mainRTVFormat = IRenderer::GetHDRRenderTextureFormat();
@@ -21,6 +23,15 @@ namespace JoyEngine
 		DXGI_FORMAT mainGBufferFormat = IRenderer::GetGBufferFormat();
 		DXGI_FORMAT mainDSVFormat = IRenderer::GetDepthFormat();
 
+		// shaders are compiled in parallel, materials below only create root signatures and PSOs
+		const auto preloadedShaders = ResourceManager::Get()->PreloadShaders({
+			{"shaders/gizmoAxisDrawer.hlsl", JoyShaderTypeVertex | JoyShaderTypePixel},
+			{"shaders/standard/standardPhong.hlsl", JoyShaderTypeVertex | JoyShaderTypePixel},
+			{"shaders/ddgi/ddgi_deferred_shading.hlsl", JoyShaderTypeVertex | JoyShaderTypePixel},
+			{"shaders/basic_renderer/deferred_shading.hlsl", JoyShaderTypeVertex | JoyShaderTypePixel},
+			{"shaders/shadowprocessing.hlsl", JoyShaderTypeVertex | JoyShaderTypePixel},
+		});
+
 
 		// Standard shared material
 		//{
@@ -12,6 +12,7 @@ namespace JoyEngine
 		m_vertexAllocator(TRIANGLE_LIMIT * sizeof(Vertex) * 3, MESH_CONTAINER_ALIGNMENT),
 		m_indexAllocator(TRIANGLE_LIMIT * sizeof(Index) * 3, MESH_CONTAINER_ALIGNMENT)
 	{
+		MEMORY_TAG_SCOPE("MeshContainer")
 		m_vertexBuffer = std::make_unique<UAVGpuBuffer>(
 			TRIANGLE_LIMIT * 3,
 			sizeof(Vertex),
@@ -32,15 +33,17 @@ namespace JoyEngine
 			.vertexBufferOffset = vertexBufferOffset,
 			.indexBufferOffset = indexBufferOffset,
 			.vertexBufferView = {
-				.BufferLocation = GetVertexBuffer()->GetBufferResource()->GetGPUVirtualAddress() + vertexBufferOffset,
+				.BufferLocation = GetVertexBuffer()->GetGPUVirtualAddress() + vertexBufferOffset,
 				.SizeInBytes = static_cast<uint32_t>(vertexBufferSize),
 				.StrideInBytes = sizeof(Vertex)
 			},
 			.indexBufferView = {
-				.BufferLocation = GetIndexBuffer()->GetBufferResource()->GetGPUVirtualAddress() + indexBufferOffset,
+				.BufferLocation = GetIndexBuffer()->GetGPUVirtualAddress() + indexBufferOffset,
 				.SizeInBytes = static_cast<uint32_t>(indexBufferSize),
 				.Format = INDEX_FORMAT
 			}
 		};
+		outView.vertexMemory = MemoryTracker::Track("Mesh vertices", vertexBufferSize);
+		outView.indexMemory = MemoryTracker::Track("Mesh indices", indexBufferSize);
 	}
 }
@@ -4,6 +4,7 @@
 
 #include "Common/Allocators/LinearAllocator.h"
 #include "ResourceManager/Buffers/UAVGpuBuffer.h"
+#include "Utils/MemoryTracker.h"
 
 namespace JoyEngine
 {
@@ -13,6 +14,9 @@ namespace JoyEngine
 		uint32_t indexBufferOffset = 0;
 		D3D12_VERTEX_BUFFER_VIEW vertexBufferView = {};
 		D3D12_INDEX_BUFFER_VIEW indexBufferView = {};
+		// Parts of the container buffers, they are also counted in the "GPU buffers/MeshContainer" tag
+		MemoryAllocation vertexMemory;
+		MemoryAllocation indexMemory;
 	};
 
 	// Store every single mesh in one single buffer
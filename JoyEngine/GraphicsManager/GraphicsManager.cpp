@@ -1,6 +1,7 @@
 #include "GraphicsManager/GraphicsManager.h"
 
 #include "Utils/Assert.h"
+#include "Utils/Log.h"
 #include "Utils/TimeCounter.h"
 
 extern "C" { __declspec(dllexport) extern const UINT D3D12SDKVersion = 613; }
@@ -9,9 +10,17 @@ extern "C" { __declspec(dllexport) extern const char* D3D12SDKPath = "ThirdParty
 
 namespace JoyEngine
 {
-	GraphicsManager::GraphicsManager() 
+	GraphicsManager::GraphicsManager(bool headless) :
+		m_headless(headless)
 	{
 		TIME_PERF("GraphicsManager ctor")
+
+		if (m_headless)
+		{
+			Logger::Log("Running headless, D3D12 device is not created\n");
+			return;
+		}
+
 		UINT createFactoryFlags = 0;
 #if defined(GRAPHICS_DEBUG)
 
@@ -45,7 +54,7 @@ namespace JoyEngine
 				dxgiAdapterDesc1.DedicatedVideoMemory > maxDedicatedVideoMemory)
 			{
 				maxDedicatedVideoMemory = dxgiAdapterDesc1.DedicatedVideoMemory;
-				dxgiAdapter1.As(&m_physicalDevice);
+				ASSERT_SUCC(dxgiAdapter1.As(&m_physicalDevice));
 			}
 		}
 		ASSERT(m_physicalDevice != nullptr);
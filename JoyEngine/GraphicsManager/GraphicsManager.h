@@ -7,6 +7,7 @@
 #include <dxgi1_6.h>
 #include <wrl.h>
 
+#include "Common/DeferredReleaseQueue.h"
 #include "Common/Singleton.h"
 using Microsoft::WRL::ComPtr;
 
@@ -15,7 +16,8 @@ namespace JoyEngine
 	class GraphicsManager : public Singleton<GraphicsManager>
 	{
 	public:
-		GraphicsManager();
+		// Headless manager creates no factory and device, resources and views below it are stubbed out
+		explicit GraphicsManager(bool headless = false);
 
 		~GraphicsManager() = default;
 
@@ -23,9 +25,13 @@ namespace JoyEngine
 		[[nodiscard]] ID3D12Device5* GetDevice() const noexcept { return m_logicalDevice.Get(); }
 		[[nodiscard]] IDXGIFactory5* GetFactory() const noexcept { return m_dxgiFactory.Get(); }
 		[[nodiscard]] bool GetTearingSupport() const noexcept { return m_allowTearing; }
+		[[nodiscard]] bool IsHeadless() const noexcept { return m_headless; }
 
 		[[nodiscard]] D3D_ROOT_SIGNATURE_VERSION GetHighestRootSignatureVersion() const noexcept { return m_highestRootSignatureVersion; }
 
+		// Resources and descriptors the GPU may still use are released through it. Driven by the renderer's frame fence
+		[[nodiscard]] DeferredReleaseQueue& GetReleaseQueue() noexcept { return m_releaseQueue; }
+
 	private:
 		ComPtr<IDXGIFactory5> m_dxgiFactory = nullptr;
 		ComPtr<IDXGIAdapter4> m_physicalDevice = nullptr;
@@ -35,10 +41,13 @@ namespace JoyEngine
 		ComPtr<ID3D12Debug> m_debugController;
 #endif
 
+		const bool m_headless;
 		uint32_t m_m4xMsaaQuality;
-		bool m_allowTearing;
+		bool m_allowTearing = false;
 		D3D12_FEATURE_DATA_D3D12_OPTIONS m_featureSupport;
 		D3D_ROOT_SIGNATURE_VERSION m_highestRootSignatureVersion;
+
+		DeferredReleaseQueue m_releaseQueue;
 	};
 }
 
@@ -12,10 +12,14 @@
 #include "DataManager/DataManager.h"
 #include "DescriptorManager/DescriptorManager.h"
 #include "GraphicsManager/GraphicsManager.h"
+#include "Common/JoyObject.h"
 #include "Common/Time.h"
 #include "InputManager/InputManager.h"
 #include "ThreadManager/LockFreeFlag.h"
 #include "ThreadManager/ThreadManager.h"
+#include "Utils/Assert.h"
+#include "Utils/MemoryTracker.h"
+#include "Utils/Profiler.h"
 #include "Utils/TimeCounter.h"
 
 #ifdef _DEBUG
@@ -30,9 +34,12 @@ namespace JoyEngine
 	auto g_startTime = std::chrono::high_resolution_clock::now();
 
 	JoyEngine::JoyEngine(HWND gameWindowHandle):
+		m_windowHandle(gameWindowHandle),
+		m_memoryTracker(new MemoryTracker()),
+		m_profiler(new Profiler()),
 		m_threadManager(new ThreadManager()),
 		m_inputManager(new InputManager()),
-		m_graphicsManager(new GraphicsManager()),
+		m_graphicsManager(new GraphicsManager(gameWindowHandle == nullptr)),
 		m_memoryManager(new MemoryManager()),
 		m_dataManager(new DataManager()),
 		m_descriptorSetManager(new DescriptorManager()),
@@ -40,6 +47,9 @@ namespace JoyEngine
 		m_engineData(new EngineDataProvider()),
 		m_worldManager(new WorldManager(gameWindowHandle))
 	{
+		// all the types are registered by now
+		JoyTypeRegistry::GetInstance()->AssignIds();
+
 		{
 			// Setup Dear ImGui context
 			IMGUI_CHECKVERSION();
@@ -50,7 +60,10 @@ namespace JoyEngine
 			//io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
 
 			ImGui::StyleColorsDark();
-			ImGui_ImplWin32_Init(gameWindowHandle);
+			if (gameWindowHandle != nullptr)
+			{
+				ImGui_ImplWin32_Init(gameWindowHandle);
+			}
 		}
 	}
 
@@ -69,6 +82,7 @@ namespace JoyEngine
 
 		m_memoryManager->PrintStats();
 		m_descriptorSetManager->PrintStats();
+		m_memoryTracker->LogStats();
 
 		Logger::Log("==================================================================\n");
 	}
@@ -82,14 +96,46 @@ namespace JoyEngine
 		m_threadManager->StartTask(&JoyEngine::UpdateTask, this);
 	}
 
+	void JoyEngine::RunHeadless(uint32_t framesCount) const noexcept
+	{
+		ASSERT(m_windowHandle == nullptr);
+
+		m_worldManager->Start();
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < framesCount; i++)
+		{
+			UpdateFrame();
+		}
+		const auto currentTime = std::chrono::high_resolution_clock::now();
+		const float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+		Logger::LogFormat("=========== %u headless frames in %.3f seconds ===========\n", framesCount, time);
+
+		m_profiler->LogStats();
+		m_memoryTracker->LogStats();
+
+		Logger::Log("==================================================================\n");
+	}
+
 	void JoyEngine::UpdateTask() const noexcept
 	{
 		while (!g_finishFlag)
 		{
+			UpdateFrame();
+		}
+	}
+
+	void JoyEngine::UpdateFrame() const noexcept
+	{
+		{
+			PROFILE_ZONE("Frame")
+
 			Time::Update();
 
 			m_worldManager->Update();
 		}
+		m_profiler->EndFrame();
+		m_memoryTracker->Update();
 	}
 
 	void JoyEngine::Stop() const noexcept
@@ -106,13 +152,19 @@ namespace JoyEngine
 		m_inputManager = nullptr;
 		m_engineData = nullptr; //delete all internal engine resources
 		m_worldManager = nullptr; //delete swapchain, synchronisation, framebuffers
+		m_graphicsManager->GetReleaseQueue().CollectAll(); // resources released by the renderer
 		m_resourceManager = nullptr; //delete all scene render data (buffers, textures)
 		m_descriptorSetManager = nullptr;
 		m_dataManager = nullptr;
 		m_memoryManager = nullptr; //free gpu memory
 		m_graphicsManager = nullptr; //delete surface, device, instance
+		m_profiler = nullptr;
+		m_memoryTracker = nullptr;
 
-		ImGui_ImplWin32_Shutdown();
+		if (m_windowHandle != nullptr)
+		{
+			ImGui_ImplWin32_Shutdown();
+		}
 		ImGui::DestroyContext();
 
 #ifdef _DEBUG
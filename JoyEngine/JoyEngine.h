@@ -27,6 +27,10 @@ namespace JoyEngine
 
 	class EngineDataProvider;
 
+	class Profiler;
+
+	class MemoryTracker;
+
 	class IWindowHandler
 	{
 	public:
@@ -44,12 +48,16 @@ namespace JoyEngine
 	class JoyEngine final : public IWindowHandler
 	{
 	public:
+		// Without window the engine runs headless: no D3D12 device, swapchain and GUI, GPU objects are stubbed out
 		JoyEngine(HWND gameWindowHandle);
 
 		void Init() const noexcept;
 
 		void Start() const noexcept;
 
+		// Runs frames on the calling thread instead of Start() and logs their timings
+		void RunHeadless(uint32_t framesCount) const noexcept;
+
 		void UpdateTask() const noexcept;
 
 		void Stop() const noexcept;
@@ -59,8 +67,12 @@ namespace JoyEngine
 		void HandleMessage(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) override;
 
 	private:
+		void UpdateFrame() const noexcept;
+
 		HWND m_windowHandle;
 
+		std::unique_ptr<MemoryTracker> m_memoryTracker; // first and destroyed last, so every tracked allocation is counted
+		std::unique_ptr<Profiler> m_profiler; // first, so managers are profiled from their constructors
 		std::unique_ptr<InputManager> m_inputManager;
 		std::unique_ptr<ThreadManager> m_threadManager;
 		std::unique_ptr<GraphicsManager> m_graphicsManager;
@@ -1,5 +1,6 @@
 #include "MemoryManager.h"
 
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -14,6 +15,7 @@
 #include "ResourceManager/Texture.h"
 #include "Utils/Assert.h"
 #include "Utils/GraphicsUtils.h"
+#include "Utils/MemoryTracker.h"
 #include "Utils/TimeCounter.h"
 
 #define GPU_BUFFER_ALLOCATION_SIZE (256*1024*1024) // 256 MB
@@ -26,8 +28,6 @@
 
 namespace JoyEngine
 {
-	uint64_t g_debugMaxResourceSizeAllocated = 0;
-
 	D3D12_PLACED_SUBRESOURCE_FOOTPRINT g_subresourceFootprints[24];
 
 	std::string ParseByteNumber(uint64_t bytes)
@@ -55,6 +55,12 @@ namespace JoyEngine
 	{
 		TIME_PERF("MemoryManager ctor")
 
+		if (GraphicsManager::Get()->IsHeadless())
+		{
+			// No heaps and copy queue, CPU visible buffers keep their data in system memory
+			return;
+		}
+
 		m_queue = std::make_unique<CommandQueue>(D3D12_COMMAND_LIST_TYPE_DIRECT, GraphicsManager::Get()->GetDevice());
 
 		m_allocators[DeviceAllocatorTypeGpuBuffer] = std::make_unique<LinearMemoryAllocator>(
@@ -87,13 +93,19 @@ namespace JoyEngine
 			CPU_READBACK_ALLOCATION_SIZE,
 			GraphicsManager::Get()->GetDevice());
 
+		MEMORY_TAG_SCOPE("MemoryManager staging")
 		m_uploadStagingBuffer = std::make_unique<Buffer>(128 * 1024 * 1024, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_HEAP_TYPE_UPLOAD);
 		m_readbackStagingBuffer = std::make_unique<Buffer>(128 * 1024 * 1024, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_HEAP_TYPE_READBACK);
 	}
 
 	void MemoryManager::PrintStats() const
 	{
-		Logger::Log(("Biggest resource allocated: " + ParseByteNumber(g_debugMaxResourceSizeAllocated) + "\n").c_str());
+		if (GraphicsManager::Get()->IsHeadless())
+		{
+			Logger::Log("GPU allocators are not created in headless mode\n");
+			return;
+		}
+
 		Logger::Log(("GPU buffer allocator: " + ParseAllocatorStats(m_allocators[DeviceAllocatorTypeGpuBuffer].get())).c_str());
 		Logger::Log(("GPU textures allocator: " + ParseAllocatorStats(m_allocators[DeviceAllocatorTypeTextures].get())).c_str());
 		Logger::Log(("GPU RT DS textures allocator: " + ParseAllocatorStats(m_allocators[DeviceAllocatorTypeRtDsTextures].get())).c_str());
@@ -106,6 +118,8 @@ namespace JoyEngine
 		uint64_t offset,
 		Texture* gpuImage) const
 	{
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		uint64_t resourceSize;
 		D3D12_RESOURCE_DESC resourceDesc = gpuImage->GetImageResource().Get()->GetDesc();
 		GraphicsManager::Get()->GetDevice()->GetCopyableFootprints(
@@ -117,10 +131,6 @@ namespace JoyEngine
 			nullptr,
 			nullptr,
 			&resourceSize);
-		if (resourceSize > g_debugMaxResourceSizeAllocated)
-		{
-			g_debugMaxResourceSizeAllocated = resourceSize;
-		}
 
 		uint32_t bytesPer4x4Block = 16;
 
@@ -141,6 +151,8 @@ namespace JoyEngine
 			ASSERT(false); // TODO later maybe never
 		}
 
+		ASSERT_DESC(resourceSize <= m_uploadStagingBuffer->GetSizeInBytes(), "Mip chain doesn't fit upload staging buffer");
+
 		const MappedAreaHandle ptr = m_uploadStagingBuffer->Map();
 		stream.clear();
 
@@ -206,57 +218,71 @@ namespace JoyEngine
 		uint64_t bufferSize,
 		const Buffer* gpuBuffer) const
 	{
-		m_queue->ResetForFrame();
+		ASSERT(bufferSize <= gpuBuffer->GetSizeInBytes());
 
-		const auto commandList = m_queue->GetCommandList(0);
+		if (GraphicsManager::Get()->IsHeadless())
+		{
+			// Nothing has ever written the buffer
+			memset(ptr, 0, bufferSize);
+			return;
+		}
 
-		const D3D12_RESOURCE_STATES state = gpuBuffer->GetCurrentResourceState();
+		const uint64_t stagingSize = m_readbackStagingBuffer->GetSizeInBytes();
+		for (uint64_t chunkOffset = 0; chunkOffset < bufferSize; chunkOffset += stagingSize)
+		{
+			const uint64_t chunkSize = std::min(bufferSize - chunkOffset, stagingSize);
 
-		GraphicsUtils::Barrier(commandList, gpuBuffer->GetBufferResource().Get(),
-		                       state,
-		                       D3D12_RESOURCE_STATE_COPY_SOURCE);
+			m_queue->ResetForFrame();
 
-		commandList->CopyBufferRegion(
-			m_readbackStagingBuffer->GetBufferResource().Get(),
-			0,
-			gpuBuffer->GetBufferResource().Get(),
-			0,
-			bufferSize);
+			const auto commandList = m_queue->GetCommandList(0);
 
-		GraphicsUtils::Barrier(commandList, gpuBuffer->GetBufferResource().Get(),
-		                       D3D12_RESOURCE_STATE_COPY_SOURCE,
-		                       state);
+			const D3D12_RESOURCE_STATES state = gpuBuffer->GetCurrentResourceState();
 
-		ASSERT_SUCC(commandList->Close());
+			GraphicsUtils::Barrier(commandList, gpuBuffer->GetBufferResource().Get(),
+			                       state,
+			                       D3D12_RESOURCE_STATE_COPY_SOURCE);
 
-		m_queue->Execute(0);
+			commandList->CopyBufferRegion(
+				m_readbackStagingBuffer->GetBufferResource().Get(),
+				0,
+				gpuBuffer->GetBufferResource().Get(),
+				chunkOffset,
+				chunkSize);
 
-		m_queue->WaitQueueIdle();
+			GraphicsUtils::Barrier(commandList, gpuBuffer->GetBufferResource().Get(),
+			                       D3D12_RESOURCE_STATE_COPY_SOURCE,
+			                       state);
 
-		const MappedAreaHandle bufferMappedPtr = m_readbackStagingBuffer->Map();
+			ASSERT_SUCC(commandList->Close());
 
-		memcpy(ptr, bufferMappedPtr.GetPtr(), bufferSize);
+			m_queue->Execute(0);
+
+			m_queue->WaitQueueIdle();
+
+			const MappedAreaHandle bufferMappedPtr = m_readbackStagingBuffer->Map();
+
+			memcpy(static_cast<uint8_t*>(ptr) + chunkOffset, bufferMappedPtr.GetPtr(), chunkSize);
+		}
 	}
 
 	ComPtr<ID3D12Resource> MemoryManager::CreateResource(
 		D3D12_HEAP_TYPE heapType,
 		const D3D12_RESOURCE_DESC* resourceDesc,
 		D3D12_RESOURCE_STATES initialResourceState,
+		MemoryAllocation& memoryAllocation,
 		const D3D12_CLEAR_VALUE* clearValue) const
 	{
 		ComPtr<ID3D12Resource> resource;
 
-		const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = GraphicsManager::Get()->GetDevice()->GetResourceAllocationInfo(
-			0, 1, resourceDesc);
-
-
 		LinearMemoryAllocator* allocator = nullptr;
+		const char* memoryDomain = nullptr;
 
 		if (heapType == D3D12_HEAP_TYPE_DEFAULT)
 		{
 			if (resourceDesc->Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
 			{
 				allocator = m_allocators[DeviceAllocatorTypeGpuBuffer].get();
+				memoryDomain = "GPU buffers";
 			}
 			else
 			{
@@ -264,26 +290,43 @@ namespace JoyEngine
 					resourceDesc->Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
 				{
 					allocator = m_allocators[DeviceAllocatorTypeRtDsTextures].get();
+					memoryDomain = "GPU render targets";
 				}
 				else
 				{
 					allocator = m_allocators[DeviceAllocatorTypeTextures].get();
+					memoryDomain = "GPU textures";
 				}
 			}
 		}
 		else if (heapType == D3D12_HEAP_TYPE_UPLOAD)
 		{
 			allocator = m_allocators[DeviceAllocatorTypeCpuUploadBuffer].get();
+			memoryDomain = "CPU upload";
 		}
 		else if (heapType == D3D12_HEAP_TYPE_READBACK)
 		{
 			allocator = m_allocators[DeviceAllocatorTypeCpuReadbackBuffer].get();
+			memoryDomain = "CPU readback";
 		}
 		else
 		{
 			ASSERT(false);
 		}
 
+		if (GraphicsManager::Get()->IsHeadless())
+		{
+			// Only buffer sizes are known without device, texture footprints are not counted
+			if (resourceDesc->Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+			{
+				memoryAllocation = MemoryTracker::Track(memoryDomain, resourceDesc->Width);
+			}
+			return nullptr;
+		}
+
+		const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = GraphicsManager::Get()->GetDevice()->GetResourceAllocationInfo(
+			0, 1, resourceDesc);
+
 		ASSERT_SUCC(GraphicsManager::Get()->GetDevice()->CreatePlacedResource(
 			allocator->GetHeap(),
 			allocator->Allocate(allocationInfo.SizeInBytes),
@@ -292,6 +335,7 @@ namespace JoyEngine
 			clearValue,
 			IID_PPV_ARGS(&resource)
 		));
+		memoryAllocation = MemoryTracker::Track(memoryDomain, allocationInfo.SizeInBytes);
 
 		return resource;
 	}
@@ -303,12 +347,22 @@ namespace JoyEngine
 		uint64_t bufferSize,
 		const Buffer* gpuBuffer) const
 	{
+		ASSERT(bufferSize <= gpuBuffer->GetSizeInBytes());
+
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		const MappedAreaHandle bufferMappedPtr = m_uploadStagingBuffer->Map();
 		stream.clear();
 		stream.seekg(offset);
-		stream.read(static_cast<char*>(bufferMappedPtr.GetPtr()), bufferSize);
 
-		LoadDataToBufferInternal(bufferSize, gpuBuffer, 0);
+		// Data larger than staging buffer goes in several copies, staging is free again after each of them
+		const uint64_t stagingSize = m_uploadStagingBuffer->GetSizeInBytes();
+		for (uint64_t chunkOffset = 0; chunkOffset < bufferSize; chunkOffset += stagingSize)
+		{
+			const uint64_t chunkSize = std::min(bufferSize - chunkOffset, stagingSize);
+			stream.read(static_cast<char*>(bufferMappedPtr.GetPtr()), chunkSize);
+			LoadDataToBufferInternal(chunkSize, gpuBuffer, chunkOffset);
+		}
 	}
 
 	void MemoryManager::LoadDataToBuffer(
@@ -317,11 +371,19 @@ namespace JoyEngine
 		const Buffer* gpuBuffer,
 		uint64_t bufferOffset) const
 	{
-		const MappedAreaHandle bufferMappedPtr = m_uploadStagingBuffer->Map();
+		ASSERT(bufferOffset + bufferSize <= gpuBuffer->GetSizeInBytes());
 
-		memcpy(bufferMappedPtr.GetPtr(), ptr, bufferSize);
+		if (GraphicsManager::Get()->IsHeadless()) return;
 
-		LoadDataToBufferInternal(bufferSize, gpuBuffer, bufferOffset);
+		const MappedAreaHandle bufferMappedPtr = m_uploadStagingBuffer->Map();
+
+		const uint64_t stagingSize = m_uploadStagingBuffer->GetSizeInBytes();
+		for (uint64_t chunkOffset = 0; chunkOffset < bufferSize; chunkOffset += stagingSize)
+		{
+			const uint64_t chunkSize = std::min(bufferSize - chunkOffset, stagingSize);
+			memcpy(bufferMappedPtr.GetPtr(), static_cast<const uint8_t*>(ptr) + chunkOffset, chunkSize);
+			LoadDataToBufferInternal(chunkSize, gpuBuffer, bufferOffset + chunkOffset);
+		}
 	}
 
 	void MemoryManager::LoadDataToBufferInternal(
@@ -329,11 +391,6 @@ namespace JoyEngine
 		const Buffer* gpuBuffer,
 		uint64_t bufferOffset) const
 	{
-		if (bufferSize > g_debugMaxResourceSizeAllocated)
-		{
-			g_debugMaxResourceSizeAllocated = bufferSize;
-		}
-
 		m_queue->ResetForFrame();
 
 		const auto commandList = m_queue->GetCommandList(0);
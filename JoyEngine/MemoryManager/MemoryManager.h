@@ -9,6 +9,7 @@
 #include "LinearMemoryAllocator.h"
 #include "Common/Singleton.h"
 #include "ResourceManager/Buffers/Buffer.h"
+#include "Utils/MemoryTracker.h"
 
 
 namespace JoyEngine
@@ -49,6 +50,7 @@ namespace JoyEngine
 			D3D12_HEAP_TYPE heapType,
 			const D3D12_RESOURCE_DESC* resourceDesc,
 			D3D12_RESOURCE_STATES initialResourceState,
+			MemoryAllocation& memoryAllocation,
 			const D3D12_CLEAR_VALUE* clearValue = nullptr) const;
 
 	private:
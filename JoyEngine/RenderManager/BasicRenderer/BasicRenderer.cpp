@@ -21,10 +21,13 @@
 #include "GraphicsManager/GraphicsManager.h"
 #include "EngineDataProvider/EngineDataProvider.h"
 #include "ResourceManager/Material.h"
+#include "ResourceManager/ResourceManager.h"
 #include "SceneManager/GameObject.h"
 #include "SceneManager/Transform.h"
 
 #include "Utils/GraphicsUtils.h"
+#include "Utils/MemoryTracker.h"
+#include "Utils/Profiler.h"
 #include "Utils/TimeCounter.h"
 
 namespace JoyEngine
@@ -120,6 +123,8 @@ namespace JoyEngine
 
 		m_gbuffer = std::make_unique<RTVGbuffer>(m_width, m_height);
 
+		// compile all the renderer shaders in parallel before subsystems create their pipelines
+		const auto preloadedShaders = ResourceManager::Get()->PreloadShaders(Tonemapping::GetPreloadShaders());
 
 		m_tonemapping = std::make_unique<Tonemapping>(
 			this,
@@ -205,6 +210,8 @@ namespace JoyEngine
 		m_currentFrameIndex = m_swapChain->GetCurrentBackBufferIndex();
 
 		m_queue->WaitForFence(m_currentFrameIndex);
+		GraphicsManager::Get()->GetReleaseQueue().BeginFrame(m_queue->GetCurrentFenceValue(), m_queue->GetCompletedFenceValue());
+		DescriptorManager::Get()->BeginFrame(m_queue->GetCurrentFenceValue(), m_queue->GetCompletedFenceValue());
 
 		m_queue->ResetForFrame(m_currentFrameIndex);
 
@@ -353,12 +360,16 @@ namespace JoyEngine
 
 		ASSERT_SUCC(commandList->Close());
 
-		m_queue->Execute(m_currentFrameIndex);
+		{
+			PROFILE_ZONE("Execute and present")
+
+			m_queue->Execute(m_currentFrameIndex);
 
-		UINT presentFlags = GraphicsManager::Get()->GetTearingSupport() ? DXGI_PRESENT_ALLOW_TEARING : 0;
+			UINT presentFlags = GraphicsManager::Get()->GetTearingSupport() ? DXGI_PRESENT_ALLOW_TEARING : 0;
 
-		// Present the frame.
-		ASSERT_SUCC(m_swapChain->Present(0, presentFlags));
+			// Present the frame.
+			ASSERT_SUCC(m_swapChain->Present(0, presentFlags));
+		}
 
 		m_trianglesCount = 0;
 	}
@@ -432,6 +443,19 @@ namespace JoyEngine
 			ImGui::End();
 			m_tonemapping->UpdateConstants(m_currentFrameIndex);
 		}
+		windowPosY += windowHeight;
+		windowHeight = 250;
+		ImGui::SetNextWindowPos({0, windowPosY});
+		ImGui::SetNextWindowSize({450, windowHeight});
+		{
+			Profiler::Get()->DrawGui();
+		}
+		windowPosY += windowHeight;
+		ImGui::SetNextWindowPos({0, windowPosY});
+		ImGui::SetNextWindowSize({450, windowHeight});
+		{
+			MemoryTracker::Get()->DrawGui();
+		}
 
 		ImGui::Render();
 		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList);
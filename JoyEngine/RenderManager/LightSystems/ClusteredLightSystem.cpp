@@ -1,7 +1,5 @@
 #include "ClusteredLightSystem.h"
 
-#include <cmath>
-
 #include "Components/Camera.h"
 #include "Components/MeshRenderer.h"
 #include "EngineDataProvider/EngineDataProvider.h"
@@ -13,25 +11,6 @@
 
 namespace JoyEngine
 {
-	bool SphereCubeIntersection(jmath::vec3 cubeMin, jmath::vec3 cubeMax, jmath::vec3 sphereCenter, float sphereRadius)
-	{
-		float dmin = 0;
-		float r2 = pow(sphereRadius, 2.f);
-		for (int i = 0; i < 3; i++)
-		{
-			if (sphereCenter[i] < cubeMin[i])
-				dmin += pow(sphereCenter[i] - cubeMin[i], 2.f);
-			else if (sphereCenter[i] > cubeMax[i])
-				dmin += pow(sphereCenter[i] - cubeMax[i], 2.f);
-		}
-
-		if (dmin <= r2)
-		{
-			return true;
-		}
-		return false;
-	}
-
 	ClusteredLightSystem::ClusteredLightSystem(const uint32_t frameCount) :
 		m_frameCount(frameCount),
 		m_camera(nullptr),
@@ -62,90 +41,22 @@ namespace JoyEngine
 		//	}
 		//}
 
-		const float cameraNear = m_camera->GetNear();
-		const float cameraFar = m_camera->GetFar();
-		const float cameraAspect = m_camera->GetAspect();
-		const float cameraFowRad = m_camera->GetFovRadians();
-
-		const float distance = cameraFar - cameraNear;
-		const float logDistance = log2(distance + 1);
+		GetClusterBounds(m_camera->GetNear(), m_camera->GetFar(), m_camera->GetAspect(), m_camera->GetFovRadians(), m_clusterBounds.data());
 
 		const jmath::mat4x4 cameraViewMatrix = m_camera->GetViewMatrix();
 
-		auto GetCubeVertex = [&](int x, int y, int z)
-		{
-			const float nearZ = (pow(2.0f, logDistance / NUM_CLUSTERS_Z * z) - 1 + cameraNear);
-			const float nearH = 2 * nearZ * tan(cameraFowRad / 2.f);
-			const float nearW = cameraAspect * nearH;
-			const float cubeX = x * nearW / NUM_CLUSTERS_X - nearW / 2;
-			const float cubeY = y * nearH / NUM_CLUSTERS_Y - nearH / 2;
-
-			return jmath::vec3(cubeX, cubeY, nearZ);
-		};
-
-		for (auto& pair : m_lights) // TODO make it in parallel
+		m_clusterLights.clear();
+		for (LightBase* light : m_lights) // TODO make it in parallel
 		{
-			jmath::xvec4 sphereCenter = pair.first->GetGameObject().GetTransform().GetXPosition();
-			sphereCenter = jmath::mul(cameraViewMatrix, sphereCenter);
-			pair.second = sphereCenter;
+			const jmath::xvec4 sphereCenter = jmath::mul(cameraViewMatrix, light->GetGameObject().GetTransform().GetXPosition());
+			m_clusterLights.push_back({
+				.viewPosition = jmath::toVec3(sphereCenter),
+				.radius = m_lightDataPool.GetValue(light->GetIndex()).radius,
+				.index = light->GetIndex()
+			});
 		}
 
-		for (int z = 0; z < NUM_CLUSTERS_Z; z++) // TODO make it in parallel
-		{
-			for (int x = 0; x < NUM_CLUSTERS_X; x++)
-			{
-				for (int y = 0; y < NUM_CLUSTERS_Y; y++)
-				{
-					jmath::vec3 cubePoints[8];
-
-					cubePoints[0] = GetCubeVertex(x + 0, y + 0, z + 0);
-					cubePoints[1] = GetCubeVertex(x + 0, y + 0, z + 1);
-					cubePoints[2] = GetCubeVertex(x + 0, y + 1, z + 0);
-					cubePoints[3] = GetCubeVertex(x + 0, y + 1, z + 1);
-					cubePoints[4] = GetCubeVertex(x + 1, y + 0, z + 0);
-					cubePoints[5] = GetCubeVertex(x + 1, y + 0, z + 1);
-					cubePoints[6] = GetCubeVertex(x + 1, y + 1, z + 0);
-					cubePoints[7] = GetCubeVertex(x + 1, y + 1, z + 1);
-
-					jmath::vec3 cubeMin = cubePoints[0];
-					jmath::vec3 cubeMax = cubePoints[0];
-
-					for (int i = 1; i < 8; i++)
-					{
-						cubeMin = jmath::min(cubePoints[i], cubeMin);
-						cubeMax = jmath::max(cubePoints[i], cubeMax);
-					}
-
-					int currentLight = 0;
-					const int clusterStartingPoint =
-						y * LIGHTS_PER_CLUSTER +
-						x * LIGHTS_PER_CLUSTER * NUM_CLUSTERS_Y +
-						z * LIGHTS_PER_CLUSTER * NUM_CLUSTERS_Y * NUM_CLUSTERS_X;
-
-					for (const auto& light : m_lights)
-					{
-						uint32_t lightIndex = light.first->GetIndex();
-
-						if (SphereCubeIntersection(
-								cubeMin,
-								cubeMax,
-								jmath::toVec3(light.second),
-								m_lightDataPool.GetValue(lightIndex).radius)
-						)
-						{
-							ASSERT(currentLight < LIGHTS_PER_CLUSTER);
-							m_clusterLightIndices[clusterStartingPoint + currentLight] = lightIndex;
-							currentLight++;
-						}
-					}
-
-					for (int i = currentLight; i < LIGHTS_PER_CLUSTER; i++)
-					{
-						m_clusterLightIndices[clusterStartingPoint + i] = -1;
-					}
-				}
-			}
-		}
+		AssignLightsToClusters(m_clusterBounds.data(), m_clusterLights.data(), static_cast<uint32_t>(m_clusterLights.size()), m_clusterLightIndices.data());
 
 		uint32_t currentOffset = 0;
 		for (int z = 0; z < NUM_CLUSTERS_Z; z++)
@@ -164,7 +75,7 @@ namespace JoyEngine
 
 					for (int i = 0; i < LIGHTS_PER_CLUSTER; i++)
 					{
-						if (m_clusterLightIndices[clusterIndex * LIGHTS_PER_CLUSTER + i] == -1)
+						if (m_clusterLightIndices[clusterIndex * LIGHTS_PER_CLUSTER + i] == NoClusterLight)
 						{
 							break;
 						}
@@ -260,7 +171,7 @@ namespace JoyEngine
 	uint32_t ClusteredLightSystem::RegisterLight(LightBase* light)
 	{
 		ASSERT(!m_lights.contains(light));
-		m_lights.insert({light, jmath::xvec4()});
+		m_lights.insert(light);
 		return m_lightDataPool.Allocate();
 	}
 
@@ -1,10 +1,12 @@
 #ifndef CLUSTERED_LIGHT_SYSTEM_H
 #define CLUSTERED_LIGHT_SYSTEM_H
 
-#include <map>
+#include <set>
+#include <vector>
 
 #include "CommonEngineStructs.h"
 #include "ILightSystem.h"
+#include "LightClusters.h"
 #include "Components/Light.h"
 #include "ResourceManager/Texture.h"
 #include "ResourceManager/Buffers/DynamicBufferPool.h"
@@ -86,8 +88,10 @@ namespace JoyEngine
 		DynamicBufferPool<LightInfo, LIGHT_SIZE> m_lightDataPool;
 		// TODO we store pointers to lights here for getting their positions during light clusterization
 		// TODO make something smarter than this
-		std::map<LightBase*, jmath::xvec4> m_lights;
-		std::array<uint32_t, NUM_CLUSTERS_X * NUM_CLUSTERS_Y * NUM_CLUSTERS_Z * LIGHTS_PER_CLUSTER> m_clusterLightIndices;
+		std::set<LightBase*> m_lights;
+		std::vector<ClusterLight> m_clusterLights;
+		std::array<ClusterBounds, ClustersCount> m_clusterBounds;
+		std::array<uint32_t, ClustersCount * LIGHTS_PER_CLUSTER> m_clusterLightIndices;
 		DynamicCpuBuffer<ClusterEntry, NUM_CLUSTERS_X * NUM_CLUSTERS_Y * NUM_CLUSTERS_Z> m_clusterEntryData;
 		DynamicCpuBuffer<UINT1, CLUSTER_ITEM_DATA_SIZE> m_clusterItemData;
 	};
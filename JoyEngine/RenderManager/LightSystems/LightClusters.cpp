@@ -0,0 +1,102 @@
+#include "LightClusters.h"
+
+#include <cmath>
+
+#include "Utils/Assert.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		bool SphereCubeIntersection(jmath::vec3 cubeMin, jmath::vec3 cubeMax, jmath::vec3 sphereCenter, float sphereRadius)
+		{
+			float dmin = 0;
+			float r2 = pow(sphereRadius, 2.f);
+			for (int i = 0; i < 3; i++)
+			{
+				if (sphereCenter[i] < cubeMin[i])
+					dmin += pow(sphereCenter[i] - cubeMin[i], 2.f);
+				else if (sphereCenter[i] > cubeMax[i])
+					dmin += pow(sphereCenter[i] - cubeMax[i], 2.f);
+			}
+
+			if (dmin <= r2)
+			{
+				return true;
+			}
+			return false;
+		}
+	}
+
+	void GetClusterBounds(float cameraNear, float cameraFar, float cameraAspect, float cameraFovRadians, ClusterBounds* bounds)
+	{
+		const float distance = cameraFar - cameraNear;
+		const float logDistance = log2(distance + 1);
+
+		auto GetCubeVertex = [&](int x, int y, int z)
+		{
+			const float nearZ = (pow(2.0f, logDistance / NUM_CLUSTERS_Z * z) - 1 + cameraNear);
+			const float nearH = 2 * nearZ * tan(cameraFovRadians / 2.f);
+			const float nearW = cameraAspect * nearH;
+			const float cubeX = x * nearW / NUM_CLUSTERS_X - nearW / 2;
+			const float cubeY = y * nearH / NUM_CLUSTERS_Y - nearH / 2;
+
+			return jmath::vec3(cubeX, cubeY, nearZ);
+		};
+
+		for (int z = 0; z < NUM_CLUSTERS_Z; z++)
+		{
+			for (int x = 0; x < NUM_CLUSTERS_X; x++)
+			{
+				for (int y = 0; y < NUM_CLUSTERS_Y; y++)
+				{
+					jmath::vec3 cubePoints[8];
+
+					cubePoints[0] = GetCubeVertex(x + 0, y + 0, z + 0);
+					cubePoints[1] = GetCubeVertex(x + 0, y + 0, z + 1);
+					cubePoints[2] = GetCubeVertex(x + 0, y + 1, z + 0);
+					cubePoints[3] = GetCubeVertex(x + 0, y + 1, z + 1);
+					cubePoints[4] = GetCubeVertex(x + 1, y + 0, z + 0);
+					cubePoints[5] = GetCubeVertex(x + 1, y + 0, z + 1);
+					cubePoints[6] = GetCubeVertex(x + 1, y + 1, z + 0);
+					cubePoints[7] = GetCubeVertex(x + 1, y + 1, z + 1);
+
+					ClusterBounds& cube = bounds[y + x * NUM_CLUSTERS_Y + z * NUM_CLUSTERS_Y * NUM_CLUSTERS_X];
+					cube.min = cubePoints[0];
+					cube.max = cubePoints[0];
+
+					for (int i = 1; i < 8; i++)
+					{
+						cube.min = jmath::min(cubePoints[i], cube.min);
+						cube.max = jmath::max(cubePoints[i], cube.max);
+					}
+				}
+			}
+		}
+	}
+
+	void AssignLightsToClusters(const ClusterBounds* bounds, const ClusterLight* lights, uint32_t lightsCount, uint32_t* clusterLightIndices)
+	{
+		for (uint32_t clusterIndex = 0; clusterIndex < ClustersCount; clusterIndex++)
+		{
+			const ClusterBounds& cube = bounds[clusterIndex];
+			uint32_t* clusterLights = clusterLightIndices + clusterIndex * LIGHTS_PER_CLUSTER;
+
+			uint32_t currentLight = 0;
+			for (uint32_t i = 0; i < lightsCount; i++)
+			{
+				if (SphereCubeIntersection(cube.min, cube.max, lights[i].viewPosition, lights[i].radius))
+				{
+					ASSERT(currentLight < LIGHTS_PER_CLUSTER);
+					clusterLights[currentLight] = lights[i].index;
+					currentLight++;
+				}
+			}
+
+			for (uint32_t i = currentLight; i < LIGHTS_PER_CLUSTER; i++)
+			{
+				clusterLights[i] = NoClusterLight;
+			}
+		}
+	}
+}
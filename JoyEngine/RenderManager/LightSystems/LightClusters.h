@@ -0,0 +1,34 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <cstdint>
+
+#include "CommonEngineStructs.h"
+
+namespace JoyEngine
+{
+	// Cpu part of light clusterization, it doesn't touch gpu resources so the benchmarks run it on its own.
+	// Clusters are indexed as y + x * NUM_CLUSTERS_Y + z * NUM_CLUSTERS_Y * NUM_CLUSTERS_X, the same way deferred_shading.hlsl finds them
+	inline constexpr uint32_t ClustersCount = NUM_CLUSTERS_X * NUM_CLUSTERS_Y * NUM_CLUSTERS_Z;
+	inline constexpr uint32_t NoClusterLight = UINT32_MAX;
+
+	struct ClusterBounds
+	{
+		jmath::vec3 min; // view space
+		jmath::vec3 max;
+	};
+
+	struct ClusterLight
+	{
+		jmath::vec3 viewPosition;
+		float radius;
+		uint32_t index; // in light data
+	};
+
+	// Z slices grow exponentially from near to far plane
+	void GetClusterBounds(float cameraNear, float cameraFar, float cameraAspect, float cameraFovRadians, ClusterBounds* bounds);
+
+	// Writes LIGHTS_PER_CLUSTER indices of lights intersecting every cluster, the unused ones are NoClusterLight
+	void AssignLightsToClusters(const ClusterBounds* bounds, const ClusterLight* lights, uint32_t lightsCount, uint32_t* clusterLightIndices);
+}
+#endif // LIGHT_CLUSTERS_H
@@ -0,0 +1,132 @@
+#include "NullRenderer.h"
+
+#include "imgui.h"
+
+#include "Common/Time.h"
+#include "Components/Camera.h"
+#include "Components/MeshRenderer.h"
+#include "DescriptorManager/DescriptorManager.h"
+#include "EngineDataProvider/EngineDataProvider.h"
+#include "GraphicsManager/GraphicsManager.h"
+#include "ResourceManager/Mesh.h"
+#include "ResourceManager/SharedMaterial.h"
+#include "SceneManager/GameObject.h"
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+#include "Utils/TimeCounter.h"
+
+namespace JoyEngine
+{
+	NullRenderer::NullRenderer() : IRenderer(nullptr)
+	{
+	}
+
+	void NullRenderer::Init(Skybox* skybox)
+	{
+		TIME_PERF("NullRenderer init")
+
+		m_lightSystem = std::make_unique<ClusteredLightSystem>(FRAME_COUNT);
+
+		// Components still draw their GUI, frames are built without platform and renderer backends and never rendered
+		ImGuiIO& io = ImGui::GetIO();
+		io.DisplaySize = {GetWidth_f(), GetHeight_f()};
+		io.Fonts->Build();
+	}
+
+	void NullRenderer::Start() const
+	{
+	}
+
+	void NullRenderer::Stop()
+	{
+		if (m_stats.framesCount > 0)
+		{
+			Logger::LogFormat("Null renderer: %u frames, %.1f draws and %.1f triangles per frame\n",
+			                  m_stats.framesCount,
+			                  static_cast<double>(m_totalDrawsCount) / m_stats.framesCount,
+			                  static_cast<double>(m_totalTrianglesCount) / m_stats.framesCount);
+		}
+	}
+
+	void NullRenderer::RegisterSharedMaterial(SharedMaterial* sm)
+	{
+		m_sharedMaterials.insert(sm);
+	}
+
+	void NullRenderer::UnregisterSharedMaterial(SharedMaterial* sm)
+	{
+		if (!m_sharedMaterials.contains(sm))
+		{
+			ASSERT(false);
+		}
+		m_sharedMaterials.erase(sm);
+	}
+
+	void NullRenderer::RegisterCamera(Camera* camera)
+	{
+		m_currentCamera = camera;
+		m_lightSystem->SetCamera(m_currentCamera);
+	}
+
+	void NullRenderer::UnregisterCamera(Camera* camera)
+	{
+		ASSERT(m_currentCamera == camera);
+		m_currentCamera = nullptr;
+	}
+
+	void NullRenderer::PreUpdate()
+	{
+		ImGui::GetIO().DeltaTime = Time::GetDeltaTime() > 0 ? Time::GetDeltaTime() : 1.0f / 60.0f;
+		ImGui::NewFrame();
+	}
+
+	void NullRenderer::Update()
+	{
+		// There is no swapchain to wait for, frames in flight just go round
+		m_currentFrameIndex = (m_currentFrameIndex + 1) % FRAME_COUNT;
+		// Nothing is submitted, so the releases of previous frames can go
+		GraphicsManager::Get()->GetReleaseQueue().BeginFrame(m_stats.framesCount + 1, m_stats.framesCount);
+		DescriptorManager::Get()->BeginFrame(m_stats.framesCount + 1, m_stats.framesCount);
+
+		if (m_currentCamera != nullptr)
+		{
+			const jmath::mat4x4 mainCameraViewMatrix = m_currentCamera->GetViewMatrix();
+			const jmath::mat4x4 mainCameraProjMatrix = m_currentCamera->GetProjMatrix();
+
+			const DynamicCpuBuffer<EngineData>* engineDataBuffer = EngineDataProvider::Get()->GetEngineDataBuffer();
+
+			const auto data = static_cast<EngineData*>(engineDataBuffer->GetPtr(m_currentFrameIndex));
+			data->cameraWorldPos = m_currentCamera->GetGameObject().GetTransform().GetPosition();
+			data->time = Time::GetTime();
+			data->cameraInvProj = jmath::inverse(mainCameraProjMatrix);
+			data->cameraInvView = jmath::inverse(mainCameraViewMatrix);
+			data->cameraNear = m_currentCamera->GetNear();
+			data->cameraFar = m_currentCamera->GetFar();
+			data->cameraFovRadians = m_currentCamera->GetFovRadians();
+			data->screenWidth = m_width;
+			data->screenHeight = m_height;
+			data->cameraAspect = GetAspect();
+
+			PROFILE_ZONE("Light clusterization")
+			m_lightSystem->Update(m_currentFrameIndex);
+		}
+
+		m_stats.framesCount++;
+		m_stats.sharedMaterialsCount = static_cast<uint32_t>(m_sharedMaterials.size());
+		m_stats.drawsCount = 0;
+		m_stats.trianglesCount = 0;
+		for (const auto& sm : m_sharedMaterials)
+		{
+			for (const auto& mr : sm->GetMeshRenderers())
+			{
+				if (!mr->IsReady()) continue;
+				m_stats.drawsCount++;
+				m_stats.trianglesCount += mr->GetMesh()->GetIndexCount() / 3;
+			}
+		}
+		m_totalDrawsCount += m_stats.drawsCount;
+		m_totalTrianglesCount += m_stats.trianglesCount;
+
+		ImGui::EndFrame();
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef NULL_RENDERER_H
+#define NULL_RENDERER_H
+
+#include <memory>
+#include <set>
+
+#include "RenderManager/IRenderer.h"
+#include "RenderManager/LightSystems/ClusteredLightSystem.h"
+
+namespace JoyEngine
+{
+	class Camera;
+	class SharedMaterial;
+
+	struct NullRendererStats
+	{
+		uint32_t framesCount = 0;
+		uint32_t sharedMaterialsCount = 0; // in the last frame
+		uint32_t drawsCount = 0;
+		uint64_t trianglesCount = 0;
+	};
+
+	// Renderer without device, swapchain and draws for running the scene on machines without a display or GPU.
+	// Resources are stubbed out below GraphicsManager, CPU visible buffers are kept in system memory.
+	// It keeps the cpu side of a frame: engine data, light clusterization and walking shared materials for draw statistics
+	class NullRenderer final : public IRenderer
+	{
+	public:
+		NullRenderer();
+
+		~NullRenderer() override = default;
+
+		void Init(Skybox* skybox) override;
+
+		void Start() const override;
+
+		void Stop() override;
+
+		void PreUpdate() override;
+
+		void Update() override;
+
+		void RegisterSharedMaterial(SharedMaterial*) override;
+
+		void UnregisterSharedMaterial(SharedMaterial*) override;
+
+		void RegisterCamera(Camera* camera) override;
+
+		void UnregisterCamera(Camera* camera) override;
+
+		[[nodiscard]] float GetAspect() const noexcept override { return GetWidth_f() / GetHeight_f(); }
+
+		[[nodiscard]] float GetWidth_f() const noexcept override { return static_cast<float>(m_width); }
+		[[nodiscard]] float GetHeight_f() const noexcept override { return static_cast<float>(m_height); }
+
+		[[nodiscard]] uint32_t GetWidth() const noexcept override { return m_width; }
+		[[nodiscard]] uint32_t GetHeight() const noexcept override { return m_height; }
+
+		[[nodiscard]] const uint32_t GetFrameCount() const noexcept override { return FRAME_COUNT; }
+		[[nodiscard]] const uint32_t GetCurrentFrameIndex() const noexcept override { return m_currentFrameIndex; }
+
+		[[nodiscard]] ILightSystem& GetLightSystem() const noexcept override { return *m_lightSystem; }
+
+		[[nodiscard]] const NullRendererStats& GetStats() const noexcept { return m_stats; }
+
+	private:
+		static constexpr uint32_t FRAME_COUNT = 3;
+
+		std::unique_ptr<ClusteredLightSystem> m_lightSystem;
+		std::set<SharedMaterial*> m_sharedMaterials;
+
+		Camera* m_currentCamera = nullptr;
+		uint32_t m_currentFrameIndex = 0;
+
+		const uint32_t m_width = 1280;
+		const uint32_t m_height = 720;
+
+		NullRendererStats m_stats;
+		uint64_t m_totalDrawsCount = 0;
+		uint64_t m_totalTrianglesCount = 0;
+	};
+}
+
+#endif // NULL_RENDERER_H
@@ -14,6 +14,13 @@ namespace JoyEngine
 		virtual ~AbstractRaytracedDDGIController() = default;
 
 		virtual void UploadSceneData() = 0;
+		// Refits acceleration structure to moved dynamic objects, called every frame
+		virtual void UpdateSceneData() = 0;
+		// Records copies of the data UpdateSceneData changed on the frame command list, before any pass reads it
+		virtual void RecordSceneDataUpload(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex) = 0;
+		// Refit quality went too low, structure has to be rebuilt while gpu is idle
+		[[nodiscard]] virtual bool IsSceneRebuildRequired() const noexcept = 0;
+		virtual void RebuildSceneData() = 0;
 		virtual void ProcessRaytracing(ID3D12GraphicsCommandList4* commandList, uint32_t frameIndex) const = 0;
 		virtual void DebugDrawRaytracedImage(ID3D12GraphicsCommandList* commandList) const = 0;
 		virtual void GenerateProbeIrradiance(ID3D12GraphicsCommandList4* commandList, uint32_t frameIndex) const = 0;
@@ -3,6 +3,7 @@
 
 #include "MemoryManager/MemoryManager.h"
 #include "ResourceManager/Buffers/UAVGpuBuffer.h"
+#include "ResourceManager/Buffers/UploadRingBuffer.h"
 
 namespace JoyEngine
 {
@@ -42,6 +43,28 @@ namespace JoyEngine
 				m_gpuBuffer.get(), 0);
 		}
 
+		void UploadCpuData(uint32_t firstElement, uint32_t elementsCount) const
+		{
+			MemoryManager::Get()->LoadDataToBuffer(
+				m_dataArray + firstElement,
+				elementsCount * sizeof(T),
+				m_gpuBuffer.get(), firstElement * sizeof(T));
+		}
+
+		// Copy is recorded on the frame command list instead of waiting for the queue
+		[[nodiscard]] bool UploadCpuData(
+			UploadRingBuffer& uploadRing,
+			ID3D12GraphicsCommandList* commandList,
+			uint32_t firstElement,
+			uint32_t elementsCount) const
+		{
+			return uploadRing.Upload(
+				commandList,
+				m_dataArray + firstElement,
+				elementsCount * sizeof(T),
+				m_gpuBuffer.get(), firstElement * sizeof(T));
+		}
+
 		void ReadbackGpuData() const
 		{
 			MemoryManager::Get()->ReadbackDataFromBuffer(
@@ -24,7 +24,7 @@ namespace JoyEngine
 		m_raytracedTextureWidth(width),
 		m_raytracedTextureHeight(height)
 #else
-		m_raytracedTextureWidth(g_raytracedProbesData.gridX * g_raytracedProbesData.gridY * g_raytracedProbesData.gridZ),
+		m_raytracedTextureWidth(ProbeCascades::GetProbesCount(g_raytracedProbesData)),
 		m_raytracedTextureHeight(DDGI_RAYS_COUNT)
 #endif
 	{
@@ -40,7 +40,7 @@ namespace JoyEngine
 
 			m_probeIrradianceTexture = std::make_unique<UAVTexture>(
 				g_raytracedProbesData.gridX * g_raytracedProbesData.gridY * (DDGI_PROBE_DATA_RESOLUTION + 2),
-				g_raytracedProbesData.gridZ * (DDGI_PROBE_DATA_RESOLUTION + 2),
+				g_raytracedProbesData.gridZ * DDGI_CASCADES_COUNT * (DDGI_PROBE_DATA_RESOLUTION + 2),
 				DXGI_FORMAT_R11G11B10_FLOAT,
 				D3D12_RESOURCE_STATE_GENERIC_READ,
 				D3D12_HEAP_TYPE_DEFAULT
@@ -48,7 +48,7 @@ namespace JoyEngine
 
 			m_probeDepthTexture = std::make_unique<UAVTexture>(
 				g_raytracedProbesData.gridX * g_raytracedProbesData.gridY * (DDGI_PROBE_DATA_RESOLUTION + 2),
-				g_raytracedProbesData.gridZ * (DDGI_PROBE_DATA_RESOLUTION + 2),
+				g_raytracedProbesData.gridZ * DDGI_CASCADES_COUNT * (DDGI_PROBE_DATA_RESOLUTION + 2),
 				DXGI_FORMAT_R16G16_FLOAT,
 				D3D12_RESOURCE_STATE_GENERIC_READ,
 				D3D12_HEAP_TYPE_DEFAULT
@@ -210,6 +210,11 @@ namespace JoyEngine
 
 #if defined(HW_CAMERA_TRACE)
 		GraphicsUtils::AttachView(commandList, m_raytracingPipeline.get(), "g_engineData", EngineDataProvider::Get()->GetEngineDataView(frameIndex));
+		const uint32_t dispatchWidth = m_raytracedTextureWidth;
+#else
+		GraphicsUtils::AttachView(commandList, m_raytracingPipeline.get(), "scheduledProbes", m_dataContainer.GetScheduledProbesView(frameIndex));
+		GraphicsUtils::AttachView(commandList, m_raytracingPipeline.get(), "probeRelocationData", m_dataContainer.GetProbeRelocationView(frameIndex));
+		const uint32_t dispatchWidth = m_dataContainer.GetScheduledProbesCount();
 #endif
 
 
@@ -229,7 +234,7 @@ namespace JoyEngine
 				.StrideInBytes = m_raytracingPipeline->GetShaderTableByType(ShaderTableHitGroup)->GetSize()
 			},
 			.CallableShaderTable = {},
-			.Width = m_raytracedTextureWidth,
+			.Width = dispatchWidth,
 			.Height = m_raytracedTextureHeight,
 			.Depth = 1
 		};
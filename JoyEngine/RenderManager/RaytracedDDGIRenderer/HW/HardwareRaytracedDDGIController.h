@@ -23,6 +23,11 @@ namespace JoyEngine
 			uint32_t height
 		);
 		void UploadSceneData() override;
+		// Acceleration structure is built for static objects only
+		void UpdateSceneData() override {}
+		void RecordSceneDataUpload(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex) override {}
+		[[nodiscard]] bool IsSceneRebuildRequired() const noexcept override { return false; }
+		void RebuildSceneData() override {}
 		void ProcessRaytracing(ID3D12GraphicsCommandList4* commandList, uint32_t frameIndex) const override;
 		void DebugDrawRaytracedImage(ID3D12GraphicsCommandList* commandList) const override;
 		void GenerateProbeIrradiance(ID3D12GraphicsCommandList4* commandList, uint32_t frameIndex) const override;
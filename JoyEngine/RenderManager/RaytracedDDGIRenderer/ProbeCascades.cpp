@@ -0,0 +1,342 @@
+#include "ProbeCascades.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		uint32_t GetGridSize(const RaytracedProbesData& data, uint32_t axis)
+		{
+			return axis == 0 ? data.gridX : axis == 1 ? data.gridY : data.gridZ;
+		}
+
+		float GetAxis(const jmath::vec3& v, uint32_t axis)
+		{
+			return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+		}
+
+		int32_t GetScroll(const ProbeCascadeData& cascade, uint32_t axis)
+		{
+			return axis == 0 ? cascade.gridScroll.x : axis == 1 ? cascade.gridScroll.y : cascade.gridScroll.z;
+		}
+
+		// World cell of grid coordinate 0, gridMin is always a whole number of cells
+		int32_t GetOriginCell(const ProbeCascadeData& cascade, uint32_t axis)
+		{
+			return static_cast<int32_t>(std::lround(GetAxis(cascade.gridMin, axis) / cascade.cellSize));
+		}
+
+		// Origin which puts position into the middle cell of the cascade
+		int32_t GetTargetOriginCell(const RaytracedProbesData& data, uint32_t cascade, const jmath::vec3& position, uint32_t axis)
+		{
+			return static_cast<int32_t>(std::floor(GetAxis(position, axis) / data.cascades[cascade].cellSize)) -
+				static_cast<int32_t>(GetGridSize(data, axis) / 2);
+		}
+
+		void SetOriginCell(ProbeCascadeData& cascade, const std::array<int32_t, 3>& origin)
+		{
+			cascade.gridMin = jmath::vec3(
+				static_cast<float>(origin[0]) * cascade.cellSize,
+				static_cast<float>(origin[1]) * cascade.cellSize,
+				static_cast<float>(origin[2]) * cascade.cellSize);
+		}
+	}
+
+	void ProbeCascades::Init(RaytracedProbesData& data, const float* cellSizes, const jmath::vec3& position)
+	{
+		for (uint32_t cascade = 0; cascade < DDGI_CASCADES_COUNT; cascade++)
+		{
+			data.cascades[cascade].cellSize = cellSizes[cascade];
+			data.cascades[cascade].gridScroll = {0, 0, 0};
+			SetOriginCell(data.cascades[cascade], {
+				              GetTargetOriginCell(data, cascade, position, 0),
+				              GetTargetOriginCell(data, cascade, position, 1),
+				              GetTargetOriginCell(data, cascade, position, 2)
+			              });
+		}
+	}
+
+	void ProbeCascades::Follow(RaytracedProbesData& data, const jmath::vec3& position, std::vector<uint32_t>& enteredProbes)
+	{
+		enteredProbes.clear();
+		for (uint32_t cascade = 0; cascade < DDGI_CASCADES_COUNT; cascade++)
+		{
+			int32_t d[3];
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				d[axis] = GetTargetOriginCell(data, cascade, position, axis) - GetOriginCell(data.cascades[cascade], axis);
+			}
+
+			if (d[0] != 0 || d[1] != 0 || d[2] != 0)
+			{
+				Scroll(data, cascade, d[0], d[1], d[2], enteredProbes);
+			}
+		}
+	}
+
+	void ProbeCascades::Scroll(RaytracedProbesData& data, uint32_t cascade, int32_t dx, int32_t dy, int32_t dz, std::vector<uint32_t>& enteredProbes)
+	{
+		ProbeCascadeData& cascadeData = data.cascades[cascade];
+		const int32_t d[3] = {dx, dy, dz};
+
+		std::array<int32_t, 3> origin;
+		int32_t scroll[3];
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			const int32_t size = static_cast<int32_t>(GetGridSize(data, axis));
+			origin[axis] = GetOriginCell(cascadeData, axis) + d[axis];
+			scroll[axis] = ((GetScroll(cascadeData, axis) + d[axis]) % size + size) % size;
+		}
+		SetOriginCell(cascadeData, origin);
+		cascadeData.gridScroll = {scroll[0], scroll[1], scroll[2]};
+
+		// Cells past the old far side along the move are new, the rest of the volume keeps its probes
+		for (uint32_t x = 0; x < data.gridX; x++)
+		{
+			for (uint32_t y = 0; y < data.gridY; y++)
+			{
+				for (uint32_t z = 0; z < data.gridZ; z++)
+				{
+					const uint32_t g[3] = {x, y, z};
+					bool isEntered = false;
+					for (uint32_t axis = 0; axis < 3; axis++)
+					{
+						const int32_t size = static_cast<int32_t>(GetGridSize(data, axis));
+						const int32_t coordinate = static_cast<int32_t>(g[axis]);
+						isEntered |= d[axis] > 0 && coordinate >= size - d[axis];
+						isEntered |= d[axis] < 0 && coordinate < -d[axis];
+					}
+
+					if (isEntered)
+					{
+						enteredProbes.push_back(GetProbeIndex(data, cascade, x, y, z));
+					}
+				}
+			}
+		}
+	}
+
+	uint32_t ProbeCascades::GetProbeIndex(const RaytracedProbesData& data, uint32_t cascade, uint32_t gridX, uint32_t gridY, uint32_t gridZ)
+	{
+		const ProbeCascadeData& cascadeData = data.cascades[cascade];
+		const uint32_t storageX = (gridX + cascadeData.gridScroll.x) % data.gridX;
+		const uint32_t storageY = (gridY + cascadeData.gridScroll.y) % data.gridY;
+		const uint32_t storageZ = (gridZ + cascadeData.gridScroll.z) % data.gridZ;
+
+		return cascade * GetProbesPerCascade(data) + storageX * data.gridY * data.gridZ + storageY * data.gridZ + storageZ;
+	}
+
+	void ProbeCascades::GetGridCoordinate(const RaytracedProbesData& data, uint32_t probe, uint32_t& gridX, uint32_t& gridY, uint32_t& gridZ)
+	{
+		const ProbeCascadeData& cascadeData = data.cascades[GetCascade(data, probe)];
+		const uint32_t storage = probe % GetProbesPerCascade(data);
+		const uint32_t storageX = storage / (data.gridY * data.gridZ);
+		const uint32_t storageY = (storage / data.gridZ) % data.gridY;
+		const uint32_t storageZ = storage % data.gridZ;
+
+		gridX = (storageX + data.gridX - cascadeData.gridScroll.x) % data.gridX;
+		gridY = (storageY + data.gridY - cascadeData.gridScroll.y) % data.gridY;
+		gridZ = (storageZ + data.gridZ - cascadeData.gridScroll.z) % data.gridZ;
+	}
+
+	jmath::vec3 ProbeCascades::GetProbePosition(const RaytracedProbesData& data, uint32_t probe)
+	{
+		const ProbeCascadeData& cascadeData = data.cascades[GetCascade(data, probe)];
+		uint32_t x, y, z;
+		GetGridCoordinate(data, probe, x, y, z);
+
+		return jmath::vec3(
+			cascadeData.gridMin.x + static_cast<float>(x) * cascadeData.cellSize,
+			cascadeData.gridMin.y + static_cast<float>(y) * cascadeData.cellSize,
+			cascadeData.gridMin.z + static_cast<float>(z) * cascadeData.cellSize);
+	}
+
+	uint32_t ProbeCascades::FindCascade(const RaytracedProbesData& data, const jmath::vec3& position)
+	{
+		for (uint32_t cascade = 0; cascade < DDGI_CASCADES_COUNT; cascade++)
+		{
+			const ProbeCascadeData& cascadeData = data.cascades[cascade];
+
+			bool isInside = true;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				const float local = (GetAxis(position, axis) - GetAxis(cascadeData.gridMin, axis)) / cascadeData.cellSize;
+				isInside &= local >= 0 && local <= static_cast<float>(GetGridSize(data, axis) - 1);
+			}
+
+			if (isInside) return cascade;
+		}
+		return DDGI_CASCADES_COUNT;
+	}
+
+	bool ProbeCascades::IsProbeCovered(const RaytracedProbesData& data, uint32_t probe)
+	{
+		const uint32_t cascade = GetCascade(data, probe);
+		const jmath::vec3 position = GetProbePosition(data, probe);
+		const float radius = data.cascades[cascade].cellSize;
+
+		for (uint32_t finer = 0; finer < cascade; finer++)
+		{
+			const ProbeCascadeData& finerData = data.cascades[finer];
+
+			// The outer cell of the finer cascade is blended with the next cascade in shading
+			bool isCovered = true;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				const float min = GetAxis(finerData.gridMin, axis) + finerData.cellSize;
+				const float max = GetAxis(finerData.gridMin, axis) + static_cast<float>(GetGridSize(data, axis) - 2) * finerData.cellSize;
+				isCovered &= GetAxis(position, axis) - radius >= min && GetAxis(position, axis) + radius <= max;
+			}
+
+			if (isCovered) return true;
+		}
+		return false;
+	}
+
+	bool ProbeCascades::Test()
+	{
+		bool isSuccess = true;
+
+		// Cascades are nested while every axis has at least 6 probes with cell size doubling,
+		// coarse probes can be covered by a finer cascade from 7 probes
+		RaytracedProbesData data = {
+			.cascades = {},
+			.gridX = 8,
+			.gridY = 7,
+			.gridZ = 10,
+			.useDDGI = 0,
+			.skyboxTextureIndex = 0,
+			.dummy_0 = 0,
+			.dummy_1 = 0,
+			.dummy_2 = 0,
+		};
+		float cellSizes[DDGI_CASCADES_COUNT];
+		for (uint32_t cascade = 0; cascade < DDGI_CASCADES_COUNT; cascade++)
+		{
+			cellSizes[cascade] = 1.5f * static_cast<float>(1 << cascade);
+		}
+		const uint32_t probesCount = GetProbesCount(data);
+
+		const auto getWorldCells = [&data, probesCount]()
+		{
+			std::vector<std::array<int32_t, 3>> cells(probesCount);
+			for (uint32_t probe = 0; probe < probesCount; probe++)
+			{
+				const jmath::vec3 position = GetProbePosition(data, probe);
+				const float cellSize = GetCellSize(data, probe);
+				cells[probe] = {
+					static_cast<int32_t>(std::lround(position.x / cellSize)),
+					static_cast<int32_t>(std::lround(position.y / cellSize)),
+					static_cast<int32_t>(std::lround(position.z / cellSize))
+				};
+			}
+			return cells;
+		};
+
+		std::mt19937 generator(7);
+		std::uniform_real_distribution<float> step(-0.7f, 0.7f);
+		jmath::vec3 position(0.3f, 1.7f, -2.2f);
+		Init(data, cellSizes, position);
+
+		constexpr uint32_t stepsCount = 2000;
+		uint32_t scrollsCount = 0;
+		uint32_t enteredCount = 0;
+		std::vector<uint32_t> enteredProbes;
+		for (uint32_t i = 0; i < stepsCount && isSuccess; i++)
+		{
+			const bool isTeleport = i % 500 == 499;
+			position = isTeleport
+				           ? jmath::vec3(position.x + 100.0f, position.y - 40.0f, position.z + 7.0f)
+				           : jmath::vec3(position.x + step(generator), position.y + step(generator) * 0.5f, position.z + step(generator));
+
+			const std::vector<std::array<int32_t, 3>> cellsBefore = getWorldCells();
+			Follow(data, position, enteredProbes);
+			const std::vector<std::array<int32_t, 3>> cellsAfter = getWorldCells();
+
+			std::vector<uint32_t> expectedProbes;
+			for (uint32_t probe = 0; probe < probesCount; probe++)
+			{
+				if (cellsBefore[probe] != cellsAfter[probe])
+				{
+					expectedProbes.push_back(probe);
+				}
+			}
+			std::ranges::sort(enteredProbes);
+			if (enteredProbes != expectedProbes)
+			{
+				Logger::LogFormat("Probe cascades: step %u reports %u entered probes, %u changed their cell\n",
+				                  i, static_cast<uint32_t>(enteredProbes.size()), static_cast<uint32_t>(expectedProbes.size()));
+				isSuccess = false;
+			}
+			if (!isTeleport && !enteredProbes.empty())
+			{
+				scrollsCount++;
+				enteredCount += static_cast<uint32_t>(enteredProbes.size());
+			}
+
+			for (uint32_t cascade = 0; cascade < DDGI_CASCADES_COUNT; cascade++)
+			{
+				const ProbeCascadeData& cascadeData = data.cascades[cascade];
+				const float localX = (position.x - cascadeData.gridMin.x) / cascadeData.cellSize;
+				const float localY = (position.y - cascadeData.gridMin.y) / cascadeData.cellSize;
+				const float localZ = (position.z - cascadeData.gridMin.z) / cascadeData.cellSize;
+				const auto isMiddle = [](float local, uint32_t size)
+				{
+					return local >= static_cast<float>(size / 2) - 0.001f && local <= static_cast<float>(size / 2 + 1) + 0.001f;
+				};
+				if (!isMiddle(localX, data.gridX) || !isMiddle(localY, data.gridY) || !isMiddle(localZ, data.gridZ))
+				{
+					Logger::LogFormat("Probe cascades: camera is not in the middle of cascade %u on step %u\n", cascade, i);
+					isSuccess = false;
+				}
+			}
+
+			if (FindCascade(data, position) != 0)
+			{
+				Logger::LogFormat("Probe cascades: camera is not in the finest cascade on step %u\n", i);
+				isSuccess = false;
+			}
+
+			for (uint32_t probe = 0; probe < probesCount; probe++)
+			{
+				uint32_t x, y, z;
+				GetGridCoordinate(data, probe, x, y, z);
+				const uint32_t cascade = GetCascade(data, probe);
+				if (GetProbeIndex(data, cascade, x, y, z) != probe ||
+					(cascade + 1 < DDGI_CASCADES_COUNT && FindCascade(data, GetProbePosition(data, probe)) > cascade + 1))
+				{
+					Logger::LogFormat("Probe cascades: probe %u has wrong address or is outside the next cascade on step %u\n", probe, i);
+					isSuccess = false;
+					break;
+				}
+			}
+		}
+
+		uint32_t coveredCount[DDGI_CASCADES_COUNT] = {};
+		for (uint32_t probe = 0; probe < probesCount; probe++)
+		{
+			coveredCount[GetCascade(data, probe)] += IsProbeCovered(data, probe);
+		}
+		if (coveredCount[0] != 0 || coveredCount[DDGI_CASCADES_COUNT - 1] == 0)
+		{
+			Logger::Log("Probe cascades: wrong covered probes\n");
+			isSuccess = false;
+		}
+
+		Logger::LogFormat("Probe cascades: %u steps, %u scrolls, %.1f of %u probes entered per scroll, %u of %u probes of the last cascade covered\n",
+		                  stepsCount,
+		                  scrollsCount,
+		                  static_cast<float>(enteredCount) / static_cast<float>(std::max(scrollsCount, 1u)),
+		                  probesCount,
+		                  coveredCount[DDGI_CASCADES_COUNT - 1],
+		                  GetProbesPerCascade(data));
+
+		return isSuccess;
+	}
+}
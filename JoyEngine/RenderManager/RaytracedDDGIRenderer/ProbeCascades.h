@@ -0,0 +1,53 @@
+#ifndef PROBE_CASCADES_H
+#define PROBE_CASCADES_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace JoyEngine
+{
+	// Addressing and scrolling of camera centered probe cascades, the same math as ProbeGridInclude.hlsl.
+	// Probe index = cascade * probes per cascade + storage x * gridY * gridZ + storage y * gridZ + storage z,
+	// where storage coordinate = (grid coordinate + gridScroll) % grid size.
+	// When a cascade scrolls by d cells, gridMin moves by d cells and gridScroll by d, so probes which stay
+	// inside the volume keep their storage and only probes of the entered cells need a full update.
+	// Has no gpu dependencies and can be checked anywhere
+	class ProbeCascades
+	{
+	public:
+		// Places cascade c with cell size cellSizes[c] so position is in its middle cell, storage order is reset
+		static void Init(RaytracedProbesData& data, const float* cellSizes, const jmath::vec3& position);
+
+		// Scrolls every cascade by whole cells so position stays in its middle cell.
+		// enteredProbes receives probes whose world cell changed, every probe of a cascade moved farther than its size
+		static void Follow(RaytracedProbesData& data, const jmath::vec3& position, std::vector<uint32_t>& enteredProbes);
+
+		// Moves the cascade by whole cells and appends probes of the entered cells to enteredProbes
+		static void Scroll(RaytracedProbesData& data, uint32_t cascade, int32_t dx, int32_t dy, int32_t dz, std::vector<uint32_t>& enteredProbes);
+
+		[[nodiscard]] static uint32_t GetProbesPerCascade(const RaytracedProbesData& data) { return data.gridX * data.gridY * data.gridZ; }
+		[[nodiscard]] static uint32_t GetProbesCount(const RaytracedProbesData& data) { return GetProbesPerCascade(data) * DDGI_CASCADES_COUNT; }
+		[[nodiscard]] static uint32_t GetCascade(const RaytracedProbesData& data, uint32_t probe) { return probe / GetProbesPerCascade(data); }
+		[[nodiscard]] static float GetCellSize(const RaytracedProbesData& data, uint32_t probe) { return data.cascades[GetCascade(data, probe)].cellSize; }
+
+		[[nodiscard]] static uint32_t GetProbeIndex(const RaytracedProbesData& data, uint32_t cascade, uint32_t gridX, uint32_t gridY, uint32_t gridZ);
+		static void GetGridCoordinate(const RaytracedProbesData& data, uint32_t probe, uint32_t& gridX, uint32_t& gridY, uint32_t& gridZ);
+
+		// Position on the regular grid, relocation offsets are not applied
+		[[nodiscard]] static jmath::vec3 GetProbePosition(const RaytracedProbesData& data, uint32_t probe);
+
+		// Finest cascade which has position between its probes, as deferred shading picks it. DDGI_CASCADES_COUNT if none
+		[[nodiscard]] static uint32_t FindCascade(const RaytracedProbesData& data, const jmath::vec3& position);
+
+		// Every point the probe lights is shaded by a finer cascade, the probe is needed only for rays which leave it
+		[[nodiscard]] static bool IsProbeCovered(const RaytracedProbesData& data, uint32_t probe);
+
+		// Walks the camera through the scene with small steps and teleports, checks entered probes against
+		// world cells of every storage place before and after the move, that cascades are nested and centered
+		// and that probes keep their storage. Logs failures and the share of probes updated because of scrolling
+		static bool Test();
+	};
+}
+#endif // PROBE_CASCADES_H
@@ -0,0 +1,527 @@
+#include "ProbeClassifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+#include <numeric>
+
+#include "Common/HashDefs.h"
+#include "ProbeCascades.h"
+#include "SW/BVHUtils.h"
+#include "SW/CpuSAHBVHBuilder.h"
+#include "ThreadManager/ParallelFor.h"
+#include "Utils/FileUtils.h"
+#include "Utils/Log.h"
+
+#define PROBE_CLASSIFIER_MAGIC 0x4250594A // 'JYPB'
+#define PROBE_CLASSIFIER_FORMAT_VERSION 2
+
+namespace JoyEngine
+{
+	namespace
+	{
+		float Dot(const jmath::vec3& a, const jmath::vec3& b)
+		{
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		jmath::vec3 Cross(const jmath::vec3& a, const jmath::vec3& b)
+		{
+			return jmath::vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+		}
+
+		jmath::vec3 Sub(const jmath::vec3& a, const jmath::vec3& b)
+		{
+			return jmath::vec3(a.x - b.x, a.y - b.y, a.z - b.z);
+		}
+
+		jmath::vec3 MulAdd(const jmath::vec3& a, const jmath::vec3& b, float t)
+		{
+			return jmath::vec3(a.x + b.x * t, a.y + b.y * t, a.z + b.z * t);
+		}
+
+		bool IsZero(const jmath::vec3& v)
+		{
+			return v.x == 0 && v.y == 0 && v.z == 0;
+		}
+
+		// Same direction set as sphericalFibonacci of RaytracingInclude.hlsl
+		jmath::vec3 SphericalFibonacci(uint32_t i, uint32_t n)
+		{
+			const float phiRatio = std::numbers::phi_v<float> - 1;
+			const float fi = static_cast<float>(i);
+			const float phi = 2.0f * std::numbers::pi_v<float> * (fi * phiRatio - std::floor(fi * phiRatio));
+			const float cosTheta = 1.0f - (2.0f * fi + 1.0f) / static_cast<float>(n);
+			const float sinTheta = std::sqrt(std::clamp(1.0f - cosTheta * cosTheta, 0.0f, 1.0f));
+			return jmath::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+		}
+
+		template <typename T>
+		uint64_t HashValue(const T& value, uint64_t hash)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			return MemHash64(&value, sizeof(T), hash);
+		}
+
+		template <typename T>
+		void WriteValue(std::vector<char>& data, const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			const char* ptr = reinterpret_cast<const char*>(&value);
+			data.insert(data.end(), ptr, ptr + sizeof(T));
+		}
+
+		// Room of thick walls for the test, 12 triangles per box with outward normals and counter clockwise winding
+		void AddBox(const jmath::vec3& min, const jmath::vec3& max, std::vector<jmath::vec3>& vertices, std::vector<jmath::vec3>& normals)
+		{
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				const uint32_t uAxis = (axis + 1) % 3;
+				const uint32_t vAxis = (axis + 2) % 3;
+
+				for (const float sign : {-1.0f, 1.0f})
+				{
+					jmath::vec3 p = min;
+					jmath::vec3 u(0, 0, 0);
+					jmath::vec3 v(0, 0, 0);
+					jmath::vec3 n(0, 0, 0);
+					(&p.x)[axis] = sign > 0 ? (&max.x)[axis] : (&min.x)[axis];
+					(&u.x)[uAxis] = (&max.x)[uAxis] - (&min.x)[uAxis];
+					(&v.x)[vAxis] = (&max.x)[vAxis] - (&min.x)[vAxis];
+					(&n.x)[axis] = sign;
+					if (sign < 0) std::swap(u, v);
+
+					const jmath::vec3 pu = MulAdd(p, u, 1);
+					const jmath::vec3 puv = MulAdd(pu, v, 1);
+					const jmath::vec3 pv = MulAdd(p, v, 1);
+					vertices.insert(vertices.end(), {p, pu, puv, p, puv, pv});
+					normals.insert(normals.end(), {n, n});
+				}
+			}
+		}
+
+		bool IsInsideBox(const jmath::vec3& p, const jmath::vec3& min, const jmath::vec3& max)
+		{
+			return p.x > min.x && p.y > min.y && p.z > min.z && p.x < max.x && p.y < max.y && p.z < max.z;
+		}
+	}
+
+	ProbeClassifier::ProbeClassifier(const jmath::vec3* triangleVertices, const jmath::vec3* triangleNormals, uint32_t trianglesCount, uint32_t threadsCount) :
+		m_triangleVertices(triangleVertices),
+		m_triangleNormals(triangleNormals),
+		m_trianglesCount(trianglesCount),
+		m_threadsCount(threadsCount),
+		m_triangleAABB(trianglesCount),
+		m_sortedTriangleIndices(trianglesCount),
+		m_internalNodes(std::max(trianglesCount, 2u) - 1),
+		m_leafNodes(std::max(trianglesCount, 1u)),
+		m_bvhData(std::max(trianglesCount, 2u) - 1)
+	{
+		for (uint32_t i = 0; i < trianglesCount; i++)
+		{
+			jmath::vec3 centroid;
+			GetCentroidAndAABB(triangleVertices[i * 3 + 0], triangleVertices[i * 3 + 1], triangleVertices[i * 3 + 2], &centroid, &m_triangleAABB[i]);
+		}
+
+		if (trianglesCount == 0) return;
+
+		CpuSAHBVHBuilder::Construct(
+			m_triangleAABB.data(),
+			trianglesCount,
+			m_sortedTriangleIndices.data(),
+			m_internalNodes.data(),
+			m_leafNodes.data(),
+			m_bvhData.data(),
+			threadsCount);
+	}
+
+	jmath::vec3 ProbeClassifier::GetTriangleNormal(uint32_t triangle) const
+	{
+		if (m_triangleNormals != nullptr)
+		{
+			return m_triangleNormals[triangle];
+		}
+
+		const jmath::vec3& v0 = m_triangleVertices[triangle * 3 + 0];
+		return Cross(Sub(m_triangleVertices[triangle * 3 + 1], v0), Sub(m_triangleVertices[triangle * 3 + 2], v0));
+	}
+
+	ProbeClassifier::RaysResult ProbeClassifier::CastRays(const jmath::vec3& position, const jmath::vec3& gridPosition, float cellSize, uint32_t raysCount) const
+	{
+		RaysResult result;
+
+		// Far enough to reach any corner of the 8 cells around the grid position from a relocated probe
+		const float maxDistance = 2.0f * std::sqrt(3.0f) * cellSize;
+
+		for (uint32_t i = 0; i < raysCount; i++)
+		{
+			const jmath::vec3 dir = SphericalFibonacci(i, raysCount);
+
+			float distance = maxDistance;
+			const uint32_t triangle = TraceClosestHit(
+				position,
+				dir,
+				m_triangleVertices,
+				m_sortedTriangleIndices.data(),
+				m_triangleAABB.data(),
+				m_trianglesCount,
+				m_internalNodes.data(),
+				m_leafNodes.data(),
+				m_bvhData.data(),
+				distance);
+
+			if (triangle == MAX_UINT) continue;
+
+			const jmath::vec3 hit = MulAdd(position, dir, distance);
+			result.hasNearGeometry |=
+				std::abs(hit.x - gridPosition.x) <= cellSize &&
+				std::abs(hit.y - gridPosition.y) <= cellSize &&
+				std::abs(hit.z - gridPosition.z) <= cellSize;
+
+			if (Dot(GetTriangleNormal(triangle), dir) > 0)
+			{
+				result.backfaceCount++;
+				if (distance < result.closestBackfaceDistance)
+				{
+					result.closestBackfaceDistance = distance;
+					result.closestBackfaceDir = dir;
+				}
+			}
+			else if (distance < result.closestFrontfaceDistance)
+			{
+				result.closestFrontfaceDistance = distance;
+				result.closestFrontfaceDir = dir;
+			}
+		}
+
+		return result;
+	}
+
+	void ProbeClassifier::ClassifyProbe(const RaytracedProbesData& grid, uint32_t probe, ProbeRelocationData* probes, const ProbeClassifierSettings& settings) const
+	{
+		// Without static geometry there is nothing to decide on, the grid works as before
+		if (m_trianglesCount == 0)
+		{
+			probes[probe] = {.offset = jmath::vec3(0, 0, 0), .isActive = 1};
+			return;
+		}
+
+		const jmath::vec3 gridPosition = ProbeCascades::GetProbePosition(grid, probe);
+		const float cellSize = ProbeCascades::GetCellSize(grid, probe);
+		const float maxOffset = settings.maxOffset * cellSize;
+		const float minFrontfaceDistance = settings.minFrontfaceDistance * cellSize;
+		const float backfaceLimit = settings.backfaceThreshold * static_cast<float>(settings.raysCount);
+
+		jmath::vec3 offset(0, 0, 0);
+		RaysResult rays;
+		for (uint32_t iteration = 0; iteration <= settings.iterationsCount; iteration++)
+		{
+			rays = CastRays(MulAdd(gridPosition, offset, 1), gridPosition, cellSize, settings.raysCount);
+			if (iteration == settings.iterationsCount) break;
+
+			if (static_cast<float>(rays.backfaceCount) > backfaceLimit)
+			{
+				// Inside geometry: the closest backface is the shortest way out
+				offset = MulAdd(offset, rays.closestBackfaceDir, rays.closestBackfaceDistance + minFrontfaceDistance);
+			}
+			else if (rays.closestFrontfaceDistance < minFrontfaceDistance)
+			{
+				offset = MulAdd(offset, rays.closestFrontfaceDir, rays.closestFrontfaceDistance - minFrontfaceDistance);
+			}
+			else
+			{
+				break;
+			}
+
+			offset.x = std::clamp(offset.x, -maxOffset, maxOffset);
+			offset.y = std::clamp(offset.y, -maxOffset, maxOffset);
+			offset.z = std::clamp(offset.z, -maxOffset, maxOffset);
+		}
+
+		const bool isInside = static_cast<float>(rays.backfaceCount) > backfaceLimit;
+		probes[probe] = {
+			.offset = offset,
+			.isActive = !isInside && rays.hasNearGeometry ? 1u : 0u
+		};
+	}
+
+	ProbeClassificationStats ProbeClassifier::Classify(const RaytracedProbesData& grid, ProbeRelocationData* probes, const ProbeClassifierSettings& settings) const
+	{
+		const uint32_t probesCount = ProbeCascades::GetProbesCount(grid);
+
+		ParallelFor(probesCount, [&](uint32_t probe)
+		{
+			ClassifyProbe(grid, probe, probes, settings);
+		}, m_threadsCount);
+
+		return GetStats(probes, probesCount);
+	}
+
+	void ProbeClassifier::Classify(const RaytracedProbesData& grid, const std::vector<uint32_t>& probeIndices, ProbeRelocationData* probes, const ProbeClassifierSettings& settings) const
+	{
+		ParallelFor(static_cast<uint32_t>(probeIndices.size()), [&](uint32_t i)
+		{
+			ClassifyProbe(grid, probeIndices[i], probes, settings);
+		}, m_threadsCount);
+	}
+
+	ProbeClassificationStats ProbeClassifier::GetStats(const ProbeRelocationData* probes, uint32_t probesCount)
+	{
+		ProbeClassificationStats stats;
+		stats.probesCount = probesCount;
+		for (uint32_t probe = 0; probe < probesCount; probe++)
+		{
+			stats.activeCount += probes[probe].isActive != 0;
+			stats.relocatedCount += probes[probe].isActive != 0 && !IsZero(probes[probe].offset);
+		}
+		return stats;
+	}
+
+	uint64_t ProbeClassifier::ComputeKey(
+		const RaytracedProbesData& grid,
+		const jmath::vec3* triangleVertices,
+		const jmath::vec3* triangleNormals,
+		uint32_t trianglesCount,
+		const ProbeClassifierSettings& settings)
+	{
+		// Fields one by one, the structs may have padding
+		uint64_t key = val_64_const;
+		for (const ProbeCascadeData& cascade : grid.cascades)
+		{
+			key = HashValue(cascade.gridMin, key);
+			key = HashValue(cascade.cellSize, key);
+			key = HashValue(cascade.gridScroll, key);
+		}
+		key = HashValue(grid.gridX, key);
+		key = HashValue(grid.gridY, key);
+		key = HashValue(grid.gridZ, key);
+		key = HashValue(settings.raysCount, key);
+		key = HashValue(settings.iterationsCount, key);
+		key = HashValue(settings.backfaceThreshold, key);
+		key = HashValue(settings.minFrontfaceDistance, key);
+		key = HashValue(settings.maxOffset, key);
+		key = HashValue(trianglesCount, key);
+		key = MemHash64(triangleVertices, sizeof(jmath::vec3) * trianglesCount * 3, key);
+		if (triangleNormals != nullptr)
+		{
+			key = MemHash64(triangleNormals, sizeof(jmath::vec3) * trianglesCount, key);
+		}
+		return key;
+	}
+
+	bool ProbeClassifier::Load(const std::filesystem::path& path, uint64_t key, ProbeRelocationData* probes, uint32_t probesCount)
+	{
+		if (!std::filesystem::exists(path))
+		{
+			return false;
+		}
+
+		const std::vector<char> data = ReadFile(path.generic_string(), 0);
+
+		uint32_t magic, version, storedProbesCount;
+		uint64_t storedKey;
+		const size_t headerSize = sizeof(magic) + sizeof(version) + sizeof(storedKey) + sizeof(storedProbesCount);
+		if (data.size() != headerSize + sizeof(ProbeRelocationData) * probesCount)
+		{
+			return false;
+		}
+
+		const char* ptr = data.data();
+		for (const auto& [value, size] : {
+			     std::pair<void*, size_t>{&magic, sizeof(magic)},
+			     std::pair<void*, size_t>{&version, sizeof(version)},
+			     std::pair<void*, size_t>{&storedKey, sizeof(storedKey)},
+			     std::pair<void*, size_t>{&storedProbesCount, sizeof(storedProbesCount)}
+		     })
+		{
+			memcpy(value, ptr, size);
+			ptr += size;
+		}
+
+		if (magic != PROBE_CLASSIFIER_MAGIC ||
+			version != PROBE_CLASSIFIER_FORMAT_VERSION ||
+			storedKey != key ||
+			storedProbesCount != probesCount)
+		{
+			return false;
+		}
+
+		memcpy(probes, ptr, sizeof(ProbeRelocationData) * probesCount);
+		return true;
+	}
+
+	void ProbeClassifier::Store(const std::filesystem::path& path, uint64_t key, const ProbeRelocationData* probes, uint32_t probesCount)
+	{
+		std::vector<char> data;
+		WriteValue(data, static_cast<uint32_t>(PROBE_CLASSIFIER_MAGIC));
+		WriteValue(data, static_cast<uint32_t>(PROBE_CLASSIFIER_FORMAT_VERSION));
+		WriteValue(data, key);
+		WriteValue(data, probesCount);
+		const char* probesPtr = reinterpret_cast<const char*>(probes);
+		data.insert(data.end(), probesPtr, probesPtr + sizeof(ProbeRelocationData) * probesCount);
+
+		// write to the temporary file first, so nobody can read half written data
+		std::filesystem::path tempPath = path;
+		tempPath += ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				Logger::LogFormat(LogLevel::Warning, "Cannot write probe classification %s\n", tempPath.generic_string().c_str());
+				return;
+			}
+			file.write(data.data(), static_cast<std::streamsize>(data.size()));
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, path, error);
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+		}
+	}
+
+	void ProbeClassifier::ClassifyCached(
+		const std::filesystem::path& cachePath,
+		const RaytracedProbesData& grid,
+		ProbeRelocationData* probes,
+		const ProbeClassifierSettings& settings) const
+	{
+		const uint32_t probesCount = ProbeCascades::GetProbesCount(grid);
+		const uint64_t key = ComputeKey(grid, m_triangleVertices, m_triangleNormals, m_trianglesCount, settings);
+
+		const bool isLoaded = Load(cachePath, key, probes, probesCount);
+		if (!isLoaded)
+		{
+			Classify(grid, probes, settings);
+			Store(cachePath, key, probes, probesCount);
+		}
+
+		const ProbeClassificationStats stats = GetStats(probes, probesCount);
+		Logger::LogFormat("Probe classification %s: %u of %u probes active, %u relocated, %u rays saved per grid update\n",
+		                  isLoaded ? "loaded" : "computed",
+		                  stats.activeCount,
+		                  stats.probesCount,
+		                  stats.relocatedCount,
+		                  stats.GetRaysSaved());
+	}
+
+	bool ProbeClassifier::Test()
+	{
+		bool isSuccess = true;
+
+		// Room [0, 20] x [0, 10] x [0, 20]. The wall at x = 20 is 4 units thick, so probes in it can't get out,
+		// the thin wall at x = 9 holds a row of probes which can
+		std::vector<jmath::vec3> vertices;
+		std::vector<jmath::vec3> normals;
+		AddBox(jmath::vec3(-1, -1, -1), jmath::vec3(24, 0, 21), vertices, normals); // floor
+		AddBox(jmath::vec3(-1, 10, -1), jmath::vec3(24, 11, 21), vertices, normals); // ceiling
+		AddBox(jmath::vec3(-1, 0, -1), jmath::vec3(0, 10, 21), vertices, normals);
+		AddBox(jmath::vec3(20, 0, -1), jmath::vec3(24, 10, 21), vertices, normals);
+		AddBox(jmath::vec3(0, 0, -1), jmath::vec3(20, 10, 0), vertices, normals);
+		AddBox(jmath::vec3(0, 0, 20), jmath::vec3(20, 10, 21), vertices, normals);
+		AddBox(jmath::vec3(8.6f, 0, 0), jmath::vec3(9.4f, 10, 20), vertices, normals);
+		const uint32_t trianglesCount = static_cast<uint32_t>(normals.size());
+
+		// Only the finest cascade is classified, it's scrolled so storage order differs from the grid order
+		RaytracedProbesData grid = {
+			.cascades = {},
+			.gridX = 16,
+			.gridY = 5,
+			.gridZ = 10,
+			.useDDGI = 0,
+			.skyboxTextureIndex = 0,
+			.dummy_0 = 0,
+			.dummy_1 = 0,
+			.dummy_2 = 0,
+		};
+		for (uint32_t cascade = 0; cascade < DDGI_CASCADES_COUNT; cascade++)
+		{
+			grid.cascades[cascade] = {
+				.gridMin = jmath::vec3(1, 1, 1),
+				.cellSize = static_cast<float>(2 << cascade),
+				.gridScroll = jmath::uvec3(cascade == 0 ? 5 : 0, cascade == 0 ? 2 : 0, cascade == 0 ? 7 : 0),
+				.dummy_0 = 0
+			};
+		}
+		const uint32_t probesCount = ProbeCascades::GetProbesPerCascade(grid);
+		std::vector<uint32_t> probeIndices(probesCount);
+		std::iota(probeIndices.begin(), probeIndices.end(), 0);
+		const ProbeClassifierSettings settings;
+
+		const ProbeClassifier classifier(vertices.data(), normals.data(), trianglesCount);
+		std::vector<ProbeRelocationData> probes(ProbeCascades::GetProbesCount(grid));
+		classifier.Classify(grid, probeIndices, probes.data(), settings);
+		const ProbeClassificationStats stats = GetStats(probes.data(), probesCount);
+
+		for (uint32_t probe = 0; probe < probesCount; probe++)
+		{
+			const jmath::vec3 gridPosition = ProbeCascades::GetProbePosition(grid, probe);
+			const jmath::vec3 position = MulAdd(gridPosition, probes[probe].offset, 1);
+			const bool isActive = probes[probe].isActive != 0;
+
+			// Probes light only the 8 cells around them, so in the room only probes within a cell from a wall are needed.
+			// x = 21 and 23 are inside the thick wall, x = 25 is near its outer side, x >= 27 is out of reach of any geometry
+			const bool isNearRoomWall =
+				gridPosition.x <= 2 || (gridPosition.x >= 7 && gridPosition.x <= 11) || gridPosition.x >= 18 ||
+				gridPosition.y <= 2 || gridPosition.y >= 8 ||
+				gridPosition.z <= 2 || gridPosition.z >= 18;
+			const bool isExpectedActive = (gridPosition.x < 20 && isNearRoomWall) || gridPosition.x == 25;
+			const bool isInThinWall = gridPosition.x == 9;
+			const float maxOffset = settings.maxOffset * grid.cascades[0].cellSize;
+
+			if (isActive != isExpectedActive ||
+				(isInThinWall && std::abs(probes[probe].offset.x) < 0.4f) ||
+				(isActive && (IsInsideBox(position, jmath::vec3(8.6f, 0, 0), jmath::vec3(9.4f, 10, 20)) ||
+					IsInsideBox(position, jmath::vec3(20, 0, -1), jmath::vec3(24, 10, 21)))) ||
+				std::abs(probes[probe].offset.x) > maxOffset ||
+				std::abs(probes[probe].offset.y) > maxOffset ||
+				std::abs(probes[probe].offset.z) > maxOffset)
+			{
+				Logger::LogFormat("Probe classifier: probe at %.1f %.1f %.1f is %s with offset %.2f %.2f %.2f\n",
+				                  gridPosition.x, gridPosition.y, gridPosition.z,
+				                  isActive ? "active" : "inactive",
+				                  probes[probe].offset.x, probes[probe].offset.y, probes[probe].offset.z);
+				isSuccess = false;
+			}
+		}
+
+		// Geometric normals of the counter clockwise winding give the same result
+		{
+			const ProbeClassifier windingClassifier(vertices.data(), nullptr, trianglesCount);
+			std::vector<ProbeRelocationData> windingProbes(probes.size());
+			windingClassifier.Classify(grid, probeIndices, windingProbes.data(), settings);
+			if (memcmp(probes.data(), windingProbes.data(), sizeof(ProbeRelocationData) * probesCount) != 0)
+			{
+				Logger::Log("Probe classifier: geometric normals give different result\n");
+				isSuccess = false;
+			}
+		}
+
+		// Cache round trip, the key covers the triangles
+		{
+			const std::filesystem::path path = std::filesystem::temp_directory_path() / "probe_classifier_test.probes";
+			const uint64_t key = ComputeKey(grid, vertices.data(), normals.data(), trianglesCount, settings);
+			Store(path, key, probes.data(), probesCount);
+
+			std::vector<ProbeRelocationData> loaded(probesCount);
+			vertices[0].x += 1;
+			if (!Load(path, key, loaded.data(), probesCount) ||
+				memcmp(probes.data(), loaded.data(), sizeof(ProbeRelocationData) * probesCount) != 0 ||
+				Load(path, ComputeKey(grid, vertices.data(), normals.data(), trianglesCount, settings), loaded.data(), probesCount))
+			{
+				Logger::Log(LogLevel::Error, "Probe classifier: cache round trip failed\n");
+				isSuccess = false;
+			}
+			std::error_code error;
+			std::filesystem::remove(path, error);
+		}
+
+		Logger::LogFormat("Probe classifier: %u of %u probes active, %u relocated, %u rays saved per grid update\n",
+		                  stats.activeCount, stats.probesCount, stats.relocatedCount, stats.GetRaysSaved());
+
+		return isSuccess;
+	}
+}
@@ -0,0 +1,100 @@
+#ifndef PROBE_CLASSIFIER_H
+#define PROBE_CLASSIFIER_H
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace JoyEngine
+{
+	struct ProbeClassifierSettings
+	{
+		uint32_t raysCount = DDGI_RAYS_COUNT;
+		uint32_t iterationsCount = 4; // relocation steps, every step casts raysCount rays
+		float backfaceThreshold = 0.25f; // share of backface hits which means the probe is inside geometry
+		float minFrontfaceDistance = 0.1f; // of cell size, closer probes are pushed away from the surface
+		float maxOffset = 0.45f; // of cell size on every axis, so probes stay in their cells
+	};
+
+	struct ProbeClassificationStats
+	{
+		uint32_t probesCount = 0;
+		uint32_t activeCount = 0;
+		uint32_t relocatedCount = 0;
+
+		// Rays one full grid update doesn't trace anymore
+		[[nodiscard]] uint32_t GetRaysSaved() const noexcept { return (probesCount - activeCount) * DDGI_RAYS_COUNT; }
+	};
+
+	// Pass over probe cascades with cpu rays against static scene triangles, on load and for probes entering their cascades.
+	// Probes inside walls are moved through the closest backface, probes too close to a surface are pushed away from it.
+	// Probes left inside geometry or without any geometry in the cells they light are marked inactive.
+	// Results for the start cascades are cached in a file next to the scene, keyed by the cascades, the settings and the triangles
+	class ProbeClassifier
+	{
+	public:
+		ProbeClassifier() = delete;
+
+		// 3 vertices and one front direction per triangle, in world space. Normals come from vertex normals,
+		// so the result doesn't depend on the winding order. Triangles are not copied and must outlive the classifier
+		ProbeClassifier(const jmath::vec3* triangleVertices, const jmath::vec3* triangleNormals, uint32_t trianglesCount, uint32_t threadsCount = 0);
+
+		// probes size = ProbeCascades::GetProbesCount(grid), indexed like in shaders
+		ProbeClassificationStats Classify(const RaytracedProbesData& grid, ProbeRelocationData* probes, const ProbeClassifierSettings& settings = {}) const;
+		// Only the listed probes are written, for probes which entered their cascades
+		void Classify(const RaytracedProbesData& grid, const std::vector<uint32_t>& probeIndices, ProbeRelocationData* probes, const ProbeClassifierSettings& settings = {}) const;
+
+		// Cached result or a new classification of every probe which is stored to cachePath. Logs stats and rays saved per frame
+		void ClassifyCached(
+			const std::filesystem::path& cachePath,
+			const RaytracedProbesData& grid,
+			ProbeRelocationData* probes,
+			const ProbeClassifierSettings& settings = {}) const;
+
+		static uint64_t ComputeKey(
+			const RaytracedProbesData& grid,
+			const jmath::vec3* triangleVertices,
+			const jmath::vec3* triangleNormals,
+			uint32_t trianglesCount,
+			const ProbeClassifierSettings& settings);
+		static bool Load(const std::filesystem::path& path, uint64_t key, ProbeRelocationData* probes, uint32_t probesCount);
+		static void Store(const std::filesystem::path& path, uint64_t key, const ProbeRelocationData* probes, uint32_t probesCount);
+
+		static ProbeClassificationStats GetStats(const ProbeRelocationData* probes, uint32_t probesCount);
+
+		// Classifies the finest cascade over a closed room with a thick wall through it and a far empty wing,
+		// checks probes in the wall are relocated or disabled, probes in the empty wing are disabled
+		// and the rest stay active. Logs failures and the rays saved
+		static bool Test();
+
+	private:
+		struct RaysResult
+		{
+			uint32_t backfaceCount = 0;
+			float closestBackfaceDistance = std::numeric_limits<float>::max();
+			jmath::vec3 closestBackfaceDir;
+			float closestFrontfaceDistance = std::numeric_limits<float>::max();
+			jmath::vec3 closestFrontfaceDir;
+			bool hasNearGeometry = false; // frontface hit inside the 8 cells around the grid position
+		};
+
+		void ClassifyProbe(const RaytracedProbesData& grid, uint32_t probe, ProbeRelocationData* probes, const ProbeClassifierSettings& settings) const;
+		[[nodiscard]] RaysResult CastRays(const jmath::vec3& position, const jmath::vec3& gridPosition, float cellSize, uint32_t raysCount) const;
+		[[nodiscard]] jmath::vec3 GetTriangleNormal(uint32_t triangle) const;
+
+		const jmath::vec3* m_triangleVertices;
+		const jmath::vec3* m_triangleNormals;
+		uint32_t m_trianglesCount;
+		uint32_t m_threadsCount;
+
+		std::vector<AABB> m_triangleAABB;
+		std::vector<uint32_t> m_sortedTriangleIndices;
+		std::vector<InternalNode> m_internalNodes;
+		std::vector<LeafNode> m_leafNodes;
+		std::vector<AABB> m_bvhData;
+	};
+}
+#endif // PROBE_CLASSIFIER_H
@@ -0,0 +1,333 @@
+#include "ProbeUpdateScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "ProbeCascades.h"
+#include "Benchmarks/TestSuite.h"
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	ProbeUpdateScheduler::ProbeUpdateScheduler(const RaytracedProbesData& grid, uint32_t raysPerProbe, const ProbeSchedulerSettings& settings) :
+		m_grid(grid),
+		m_raysPerProbe(raysPerProbe),
+		m_settings(settings)
+	{
+		SetGrid(grid);
+	}
+
+	void ProbeUpdateScheduler::SetGrid(const RaytracedProbesData& grid)
+	{
+		const uint32_t probesCount = ProbeCascades::GetProbesCount(grid);
+		const bool isResized = probesCount != GetProbesCount();
+
+		m_grid = grid;
+		if (!isResized) return;
+
+		m_age.resize(probesCount);
+		m_change.assign(probesCount, 0);
+		m_invalidatedFrame.assign(probesCount, m_scheduledFramesCount);
+		m_priority.resize(probesCount);
+		m_activeProbes.resize(probesCount);
+		std::iota(m_activeProbes.begin(), m_activeProbes.end(), 0);
+		m_scheduledProbes.clear();
+		Invalidate();
+	}
+
+	void ProbeUpdateScheduler::Invalidate()
+	{
+		std::fill(m_age.begin(), m_age.end(), m_settings.maxAge);
+	}
+
+	void ProbeUpdateScheduler::Invalidate(const std::vector<uint32_t>& probes)
+	{
+		for (const uint32_t probe : probes)
+		{
+			m_age[probe] = m_settings.maxAge;
+			m_change[probe] = 0;
+			m_invalidatedFrame[probe] = m_scheduledFramesCount;
+		}
+	}
+
+	void ProbeUpdateScheduler::SetActiveProbes(const ProbeRelocationData* probes)
+	{
+		m_activeProbes.clear();
+		for (uint32_t probe = 0; probe < GetProbesCount(); probe++)
+		{
+			if (probes[probe].isActive != 0)
+			{
+				m_activeProbes.push_back(probe);
+			}
+		}
+	}
+
+	uint32_t ProbeUpdateScheduler::GetProbesPerFrame() const noexcept
+	{
+		return std::min(std::max(m_settings.raysBudget / m_raysPerProbe, 1u), GetActiveProbesCount());
+	}
+
+	jmath::vec3 ProbeUpdateScheduler::GetProbePosition(uint32_t probe) const
+	{
+		return ProbeCascades::GetProbePosition(m_grid, probe);
+	}
+
+	bool ProbeUpdateScheduler::IsProbeVisible(uint32_t probe, const ProbeSchedulerView& view) const
+	{
+		// Probe lights surfaces up to one cell away, so its cell sphere is tested against the frustum
+		const jmath::vec3 p = jmath::toVec3(jmath::mul(view.view, jmath::loadPosition(GetProbePosition(probe))));
+		const float radius = ProbeCascades::GetCellSize(m_grid, probe);
+
+		if (p.z < view.nearPlane - radius || p.z > view.farPlane + radius) return false;
+
+		const float tanY = std::tan(view.fovRadians / 2);
+		const float tanX = tanY * view.aspect;
+
+		// Side planes pass through the eye, their distance to the point is (|x| - z * tan) / sqrt(1 + tan^2)
+		return std::abs(p.x) - p.z * tanX <= radius * std::sqrt(1 + tanX * tanX) &&
+			std::abs(p.y) - p.z * tanY <= radius * std::sqrt(1 + tanY * tanY);
+	}
+
+	float ProbeUpdateScheduler::GetPriority(uint32_t probe, const ProbeSchedulerView& view) const
+	{
+		const jmath::vec3 p = GetProbePosition(probe);
+		const float dx = p.x - view.position.x;
+		const float dy = p.y - view.position.y;
+		const float dz = p.z - view.position.z;
+		const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+		const bool isLighting = IsProbeVisible(probe, view) && !ProbeCascades::IsProbeCovered(m_grid, probe);
+		const float importance =
+			(isLighting ? 1.0f : m_settings.invisibleImportance) /
+			(1.0f + distance / m_settings.distanceFalloff);
+
+		return importance * static_cast<float>(m_age[probe]) * (1.0f + m_settings.changeWeight * m_change[probe]);
+	}
+
+	const std::vector<uint32_t>& ProbeUpdateScheduler::Schedule(const ProbeSchedulerView& view)
+	{
+		for (const uint32_t probe : m_activeProbes)
+		{
+			m_age[probe]++;
+			m_priority[probe] = GetPriority(probe, view);
+		}
+		m_order.assign(m_activeProbes.begin(), m_activeProbes.end());
+
+		const uint32_t probesPerFrame = GetProbesPerFrame();
+		const uint32_t maxAge = m_settings.maxAge;
+
+		// Too old probes first, then by priority, ties by index so the result is deterministic
+		std::partial_sort(m_order.begin(), m_order.begin() + probesPerFrame, m_order.end(),
+		                  [this, maxAge](uint32_t a, uint32_t b)
+		                  {
+			                  const bool isAOld = m_age[a] > maxAge;
+			                  const bool isBOld = m_age[b] > maxAge;
+			                  if (isAOld != isBOld) return isAOld;
+			                  if (isAOld && m_age[a] != m_age[b]) return m_age[a] > m_age[b];
+			                  if (m_priority[a] != m_priority[b]) return m_priority[a] > m_priority[b];
+			                  return a < b;
+		                  });
+
+		m_scheduledProbes.assign(m_order.begin(), m_order.begin() + probesPerFrame);
+		std::sort(m_scheduledProbes.begin(), m_scheduledProbes.end());
+
+		for (const uint32_t probe : m_scheduledProbes)
+		{
+			m_age[probe] = 0;
+		}
+		m_scheduledFramesCount++;
+
+		return m_scheduledProbes;
+	}
+
+	void ProbeUpdateScheduler::SetIrradianceChange(const float* changes, uint32_t scheduledFrame)
+	{
+		for (uint32_t probe = 0; probe < GetProbesCount(); probe++)
+		{
+			// Readback was written before the probe moved, the change belongs to its old place
+			if (m_invalidatedFrame[probe] >= scheduledFrame) continue;
+
+			// Readback may hold anything before the first update of the probe
+			m_change[probe] = std::isfinite(changes[probe]) ? std::clamp(changes[probe], 0.0f, 1.0f) : 0.0f;
+		}
+	}
+
+	bool ProbeUpdateScheduler::Test()
+	{
+		bool isPassed = true;
+
+		// Camera looks along +x from the cascades middle, the half behind it is invisible
+		const jmath::vec3 cameraPosition(0, 10, 0);
+		RaytracedProbesData grid = {
+			.cascades = {},
+			.gridX = 12,
+			.gridY = 8,
+			.gridZ = 12,
+			.useDDGI = 0,
+			.skyboxTextureIndex = 0,
+			.dummy_0 = 0,
+			.dummy_1 = 0,
+			.dummy_2 = 0,
+		};
+		const float cellSizes[DDGI_CASCADES_COUNT] = {2.05f, 4.1f, 8.2f};
+		ProbeCascades::Init(grid, cellSizes, cameraPosition);
+		const uint32_t probesCount = ProbeCascades::GetProbesCount(grid);
+
+		ProbeSchedulerSettings settings;
+		settings.raysBudget = DDGI_RAYS_COUNT * 256;
+		settings.maxAge = 16;
+		ProbeUpdateScheduler scheduler(grid, DDGI_RAYS_COUNT, settings);
+
+		const ProbeSchedulerView view = {
+			.view = jmath::lookAtLH(
+				jmath::loadPosition(cameraPosition),
+				jmath::loadPosition(jmath::vec3(cameraPosition.x + 1, cameraPosition.y, cameraPosition.z)),
+				jmath::xup),
+			.position = cameraPosition,
+			.fovRadians = jmath::toRadians(60),
+			.aspect = 16.0f / 9.0f,
+			.nearPlane = 0.1f,
+			.farPlane = 1000.0f
+		};
+
+		// First frames cover the whole grid
+		{
+			std::vector<uint32_t> updates(probesCount, 0);
+			const uint32_t firstFrames = (probesCount + scheduler.GetProbesPerFrame() - 1) / scheduler.GetProbesPerFrame();
+			for (uint32_t frame = 0; frame < firstFrames; frame++)
+			{
+				for (const uint32_t probe : scheduler.Schedule(view))
+				{
+					updates[probe]++;
+				}
+			}
+			isPassed &= TEST_CHECK(std::ranges::all_of(updates, [](uint32_t count) { return count > 0; }), "first frames don't update every probe");
+		}
+
+		// Steady state: budget, list order, ages and update rates
+		std::vector<uint32_t> updates(probesCount, 0);
+		constexpr uint32_t framesCount = 512;
+		uint32_t maxAge = 0;
+		for (uint32_t frame = 0; frame < framesCount; frame++)
+		{
+			const std::vector<uint32_t>& probes = scheduler.Schedule(view);
+
+			const bool isListValid = probes.size() * DDGI_RAYS_COUNT <= settings.raysBudget &&
+				std::ranges::is_sorted(probes) &&
+				std::ranges::adjacent_find(probes) == probes.end() &&
+				(probes.empty() || probes.back() < probesCount);
+			isPassed &= TEST_CHECK(isListValid, "scheduled list is over budget, unsorted, has duplicates or probes out of grid");
+			if (!isListValid) break;
+
+			for (const uint32_t probe : probes)
+			{
+				updates[probe]++;
+			}
+			for (uint32_t probe = 0; probe < probesCount; probe++)
+			{
+				maxAge = std::max(maxAge, scheduler.GetProbeAge(probe));
+			}
+		}
+
+		// probesCount / probesPerFrame frames are needed to cover the grid, so ages are bounded by both limits
+		const uint32_t ageLimit = std::max(settings.maxAge, probesCount / scheduler.GetProbesPerFrame()) + 1;
+		isPassed &= TEST_CHECK(maxAge <= ageLimit, "probe waited longer than the age limit");
+
+		uint32_t visibleUpdates = 0, visibleCount = 0, invisibleUpdates = 0, invisibleCount = 0;
+		for (uint32_t probe = 0; probe < probesCount; probe++)
+		{
+			const bool isVisible = scheduler.IsProbeVisible(probe, view);
+			(isVisible ? visibleUpdates : invisibleUpdates) += updates[probe];
+			(isVisible ? visibleCount : invisibleCount)++;
+		}
+		const float visibleRate = static_cast<float>(visibleUpdates) / static_cast<float>(std::max(visibleCount, 1u)) / framesCount;
+		const float invisibleRate = static_cast<float>(invisibleUpdates) / static_cast<float>(std::max(invisibleCount, 1u)) / framesCount;
+		Logger::LogFormat("Probe scheduler: %u of %u probes per frame, %u visible updated every %.1f frames, %u invisible every %.1f frames, max age %u\n",
+		                  scheduler.GetProbesPerFrame(), probesCount,
+		                  visibleCount, 1.0f / visibleRate,
+		                  invisibleCount, 1.0f / invisibleRate,
+		                  maxAge);
+		isPassed &= TEST_CHECK(visibleCount > 0 && invisibleCount > 0 && visibleRate > invisibleRate, "visible probes are not updated more often");
+
+		// Same invisible probe with and without measured change
+		{
+			uint32_t changingProbe = 0;
+			while (scheduler.IsProbeVisible(changingProbe, view)) changingProbe++;
+
+			uint32_t changeUpdates[2] = {0, 0};
+			for (uint32_t run = 0; run < 2; run++)
+			{
+				std::vector<float> changes(probesCount, 0.0f);
+				changes[changingProbe] = run == 0 ? 0.0f : 1.0f;
+				scheduler.SetIrradianceChange(changes.data(), scheduler.GetScheduledFramesCount());
+
+				for (uint32_t frame = 0; frame < framesCount; frame++)
+				{
+					changeUpdates[run] += std::ranges::binary_search(scheduler.Schedule(view), changingProbe);
+				}
+			}
+			isPassed &= TEST_CHECK(changeUpdates[1] > changeUpdates[0], "changing probe is not updated more often than still one");
+		}
+
+		// Camera moves by a cell, probes entered the cascades are updated within the age limit
+		{
+			std::vector<uint32_t> enteredProbes;
+			ProbeCascades::Follow(grid, jmath::vec3(cameraPosition.x + cellSizes[0], cameraPosition.y, cameraPosition.z), enteredProbes);
+			scheduler.SetGrid(grid);
+			scheduler.Invalidate(enteredProbes);
+
+			std::vector<uint32_t> waitingProbes = enteredProbes;
+			std::ranges::sort(waitingProbes);
+			for (uint32_t frame = 0; frame < ageLimit && !waitingProbes.empty(); frame++)
+			{
+				const std::vector<uint32_t>& probes = scheduler.Schedule(view);
+				std::erase_if(waitingProbes, [&probes](uint32_t probe) { return std::ranges::binary_search(probes, probe); });
+			}
+			isPassed &= TEST_CHECK(!enteredProbes.empty() && waitingProbes.empty(), "entered probes are not updated within the age limit");
+		}
+
+		// Readback of a frame scheduled before the probes entered doesn't change them, the next one does
+		{
+			const uint32_t staleFrame = scheduler.GetScheduledFramesCount();
+			std::vector<uint32_t> enteredProbes;
+			ProbeCascades::Follow(grid, cameraPosition, enteredProbes);
+			scheduler.SetGrid(grid);
+			scheduler.Invalidate(enteredProbes);
+			scheduler.Schedule(view);
+
+			const std::vector<float> changes(probesCount, 1.0f);
+			scheduler.SetIrradianceChange(changes.data(), staleFrame);
+			const std::vector<float> staleChange = scheduler.m_change;
+			scheduler.SetIrradianceChange(changes.data(), scheduler.GetScheduledFramesCount());
+			isPassed &= TEST_CHECK(!enteredProbes.empty(), "camera move back doesn't enter probes");
+			isPassed &= TEST_CHECK(std::ranges::all_of(enteredProbes, [&staleChange](uint32_t probe) { return staleChange[probe] == 0.0f; }),
+			                       "irradiance change of entered probes is taken from stale readback");
+			isPassed &= TEST_CHECK(std::ranges::all_of(enteredProbes, [&scheduler](uint32_t probe) { return scheduler.m_change[probe] == 1.0f; }),
+			                       "irradiance change of entered probes is not taken from fresh readback");
+		}
+
+		// Budget larger than the grid updates everything every frame
+		{
+			settings.raysBudget = DDGI_RAYS_COUNT * probesCount * 2;
+			scheduler.SetSettings(settings);
+			isPassed &= TEST_CHECK(scheduler.Schedule(view).size() == probesCount, "large budget doesn't update every probe");
+		}
+
+		// Every third probe inactive: never scheduled, the rest still fill the budget
+		{
+			std::vector<ProbeRelocationData> relocation(probesCount);
+			for (uint32_t probe = 0; probe < probesCount; probe++)
+			{
+				relocation[probe] = {.offset = jmath::vec3(0, 0, 0), .isActive = probe % 3 != 0 ? 1u : 0u};
+			}
+			scheduler.SetActiveProbes(relocation.data());
+
+			const std::vector<uint32_t>& probes = scheduler.Schedule(view);
+			isPassed &= TEST_CHECK(probes.size() == scheduler.GetActiveProbesCount(), "active probes don't fill the budget");
+			isPassed &= TEST_CHECK(std::ranges::none_of(probes, [](uint32_t probe) { return probe % 3 == 0; }), "inactive probes are scheduled");
+		}
+
+		return isPassed;
+	}
+}
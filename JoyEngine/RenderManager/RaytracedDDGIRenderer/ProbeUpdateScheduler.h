@@ -0,0 +1,93 @@
+#ifndef PROBE_UPDATE_SCHEDULER_H
+#define PROBE_UPDATE_SCHEDULER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace JoyEngine
+{
+	// Camera the probes are scheduled for, view is world to view space (left handed, z forward)
+	struct ProbeSchedulerView
+	{
+		jmath::mat4x4 view;
+		jmath::vec3 position;
+		float fovRadians; // vertical
+		float aspect;
+		float nearPlane;
+		float farPlane;
+	};
+
+	struct ProbeSchedulerSettings
+	{
+		uint32_t raysBudget = DDGI_RAYS_COUNT * 256; // rays traced for probes every frame
+		uint32_t maxAge = 16; // frames, older probes go first regardless of priority while the budget allows
+		float distanceFalloff = 8.0f; // camera distance at which probe importance halves
+		float invisibleImportance = 0.1f; // importance of probes which can't light anything in the frustum
+		float changeWeight = 8.0f; // scale of measured relative irradiance change
+	};
+
+	// Picks probes to update this frame within the ray budget. Probe priority grows with the frames since its update
+	// and is scaled by importance, which comes from camera distance and frustum visibility of the probe cell,
+	// and by the last measured irradiance change of the probe. Probes of coarse cascades which only light
+	// what a finer cascade already shades are as important as invisible ones.
+	// Probe indices are the same as in shaders, see ProbeCascades.
+	// Has no gpu dependencies and can be checked anywhere
+	class ProbeUpdateScheduler
+	{
+	public:
+		ProbeUpdateScheduler() = delete;
+		ProbeUpdateScheduler(const RaytracedProbesData& grid, uint32_t raysPerProbe, const ProbeSchedulerSettings& settings = {});
+
+		// Returns scheduled probes in ascending order, no more than GetProbesPerFrame() of them
+		const std::vector<uint32_t>& Schedule(const ProbeSchedulerView& view);
+
+		// Mean relative irradiance change of every probe on its last update. scheduledFrame is GetScheduledFramesCount()
+		// after the Schedule call which updates were read back, changes of probes invalidated since then are ignored
+		void SetIrradianceChange(const float* changes, uint32_t scheduledFrame);
+
+		// Grid moved or scene changed, every probe goes first until it is updated
+		void Invalidate();
+		// Probes entered their cascade, they go first and their irradiance change is unknown
+		void Invalidate(const std::vector<uint32_t>& probes);
+
+		// Inactive probes are never scheduled. Every probe is active after the grid is resized
+		void SetActiveProbes(const ProbeRelocationData* probes);
+
+		void SetGrid(const RaytracedProbesData& grid);
+		void SetSettings(const ProbeSchedulerSettings& settings) { m_settings = settings; }
+
+		[[nodiscard]] const ProbeSchedulerSettings& GetSettings() const noexcept { return m_settings; }
+		[[nodiscard]] const std::vector<uint32_t>& GetScheduledProbes() const noexcept { return m_scheduledProbes; }
+		[[nodiscard]] uint32_t GetProbesCount() const noexcept { return static_cast<uint32_t>(m_age.size()); }
+		[[nodiscard]] uint32_t GetActiveProbesCount() const noexcept { return static_cast<uint32_t>(m_activeProbes.size()); }
+		[[nodiscard]] uint32_t GetProbesPerFrame() const noexcept;
+		[[nodiscard]] uint32_t GetScheduledFramesCount() const noexcept { return m_scheduledFramesCount; }
+		[[nodiscard]] uint32_t GetProbeAge(uint32_t probe) const { return m_age[probe]; }
+		[[nodiscard]] jmath::vec3 GetProbePosition(uint32_t probe) const;
+		[[nodiscard]] bool IsProbeVisible(uint32_t probe, const ProbeSchedulerView& view) const;
+
+		// Runs the scheduler over cascades around the camera and checks the budget, ages,
+		// that visible probes are updated more often, that changing probes are updated more often
+		// and that stale changes of invalidated probes are ignored. Logs failures
+		static bool Test();
+
+	private:
+		[[nodiscard]] float GetPriority(uint32_t probe, const ProbeSchedulerView& view) const;
+
+		RaytracedProbesData m_grid;
+		uint32_t m_raysPerProbe;
+		ProbeSchedulerSettings m_settings;
+
+		std::vector<uint32_t> m_age; // frames since the probe update
+		std::vector<float> m_change;
+		std::vector<uint32_t> m_invalidatedFrame; // scheduled frames count when the probe was invalidated
+		std::vector<float> m_priority;
+		std::vector<uint32_t> m_activeProbes;
+		std::vector<uint32_t> m_order;
+		std::vector<uint32_t> m_scheduledProbes;
+		uint32_t m_scheduledFramesCount = 0;
+	};
+}
+#endif // PROBE_UPDATE_SCHEDULER_H
@@ -1,23 +1,52 @@
 #include "RaytracedDDGIDataContainer.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "Components/MeshRenderer.h"
+#include "DataManager/DataManager.h"
 #include "ResourceManager/Material.h"
 #include "SceneManager/GameObject.h"
+#include "SceneManager/WorldManager.h"
+#include "Utils/Assert.h"
 #include "Utils/GraphicsUtils.h"
 #include "Utils/TimeCounter.h"
 
 namespace JoyEngine
 {
+	namespace
+	{
+		jmath::vec3 UnpackNormal(const jmath::rgb10a2unorm& normal)
+		{
+			return jmath::vec3(
+				static_cast<float>((normal.v >> 0) & 0x3FF) / 1023.0f * 2.0f - 1.0f,
+				static_cast<float>((normal.v >> 10) & 0x3FF) / 1023.0f * 2.0f - 1.0f,
+				static_cast<float>((normal.v >> 20) & 0x3FF) / 1023.0f * 2.0f - 1.0f);
+		}
+	}
+
 	RaytracedDDGIDataContainer::RaytracedDDGIDataContainer(
 		std::set<SharedMaterial*>& sceneSharedMaterials,
 		uint32_t frameCount,
 		DXGI_FORMAT mainColorFormat,
 		DXGI_FORMAT depthFormat):
 		m_sceneSharedMaterials(sceneSharedMaterials),
-		m_raytracedProbesData(frameCount)
+		m_raytracedProbesData(frameCount),
+		m_frameCount(frameCount),
+		m_scheduledProbesData(frameCount),
+		m_probeRelocationData(frameCount)
 	{
-		m_triangleDataBuffer = std::make_unique<DataBuffer<TrianglePayload>>(DATA_ARRAY_COUNT);
-		m_meshDataBuffer = std::make_unique<DataBuffer<MeshData>>(DATA_ARRAY_COUNT);
+		const uint32_t probesCount = ProbeCascades::GetProbesCount(g_raytracedProbesData);
+		ASSERT(probesCount <= DDGI_MAX_PROBES_COUNT);
+
+		m_probeScheduler = std::make_unique<ProbeUpdateScheduler>(g_raytracedProbesData, DDGI_RAYS_COUNT);
+		m_probeChangeBuffer = std::make_unique<DataBuffer<float>>(probesCount, 0.0f);
+		m_probeChangeReadbackBuffer = std::make_unique<Buffer>(
+			m_probeChangeBuffer->GetSize() * frameCount,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			D3D12_HEAP_TYPE_READBACK);
+		m_probeRelocation.assign(probesCount, ProbeRelocationData{.offset = jmath::vec3(0, 0, 0), .isActive = 1});
+		m_isProbeReset.assign(probesCount, 0);
 
 		m_dispatcher = std::make_unique<ComputeDispatcher>();
 
@@ -77,47 +106,175 @@ namespace JoyEngine
 		}
 	}
 
-	void RaytracedDDGIDataContainer::SetFrameData(uint32_t frameIndex, const ResourceView* skyboxTextureIndexDataView)
+	void RaytracedDDGIDataContainer::SetFrameData(uint32_t frameIndex, const ResourceView* skyboxTextureIndexDataView, const ProbeSchedulerView& schedulerView)
 	{
+		FollowCamera(schedulerView.position);
+
 		g_raytracedProbesData.skyboxTextureIndex = skyboxTextureIndexDataView->GetDescriptorIndex();
 		m_raytracedProbesData.SetData(&g_raytracedProbesData, frameIndex);
+		memcpy(m_probeRelocationData.GetPtr(frameIndex), m_probeRelocation.data(), m_probeRelocation.size() * sizeof(ProbeRelocationData));
+
+		// Probe changes copied by the previous use of this frame index are complete now
+		if (m_scheduledFramesCount >= m_frameCount)
+		{
+			const MappedAreaHandle readbackPtr = m_probeChangeReadbackBuffer->Map();
+			m_probeScheduler->SetIrradianceChange(
+				static_cast<const float*>(readbackPtr.GetPtr()) + m_probeScheduler->GetProbesCount() * frameIndex,
+				m_probeScheduler->GetScheduledFramesCount() - m_frameCount + 1);
+		}
+
+		const std::vector<uint32_t>& scheduledProbes = m_probeScheduler->Schedule(schedulerView);
+		uint32_t* scheduledProbesPtr = m_scheduledProbesData.GetPtr(frameIndex);
+		for (size_t i = 0; i < scheduledProbes.size(); i++)
+		{
+			const uint32_t probe = scheduledProbes[i];
+			scheduledProbesPtr[i] = m_isProbeReset[probe] ? probe | DDGI_PROBE_RESET_FLAG : probe;
+			m_isProbeReset[probe] = 0;
+		}
+		m_scheduledFramesCount++;
 	}
 
-	void RaytracedDDGIDataContainer::UploadSceneData() const
+	void RaytracedDDGIDataContainer::FollowCamera(const jmath::vec3& position)
+	{
+		if (!m_isCascadesPlaced)
+		{
+			ProbeCascades::Init(g_raytracedProbesData, g_probeCascadeCellSizes, position);
+			m_probeScheduler->SetGrid(g_raytracedProbesData);
+			ClassifyProbes();
+			std::ranges::fill(m_isProbeReset, 1);
+			m_isCascadesPlaced = true;
+			return;
+		}
+
+		m_enteredProbes.clear();
+		ProbeCascades::Follow(g_raytracedProbesData, position, m_enteredProbes);
+		if (m_enteredProbes.empty()) return;
+
+		// Entered probes keep the storage of probes which left, their irradiance belongs to another place
+		if (m_probeClassifier != nullptr)
+		{
+			m_probeClassifier->Classify(g_raytracedProbesData, m_enteredProbes, m_probeRelocation.data());
+		}
+		for (const uint32_t probe : m_enteredProbes)
+		{
+			m_isProbeReset[probe] = 1;
+		}
+
+		m_probeScheduler->SetGrid(g_raytracedProbesData);
+		m_probeScheduler->SetActiveProbes(m_probeRelocation.data());
+		m_probeScheduler->Invalidate(m_enteredProbes);
+	}
+
+	void RaytracedDDGIDataContainer::UploadSceneData()
 	{
 		TIME_PERF("Uploading scene data");
 
-		uint32_t meshCount = 0;
-		uint32_t trianglesCount = 0;
-		for (auto const& sm : m_sceneSharedMaterials)
+		// Static renderers go first: hardware raytracing uses their indices as geometry indices.
+		// Dynamic ones are appended after them, so their triangles are one contiguous range
+		m_raytracedMeshRenderers.clear();
+		for (const bool isStatic : {true, false})
 		{
-			for (const auto& mr : sm->GetMeshRenderers())
+			for (auto const& sm : m_sceneSharedMaterials)
 			{
-				if (!mr->IsStatic()) continue;
-				const uint32_t meshTrianglesLength = mr->GetMesh()->GetIndexCount() / 3;
-
-				for (uint32_t i = 0; i < meshTrianglesLength; i++, trianglesCount++)
+				for (const auto& mr : sm->GetMeshRenderers())
 				{
-					m_triangleDataBuffer->GetLocalData()[trianglesCount] = TrianglePayload
-					{
-						.triangleIndex = i,
-						.meshIndex = meshCount
-					};
+					if (mr->IsStatic() != isStatic) continue;
+					m_raytracedMeshRenderers.push_back(mr);
 				}
+			}
+			if (isStatic)
+			{
+				m_staticMeshRenderersCount = static_cast<uint32_t>(m_raytracedMeshRenderers.size());
+			}
+		}
 
-				m_meshDataBuffer->GetLocalData()[meshCount] = MeshData{
-					.materialIndex = mr->GetMaterial()->GetMaterialIndex(),
-					.verticesIndex = mr->GetMesh()->GetVerticesBufferOffsetInBytes() / static_cast<uint32_t>(sizeof(Vertex)),
-					.indicesIndex = mr->GetMesh()->GetIndicesBufferOffsetInBytes() / static_cast<uint32_t>(sizeof(Index)),
-					.transformIndex = mr->GetGameObject().GetTransform().GetTransformIndex()
-				};
+		// Buffers are sized for the scene, there is no upper limit on triangles count
+		uint32_t sceneTrianglesCount = 0;
+		for (const MeshRenderer* mr : m_raytracedMeshRenderers)
+		{
+			sceneTrianglesCount += mr->GetMesh()->GetIndexCount() / 3;
+		}
+		m_triangleDataBuffer = std::make_unique<DataBuffer<TrianglePayload>>(std::max(sceneTrianglesCount, 1u));
+		m_meshDataBuffer = std::make_unique<DataBuffer<MeshData>>(std::max(static_cast<uint32_t>(m_raytracedMeshRenderers.size()), 1u));
 
-				meshCount++;
+		uint32_t meshCount = 0;
+		uint32_t trianglesCount = 0;
+		for (const MeshRenderer* mr : m_raytracedMeshRenderers)
+		{
+			const uint32_t meshTrianglesLength = mr->GetMesh()->GetIndexCount() / 3;
+
+			for (uint32_t i = 0; i < meshTrianglesLength; i++, trianglesCount++)
+			{
+				m_triangleDataBuffer->GetLocalData()[trianglesCount] = TrianglePayload
+				{
+					.triangleIndex = i,
+					.meshIndex = meshCount
+				};
 			}
+
+			m_meshDataBuffer->GetLocalData()[meshCount] = MeshData{
+				.materialIndex = mr->GetMaterial()->GetMaterialIndex(),
+				.verticesIndex = mr->GetMesh()->GetVerticesBufferOffsetInBytes() / static_cast<uint32_t>(sizeof(Vertex)),
+				.indicesIndex = mr->GetMesh()->GetIndicesBufferOffsetInBytes() / static_cast<uint32_t>(sizeof(Index)),
+				.transformIndex = mr->GetGameObject().GetTransform().GetTransformIndex()
+			};
+
+			meshCount++;
 		}
 
 		m_meshDataBuffer->UploadCpuData();
 		m_triangleDataBuffer->UploadCpuData();
+
+		// Only static geometry decides where probes go, dynamic objects just move through the grid.
+		// Triangle front is the mean of its vertex normals, so mirrored or flipped winding doesn't matter
+		m_staticTriangleVertices.clear();
+		m_staticTriangleNormals.clear();
+		for (uint32_t i = 0; i < m_staticMeshRenderersCount; i++)
+		{
+			const MeshRenderer* mr = m_raytracedMeshRenderers[i];
+			const Vertex* vertices = mr->GetMesh()->GetVertices();
+			const uint32_t* indices = mr->GetMesh()->GetIndices();
+			const uint32_t meshTrianglesLength = mr->GetMesh()->GetIndexCount() / 3;
+			const auto& modelMatrix = mr->GetGameObject().GetTransform().GetModelMatrix();
+
+			for (uint32_t triangle = 0; triangle < meshTrianglesLength; triangle++)
+			{
+				jmath::vec3 normal(0, 0, 0);
+				for (uint32_t v = 0; v < 3; v++)
+				{
+					const Vertex& vertex = vertices[indices[triangle * 3 + v]];
+					m_staticTriangleVertices.push_back(jmath::toVec3(jmath::mul(modelMatrix, jmath::loadPosition(jmath::toVec3(vertex.pos)))));
+
+					const jmath::vec3 vertexNormal = UnpackNormal(vertex.normal);
+					normal = jmath::vec3(normal.x + vertexNormal.x, normal.y + vertexNormal.y, normal.z + vertexNormal.z);
+				}
+				m_staticTriangleNormals.push_back(jmath::toVec3(jmath::mul(modelMatrix, jmath::loadVec4(jmath::vec4(normal.x, normal.y, normal.z, 0)))));
+			}
+		}
+
+		m_probeClassifier = std::make_unique<ProbeClassifier>(
+			m_staticTriangleVertices.data(),
+			m_staticTriangleNormals.data(),
+			static_cast<uint32_t>(m_staticTriangleNormals.size()));
+
+		// Scene is reloaded, cascades are placed and classified again on the next frame
+		m_isCascadesPlaced = false;
+	}
+
+	void RaytracedDDGIDataContainer::ClassifyProbes()
+	{
+		TIME_PERF("Classifying DDGI probes");
+
+		// Cached result is valid while the camera starts in the same cells
+		if (m_probeClassifier != nullptr)
+		{
+			m_probeClassifier->ClassifyCached(
+				DataManager::Get()->GetAbsolutePath(WorldManager::Get()->GetScenePath() + ".probes"),
+				g_raytracedProbesData,
+				m_probeRelocation.data());
+		}
+
+		m_probeScheduler->SetActiveProbes(m_probeRelocation.data());
 	}
 
 	void RaytracedDDGIDataContainer::GenerateProbeIrradiance(
@@ -142,11 +299,30 @@ namespace JoyEngine
 			GraphicsUtils::AttachView(commandList, m_probeIrradiancePipeline.get(), "probeDepthTexture", probeDepthTexture->GetUAV());
 
 			GraphicsUtils::AttachView(commandList, m_probeIrradiancePipeline.get(), "raytracedProbesData", m_raytracedProbesData.GetView(frameIndex));
+			GraphicsUtils::AttachView(commandList, m_probeIrradiancePipeline.get(), "scheduledProbes", m_scheduledProbesData.GetView(frameIndex));
+			GraphicsUtils::AttachView(commandList, m_probeIrradiancePipeline.get(), "probeRelocationData", m_probeRelocationData.GetView(frameIndex));
+			GraphicsUtils::AttachView(commandList, m_probeIrradiancePipeline.get(), "probeChangeData", m_probeChangeBuffer->GetUAV());
 		}
-		commandList->Dispatch(g_raytracedProbesData.gridX, g_raytracedProbesData.gridY, g_raytracedProbesData.gridZ);
+		// One group per scheduled probe
+		commandList->Dispatch(GetScheduledProbesCount(), 1, 1);
 
 		GraphicsUtils::UAVBarrier(commandList, probeIrradianceTexture->GetImageResource().Get());
 		GraphicsUtils::UAVBarrier(commandList, probeDepthTexture->GetImageResource().Get());
+
+		// Probe changes are read on cpu when this frame index comes again
+		{
+			const Buffer* changeBuffer = m_probeChangeBuffer->GetBuffer();
+			const D3D12_RESOURCE_STATES state = changeBuffer->GetCurrentResourceState();
+
+			GraphicsUtils::Barrier(commandList, changeBuffer->GetBufferResource().Get(), state, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			commandList->CopyBufferRegion(
+				m_probeChangeReadbackBuffer->GetBufferResource().Get(),
+				m_probeChangeBuffer->GetSize() * frameIndex,
+				changeBuffer->GetBufferResource().Get(),
+				0,
+				m_probeChangeBuffer->GetSize());
+			GraphicsUtils::Barrier(commandList, changeBuffer->GetBufferResource().Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, state);
+		}
 	}
 
 
@@ -181,10 +357,11 @@ namespace JoyEngine
 		GraphicsUtils::ProcessEngineBindings(commandList, sm.get(), frameIndex, nullptr, viewProjectionMatrixData);
 
 		GraphicsUtils::AttachView(commandList, sm.get(), "raytracedProbesData", m_raytracedProbesData.GetView(frameIndex));
+		GraphicsUtils::AttachView(commandList, sm.get(), "probeRelocationData", m_probeRelocationData.GetView(frameIndex));
 		GraphicsUtils::AttachView(commandList, sm.get(), "irradianceTexture", probeIrradianceTexture);
 		GraphicsUtils::AttachView(commandList, sm.get(), "linearClampSampler", EngineSamplersProvider::GetLinearWrapSampler());
 
-		const uint32_t instanceCount = g_raytracedProbesData.gridX * g_raytracedProbesData.gridY * g_raytracedProbesData.gridZ;
+		const uint32_t instanceCount = ProbeCascades::GetProbesCount(g_raytracedProbesData);
 
 		commandList->DrawInstanced(
 			m_debugSphereProbeMesh->GetIndexCount(),
@@ -1,8 +1,13 @@
 #ifndef RAYTRACED_DDGI_DATA_CONTAINER_H
 #define RAYTRACED_DDGI_DATA_CONTAINER_H
 
+#include <vector>
+
 #include "CommonEngineStructs.h"
 #include "DataBuffer.h"
+#include "ProbeCascades.h"
+#include "ProbeClassifier.h"
+#include "ProbeUpdateScheduler.h"
 #include "RenderManager/ComputeDispatcher.h"
 #include "RenderManager/GBuffer.h"
 #include "ResourceManager/Mesh.h"
@@ -12,15 +17,15 @@
 
 namespace JoyEngine
 {
+	// Cascades are placed around the camera on the first frame, see ProbeCascades
 	inline RaytracedProbesData g_raytracedProbesData = {
-		.gridMin = jmath::vec3(-27.0f, 1.f, -12.f),
-		.cellSize = 4.1f,
-		.gridX = 14,
+		.gridX = 12,
 		.gridY = 8,
-		.gridZ = 6,
+		.gridZ = 12,
 		.useDDGI = 1,
 		.skyboxTextureIndex = 0,
 	};
+	inline constexpr float g_probeCascadeCellSizes[DDGI_CASCADES_COUNT] = {2.05f, 4.1f, 8.2f};
 
 	// common structs, buffers, shaders for both software and hardware DDGI systems
 	class RaytracedDDGIDataContainer
@@ -32,13 +37,24 @@ namespace JoyEngine
 			uint32_t frameCount,
 			DXGI_FORMAT mainColorFormat,
 			DXGI_FORMAT depthFormat);
-		void SetFrameData(uint32_t frameIndex, const ResourceView* skyboxTextureIndexDataView);
-		void UploadSceneData() const;
+		// Also moves cascades with the camera and schedules probes traced this frame,
+		// must be called when the previous use of frameIndex finished on gpu
+		void SetFrameData(uint32_t frameIndex, const ResourceView* skyboxTextureIndexDataView, const ProbeSchedulerView& schedulerView);
+		void UploadSceneData();
 		void GenerateProbeIrradiance(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex, const RenderTexture* shadedRenderTexture, const UAVGbuffer* gbuffer, const UAVTexture* probeIrradianceTexture, const UAVTexture* probeDepthTexture) const;
 
 		[[nodiscard]] ComputeDispatcher* GetDispatcher() const { return m_dispatcher.get(); }
 		[[nodiscard]] const std::set<SharedMaterial*>& GetSceneSharedMaterials() const { return m_sceneSharedMaterials; }
+		// Renderers in the order of triangles and meshes in raytracing buffers: static ones, then dynamic ones
+		[[nodiscard]] const std::vector<MeshRenderer*>& GetRaytracedMeshRenderers() const { return m_raytracedMeshRenderers; }
+		[[nodiscard]] uint32_t GetStaticMeshRenderersCount() const { return m_staticMeshRenderersCount; }
 		[[nodiscard]] ResourceView* GetProbesDataView(uint32_t frameIndex) const { return m_raytracedProbesData.GetView(frameIndex); }
+		// Probe indices traced this frame, raytraced texture column i holds rays of probe scheduledProbes[i]
+		[[nodiscard]] ResourceView* GetScheduledProbesView(uint32_t frameIndex) const { return m_scheduledProbesData.GetView(frameIndex); }
+		[[nodiscard]] uint32_t GetScheduledProbesCount() const noexcept { return static_cast<uint32_t>(m_probeScheduler->GetScheduledProbes().size()); }
+		[[nodiscard]] ProbeUpdateScheduler* GetProbeScheduler() const { return m_probeScheduler.get(); }
+		// Offsets of probes from the regular grid and their active flags, same indices as in shaders
+		[[nodiscard]] ResourceView* GetProbeRelocationView(uint32_t frameIndex) const { return m_probeRelocationData.GetView(frameIndex); }
 		[[nodiscard]] ResourceView* GetTrianglesDataView() const { return m_triangleDataBuffer->GetSRV(); }
 		[[nodiscard]] ResourceView* GetMeshDataView() const { return m_meshDataBuffer->GetSRV(); }
 		[[nodiscard]] Mesh* GetDebugSphereMesh() const { return m_debugSphereProbeMesh.Get(); }
@@ -48,12 +64,35 @@ namespace JoyEngine
 		static RaytracedProbesData* GetRaytracedProbesDataPtr() { return &g_raytracedProbesData; }
 
 	private:
+		void ClassifyProbes();
+		void FollowCamera(const jmath::vec3& position);
+
 		const std::set<SharedMaterial*>& m_sceneSharedMaterials;
+		std::vector<MeshRenderer*> m_raytracedMeshRenderers;
+		uint32_t m_staticMeshRenderersCount = 0;
+
 		std::unique_ptr<DataBuffer<TrianglePayload>> m_triangleDataBuffer;
 		std::unique_ptr<DataBuffer<MeshData>> m_meshDataBuffer;
 
 		DynamicCpuBuffer<RaytracedProbesData> m_raytracedProbesData;
 
+		const uint32_t m_frameCount;
+		uint64_t m_scheduledFramesCount = 0;
+		std::unique_ptr<ProbeUpdateScheduler> m_probeScheduler;
+		DynamicCpuBuffer<uint32_t, DDGI_MAX_PROBES_COUNT> m_scheduledProbesData;
+		std::unique_ptr<DataBuffer<float>> m_probeChangeBuffer; // mean relative irradiance change of the last probe update
+		std::unique_ptr<Buffer> m_probeChangeReadbackBuffer; // copy of m_probeChangeBuffer per frame
+
+		// Static scene triangles stay for probes entering the cascades
+		std::vector<jmath::vec3> m_staticTriangleVertices;
+		std::vector<jmath::vec3> m_staticTriangleNormals;
+		std::unique_ptr<ProbeClassifier> m_probeClassifier;
+		bool m_isCascadesPlaced = false;
+		std::vector<uint32_t> m_enteredProbes;
+		std::vector<uint8_t> m_isProbeReset; // entered probes drop their history on the next update
+		std::vector<ProbeRelocationData> m_probeRelocation;
+		DynamicCpuBuffer<ProbeRelocationData, DDGI_MAX_PROBES_COUNT> m_probeRelocationData;
+
 		std::unique_ptr<ComputeDispatcher> m_dispatcher;
 
 		std::unique_ptr<ComputePipeline> m_probeIrradiancePipeline;
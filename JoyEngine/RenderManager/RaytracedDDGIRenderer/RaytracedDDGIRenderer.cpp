@@ -21,6 +21,7 @@
 #include "GraphicsManager/GraphicsManager.h"
 #include "EngineDataProvider/EngineDataProvider.h"
 #include "ResourceManager/Material.h"
+#include "ResourceManager/ResourceManager.h"
 #include "SceneManager/GameObject.h"
 #include "SceneManager/Transform.h"
 
@@ -28,6 +29,8 @@
 #include "RenderManager/RaytracedDDGIRenderer/SW/SoftwareRaytracedDDGIController.h"
 
 #include "Utils/GraphicsUtils.h"
+#include "Utils/MemoryTracker.h"
+#include "Utils/Profiler.h"
 #include "Utils/TimeCounter.h"
 
 namespace JoyEngine
@@ -40,6 +43,7 @@ namespace JoyEngine
 
 	bool g_drawRaytracedImage = false;
 	bool g_drawProbes = true;
+	bool g_validateSoftwareBVH = false;
 	CurrentDDGIRaytracer g_currentRaytracer = CurrentDDGIRaytracer::Software;
 
 	RaytracedDDGIRenderer::RaytracedDDGIRenderer(HWND windowHandle): IRenderer(windowHandle)
@@ -133,6 +137,24 @@ namespace JoyEngine
 
 		m_gbuffer = std::make_unique<RTVGbuffer>(m_width, m_height);
 
+		// compile all the renderer shaders in parallel before subsystems create their pipelines
+		std::vector<ShaderPreloadArgs> shadersToPreload = Tonemapping::GetPreloadShaders();
+		shadersToPreload.insert(shadersToPreload.end(), {
+			{"shaders/ddgi/sw_raytracing/ProbeIrradiance.hlsl", JoyShaderTypeCompute},
+			{"shaders/ddgi/sw_raytracing/debugImageCompose.hlsl", JoyShaderTypeVertex | JoyShaderTypePixel},
+			{"shaders/ddgi/sw_raytracing/debugDrawProbes.hlsl", JoyShaderTypeVertex | JoyShaderTypePixel},
+			{"shaders/ddgi/sw_raytracing/LocalRadixSort.hlsl", JoyShaderTypeCompute},
+			{"shaders/ddgi/sw_raytracing/PreScan.hlsl", JoyShaderTypeCompute},
+			{"shaders/ddgi/sw_raytracing/BlockSum.hlsl", JoyShaderTypeCompute},
+			{"shaders/ddgi/sw_raytracing/GlobalScan.hlsl", JoyShaderTypeCompute},
+			{"shaders/ddgi/sw_raytracing/GlobalRadixSort.hlsl", JoyShaderTypeCompute},
+			{"shaders/ddgi/sw_raytracing/BVHTreeConstructor.hlsl", JoyShaderTypeCompute},
+			{"shaders/ddgi/sw_raytracing/BVHAABBMerger.hlsl", JoyShaderTypeCompute},
+			{"shaders/ddgi/sw_raytracing/Raytracing.hlsl", JoyShaderTypeCompute},
+			{"shaders/ddgi/sw_raytracing/gizmoAABBDrawer.hlsl", JoyShaderTypeVertex | JoyShaderTypePixel},
+			{"shaders/ddgi/hw_raytracing/Raytracing.hlsl", JoyShaderTypeRaytracing},
+		});
+		const auto preloadedShaders = ResourceManager::Get()->PreloadShaders(shadersToPreload);
 
 		m_tonemapping = std::make_unique<Tonemapping>(
 			this,
@@ -263,10 +285,39 @@ namespace JoyEngine
 
 		m_queue->WaitForFence(m_currentFrameIndex);
 
+		AbstractRaytracedDDGIController* controllers[] = {m_softwareRaytracedDDGI.get(), m_hardwareRaytracedDDGI.get()};
+		for (AbstractRaytracedDDGIController* controller : controllers)
+		{
+			controller->UpdateSceneData();
+			if (controller->IsSceneRebuildRequired())
+			{
+				// Tree topology changes, so no frame in flight should read it
+				m_queue->WaitQueueIdle();
+				controller->RebuildSceneData();
+			}
+		}
+
+		if (g_validateSoftwareBVH)
+		{
+			// Reads the tree back, so no frame in flight should write it
+			m_queue->WaitQueueIdle();
+			(void)static_cast<SoftwareRaytracedDDGIController*>(m_softwareRaytracedDDGI.get())->ValidateSceneData();
+			g_validateSoftwareBVH = false;
+		}
+
+		// After the idle wait, it signals and moves the fence value the frame is going to signal
+		GraphicsManager::Get()->GetReleaseQueue().BeginFrame(m_queue->GetCurrentFenceValue(), m_queue->GetCompletedFenceValue());
+		DescriptorManager::Get()->BeginFrame(m_queue->GetCurrentFenceValue(), m_queue->GetCompletedFenceValue());
+
 		m_queue->ResetForFrame(m_currentFrameIndex);
 
 		const auto commandList = m_queue->GetCommandList(m_currentFrameIndex);
 
+		for (AbstractRaytracedDDGIController* controller : controllers)
+		{
+			controller->RecordSceneDataUpload(commandList, m_currentFrameIndex);
+		}
+
 		const auto swapchainResource = m_swapchainRenderTargets[m_currentFrameIndex]->GetImageResource().Get();
 		const auto hdrRTVResource = m_mainColorRenderTarget->GetImageResource().Get();
 		const auto swapchainRTVHandle = m_swapchainRenderTargets[m_currentFrameIndex]->GetRTV()->GetCPUHandle();
@@ -355,7 +406,15 @@ namespace JoyEngine
 			m_gbuffer->BarrierColorToRead(commandList);
 		}
 
-		m_raytracingDataContainer->SetFrameData(m_currentFrameIndex, m_skybox->GetSkyboxTextureSrv());
+		const ProbeSchedulerView probeSchedulerView = {
+			.view = mainCameraViewMatrix,
+			.position = m_currentCamera->GetGameObject().GetTransform().GetPosition(),
+			.fovRadians = m_currentCamera->GetFovRadians(),
+			.aspect = GetAspect(),
+			.nearPlane = m_currentCamera->GetNear(),
+			.farPlane = m_currentCamera->GetFar()
+		};
+		m_raytracingDataContainer->SetFrameData(m_currentFrameIndex, m_skybox->GetSkyboxTextureSrv(), probeSchedulerView);
 
 		// Process raytracing
 		{
@@ -465,12 +524,16 @@ namespace JoyEngine
 
 		ASSERT_SUCC(commandList->Close());
 
-		m_queue->Execute(m_currentFrameIndex);
+		{
+			PROFILE_ZONE("Execute and present")
 
-		UINT presentFlags = GraphicsManager::Get()->GetTearingSupport() ? DXGI_PRESENT_ALLOW_TEARING : 0;
+			m_queue->Execute(m_currentFrameIndex);
 
-		// Present the frame.
-		ASSERT_SUCC(m_swapChain->Present(0, presentFlags));
+			UINT presentFlags = GraphicsManager::Get()->GetTearingSupport() ? DXGI_PRESENT_ALLOW_TEARING : 0;
+
+			// Present the frame.
+			ASSERT_SUCC(m_swapChain->Present(0, presentFlags));
+		}
 
 		m_trianglesCount = 0;
 	}
@@ -518,7 +581,7 @@ namespace JoyEngine
 				0, 0);
 		}
 		float windowPosY = 0;
-		float windowHeight = 150;
+		float windowHeight = 175;
 		ImGui::SetNextWindowPos({0, windowPosY});
 		ImGui::SetNextWindowSize({300, windowHeight});
 		{
@@ -531,11 +594,15 @@ namespace JoyEngine
 
 			ImGui::RadioButton("Software raytracing", reinterpret_cast<int*>(&g_currentRaytracer), 0);
 			ImGui::RadioButton("Hardware raytracing", reinterpret_cast<int*>(&g_currentRaytracer), 1);
+			if (ImGui::Button("Validate software BVH"))
+			{
+				g_validateSoftwareBVH = true;
+			}
 
 			ImGui::End();
 		}
 		windowPosY += windowHeight;
-		windowHeight = 75;
+		windowHeight = 140;
 		ImGui::SetNextWindowPos({0, windowPosY});
 		ImGui::SetNextWindowSize({300, windowHeight});
 		{
@@ -543,6 +610,15 @@ namespace JoyEngine
 			ImGui::Begin("DDGI:");
 			ImGui::Checkbox("Draw probes", &g_drawProbes);
 			ImGui::Checkbox("Use GI", &useDDGI);
+
+			ProbeUpdateScheduler* probeScheduler = m_raytracingDataContainer->GetProbeScheduler();
+			ProbeSchedulerSettings schedulerSettings = probeScheduler->GetSettings();
+			int probesPerFrame = static_cast<int>(schedulerSettings.raysBudget / DDGI_RAYS_COUNT);
+			ImGui::SliderInt("Probes per frame", &probesPerFrame, 1, static_cast<int>(probeScheduler->GetProbesCount()));
+			ImGui::SliderInt("Probe max age", reinterpret_cast<int*>(&schedulerSettings.maxAge), 1, 120);
+			schedulerSettings.raysBudget = static_cast<uint32_t>(probesPerFrame) * DDGI_RAYS_COUNT;
+			probeScheduler->SetSettings(schedulerSettings);
+			ImGui::Text("Scheduled probes %d", m_raytracingDataContainer->GetScheduledProbesCount());
 			ImGui::End();
 			m_raytracingDataContainer->GetRaytracedProbesDataPtr()->useDDGI = useDDGI ? 1 : 0;
 		}
@@ -560,6 +636,19 @@ namespace JoyEngine
 			ImGui::End();
 			m_tonemapping->UpdateConstants(m_currentFrameIndex);
 		}
+		windowPosY += windowHeight;
+		windowHeight = 250;
+		ImGui::SetNextWindowPos({0, windowPosY});
+		ImGui::SetNextWindowSize({450, windowHeight});
+		{
+			Profiler::Get()->DrawGui();
+		}
+		windowPosY += windowHeight;
+		ImGui::SetNextWindowPos({0, windowPosY});
+		ImGui::SetNextWindowSize({450, windowHeight});
+		{
+			MemoryTracker::Get()->DrawGui();
+		}
 
 		ImGui::Render();
 		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList);
@@ -661,6 +750,7 @@ namespace JoyEngine
 
 
 		GraphicsUtils::AttachView(commandList, sm->GetGraphicsPipeline(), "raytracedProbesData", m_raytracingDataContainer->GetProbesDataView(m_currentFrameIndex));
+		GraphicsUtils::AttachView(commandList, sm->GetGraphicsPipeline(), "probeRelocationData", m_raytracingDataContainer->GetProbeRelocationView(m_currentFrameIndex));
 		GraphicsUtils::AttachView(commandList, sm->GetGraphicsPipeline(), "linearBlackBorderSampler", EngineSamplersProvider::GetLinearBlackBorderSampler());
 
 		GraphicsUtils::AttachView(commandList, sm->GetGraphicsPipeline(), "probeIrradianceTexture", raytracer->GetProbeIrradianceTexture()->GetSRV());
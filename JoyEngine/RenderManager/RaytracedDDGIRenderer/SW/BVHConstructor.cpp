@@ -1,5 +1,8 @@
 #include "BVHConstructor.h"
 
+#include <algorithm>
+
+#include "BufferSorterPlan.h"
 #include "DescriptorManager/DescriptorManager.h"
 #include "RenderManager/ComputeDispatcher.h"
 #include "Utils/GraphicsUtils.h"
@@ -8,7 +11,8 @@
 namespace JoyEngine
 {
 	BVHConstructor::BVHConstructor(
-		DataBuffer<uint32_t>* sortedMortonCodes,
+		uint32_t trianglesCount,
+		DataBuffer<uint64_t>* sortedMortonCodes,
 		DataBuffer<uint32_t>* sortedTriangleIndices,
 		DataBuffer<AABB>* triangleAABB,
 		DataBuffer<InternalNode>* internalNodes,
@@ -18,6 +22,7 @@ namespace JoyEngine
 		ConstantCpuBuffer<BVHConstructorData>* bvhConstructionData
 	) :
 
+		m_trianglesCount(trianglesCount),
 		m_sortedMortonCodes(sortedMortonCodes),
 		m_sortedTriangleIndices(sortedTriangleIndices),
 		m_triangleAABB(triangleAABB),
@@ -28,7 +33,8 @@ namespace JoyEngine
 		m_dispatcher(dispatcher)
 
 	{
-		m_atomics = std::make_unique<DataBuffer<uint32_t>>(DATA_ARRAY_COUNT, 0);
+		// One counter per internal node
+		m_atomics = std::make_unique<DataBuffer<uint32_t>>(std::max(trianglesCount, 2u) - 1, 0);
 
 		// TREE CONSTRUCTOR
 		{
@@ -53,6 +59,8 @@ namespace JoyEngine
 	{
 		TIME_PERF("Scene BVH tree construction");
 
+		if (m_trianglesCount < 2) return;
+
 		const auto commandList = m_dispatcher->GetCommandList();
 
 		ID3D12DescriptorHeap* heaps[2]
@@ -75,7 +83,8 @@ namespace JoyEngine
 			GraphicsUtils::AttachView(commandList, m_bvhTreeConstructorPipeline.get(), "leafNodes", m_leafNodes->GetUAV());
 		}
 
-		commandList->Dispatch(BLOCK_SIZE, 1, 1);
+		// One thread per internal node
+		commandList->Dispatch(BufferSorterPlan::GetGroupsCount(m_trianglesCount - 1), 1, 1);
 		m_dispatcher->ExecuteAndWait();
 	}
 
@@ -83,6 +92,8 @@ namespace JoyEngine
 	{
 		TIME_PERF("Scene BVH merge");
 
+		if (m_trianglesCount < 2) return;
+
 		const auto commandList = m_dispatcher->GetCommandList();
 
 		ID3D12DescriptorHeap* heaps[2]
@@ -107,7 +118,8 @@ namespace JoyEngine
 			GraphicsUtils::AttachView(commandList, m_bvhMergerPipeline.get(), "BVHData", m_bvhData->GetUAV());
 		}
 
-		commandList->Dispatch(BLOCK_SIZE, 1, 1);
+		// One thread per leaf
+		commandList->Dispatch(BufferSorterPlan::GetGroupsCount(m_trianglesCount), 1, 1);
 		m_dispatcher->ExecuteAndWait();
 	}
 }
@@ -15,8 +15,10 @@ namespace JoyEngine
 	class BVHConstructor
 	{
 	public:
+		// Buffers hold trianglesCount elements, internal nodes and their bounds trianglesCount - 1
 		BVHConstructor(
-			DataBuffer<uint32_t>* sortedMortonCodes,
+			uint32_t trianglesCount,
+			DataBuffer<uint64_t>* sortedMortonCodes,
 			DataBuffer<uint32_t>* sortedTriangleIndices,
 			DataBuffer<AABB>* triangleAABB,
 			DataBuffer<InternalNode>* internalNodes,
@@ -29,7 +31,8 @@ namespace JoyEngine
 		void ConstructTree();
 		void ConstructBVH() const;
 	private:
-		DataBuffer<uint32_t>* m_sortedMortonCodes;
+		uint32_t m_trianglesCount;
+		DataBuffer<uint64_t>* m_sortedMortonCodes;
 		DataBuffer<uint32_t>* m_sortedTriangleIndices;
 		DataBuffer<AABB>* m_triangleAABB;
 		DataBuffer<InternalNode>* m_internalNodes;
@@ -0,0 +1,277 @@
+#include "BVHUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace JoyEngine
+{
+	namespace
+	{
+		float Dot(const jmath::vec3& a, const jmath::vec3& b)
+		{
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		jmath::vec3 Cross(const jmath::vec3& a, const jmath::vec3& b)
+		{
+			return jmath::vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+		}
+
+		jmath::vec3 Sub(const jmath::vec3& a, const jmath::vec3& b)
+		{
+			return jmath::vec3(a.x - b.x, a.y - b.y, a.z - b.z);
+		}
+	}
+
+	const AABB g_sceneAabb = {
+		.min = jmath::vec3(-50.0f, -30.0f, -50.0f),
+		.max = jmath::vec3(50.0f, 50.0f, 50.0f),
+	};
+
+	uint32_t ExpandBits(uint32_t v)
+	{
+		v = (v * 0x00010001) & 0xFF0000FF;
+		v = (v * 0x00000101) & 0x0F00F00F;
+		v = (v * 0x00000011) & 0xC30C30C3;
+		v = (v * 0x00000005) & 0x49249249;
+		return v;
+	}
+
+	uint32_t Morton3D(float x, float y, float z)
+	{
+		x = std::min(std::max(x * 1024.0f, 0.0f), 1023.0f);
+		y = std::min(std::max(y * 1024.0f, 0.0f), 1023.0f);
+		z = std::min(std::max(z * 1024.0f, 0.0f), 1023.0f);
+		uint32_t xx = ExpandBits(static_cast<uint32_t>(x));
+		uint32_t yy = ExpandBits(static_cast<uint32_t>(y));
+		uint32_t zz = ExpandBits(static_cast<uint32_t>(z));
+		return xx * 4 + yy * 2 + zz;
+	}
+
+	uint64_t ExpandBits64(uint32_t v)
+	{
+		uint64_t x = v & 0x1FFFFF;
+		x = (x | x << 32) & 0x001F00000000FFFF;
+		x = (x | x << 16) & 0x001F0000FF0000FF;
+		x = (x | x << 8) & 0x100F00F00F00F00F;
+		x = (x | x << 4) & 0x10C30C30C30C30C3;
+		x = (x | x << 2) & 0x1249249249249249;
+		return x;
+	}
+
+	uint64_t Morton3D64(float x, float y, float z)
+	{
+		constexpr float axisSize = static_cast<float>(1 << 21);
+		x = std::min(std::max(x * axisSize, 0.0f), axisSize - 1.0f);
+		y = std::min(std::max(y * axisSize, 0.0f), axisSize - 1.0f);
+		z = std::min(std::max(z * axisSize, 0.0f), axisSize - 1.0f);
+		const uint64_t xx = ExpandBits64(static_cast<uint32_t>(x));
+		const uint64_t yy = ExpandBits64(static_cast<uint32_t>(y));
+		const uint64_t zz = ExpandBits64(static_cast<uint32_t>(z));
+		return xx * 4 + yy * 2 + zz;
+	}
+
+	void GetCentroidAndAABB(jmath::vec3 a, jmath::vec3 b, jmath::vec3 c, jmath::vec3* centroid, AABB* aabb)
+	{
+		jmath::vec3 min = jmath::vec3(
+			std::min(std::min(a.x, b.x), c.x) - 0.001f,
+			std::min(std::min(a.y, b.y), c.y) - 0.001f,
+			std::min(std::min(a.z, b.z), c.z) - 0.001f
+		);
+		jmath::vec3 max = jmath::vec3(
+			std::max(std::max(a.x, b.x), c.x) + 0.001f,
+			std::max(std::max(a.y, b.y), c.y) + 0.001f,
+			std::max(std::max(a.z, b.z), c.z) + 0.001f
+		);
+
+		*centroid = (min + max) * 0.5f;
+		*aabb = {
+			.min = min,
+			.max = max,
+		};
+	}
+
+	jmath::vec3 NormalizeCentroid(jmath::vec3 centroid)
+	{
+		jmath::vec3 ret = centroid;
+		ret.x -= g_sceneAabb.min.x;
+		ret.y -= g_sceneAabb.min.y;
+		ret.z -= g_sceneAabb.min.z;
+		ret.x /= (g_sceneAabb.max.x - g_sceneAabb.min.x);
+		ret.y /= (g_sceneAabb.max.y - g_sceneAabb.min.y);
+		ret.z /= (g_sceneAabb.max.z - g_sceneAabb.min.z);
+		return ret;
+	}
+
+	// Same as MergeAABB in BVHAABBMerger.hlsl
+	AABB MergeAABB(const AABB& left, const AABB& right)
+	{
+		return {
+			.min = jmath::vec3(
+				std::min(left.min.x, right.min.x),
+				std::min(left.min.y, right.min.y),
+				std::min(left.min.z, right.min.z)),
+			._dummy0 = 0,
+			.max = jmath::vec3(
+				std::max(left.max.x, right.max.x),
+				std::max(left.max.y, right.max.y),
+				std::max(left.max.z, right.max.z)),
+			._dummy1 = 0,
+		};
+	}
+
+	void MakeKeysUnique(uint32_t* sortedKeys, uint32_t count)
+	{
+		if (count == 0) return;
+
+		uint32_t newCurrentValue = 0;
+		uint32_t oldCurrentValue = sortedKeys[0];
+		sortedKeys[0] = newCurrentValue;
+
+		for (uint32_t i = 1; i < count; i++)
+		{
+			newCurrentValue += std::max(sortedKeys[i] - oldCurrentValue, 1u);
+			oldCurrentValue = sortedKeys[i];
+			sortedKeys[i] = newCurrentValue;
+		}
+	}
+
+	void GenerateRandomTriangles(uint32_t count, float minSize, float maxSize, uint32_t seed, jmath::vec3* vertices, AABB* triangleAABB)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+		std::uniform_real_distribution<float> logSize(std::log(minSize), std::log(maxSize));
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const float size = std::exp(logSize(generator));
+			const jmath::vec3 a = jmath::vec3(
+				g_sceneAabb.min.x + unit(generator) * (g_sceneAabb.max.x - g_sceneAabb.min.x),
+				g_sceneAabb.min.y + unit(generator) * (g_sceneAabb.max.y - g_sceneAabb.min.y),
+				g_sceneAabb.min.z + unit(generator) * (g_sceneAabb.max.z - g_sceneAabb.min.z));
+			const jmath::vec3 b = jmath::vec3(a.x + offset(generator) * size, a.y + offset(generator) * size, a.z + offset(generator) * size);
+			const jmath::vec3 c = jmath::vec3(a.x + offset(generator) * size, a.y + offset(generator) * size, a.z + offset(generator) * size);
+
+			vertices[i * 3 + 0] = a;
+			vertices[i * 3 + 1] = b;
+			vertices[i * 3 + 2] = c;
+
+			jmath::vec3 centroid;
+			GetCentroidAndAABB(a, b, c, &centroid, &triangleAABB[i]);
+		}
+	}
+
+	// Same as RayBoxIntersection in Raytracing.hlsl
+	bool RayBoxIntersection(const AABB& b, const jmath::vec3& origin, const jmath::vec3& invDir)
+	{
+		const float t1x = (b.min.x - origin.x) * invDir.x;
+		const float t1y = (b.min.y - origin.y) * invDir.y;
+		const float t1z = (b.min.z - origin.z) * invDir.z;
+		const float t2x = (b.max.x - origin.x) * invDir.x;
+		const float t2y = (b.max.y - origin.y) * invDir.y;
+		const float t2z = (b.max.z - origin.z) * invDir.z;
+
+		const float tmin = std::max(std::max(std::min(t1x, t2x), std::min(t1y, t2y)), std::min(t1z, t2z));
+		const float tmax = std::min(std::min(std::max(t1x, t2x), std::max(t1y, t2y)), std::max(t1z, t2z));
+
+		return tmax > tmin && tmax > 0;
+	}
+
+	// Same as RayTriangleIntersection in Raytracing.hlsl
+	float RayTriangleIntersection(const jmath::vec3& origin, const jmath::vec3& dir, const jmath::vec3& v0, const jmath::vec3& v1, const jmath::vec3& v2)
+	{
+		const jmath::vec3 e1 = Sub(v1, v0);
+		const jmath::vec3 e2 = Sub(v2, v0);
+
+		const jmath::vec3 pvec = Cross(dir, e2);
+		const float det = Dot(e1, pvec);
+
+		if (det < 1e-8f && det > -1e-8f)
+		{
+		return std::numeric_limits<float>::max();
+		}
+
+		const float invDet = 1 / det;
+		const jmath::vec3 tvec = Sub(origin, v0);
+		const float u = Dot(tvec, pvec) * invDet;
+
+		const jmath::vec3 qvec = Cross(tvec, e1);
+		const float v = Dot(dir, qvec) * invDet;
+		if ((v < 0 || u + v > 1) || (u < 0 || u > 1))
+		{
+		return std::numeric_limits<float>::max();
+		}
+
+		return Dot(e2, qvec) * invDet;
+	}
+
+	float RayBoxEntry(const AABB& b, const jmath::vec3& origin, const jmath::vec3& invDir)
+	{
+		const float t1x = (b.min.x - origin.x) * invDir.x;
+		const float t1y = (b.min.y - origin.y) * invDir.y;
+		const float t1z = (b.min.z - origin.z) * invDir.z;
+		const float t2x = (b.max.x - origin.x) * invDir.x;
+		const float t2y = (b.max.y - origin.y) * invDir.y;
+		const float t2z = (b.max.z - origin.z) * invDir.z;
+
+		const float tmin = std::max(std::max(std::min(t1x, t2x), std::min(t1y, t2y)), std::min(t1z, t2z));
+		const float tmax = std::min(std::min(std::max(t1x, t2x), std::max(t1y, t2y)), std::max(t1z, t2z));
+
+		return tmax > tmin && tmax > 0 ? tmin : std::numeric_limits<float>::max();
+	}
+
+	uint32_t TraceClosestHit(
+		const jmath::vec3& origin,
+		const jmath::vec3& dir,
+		const jmath::vec3* triangleVertices,
+		const uint32_t* sortedTriangleIndices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		const AABB* bvhData,
+		float& distance)
+	{
+		const jmath::vec3 invDir = jmath::vec3(1 / dir.x, 1 / dir.y, 1 / dir.z);
+		uint32_t hitTriangle = MAX_UINT;
+
+		TraverseBVH(origin, invDir, distance, trianglesCount, sortedTriangleIndices, internalNodes, leafNodes, bvhData,
+		            [&](uint32_t triangleIndex)
+		            {
+			            if (RayBoxEntry(triangleAABB[triangleIndex], origin, invDir) >= distance) return;
+
+			            const float newDistance = RayTriangleIntersection(
+				            origin, dir,
+				            triangleVertices[triangleIndex * 3 + 0],
+				            triangleVertices[triangleIndex * 3 + 1],
+				            triangleVertices[triangleIndex * 3 + 2]);
+			            if (newDistance > 0 && newDistance < distance)
+			            {
+				            distance = newDistance;
+				            hitTriangle = triangleIndex;
+			            }
+		            });
+
+		return hitTriangle;
+	}
+
+	void GenerateRandomRays(uint32_t count, uint32_t seed, jmath::vec3* origins, jmath::vec3* directions)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::normal_distribution<float> normal(0.0f, 1.0f);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			origins[i] = jmath::vec3(
+				g_sceneAabb.min.x + unit(generator) * (g_sceneAabb.max.x - g_sceneAabb.min.x),
+				g_sceneAabb.min.y + unit(generator) * (g_sceneAabb.max.y - g_sceneAabb.min.y),
+				g_sceneAabb.min.z + unit(generator) * (g_sceneAabb.max.z - g_sceneAabb.min.z));
+
+			const jmath::vec3 dir = jmath::vec3(normal(generator), normal(generator), normal(generator));
+			directions[i] = dir * (1.0f / std::max(std::sqrt(Dot(dir, dir)), 1e-6f));
+		}
+	}
+}
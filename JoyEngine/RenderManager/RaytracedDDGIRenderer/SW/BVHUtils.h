@@ -0,0 +1,122 @@
+#ifndef BVH_UTILS_H
+#define BVH_UTILS_H
+
+#include <cstdint>
+
+#include "CommonEngineStructs.h"
+#include "CpuBVHBuilder.h"
+#include "Utils/Assert.h"
+
+namespace JoyEngine
+{
+	// Scene bounds used for morton codes quantization
+	extern const AABB g_sceneAabb;
+
+	uint32_t ExpandBits(uint32_t v);
+
+	uint32_t Morton3D(float x, float y, float z);
+
+	// Spreads 21 lower bits of v to every third bit of the result
+	uint64_t ExpandBits64(uint32_t v);
+
+	// MORTON_CODE_BITS code, 21 bits per axis. Used by the gpu LBVH path
+	uint64_t Morton3D64(float x, float y, float z);
+
+	void GetCentroidAndAABB(jmath::vec3 a, jmath::vec3 b, jmath::vec3 c, jmath::vec3* centroid, AABB* aabb);
+
+	jmath::vec3 NormalizeCentroid(jmath::vec3 centroid);
+
+	AABB MergeAABB(const AABB& left, const AABB& right);
+
+	// Sorted keys are remapped to strictly increasing values, so tree construction never sees equal codes
+	void MakeKeysUnique(uint32_t* sortedKeys, uint32_t count);
+
+	// Same as RayBoxIntersection in Raytracing.hlsl
+	bool RayBoxIntersection(const AABB& b, const jmath::vec3& origin, const jmath::vec3& invDir);
+
+	// Same as RayTriangleIntersection in Raytracing.hlsl, returns hit distance or max float
+	float RayTriangleIntersection(const jmath::vec3& origin, const jmath::vec3& dir, const jmath::vec3& v0, const jmath::vec3& v1, const jmath::vec3& v2);
+
+	// Entry distance of the ray into the box, max float when it misses. Same test as RayBoxIntersection
+	float RayBoxEntry(const AABB& b, const jmath::vec3& origin, const jmath::vec3& invDir);
+
+	// Stack traversal of Raytracing.hlsl, but nodes farther than the current closest hit are skipped.
+	// checkLeaf receives sorted leaf value and may decrease distance
+	template <typename CheckLeafFunc>
+	void TraverseBVH(
+		const jmath::vec3& origin,
+		const jmath::vec3& invDir,
+		const float& distance,
+		uint32_t leavesCount,
+		const uint32_t* sortedIndices,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		const AABB* bvhData,
+		CheckLeafFunc&& checkLeaf)
+	{
+		if (leavesCount == 0) return;
+		if (leavesCount == 1)
+		{
+			checkLeaf(sortedIndices[0]);
+			return;
+		}
+
+		uint32_t stack[CpuBVHBuilder::traversalStackSize];
+		uint32_t currentStackIndex = 0;
+		stack[currentStackIndex++] = 0;
+
+		while (currentStackIndex != 0)
+		{
+			const uint32_t index = stack[--currentStackIndex];
+
+			if (RayBoxEntry(bvhData[index], origin, invDir) >= distance)
+			{
+				continue;
+			}
+
+			const InternalNode& node = internalNodes[index];
+
+			if (node.leftNodeType == INTERNAL_NODE)
+			{
+				ASSERT(currentStackIndex < CpuBVHBuilder::traversalStackSize);
+				stack[currentStackIndex++] = node.leftNode;
+			}
+			else
+			{
+				checkLeaf(sortedIndices[leafNodes[node.leftNode].index]);
+			}
+
+			if (node.rightNodeType == INTERNAL_NODE)
+			{
+				ASSERT(currentStackIndex < CpuBVHBuilder::traversalStackSize);
+				stack[currentStackIndex++] = node.rightNode;
+			}
+			else
+			{
+				checkLeaf(sortedIndices[leafNodes[node.rightNode].index]);
+			}
+		}
+	}
+
+	// Closest hit in front of the origin, closer than distance on input. Unlike TraceRay of Raytracing.hlsl
+	// hits behind the origin are ignored and far nodes are skipped. Returns triangle index or MAX_UINT
+	uint32_t TraceClosestHit(
+		const jmath::vec3& origin,
+		const jmath::vec3& dir,
+		const jmath::vec3* triangleVertices,
+		const uint32_t* sortedTriangleIndices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		const AABB* bvhData,
+		float& distance);
+
+	// Random triangles inside the scene bounds for cpu benchmarks, triangle size is log-uniform in [minSize, maxSize].
+	// vertices size = count * 3
+	void GenerateRandomTriangles(uint32_t count, float minSize, float maxSize, uint32_t seed, jmath::vec3* vertices, AABB* triangleAABB);
+
+	// Unit length rays starting inside the scene bounds, uniformly distributed over the sphere of directions
+	void GenerateRandomRays(uint32_t count, uint32_t seed, jmath::vec3* origins, jmath::vec3* directions);
+}
+#endif // BVH_UTILS_H
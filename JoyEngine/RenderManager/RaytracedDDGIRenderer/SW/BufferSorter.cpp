@@ -9,12 +9,14 @@
 
 namespace JoyEngine
 {
-	BufferSorter::BufferSorter(int dataLength, DataBuffer<uint32_t>* keys, DataBuffer<uint32_t>* values, ComputeDispatcher* dispatcher):
-		m_dataLength(dataLength),
+	BufferSorter::BufferSorter(uint32_t dataLength, DataBuffer<uint64_t>* keys, DataBuffer<uint32_t>* values, ComputeDispatcher* dispatcher, uint32_t keyBitsCount):
+		m_plan(dataLength, keyBitsCount),
 		m_keys(keys),
 		m_values(values),
 		m_dispatcher(dispatcher)
 	{
+		ASSERT(keyBitsCount > 0 && keyBitsCount <= sizeof(uint64_t) * 8);
+
 		{
 			// LOCAL RADIX SORT
 			{
@@ -61,20 +63,42 @@ namespace JoyEngine
 			}
 		}
 
-		m_sortedBlocksKeysData = std::make_unique<DataBuffer<uint32_t>>(DATA_ARRAY_COUNT);
-		m_sortedBlocksValuesData = std::make_unique<DataBuffer<uint32_t>>(DATA_ARRAY_COUNT);
-		m_offsetsData = std::make_unique<DataBuffer<uint32_t>>(BUCKET_SIZE * BLOCK_SIZE);
-		m_sizesData = std::make_unique<DataBuffer<uint32_t>>(BUCKET_SIZE * BLOCK_SIZE);
-		m_sizesPrefixSumData = std::make_unique<DataBuffer<uint32_t>>(BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE));
+		if (m_plan.blocksCount == 0) return;
+
+		m_sortedBlocksKeysData = std::make_unique<DataBuffer<uint64_t>>(m_plan.GetPaddedLength());
+		m_sortedBlocksValuesData = std::make_unique<DataBuffer<uint32_t>>(m_plan.GetPaddedLength());
+		m_offsetsData = std::make_unique<DataBuffer<uint32_t>>(BUCKET_SIZE * m_plan.blocksCount);
+		m_sizesData = std::make_unique<DataBuffer<uint32_t>>(m_plan.scanLevels[0]);
+
+		for (uint32_t level = 0; level < m_plan.scanLevels.size(); level++)
+		{
+			if (level > 0)
+			{
+				m_blockSumsData.push_back(std::make_unique<DataBuffer<uint32_t>>(m_plan.scanLevels[level]));
+			}
+			m_scanData.push_back(std::make_unique<ConstantCpuBuffer<BufferScanData>>());
+			m_scanData.back()->SetData({.elementsCount = m_plan.scanLevels[level]});
+		}
+
+	}
+
+	DataBuffer<uint32_t>* BufferSorter::GetScanLevelData(uint32_t level) const
+	{
+		return level == 0 ? m_sizesData.get() : m_blockSumsData[level - 1].get();
 	}
 
 	void BufferSorter::Sort()
 	{
 		TIME_PERF("ComputeBuffer sorter")
 
-		for (uint32_t bitOffset = 0; bitOffset < sizeof(uint32_t) * 8; bitOffset += RADIX)
+		if (m_plan.blocksCount == 0) return;
+
+		const uint32_t topScanLevel = static_cast<uint32_t>(m_plan.scanLevels.size() - 1);
+
+		// Every pass is a separate stable sort by the next RADIX bits, high word passes go after the low word ones
+		for (uint32_t pass = 0; pass < m_plan.passesCount; pass++)
 		{
-			m_data.SetData({.bitOffset = bitOffset});
+			m_data.SetData({.bitOffset = pass * RADIX, .dataLength = m_plan.dataLength, .blocksCount = m_plan.blocksCount});
 			const auto commandList = m_dispatcher->GetCommandList();
 
 			ID3D12DescriptorHeap* heaps[2]
@@ -99,7 +123,7 @@ namespace JoyEngine
 				GraphicsUtils::AttachView(commandList, m_localRaidxSortPipeline.get(), "offsetsData", m_offsetsData->GetUAV());
 				GraphicsUtils::AttachView(commandList, m_localRaidxSortPipeline.get(), "sizesData", m_sizesData->GetUAV());
 
-				commandList->Dispatch(BLOCK_SIZE, 1, 1);
+				commandList->Dispatch(m_plan.blocksCount, 1, 1);
 			}
 
 			GraphicsUtils::UAVBarrier(commandList, m_keys->GetBuffer()->GetBufferResource().Get());
@@ -109,48 +133,52 @@ namespace JoyEngine
 			GraphicsUtils::UAVBarrier(commandList, m_offsetsData->GetBuffer()->GetBufferResource().Get());
 			GraphicsUtils::UAVBarrier(commandList, m_sizesData->GetBuffer()->GetBufferResource().Get());
 
-			// Pre scan 
+			// Pre scan of every level but the top one, group sums go to the next level
+			for (uint32_t level = 0; level < topScanLevel; level++)
 			{
 				commandList->SetComputeRootSignature(m_preScanPipeline->GetRootSignature().Get());
 				commandList->SetPipelineState(m_preScanPipeline->GetPipelineObject().Get());
 
 
-				GraphicsUtils::AttachView(commandList, m_preScanPipeline.get(), "data", m_sizesData->GetUAV());
-				GraphicsUtils::AttachView(commandList, m_preScanPipeline.get(), "blockSumsData", m_sizesPrefixSumData->GetUAV());
+				GraphicsUtils::AttachView(commandList, m_preScanPipeline.get(), "scanData", m_scanData[level]->GetView());
+				GraphicsUtils::AttachView(commandList, m_preScanPipeline.get(), "data", GetScanLevelData(level)->GetUAV());
+				GraphicsUtils::AttachView(commandList, m_preScanPipeline.get(), "blockSumsData", GetScanLevelData(level + 1)->GetUAV());
 
-				commandList->Dispatch(BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE), 1, 1);
-			}
+				commandList->Dispatch(BufferSorterPlan::GetGroupsCount(m_plan.scanLevels[level]), 1, 1);
 
-			GraphicsUtils::UAVBarrier(commandList, m_sizesData->GetBuffer()->GetBufferResource().Get());
-			GraphicsUtils::UAVBarrier(commandList, m_sizesPrefixSumData->GetBuffer()->GetBufferResource().Get());
+				GraphicsUtils::UAVBarrier(commandList, GetScanLevelData(level)->GetBuffer()->GetBufferResource().Get());
+				GraphicsUtils::UAVBarrier(commandList, GetScanLevelData(level + 1)->GetBuffer()->GetBufferResource().Get());
+			}
 
-			// Block sum
+			// Block sum of the top level fits one group
 			{
 				commandList->SetComputeRootSignature(m_blockSumSortPipeline->GetRootSignature().Get());
 				commandList->SetPipelineState(m_blockSumSortPipeline->GetPipelineObject().Get());
 
 
-				GraphicsUtils::AttachView(commandList, m_blockSumSortPipeline.get(), "blockSumsData", m_sizesPrefixSumData->GetUAV());
+				GraphicsUtils::AttachView(commandList, m_blockSumSortPipeline.get(), "scanData", m_scanData[topScanLevel]->GetView());
+				GraphicsUtils::AttachView(commandList, m_blockSumSortPipeline.get(), "blockSumsData", GetScanLevelData(topScanLevel)->GetUAV());
 
 				commandList->Dispatch(1, 1, 1);
 			}
 
-			GraphicsUtils::UAVBarrier(commandList, m_sizesPrefixSumData->GetBuffer()->GetBufferResource().Get());
+			GraphicsUtils::UAVBarrier(commandList, GetScanLevelData(topScanLevel)->GetBuffer()->GetBufferResource().Get());
 
-			// Global scan
+			// Global scan adds scanned sums back, from the top level down
+			for (uint32_t level = topScanLevel; level-- > 0;)
 			{
 				commandList->SetComputeRootSignature(m_globalScanPipeline->GetRootSignature().Get());
 				commandList->SetPipelineState(m_globalScanPipeline->GetPipelineObject().Get());
 
 
-				GraphicsUtils::AttachView(commandList, m_globalScanPipeline.get(), "data", m_sizesData->GetUAV());
-				GraphicsUtils::AttachView(commandList, m_globalScanPipeline.get(), "blockSumsData", m_sizesPrefixSumData->GetUAV());
+				GraphicsUtils::AttachView(commandList, m_globalScanPipeline.get(), "scanData", m_scanData[level]->GetView());
+				GraphicsUtils::AttachView(commandList, m_globalScanPipeline.get(), "data", GetScanLevelData(level)->GetUAV());
+				GraphicsUtils::AttachView(commandList, m_globalScanPipeline.get(), "blockSumsData", GetScanLevelData(level + 1)->GetUAV());
 
-				commandList->Dispatch(BLOCK_SIZE / (THREADS_PER_BLOCK / BUCKET_SIZE), 1, 1);
-			}
+				commandList->Dispatch(BufferSorterPlan::GetGroupsCount(m_plan.scanLevels[level]), 1, 1);
 
-			GraphicsUtils::UAVBarrier(commandList, m_sizesData->GetBuffer()->GetBufferResource().Get());
-			GraphicsUtils::UAVBarrier(commandList, m_sizesPrefixSumData->GetBuffer()->GetBufferResource().Get());
+				GraphicsUtils::UAVBarrier(commandList, GetScanLevelData(level)->GetBuffer()->GetBufferResource().Get());
+			}
 
 			// Global radix sort
 			{
@@ -167,7 +195,7 @@ namespace JoyEngine
 				GraphicsUtils::AttachView(commandList, m_globalRadixSortPipeline.get(), "sortedKeysData", m_keys->GetUAV());
 				GraphicsUtils::AttachView(commandList, m_globalRadixSortPipeline.get(), "sortedValuesData", m_values->GetUAV());
 
-				commandList->Dispatch(BLOCK_SIZE, 1, 1);
+				commandList->Dispatch(m_plan.blocksCount, 1, 1);
 			}
 			m_dispatcher->ExecuteAndWait();
 		}
@@ -177,10 +205,10 @@ namespace JoyEngine
 		//Logger::Log("\n\n");
 		//Logger::LogUintArray(m_keys->GetLocalData(), m_keys->GetSize(), 1030);
 
-		for (int i = 0; i < BLOCK_SIZE * THREADS_PER_BLOCK - 1; i++)
+		for (uint32_t i = 0; i + 1 < m_plan.dataLength; i++)
 		{
-			uint32_t first = m_keys->GetLocalData()[i];
-			uint32_t second = m_keys->GetLocalData()[i + 1];
+			uint64_t first = m_keys->GetLocalData()[i];
+			uint64_t second = m_keys->GetLocalData()[i + 1];
 			ASSERT(first <= second);
 		}
 #endif
@@ -1,6 +1,9 @@
 #ifndef BUFFER_SORTER_H
 #define BUFFER_SORTER_H
 
+#include <vector>
+
+#include "BufferSorterPlan.h"
 #include "CommonEngineStructs.h"
 #include "RenderManager/RaytracedDDGIRenderer/DataBuffer.h"
 #include "ResourceManager/Buffers/ConstantCpuBuffer.h"
@@ -10,15 +13,20 @@ namespace JoyEngine
 {
 	class ComputeDispatcher;
 
+	// Sorts 64 bit keys with uint values, RADIX bits per pass. Only the lower keyBitsCount bits are sorted.
+	// Dispatches and temporary buffers follow BufferSorterPlan of dataLength, keys and values need dataLength elements
 	class BufferSorter
 	{
 	public:
 		BufferSorter() = delete;
-		explicit BufferSorter(int dataLength, DataBuffer<uint32_t>* keys, DataBuffer<uint32_t>* values, ComputeDispatcher* dispatcher);
+		explicit BufferSorter(uint32_t dataLength, DataBuffer<uint64_t>* keys, DataBuffer<uint32_t>* values, ComputeDispatcher* dispatcher, uint32_t keyBitsCount = MORTON_CODE_BITS);
 		void Sort();
 	private:
-		uint32_t m_dataLength;
-		DataBuffer<uint32_t>* m_keys;
+		// Level 0 is bucket sizes, the rest are block sums
+		[[nodiscard]] DataBuffer<uint32_t>* GetScanLevelData(uint32_t level) const;
+
+		const BufferSorterPlan m_plan;
+		DataBuffer<uint64_t>* m_keys;
 		DataBuffer<uint32_t>* m_values;
 
 		std::unique_ptr<ComputePipeline> m_localRaidxSortPipeline;
@@ -27,13 +35,14 @@ namespace JoyEngine
 		std::unique_ptr<ComputePipeline> m_globalScanPipeline;
 		std::unique_ptr<ComputePipeline> m_globalRadixSortPipeline;
 
-		std::unique_ptr<DataBuffer<uint32_t>> m_sortedBlocksKeysData;
+		std::unique_ptr<DataBuffer<uint64_t>> m_sortedBlocksKeysData;
 		std::unique_ptr<DataBuffer<uint32_t>> m_sortedBlocksValuesData;
 		std::unique_ptr<DataBuffer<uint32_t>> m_offsetsData;
 		std::unique_ptr<DataBuffer<uint32_t>> m_sizesData;
-		std::unique_ptr<DataBuffer<uint32_t>> m_sizesPrefixSumData;
+		std::vector<std::unique_ptr<DataBuffer<uint32_t>>> m_blockSumsData;
 
 		ConstantCpuBuffer<BufferSorterData> m_data;
+		std::vector<std::unique_ptr<ConstantCpuBuffer<BufferScanData>>> m_scanData; // per scan level
 
 		ComputeDispatcher* m_dispatcher = nullptr;
 	};
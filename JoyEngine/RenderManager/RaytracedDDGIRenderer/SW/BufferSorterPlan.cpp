@@ -0,0 +1,241 @@
+#include "BufferSorterPlan.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		constexpr uint64_t paddingKey = ~0ull;
+
+		uint32_t GetDigit(uint64_t key, uint32_t bitOffset)
+		{
+			return static_cast<uint32_t>(key >> bitOffset) & (BUCKET_SIZE - 1);
+		}
+
+		// Exclusive scan of one group as in PreScan.hlsl and BlockSum.hlsl, elements past count read as 0. Returns group total
+		uint32_t ScanGroup(uint32_t* elements, uint32_t count)
+		{
+			uint32_t sum = 0;
+			for (uint32_t i = 0; i < std::min<uint32_t>(count, THREADS_PER_BLOCK); i++)
+			{
+				const uint32_t element = elements[i];
+				elements[i] = sum;
+				sum += element;
+			}
+			return sum;
+		}
+	}
+
+	BufferSorterPlan::BufferSorterPlan(uint32_t dataLength, uint32_t keyBitsCount) :
+		dataLength(dataLength),
+		blocksCount(GetGroupsCount(dataLength)),
+		passesCount((keyBitsCount + RADIX - 1) / RADIX)
+	{
+		if (blocksCount == 0) return;
+
+		scanLevels.push_back(blocksCount * BUCKET_SIZE);
+		while (scanLevels.back() > THREADS_PER_BLOCK)
+		{
+			scanLevels.push_back(GetGroupsCount(scanLevels.back()));
+		}
+	}
+
+	uint32_t BufferSorterPlan::GetDispatchesPerPass() const noexcept
+	{
+		if (blocksCount == 0) return 0;
+		return 3 + 2 * static_cast<uint32_t>(scanLevels.size() - 1);
+	}
+
+	void BufferSorterPlan::SimulateScan(std::vector<std::vector<uint32_t>>& levels) const
+	{
+		levels.resize(scanLevels.size());
+		for (size_t level = 1; level < scanLevels.size(); level++)
+		{
+			levels[level].assign(scanLevels[level], 0);
+		}
+
+		// PreScan of every level but the last one writes group totals to the next level
+		for (size_t level = 0; level + 1 < scanLevels.size(); level++)
+		{
+			for (uint32_t group = 0; group < GetGroupsCount(scanLevels[level]); group++)
+			{
+				const uint32_t first = group * THREADS_PER_BLOCK;
+				levels[level + 1][group] = ScanGroup(levels[level].data() + first, scanLevels[level] - first);
+			}
+		}
+
+		// BlockSum of the last level in one group
+		ScanGroup(levels.back().data(), scanLevels.back());
+
+		// GlobalScan adds scanned sums back, from the top level down
+		for (size_t level = scanLevels.size() - 1; level-- > 0;)
+		{
+			for (uint32_t i = 0; i < scanLevels[level]; i++)
+			{
+				levels[level][i] += levels[level + 1][i / THREADS_PER_BLOCK];
+			}
+		}
+	}
+
+	void BufferSorterPlan::Simulate(uint64_t* keys, uint32_t* values) const
+	{
+		if (blocksCount == 0) return;
+
+		std::vector<uint64_t> sortedBlocksKeys(GetPaddedLength());
+		std::vector<uint32_t> sortedBlocksValues(GetPaddedLength());
+		std::vector<uint32_t> offsets(blocksCount * BUCKET_SIZE);
+		std::vector<std::vector<uint32_t>> sizes(1);
+
+		std::vector<uint64_t> tileKeys(THREADS_PER_BLOCK);
+		std::vector<uint32_t> tileValues(THREADS_PER_BLOCK);
+		std::vector<uint64_t> splitKeys(THREADS_PER_BLOCK);
+		std::vector<uint32_t> splitValues(THREADS_PER_BLOCK);
+
+		for (uint32_t pass = 0; pass < passesCount; pass++)
+		{
+			const uint32_t bitOffset = pass * RADIX;
+			sizes[0].assign(scanLevels[0], 0);
+
+			// LocalRadixSort: RADIX stable 1-bit splits of the block, then bucket offsets inside the block and bucket sizes
+			for (uint32_t group = 0; group < blocksCount; group++)
+			{
+				for (uint32_t thread = 0; thread < THREADS_PER_BLOCK; thread++)
+				{
+					const uint32_t index = group * THREADS_PER_BLOCK + thread;
+					tileKeys[thread] = index < dataLength ? keys[index] : paddingKey;
+					tileValues[thread] = index < dataLength ? values[index] : MAX_UINT;
+				}
+
+				for (uint32_t shift = bitOffset; shift < bitOffset + RADIX; shift++)
+				{
+					uint32_t falseTotal = 0;
+					for (uint32_t thread = 0; thread < THREADS_PER_BLOCK; thread++)
+					{
+						falseTotal += ((tileKeys[thread] >> shift) & 1) == 0;
+					}
+
+					uint32_t trueBefore = 0;
+					for (uint32_t thread = 0; thread < THREADS_PER_BLOCK; thread++)
+					{
+						const bool pred = (tileKeys[thread] >> shift) & 1;
+						const uint32_t dst = pred ? trueBefore + falseTotal : thread - trueBefore;
+						splitKeys[dst] = tileKeys[thread];
+						splitValues[dst] = tileValues[thread];
+						trueBefore += pred;
+					}
+					std::swap(tileKeys, splitKeys);
+					std::swap(tileValues, splitValues);
+				}
+
+				for (uint32_t thread = 0; thread < THREADS_PER_BLOCK; thread++)
+				{
+					sortedBlocksKeys[group * THREADS_PER_BLOCK + thread] = tileKeys[thread];
+					sortedBlocksValues[group * THREADS_PER_BLOCK + thread] = tileValues[thread];
+
+					const uint32_t radix = GetDigit(tileKeys[thread], bitOffset);
+					if (thread == 0 || GetDigit(tileKeys[thread - 1], bitOffset) != radix)
+					{
+						offsets[group * BUCKET_SIZE + radix] = thread;
+					}
+					sizes[0][radix * blocksCount + group]++;
+				}
+			}
+
+			SimulateScan(sizes);
+
+			// GlobalRadixSort: scatter, padding keys are the largest and land past dataLength
+			for (uint32_t group = 0; group < blocksCount; group++)
+			{
+				for (uint32_t thread = 0; thread < THREADS_PER_BLOCK; thread++)
+				{
+					const uint64_t key = sortedBlocksKeys[group * THREADS_PER_BLOCK + thread];
+					const uint32_t radix = GetDigit(key, bitOffset);
+					const uint32_t indexOutput = sizes[0][radix * blocksCount + group] + thread - offsets[group * BUCKET_SIZE + radix];
+					if (indexOutput < dataLength)
+					{
+						keys[indexOutput] = key;
+						values[indexOutput] = sortedBlocksValues[group * THREADS_PER_BLOCK + thread];
+					}
+				}
+			}
+		}
+	}
+
+	bool BufferSorterPlan::Test(uint32_t maxSortLength, uint32_t maxScanBlocksCount)
+	{
+		bool isSuccess = true;
+
+		// Scan alone over block counts that need one, two and three levels
+		for (const uint32_t blocks : {1u, 2u, 4u, 5u, 4096u, 4097u, maxScanBlocksCount})
+		{
+			const BufferSorterPlan plan(blocks * THREADS_PER_BLOCK);
+
+			std::mt19937 generator(blocks);
+			std::vector<std::vector<uint32_t>> levels(1, std::vector<uint32_t>(plan.scanLevels[0]));
+			for (uint32_t& element : levels[0])
+			{
+				element = generator() % (THREADS_PER_BLOCK + 1);
+			}
+			std::vector<uint32_t> expected(levels[0].size());
+			std::exclusive_scan(levels[0].begin(), levels[0].end(), expected.begin(), 0u);
+
+			plan.SimulateScan(levels);
+			if (levels[0] != expected)
+			{
+				Logger::LogFormat("Buffer sorter plan: scan of %u blocks in %u levels is wrong\n", blocks, static_cast<uint32_t>(plan.scanLevels.size()));
+				isSuccess = false;
+			}
+		}
+
+		// Full sorts around block boundaries. Keys are 63 bit with many duplicates to check stability
+		std::vector<uint32_t> lengths = {0, 1, 2, 1000, THREADS_PER_BLOCK - 1, THREADS_PER_BLOCK, THREADS_PER_BLOCK + 1, 3 * THREADS_PER_BLOCK + 17};
+		for (uint32_t length = 4 * THREADS_PER_BLOCK + 1; length <= maxSortLength; length = length * 8 - 7)
+		{
+			lengths.push_back(length);
+		}
+		lengths.push_back(maxSortLength);
+
+		for (const uint32_t length : lengths)
+		{
+			const BufferSorterPlan plan(length, MORTON_CODE_BITS);
+
+			std::mt19937_64 generator(length);
+			std::vector<uint64_t> keys(length);
+			std::vector<uint32_t> values(length);
+			std::vector<std::pair<uint64_t, uint32_t>> expected(length);
+			for (uint32_t i = 0; i < length; i++)
+			{
+				// Few distinct values in the lowest and the highest passes, so equal keys are frequent
+				keys[i] = ((generator() % 4096) << (MORTON_CODE_BITS - 12)) | (generator() % 3);
+				values[i] = i;
+				expected[i] = {keys[i], i};
+			}
+			std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+			plan.Simulate(keys.data(), values.data());
+
+			bool isEqual = true;
+			for (uint32_t i = 0; i < length; i++)
+			{
+				isEqual &= keys[i] == expected[i].first && values[i] == expected[i].second;
+			}
+
+			Logger::LogFormat("Buffer sorter plan %u keys: %u blocks, %u passes, scan levels %u (top %u), %u dispatches, %s\n",
+			                  length,
+			                  plan.blocksCount,
+			                  plan.passesCount,
+			                  static_cast<uint32_t>(plan.scanLevels.size()),
+			                  plan.scanLevels.empty() ? 0 : plan.scanLevels.back(),
+			                  plan.GetDispatchesPerPass() * plan.passesCount,
+			                  isEqual ? "sorted" : "NOT SORTED");
+			isSuccess &= isEqual;
+		}
+
+		return isSuccess;
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef BUFFER_SORTER_PLAN_H
+#define BUFFER_SORTER_PLAN_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace JoyEngine
+{
+	// Group counts and buffer sizes of all BufferSorter dispatches for the real data length.
+	// Keys are sorted in blocks of THREADS_PER_BLOCK, the last block is padded with all-ones keys inside the shaders.
+	// Bucket sizes of all blocks are scanned level by level: every level holds sums of THREADS_PER_BLOCK
+	// elements of the previous one, until a level fits into one group.
+	// Has no gpu dependencies, so the plan and a cpu run of the same kernels can be checked anywhere
+	struct BufferSorterPlan
+	{
+		uint32_t dataLength = 0;
+		uint32_t blocksCount = 0; // groups of LocalRadixSort and GlobalRadixSort
+		uint32_t passesCount = 0; // RADIX bits each
+		std::vector<uint32_t> scanLevels; // element counts, level 0 is BUCKET_SIZE sizes of every block
+
+		BufferSorterPlan() = default;
+		explicit BufferSorterPlan(uint32_t dataLength, uint32_t keyBitsCount = MORTON_CODE_BITS);
+
+		[[nodiscard]] static uint32_t GetGroupsCount(uint32_t elementsCount)
+		{
+			return (elementsCount + THREADS_PER_BLOCK - 1) / THREADS_PER_BLOCK;
+		}
+
+		[[nodiscard]] uint32_t GetPaddedLength() const noexcept { return blocksCount * THREADS_PER_BLOCK; }
+
+		// Count of group dispatches of one pass: local sort, PreScan of every level but the last one,
+		// BlockSum of the last level, GlobalScan of every level but the last one, global scatter
+		[[nodiscard]] uint32_t GetDispatchesPerPass() const noexcept;
+
+		// Runs every dispatch of BufferSorter::Sort group by group on cpu, thread logic follows the shaders
+		void Simulate(uint64_t* keys, uint32_t* values) const;
+
+		// Multi-level exclusive scan of PreScan, BlockSum and GlobalScan over level 0 of the plan.
+		// levels[0] is scanned in place, the rest are filled with block sums
+		void SimulateScan(std::vector<std::vector<uint32_t>>& levels) const;
+
+		// Plans and simulated sorts for lengths around block and scan level boundaries, checked against std::stable_sort.
+		// Scans are checked up to maxScanBlocksCount blocks, which needs three scan levels. Logs failures
+		static bool Test(uint32_t maxSortLength = (1 << 20) + 1, uint32_t maxScanBlocksCount = (1 << 16) + 1);
+	};
+}
+#endif // BUFFER_SORTER_PLAN_H
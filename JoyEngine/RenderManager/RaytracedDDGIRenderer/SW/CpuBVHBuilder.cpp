@@ -0,0 +1,862 @@
+#include "CpuBVHBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "BVHUtils.h"
+#include "CpuRadixSorter.h"
+#include "Benchmarks/BenchmarkSuite.h"
+#include "ThreadManager/ParallelFor.h"
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		// Common prefix of unique 32 bit codes, the previous version of delta() in BVHTreeConstructor.hlsl
+		int Delta(const uint32_t* codes, int64_t x, int64_t y, int64_t numObjects)
+		{
+			if (x >= 0 && x <= numObjects - 1 && y >= 0 && y <= numObjects - 1)
+			{
+				return std::countl_zero(codes[x] ^ codes[y]);
+			}
+			return -1;
+		}
+
+		// Same as delta() in BVHTreeConstructor.hlsl. clz of 0 is 32 here and in hlsl.
+		// Equal codes compare their indices, so the prefix continues into the index bits
+		int Delta(const uint64_t* codes, int64_t x, int64_t y, int64_t numObjects)
+		{
+			if (x >= 0 && x <= numObjects - 1 && y >= 0 && y <= numObjects - 1)
+			{
+				const uint64_t codeDifference = codes[x] ^ codes[y];
+				return codeDifference != 0
+					       ? std::countl_zero(codeDifference)
+					       : 64 + std::countl_zero(static_cast<uint32_t>(x ^ y));
+			}
+			return -1;
+		}
+
+		template <typename CodeType>
+		void DetermineRange(const CodeType* codes, int64_t numObjects, int64_t idx, int64_t& first, int64_t& last)
+		{
+			const int deltaNext = Delta(codes, idx, idx + 1, numObjects);
+			const int deltaPrev = Delta(codes, idx, idx - 1, numObjects);
+			const int64_t d = deltaNext > deltaPrev ? 1 : (deltaNext < deltaPrev ? -1 : 0);
+			const int dmin = Delta(codes, idx, idx - d, numObjects);
+
+			int64_t lmax = 2;
+			while (Delta(codes, idx, idx + lmax * d, numObjects) > dmin)
+			{
+				lmax *= 2;
+			}
+
+			int64_t l = 0;
+			for (int64_t t = lmax / 2; t >= 1; t /= 2)
+			{
+				if (Delta(codes, idx, idx + (l + t) * d, numObjects) > dmin)
+				{
+					l += t;
+				}
+			}
+
+			const int64_t j = idx + l * d;
+			first = std::min(idx, j);
+			last = std::max(idx, j);
+		}
+
+		int64_t FindSplit(const uint32_t* codes, int64_t first, int64_t last)
+		{
+			const uint32_t firstCode = codes[first];
+			const uint32_t lastCode = codes[last];
+
+			if (firstCode == lastCode)
+			{
+				return (first + last) >> 1;
+			}
+
+			const int commonPrefix = std::countl_zero(firstCode ^ lastCode);
+
+			int64_t split = first;
+			int64_t step = last - first;
+
+			do
+			{
+				step = (step + 1) >> 1;
+				const int64_t newSplit = split + step;
+
+				if (newSplit < last)
+				{
+					const int splitPrefix = std::countl_zero(firstCode ^ codes[newSplit]);
+					if (splitPrefix > commonPrefix)
+					{
+						split = newSplit;
+					}
+				}
+			}
+			while (step > 1);
+
+			return split;
+		}
+
+		// Binary search of the last object sharing more than the common prefix of the range with the first one.
+		// Unlike the 32 bit version it needs no special case for equal codes
+		int64_t FindSplit(const uint64_t* codes, int64_t first, int64_t last)
+		{
+			const int commonPrefix = Delta(codes, first, last, last + 1);
+
+			int64_t split = first;
+			int64_t step = last - first;
+
+			do
+			{
+				step = (step + 1) >> 1;
+				const int64_t newSplit = split + step;
+
+				if (newSplit < last && Delta(codes, first, newSplit, last + 1) > commonPrefix)
+				{
+					split = newSplit;
+				}
+			}
+			while (step > 1);
+
+			return split;
+		}
+
+		template <typename CodeType>
+		void ConstructTreeImpl(
+			const CodeType* sortedMortonCodes,
+			uint32_t trianglesCount,
+			InternalNode* internalNodes,
+			LeafNode* leafNodes,
+			uint32_t threadsCount)
+		{
+			if (trianglesCount == 0) return;
+			if (trianglesCount == 1)
+			{
+				leafNodes[0] = {.parent = MAX_UINT, .index = 0};
+				return;
+			}
+
+			internalNodes[0].parent = MAX_UINT;
+
+			// Every node writes only itself, its leaf children and parent field of its internal children,
+			// and every node is a child of exactly one other node, so there are no write conflicts between ranges
+			ParallelForRange(trianglesCount - 1, [&](uint32_t begin, uint32_t end, uint32_t)
+			{
+				for (uint32_t nodeId = begin; nodeId < end; nodeId++)
+				{
+					int64_t first, last;
+					DetermineRange(sortedMortonCodes, trianglesCount, nodeId, first, last);
+					const uint32_t split = static_cast<uint32_t>(FindSplit(sortedMortonCodes, first, last));
+
+					InternalNode& node = internalNodes[nodeId];
+					node.index = nodeId;
+
+					node.leftNode = split;
+					if (split == first)
+					{
+						leafNodes[split] = {.parent = nodeId, .index = split};
+						node.leftNodeType = LEAF_NODE;
+					}
+					else
+					{
+						internalNodes[split].parent = nodeId;
+						node.leftNodeType = INTERNAL_NODE;
+					}
+
+					node.rightNode = split + 1;
+					if (split + 1 == last)
+					{
+						leafNodes[split + 1] = {.parent = nodeId, .index = split + 1};
+						node.rightNodeType = LEAF_NODE;
+					}
+					else
+					{
+						internalNodes[split + 1].parent = nodeId;
+						node.rightNodeType = INTERNAL_NODE;
+					}
+				}
+			}, threadsCount);
+		}
+
+		bool IsEqual(const AABB& a, const AABB& b)
+		{
+			return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z &&
+				a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+		}
+
+		bool Contains(const AABB& outer, const AABB& inner)
+		{
+			return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+				outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+		}
+
+		bool IsEqual(const InternalNode& a, const InternalNode& b)
+		{
+			return a.leftNode == b.leftNode && a.leftNodeType == b.leftNodeType &&
+				a.rightNode == b.rightNode && a.rightNodeType == b.rightNodeType &&
+				a.parent == b.parent && a.index == b.index;
+		}
+
+		float SurfaceArea(const AABB& aabb)
+		{
+			const float dx = aabb.max.x - aabb.min.x;
+			const float dy = aabb.max.y - aabb.min.y;
+			const float dz = aabb.max.z - aabb.min.z;
+			return 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+
+		double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+	}
+
+	void CpuBVHBuilder::ComputeSortedMortonCodes(
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		uint64_t* sortedMortonCodes,
+		uint32_t* sortedTriangleIndices,
+		uint32_t threadsCount)
+	{
+		ParallelForRange(trianglesCount, [&](uint32_t begin, uint32_t end, uint32_t)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const AABB& aabb = triangleAABB[i];
+				const jmath::vec3 centroid = NormalizeCentroid((aabb.min + aabb.max) * 0.5f);
+				sortedMortonCodes[i] = Morton3D64(centroid.x, centroid.y, centroid.z);
+				sortedTriangleIndices[i] = i;
+			}
+		}, threadsCount);
+
+		CpuRadixSorter sorter(trianglesCount, sortedMortonCodes, sortedTriangleIndices, threadsCount);
+		sorter.Sort();
+	}
+
+	void CpuBVHBuilder::ComputeSortedMortonCodes(
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		uint32_t* sortedMortonCodes,
+		uint32_t* sortedTriangleIndices,
+		uint32_t threadsCount)
+	{
+		ParallelForRange(trianglesCount, [&](uint32_t begin, uint32_t end, uint32_t)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const AABB& aabb = triangleAABB[i];
+				const jmath::vec3 centroid = NormalizeCentroid((aabb.min + aabb.max) * 0.5f);
+				sortedMortonCodes[i] = Morton3D(centroid.x, centroid.y, centroid.z);
+				sortedTriangleIndices[i] = i;
+			}
+		}, threadsCount);
+
+		CpuRadixSorter sorter(trianglesCount, sortedMortonCodes, sortedTriangleIndices, threadsCount);
+		sorter.Sort();
+		MakeKeysUnique(sortedMortonCodes, trianglesCount);
+	}
+
+	void CpuBVHBuilder::ConstructLBVH(
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		uint32_t* sortedTriangleIndices,
+		InternalNode* internalNodes,
+		LeafNode* leafNodes,
+		AABB* bvhData,
+		uint32_t threadsCount)
+	{
+		std::vector<uint64_t> sortedMortonCodes(trianglesCount);
+		ComputeSortedMortonCodes(triangleAABB, trianglesCount, sortedMortonCodes.data(), sortedTriangleIndices, threadsCount);
+		ConstructTree(sortedMortonCodes.data(), trianglesCount, internalNodes, leafNodes, threadsCount);
+		ConstructBVH(sortedTriangleIndices, triangleAABB, trianglesCount, internalNodes, leafNodes, bvhData, threadsCount);
+	}
+
+	void CpuBVHBuilder::ConstructTree(
+		const uint64_t* sortedMortonCodes,
+		uint32_t trianglesCount,
+		InternalNode* internalNodes,
+		LeafNode* leafNodes,
+		uint32_t threadsCount)
+	{
+		ConstructTreeImpl(sortedMortonCodes, trianglesCount, internalNodes, leafNodes, threadsCount);
+	}
+
+	void CpuBVHBuilder::ConstructTree(
+		const uint32_t* sortedMortonCodes,
+		uint32_t trianglesCount,
+		InternalNode* internalNodes,
+		LeafNode* leafNodes,
+		uint32_t threadsCount)
+	{
+		ConstructTreeImpl(sortedMortonCodes, trianglesCount, internalNodes, leafNodes, threadsCount);
+	}
+
+	void CpuBVHBuilder::ConstructBVH(
+		const uint32_t* sortedTriangleIndices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		AABB* bvhData,
+		uint32_t threadsCount)
+	{
+		if (trianglesCount < 2) return;
+
+		const std::unique_ptr<std::atomic<uint32_t>[]> atomics = std::make_unique<std::atomic<uint32_t>[]>(trianglesCount - 1);
+
+		auto getChildAABB = [&](uint32_t id, uint32_t type) -> const AABB&
+		{
+			return type == INTERNAL_NODE ? bvhData[id] : triangleAABB[sortedTriangleIndices[id]];
+		};
+
+		// Walk up from every leaf, the first thread coming to the node stops, the second one
+		// (which sees both children finished thanks to acquire/release) merges children bounds
+		ParallelForRange(trianglesCount, [&](uint32_t begin, uint32_t end, uint32_t)
+		{
+			for (uint32_t leafId = begin; leafId < end; leafId++)
+			{
+				uint32_t parent = leafNodes[leafId].parent;
+				while (parent != MAX_UINT)
+				{
+					uint32_t expected = 0;
+					if (atomics[parent].compare_exchange_strong(expected, 1, std::memory_order_acq_rel, std::memory_order_acquire))
+					{
+						break;
+					}
+
+					const InternalNode& node = internalNodes[parent];
+					bvhData[parent] = MergeAABB(
+						getChildAABB(node.leftNode, node.leftNodeType),
+						getChildAABB(node.rightNode, node.rightNodeType));
+
+					parent = node.parent;
+				}
+			}
+		}, threadsCount);
+	}
+
+	bool CpuBVHBuilder::Validate(
+		const uint32_t* sortedTriangleIndices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		const AABB* bvhData)
+	{
+		if (trianglesCount < 2) return true;
+
+		const uint32_t internalNodesCount = trianglesCount - 1;
+
+		if (internalNodes[0].parent != MAX_UINT)
+		{
+			Logger::LogFormat("BVH validation: root parent is %u\n", internalNodes[0].parent);
+			return false;
+		}
+
+		std::vector<uint8_t> internalVisited(internalNodesCount, 0);
+		std::vector<uint8_t> leafVisited(trianglesCount, 0);
+		std::vector<uint32_t> stack;
+		stack.push_back(0);
+
+		auto checkChild = [&](uint32_t parentId, uint32_t childId, uint32_t childType, AABB& childAABB) -> bool
+		{
+			if (childType == INTERNAL_NODE)
+			{
+				if (childId >= internalNodesCount)
+				{
+					Logger::LogFormat("BVH validation: node %u has internal child %u out of range\n", parentId, childId);
+					return false;
+				}
+				if (internalNodes[childId].parent != parentId)
+				{
+					Logger::LogFormat("BVH validation: internal node %u parent is %u, expected %u\n", childId, internalNodes[childId].parent, parentId);
+					return false;
+				}
+				if (internalVisited[childId]++ != 0)
+				{
+					Logger::LogFormat("BVH validation: internal node %u is reachable twice\n", childId);
+					return false;
+				}
+				childAABB = bvhData[childId];
+				stack.push_back(childId);
+				if (stack.size() > traversalStackSize)
+				{
+					Logger::LogFormat("BVH validation: traversal of node %u overflows the stack of %u\n", childId, traversalStackSize);
+					return false;
+				}
+				return true;
+			}
+
+			if (childType != LEAF_NODE || childId >= trianglesCount)
+			{
+				Logger::LogFormat("BVH validation: node %u has invalid child %u of type %u\n", parentId, childId, childType);
+				return false;
+			}
+			if (leafNodes[childId].parent != parentId || leafNodes[childId].index != childId)
+			{
+				Logger::LogFormat("BVH validation: leaf %u has parent %u and index %u, expected %u and %u\n",
+				                  childId, leafNodes[childId].parent, leafNodes[childId].index, parentId, childId);
+				return false;
+			}
+			if (leafVisited[childId]++ != 0)
+			{
+				Logger::LogFormat("BVH validation: leaf %u is reachable twice\n", childId);
+				return false;
+			}
+			childAABB = triangleAABB[sortedTriangleIndices[childId]];
+			return true;
+		};
+
+		internalVisited[0] = 1;
+		while (!stack.empty())
+		{
+			const uint32_t nodeId = stack.back();
+			stack.pop_back();
+
+			const InternalNode& node = internalNodes[nodeId];
+			if (node.index != nodeId)
+			{
+				Logger::LogFormat("BVH validation: internal node %u has index %u\n", nodeId, node.index);
+				return false;
+			}
+
+			AABB leftAABB, rightAABB;
+			if (!checkChild(nodeId, node.leftNode, node.leftNodeType, leftAABB) ||
+				!checkChild(nodeId, node.rightNode, node.rightNodeType, rightAABB))
+			{
+				return false;
+			}
+
+			const AABB& nodeAABB = bvhData[nodeId];
+			if (!Contains(nodeAABB, leftAABB) || !Contains(nodeAABB, rightAABB) ||
+				!IsEqual(nodeAABB, MergeAABB(leftAABB, rightAABB)))
+			{
+				Logger::LogFormat("BVH validation: internal node %u bounds are not the merge of its children\n", nodeId);
+				return false;
+			}
+		}
+
+		const auto internalNotVisited = std::find(internalVisited.begin(), internalVisited.end(), 0);
+		if (internalNotVisited != internalVisited.end())
+		{
+			Logger::LogFormat("BVH validation: internal node %u is not reachable\n", static_cast<uint32_t>(internalNotVisited - internalVisited.begin()));
+			return false;
+		}
+
+		const auto leafNotVisited = std::find(leafVisited.begin(), leafVisited.end(), 0);
+		if (leafNotVisited != leafVisited.end())
+		{
+			Logger::LogFormat("BVH validation: leaf %u is not reachable\n", static_cast<uint32_t>(leafNotVisited - leafVisited.begin()));
+			return false;
+		}
+
+		return true;
+	}
+
+	uint32_t CpuBVHBuilder::Compare(
+		uint32_t trianglesCount,
+		const InternalNode* internalNodesA,
+		const LeafNode* leafNodesA,
+		const AABB* bvhDataA,
+		const InternalNode* internalNodesB,
+		const LeafNode* leafNodesB,
+		const AABB* bvhDataB)
+	{
+		if (trianglesCount < 2) return 0;
+
+		uint32_t mismatches = 0;
+
+		for (uint32_t i = 0; i < trianglesCount - 1; i++)
+		{
+			if (!IsEqual(internalNodesA[i], internalNodesB[i]) || !IsEqual(bvhDataA[i], bvhDataB[i]))
+			{
+				if (mismatches == 0)
+				{
+					Logger::LogFormat("BVH compare: internal node %u differs\n", i);
+				}
+				mismatches++;
+			}
+		}
+
+		for (uint32_t i = 0; i < trianglesCount; i++)
+		{
+			if (leafNodesA[i].parent != leafNodesB[i].parent || leafNodesA[i].index != leafNodesB[i].index)
+			{
+				if (mismatches == 0)
+				{
+					Logger::LogFormat("BVH compare: leaf node %u differs\n", i);
+				}
+				mismatches++;
+			}
+		}
+
+		return mismatches;
+	}
+
+	float CpuBVHBuilder::ComputeSAHCost(
+		const uint32_t* sortedTriangleIndices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const LeafNode* leafNodes,
+		const AABB* bvhData)
+	{
+		if (trianglesCount < 2) return static_cast<float>(trianglesCount);
+
+		double cost = 0;
+		for (uint32_t i = 0; i < trianglesCount - 1; i++)
+		{
+			cost += SurfaceArea(bvhData[i]);
+		}
+		for (uint32_t i = 0; i < trianglesCount; i++)
+		{
+			cost += SurfaceArea(triangleAABB[sortedTriangleIndices[leafNodes[i].index]]);
+		}
+
+		return static_cast<float>(cost / SurfaceArea(bvhData[0]));
+	}
+
+	uint32_t CpuBVHBuilder::ComputeMaxDepth(uint32_t trianglesCount, const InternalNode* internalNodes)
+	{
+		if (trianglesCount < 2) return 0;
+
+		uint32_t maxDepth = 0;
+		std::vector<std::pair<uint32_t, uint32_t>> stack; // node, depth
+		stack.emplace_back(0, 1);
+		while (!stack.empty())
+		{
+			const auto [nodeId, depth] = stack.back();
+			stack.pop_back();
+			maxDepth = std::max(maxDepth, depth);
+
+			const InternalNode& node = internalNodes[nodeId];
+			if (node.leftNodeType == INTERNAL_NODE)
+			{
+				stack.emplace_back(node.leftNode, depth + 1);
+			}
+			if (node.rightNodeType == INTERNAL_NODE)
+			{
+				stack.emplace_back(node.rightNode, depth + 1);
+			}
+		}
+		return maxDepth;
+	}
+
+	uint32_t CpuBVHBuilder::TraceRay(
+		jmath::vec3 origin,
+		jmath::vec3 dir,
+		const jmath::vec3* triangleVertices,
+		const uint32_t* sortedTriangleIndices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		const AABB* bvhData,
+		float& distance)
+	{
+		const jmath::vec3 invDir = jmath::vec3(1 / dir.x, 1 / dir.y, 1 / dir.z);
+
+		uint32_t hitTriangle = MAX_UINT;
+		distance = std::numeric_limits<float>::max();
+
+		auto checkTriangle = [&](uint32_t triangleIndex)
+		{
+			if (!RayBoxIntersection(triangleAABB[triangleIndex], origin, invDir)) return;
+
+			const float newDistance = RayTriangleIntersection(
+				origin, dir,
+				triangleVertices[triangleIndex * 3 + 0],
+				triangleVertices[triangleIndex * 3 + 1],
+				triangleVertices[triangleIndex * 3 + 2]);
+			if (newDistance < distance)
+			{
+				distance = newDistance;
+				hitTriangle = triangleIndex;
+			}
+		};
+
+		if (trianglesCount == 0) return hitTriangle;
+		if (trianglesCount == 1)
+		{
+			checkTriangle(sortedTriangleIndices[0]);
+			return hitTriangle;
+		}
+
+		uint32_t stack[traversalStackSize];
+		uint32_t currentStackIndex = 0;
+		stack[currentStackIndex++] = 0;
+
+		while (currentStackIndex != 0)
+		{
+			const uint32_t index = stack[--currentStackIndex];
+
+			if (!RayBoxIntersection(bvhData[index], origin, invDir))
+			{
+				continue;
+			}
+
+			const InternalNode& node = internalNodes[index];
+
+			if (node.leftNodeType == INTERNAL_NODE)
+			{
+				ASSERT(currentStackIndex < traversalStackSize);
+				stack[currentStackIndex++] = node.leftNode;
+			}
+			else
+			{
+				checkTriangle(sortedTriangleIndices[leafNodes[node.leftNode].index]);
+			}
+
+			if (node.rightNodeType == INTERNAL_NODE)
+			{
+				ASSERT(currentStackIndex < traversalStackSize);
+				stack[currentStackIndex++] = node.rightNode;
+			}
+			else
+			{
+				checkTriangle(sortedTriangleIndices[leafNodes[node.rightNode].index]);
+			}
+		}
+
+		return hitTriangle;
+	}
+
+	double CpuBVHBuilder::MeasureRaysPerSecond(
+		uint32_t raysCount,
+		const jmath::vec3* triangleVertices,
+		const uint32_t* sortedTriangleIndices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		const AABB* bvhData,
+		uint32_t* hits,
+		uint32_t threadsCount)
+	{
+		if (raysCount == 0) return 0;
+
+		// Rays are generated before timing, so every tree is measured with the same set
+		std::vector<jmath::vec3> origins(raysCount);
+		std::vector<jmath::vec3> directions(raysCount);
+		GenerateRandomRays(raysCount, raysCount, origins.data(), directions.data());
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		ParallelForRange(raysCount, [&](uint32_t begin, uint32_t end, uint32_t)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				float distance;
+				const uint32_t hit = TraceRay(
+					origins[i], directions[i],
+					triangleVertices, sortedTriangleIndices, triangleAABB, trianglesCount,
+					internalNodes, leafNodes, bvhData,
+					distance);
+				if (hits != nullptr)
+				{
+					hits[i] = hit;
+				}
+			}
+		}, threadsCount);
+
+		return raysCount / (GetMilliseconds(start) / 1000.0);
+	}
+
+	void CpuBVHBuilder::AddBenchmarks(BenchmarkSuite& suite)
+	{
+		constexpr uint32_t trianglesCount = 1 << 18;
+		constexpr uint32_t raysCount = 1 << 16;
+		constexpr uint32_t threadsCount = 1; // results shouldn't depend on the machine load
+
+		struct LBVHData
+		{
+			std::vector<jmath::vec3> vertices = std::vector<jmath::vec3>(trianglesCount * 3);
+			std::vector<AABB> triangleAABB = std::vector<AABB>(trianglesCount);
+			std::vector<uint64_t> keys = std::vector<uint64_t>(trianglesCount);
+			std::vector<uint32_t> triangleIndices = std::vector<uint32_t>(trianglesCount);
+			std::vector<InternalNode> internalNodes = std::vector<InternalNode>(trianglesCount - 1);
+			std::vector<LeafNode> leafNodes = std::vector<LeafNode>(trianglesCount);
+			std::vector<AABB> bvhData = std::vector<AABB>(trianglesCount - 1);
+			std::vector<jmath::vec3> origins = std::vector<jmath::vec3>(raysCount);
+			std::vector<jmath::vec3> directions = std::vector<jmath::vec3>(raysCount);
+			std::vector<uint32_t> hits = std::vector<uint32_t>(raysCount);
+		};
+		auto data = std::make_shared<LBVHData>();
+
+		GenerateRandomTriangles(trianglesCount, 1.0f, 1.0f, trianglesCount, data->vertices.data(), data->triangleAABB.data());
+		GenerateRandomRays(raysCount, raysCount, data->origins.data(), data->directions.data());
+		ComputeSortedMortonCodes(data->triangleAABB.data(), trianglesCount, data->keys.data(), data->triangleIndices.data(), threadsCount);
+		ConstructTree(data->keys.data(), trianglesCount, data->internalNodes.data(), data->leafNodes.data(), threadsCount);
+		ConstructBVH(data->triangleIndices.data(), data->triangleAABB.data(), trianglesCount,
+		             data->internalNodes.data(), data->leafNodes.data(), data->bvhData.data(), threadsCount);
+
+		suite.Add("Morton/ComputeSortedCodes", trianglesCount, [data]()
+		{
+			ComputeSortedMortonCodes(data->triangleAABB.data(), trianglesCount, data->keys.data(), data->triangleIndices.data(), threadsCount);
+		});
+
+		suite.Add("LBVH/ConstructTree", trianglesCount, [data]()
+		{
+			ConstructTree(data->keys.data(), trianglesCount, data->internalNodes.data(), data->leafNodes.data(), threadsCount);
+		});
+
+		suite.Add("LBVH/ConstructBVH", trianglesCount, [data]()
+		{
+			ConstructBVH(data->triangleIndices.data(), data->triangleAABB.data(), trianglesCount,
+			             data->internalNodes.data(), data->leafNodes.data(), data->bvhData.data(), threadsCount);
+		});
+
+		suite.Add("LBVH/TraceRay", raysCount, [data]()
+		{
+			for (uint32_t i = 0; i < raysCount; i++)
+			{
+				float distance;
+				data->hits[i] = TraceRay(
+					data->origins[i], data->directions[i],
+					data->vertices.data(), data->triangleIndices.data(), data->triangleAABB.data(), trianglesCount,
+					data->internalNodes.data(), data->leafNodes.data(), data->bvhData.data(),
+					distance);
+			}
+		});
+	}
+
+	bool CpuBVHBuilder::TestDuplicateKeys(uint32_t trianglesCount, uint32_t threadsCount)
+	{
+		if (trianglesCount < 2) return true;
+
+		const jmath::vec3 sceneCenter = (g_sceneAabb.min + g_sceneAabb.max) * 0.5f;
+
+		auto makeTriangle = [](const jmath::vec3& position, float size, AABB& aabb)
+		{
+			jmath::vec3 centroid;
+			GetCentroidAndAABB(
+				position,
+				jmath::vec3(position.x + size, position.y, position.z),
+				jmath::vec3(position.x, position.y + size, position.z),
+				&centroid, &aabb);
+		};
+
+		// Every case fills triangle bounds in random order, so equal 30 bit codes keep no spatial order after the stable sort
+		struct TestCase
+		{
+			const char* name;
+			std::function<void(std::mt19937&, std::vector<AABB>&)> fill;
+		};
+		const TestCase testCases[] = {
+			{
+				"same point", [&](std::mt19937&, std::vector<AABB>& aabbs)
+				{
+					for (AABB& aabb : aabbs)
+					{
+						makeTriangle(sceneCenter, 0.01f, aabb);
+					}
+				}
+			},
+			{
+				"8 clusters of 5 cm", [&](std::mt19937& generator, std::vector<AABB>& aabbs)
+				{
+					std::uniform_real_distribution<float> offset(0.0f, 0.05f);
+					std::uniform_int_distribution<uint32_t> cluster(0, 7);
+					for (AABB& aabb : aabbs)
+					{
+						const uint32_t c = cluster(generator);
+						const jmath::vec3 clusterCenter = jmath::vec3(
+							sceneCenter.x + static_cast<float>(c & 1) * 10.0f,
+							sceneCenter.y + static_cast<float>((c >> 1) & 1) * 10.0f,
+							sceneCenter.z + static_cast<float>(c >> 2) * 10.0f);
+						makeTriangle(jmath::vec3(clusterCenter.x + offset(generator), clusterCenter.y + offset(generator), clusterCenter.z + offset(generator)), 0.001f, aabb);
+					}
+				}
+			},
+			{
+				"grid with 1 cm step", [&](std::mt19937& generator, std::vector<AABB>& aabbs)
+				{
+					const uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(aabbs.size()))));
+					std::vector<uint32_t> order(aabbs.size());
+					for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+					std::shuffle(order.begin(), order.end(), generator);
+					for (uint32_t i = 0; i < aabbs.size(); i++)
+					{
+						const uint32_t cell = order[i];
+						makeTriangle(jmath::vec3(
+							             sceneCenter.x + static_cast<float>(cell % side) * 0.01f,
+							             sceneCenter.y + static_cast<float>(cell / side % side) * 0.01f,
+							             sceneCenter.z + static_cast<float>(cell / side / side) * 0.01f),
+						             0.005f, aabbs[i]);
+					}
+				}
+			},
+			{
+				"uniform", [&](std::mt19937& generator, std::vector<AABB>& aabbs)
+				{
+					std::vector<jmath::vec3> vertices(aabbs.size() * 3);
+					GenerateRandomTriangles(static_cast<uint32_t>(aabbs.size()), 0.1f, 1.0f, generator(), vertices.data(), aabbs.data());
+				}
+			},
+		};
+
+		std::vector<AABB> triangleAABB(trianglesCount);
+		std::vector<uint64_t> keys64(trianglesCount);
+		std::vector<uint32_t> keys32(trianglesCount);
+		std::vector<uint32_t> sortedIndices64(trianglesCount);
+		std::vector<uint32_t> sortedIndices32(trianglesCount);
+		std::vector<InternalNode> internalNodes64(trianglesCount - 1);
+		std::vector<InternalNode> internalNodes32(trianglesCount - 1);
+		std::vector<LeafNode> leafNodes64(trianglesCount);
+		std::vector<LeafNode> leafNodes32(trianglesCount);
+		std::vector<AABB> bvhData64(trianglesCount - 1);
+		std::vector<AABB> bvhData32(trianglesCount - 1);
+
+		bool isSuccess = true;
+		for (const TestCase& testCase : testCases)
+		{
+			std::mt19937 generator(trianglesCount);
+			testCase.fill(generator, triangleAABB);
+
+			ComputeSortedMortonCodes(triangleAABB.data(), trianglesCount, keys64.data(), sortedIndices64.data(), threadsCount);
+			ConstructTree(keys64.data(), trianglesCount, internalNodes64.data(), leafNodes64.data(), threadsCount);
+			ConstructBVH(sortedIndices64.data(), triangleAABB.data(), trianglesCount, internalNodes64.data(), leafNodes64.data(), bvhData64.data(), threadsCount);
+
+			ComputeSortedMortonCodes(triangleAABB.data(), trianglesCount, keys32.data(), sortedIndices32.data(), threadsCount);
+			ConstructTree(keys32.data(), trianglesCount, internalNodes32.data(), leafNodes32.data(), threadsCount);
+			ConstructBVH(sortedIndices32.data(), triangleAABB.data(), trianglesCount, internalNodes32.data(), leafNodes32.data(), bvhData32.data(), threadsCount);
+
+			// Upper 30 bits of a 63 bit code are the 30 bit code of the same point
+			uint32_t uniqueCodes64 = 1;
+			uint32_t uniqueCodes30 = 1;
+			for (uint32_t i = 1; i < trianglesCount; i++)
+			{
+				uniqueCodes64 += keys64[i] != keys64[i - 1];
+				uniqueCodes30 += (keys64[i] >> 33) != (keys64[i - 1] >> 33);
+			}
+
+			const bool isValid64 = Validate(sortedIndices64.data(), triangleAABB.data(), trianglesCount, internalNodes64.data(), leafNodes64.data(), bvhData64.data());
+			const bool isValid32 = Validate(sortedIndices32.data(), triangleAABB.data(), trianglesCount, internalNodes32.data(), leafNodes32.data(), bvhData32.data());
+			isSuccess &= isValid64;
+
+			Logger::LogFormat("LBVH duplicate keys, %s, %u triangles, unique codes 30 bit %u, 63 bit %u\n"
+			                  "    30 bit unique keys: depth %u, SAH %.2f, %s\n"
+			                  "    63 bit index keys:  depth %u, SAH %.2f, %s\n",
+			                  testCase.name,
+			                  trianglesCount,
+			                  uniqueCodes30,
+			                  uniqueCodes64,
+			                  ComputeMaxDepth(trianglesCount, internalNodes32.data()),
+			                  ComputeSAHCost(sortedIndices32.data(), triangleAABB.data(), trianglesCount, leafNodes32.data(), bvhData32.data()),
+			                  isValid32 ? "valid" : "INVALID",
+			                  ComputeMaxDepth(trianglesCount, internalNodes64.data()),
+			                  ComputeSAHCost(sortedIndices64.data(), triangleAABB.data(), trianglesCount, leafNodes64.data(), bvhData64.data()),
+			                  isValid64 ? "valid" : "INVALID");
+		}
+
+		return isSuccess;
+	}
+}
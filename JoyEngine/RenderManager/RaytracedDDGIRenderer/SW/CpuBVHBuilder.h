@@ -0,0 +1,144 @@
+#ifndef CPU_BVH_BUILDER_H
+#define CPU_BVH_BUILDER_H
+
+#include <cstdint>
+
+#include "CommonEngineStructs.h"
+
+namespace JoyEngine
+{
+	class BenchmarkSuite;
+
+	// Reference implementation of BVHTreeConstructor.hlsl and BVHAABBMerger.hlsl.
+	// Produces exactly the same internal nodes, leaf nodes and node bounds as the gpu path
+	// from the same sorted 64 bit morton codes, so both can be checked against each other.
+	// Equal codes are told apart by their position in the sorted array, as if the index was appended to the key.
+	// 32 bit overloads are the previous path, they expect codes made unique with MakeKeysUnique
+	class CpuBVHBuilder
+	{
+	public:
+		// Size of the traversal stack in TraceRay of Raytracing.hlsl
+		static constexpr uint32_t traversalStackSize = 64;
+
+		// MORTON_CODE_BITS codes of triangle bounds centers, sorted the same way BuildBVH does it
+		static void ComputeSortedMortonCodes(
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			uint64_t* sortedMortonCodes,
+			uint32_t* sortedTriangleIndices,
+			uint32_t threadsCount = 0);
+
+		// 30 bit codes, sorted and made unique with MakeKeysUnique
+		static void ComputeSortedMortonCodes(
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			uint32_t* sortedMortonCodes,
+			uint32_t* sortedTriangleIndices,
+			uint32_t threadsCount = 0);
+
+		// Whole cpu LBVH build: 64 bit morton codes, sort, tree and bounds
+		static void ConstructLBVH(
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			uint32_t* sortedTriangleIndices,
+			InternalNode* internalNodes,
+			LeafNode* leafNodes,
+			AABB* bvhData,
+			uint32_t threadsCount = 0);
+
+		// internalNodes size = trianglesCount - 1, leafNodes size = trianglesCount. Codes may repeat
+		static void ConstructTree(
+			const uint64_t* sortedMortonCodes,
+			uint32_t trianglesCount,
+			InternalNode* internalNodes,
+			LeafNode* leafNodes,
+			uint32_t threadsCount = 0);
+
+		// Codes have to be unique, equal codes are split in the middle of their range
+		static void ConstructTree(
+			const uint32_t* sortedMortonCodes,
+			uint32_t trianglesCount,
+			InternalNode* internalNodes,
+			LeafNode* leafNodes,
+			uint32_t threadsCount = 0);
+
+		// bvhData size = trianglesCount - 1
+		static void ConstructBVH(
+			const uint32_t* sortedTriangleIndices,
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			const InternalNode* internalNodes,
+			const LeafNode* leafNodes,
+			AABB* bvhData,
+			uint32_t threadsCount = 0);
+
+		// Checks parent/child links, that every node is reachable from the root exactly once,
+		// that every node bounds are the merge of its children bounds and that traversal fits the stack. Logs the first error.
+		[[nodiscard]] static bool Validate(
+			const uint32_t* sortedTriangleIndices,
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			const InternalNode* internalNodes,
+			const LeafNode* leafNodes,
+			const AABB* bvhData);
+
+		// Returns count of nodes that differ between two builds. Logs the first mismatch.
+		[[nodiscard]] static uint32_t Compare(
+			uint32_t trianglesCount,
+			const InternalNode* internalNodesA,
+			const LeafNode* leafNodesA,
+			const AABB* bvhDataA,
+			const InternalNode* internalNodesB,
+			const LeafNode* leafNodesB,
+			const AABB* bvhDataB);
+
+		// Surface area heuristic cost of the tree relative to the root area.
+		// Traversal step and triangle test both cost 1, every leaf holds one triangle
+		[[nodiscard]] static float ComputeSAHCost(
+			const uint32_t* sortedTriangleIndices,
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			const LeafNode* leafNodes,
+			const AABB* bvhData);
+
+		// Count of internal nodes on the longest path from the root to a leaf
+		[[nodiscard]] static uint32_t ComputeMaxDepth(uint32_t trianglesCount, const InternalNode* internalNodes);
+
+		// Same traversal as TraceRay in Raytracing.hlsl. triangleVertices holds 3 vertices per triangle.
+		// Returns closest hit triangle index or MAX_UINT
+		static uint32_t TraceRay(
+			jmath::vec3 origin,
+			jmath::vec3 dir,
+			const jmath::vec3* triangleVertices,
+			const uint32_t* sortedTriangleIndices,
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			const InternalNode* internalNodes,
+			const LeafNode* leafNodes,
+			const AABB* bvhData,
+			float& distance);
+
+		// Traces raysCount random rays starting inside the scene bounds, returns rays per second.
+		// Hit triangle of every ray is written to hits when it is not null
+		[[nodiscard]] static double MeasureRaysPerSecond(
+			uint32_t raysCount,
+			const jmath::vec3* triangleVertices,
+			const uint32_t* sortedTriangleIndices,
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			const InternalNode* internalNodes,
+			const LeafNode* leafNodes,
+			const AABB* bvhData,
+			uint32_t* hits = nullptr,
+			uint32_t threadsCount = 0);
+
+		// Morton codes, tree, bounds and ray traversal over random triangles inside the scene bounds
+		static void AddBenchmarks(BenchmarkSuite& suite);
+
+		// Builds trees with unique 30 bit codes and with 64 bit codes over inputs where most of the codes collide:
+		// all triangles in one point, a few tight clusters, a dense grid and a uniform scene as the baseline.
+		// Logs depth, SAH cost and validity of both trees, returns false when any 64 bit tree is invalid
+		static bool TestDuplicateKeys(uint32_t trianglesCount = 1 << 16, uint32_t threadsCount = 0);
+	};
+}
+#endif // CPU_BVH_BUILDER_H
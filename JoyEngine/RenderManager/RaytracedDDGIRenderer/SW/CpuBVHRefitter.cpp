@@ -0,0 +1,215 @@
+#include "CpuBVHRefitter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "BVHUtils.h"
+#include "CpuBVHBuilder.h"
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		float SurfaceArea(const AABB& aabb)
+		{
+			const float dx = aabb.max.x - aabb.min.x;
+			const float dy = aabb.max.y - aabb.min.y;
+			const float dz = aabb.max.z - aabb.min.z;
+			return 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+
+		bool IsEqual(const AABB& a, const AABB& b)
+		{
+			return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z &&
+				a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+		}
+
+		double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+	}
+
+	CpuBVHRefitter::CpuBVHRefitter(
+		const uint32_t* sortedTriangleIndices,
+		AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		AABB* bvhData,
+		float rebuildThreshold) :
+		m_sortedTriangleIndices(sortedTriangleIndices),
+		m_triangleAABB(triangleAABB),
+		m_trianglesCount(trianglesCount),
+		m_internalNodes(internalNodes),
+		m_leafNodes(leafNodes),
+		m_bvhData(bvhData),
+		m_rebuildThreshold(rebuildThreshold),
+		m_triangleLeaves(trianglesCount)
+	{
+	}
+
+	void CpuBVHRefitter::OnTreeBuilt()
+	{
+		for (uint32_t leafId = 0; leafId < m_trianglesCount; leafId++)
+		{
+			m_triangleLeaves[m_sortedTriangleIndices[leafId]] = leafId;
+		}
+
+		m_areaSum = 0;
+		for (uint32_t i = 0; i < m_trianglesCount; i++)
+		{
+			m_areaSum += SurfaceArea(m_triangleAABB[i]);
+		}
+		for (uint32_t i = 0; i + 1 < m_trianglesCount; i++)
+		{
+			m_areaSum += SurfaceArea(m_bvhData[i]);
+		}
+
+		m_builtSAHCost = std::max(GetSAHCost(), 1e-6f);
+
+		m_firstChangedNode = MAX_UINT;
+		m_lastChangedNode = 0;
+	}
+
+	void CpuBVHRefitter::UpdateTriangle(uint32_t triangleIndex, const AABB& aabb)
+	{
+		m_areaSum += SurfaceArea(aabb) - SurfaceArea(m_triangleAABB[triangleIndex]);
+		m_triangleAABB[triangleIndex] = aabb;
+
+		uint32_t parent = m_leafNodes[m_triangleLeaves[triangleIndex]].parent;
+		while (parent != MAX_UINT)
+		{
+			const InternalNode& node = m_internalNodes[parent];
+			const AABB merged = MergeAABB(
+				node.leftNodeType == INTERNAL_NODE ? m_bvhData[node.leftNode] : m_triangleAABB[m_sortedTriangleIndices[node.leftNode]],
+				node.rightNodeType == INTERNAL_NODE ? m_bvhData[node.rightNode] : m_triangleAABB[m_sortedTriangleIndices[node.rightNode]]);
+
+			// Every node is the merge of its children before the walk, so nothing above can change
+			if (IsEqual(merged, m_bvhData[parent])) break;
+
+			m_areaSum += SurfaceArea(merged) - SurfaceArea(m_bvhData[parent]);
+			m_bvhData[parent] = merged;
+
+			m_firstChangedNode = std::min(m_firstChangedNode, parent);
+			m_lastChangedNode = std::max(m_lastChangedNode, parent);
+
+			parent = node.parent;
+		}
+	}
+
+	float CpuBVHRefitter::GetSAHCost() const
+	{
+		if (m_trianglesCount < 2) return 1;
+		return static_cast<float>(m_areaSum / SurfaceArea(m_bvhData[0]));
+	}
+
+	bool CpuBVHRefitter::PopChangedNodesRange(uint32_t& firstNode, uint32_t& nodesCount)
+	{
+		if (m_firstChangedNode == MAX_UINT) return false;
+
+		firstNode = m_firstChangedNode;
+		nodesCount = m_lastChangedNode - m_firstChangedNode + 1;
+
+		m_firstChangedNode = MAX_UINT;
+		m_lastChangedNode = 0;
+		return true;
+	}
+
+	bool CpuBVHRefitter::Test(uint32_t trianglesCount, float movedTrianglesFraction)
+	{
+		if (trianglesCount < 2) return true;
+
+		std::vector<jmath::vec3> vertices(trianglesCount * 3);
+		std::vector<AABB> triangleAABB(trianglesCount);
+		GenerateRandomTriangles(trianglesCount, 0.1f, 2.0f, trianglesCount, vertices.data(), triangleAABB.data());
+
+		std::vector<uint32_t> sortedTriangleIndices(trianglesCount);
+		std::vector<InternalNode> internalNodes(trianglesCount - 1);
+		std::vector<LeafNode> leafNodes(trianglesCount);
+		std::vector<AABB> bvhData(trianglesCount - 1);
+
+		CpuBVHBuilder::ConstructLBVH(triangleAABB.data(), trianglesCount,
+		                             sortedTriangleIndices.data(), internalNodes.data(), leafNodes.data(), bvhData.data());
+
+		CpuBVHRefitter refitter(sortedTriangleIndices.data(), triangleAABB.data(), trianglesCount,
+		                        internalNodes.data(), leafNodes.data(), bvhData.data());
+		refitter.OnTreeBuilt();
+
+		// Moved triangles keep their size, like parts of a moving object
+		std::mt19937 generator(trianglesCount);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+
+		std::vector<std::pair<uint32_t, AABB>> movedTriangles;
+		for (uint32_t i = 0; i < trianglesCount; i++)
+		{
+			if (unit(generator) >= movedTrianglesFraction) continue;
+
+			const jmath::vec3 shift = jmath::vec3(offset(generator), offset(generator), offset(generator));
+			AABB aabb = triangleAABB[i];
+			aabb.min = aabb.min + shift;
+			aabb.max = aabb.max + shift;
+			movedTriangles.emplace_back(i, aabb);
+		}
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (const auto& [triangleIndex, aabb] : movedTriangles)
+		{
+			refitter.UpdateTriangle(triangleIndex, aabb);
+		}
+		const double refitTime = GetMilliseconds(start);
+
+		bool isValid = CpuBVHBuilder::Validate(
+			sortedTriangleIndices.data(), triangleAABB.data(), trianglesCount,
+			internalNodes.data(), leafNodes.data(), bvhData.data());
+
+		const float refitSAHCost = refitter.GetSAHCost();
+		const float fullSAHCost = CpuBVHBuilder::ComputeSAHCost(
+			sortedTriangleIndices.data(), triangleAABB.data(), trianglesCount,
+			leafNodes.data(), bvhData.data());
+		// Incremental cost accumulates float rounding only
+		if (std::abs(refitSAHCost - fullSAHCost) > fullSAHCost * 1e-3f)
+		{
+			Logger::LogFormat("BVH refit: incremental SAH cost %.3f differs from full %.3f\n", refitSAHCost, fullSAHCost);
+			isValid = false;
+		}
+
+		// Fresh build over the moved triangles
+		std::vector<uint32_t> freshSortedTriangleIndices(trianglesCount);
+		std::vector<InternalNode> freshInternalNodes(trianglesCount - 1);
+		std::vector<LeafNode> freshLeafNodes(trianglesCount);
+		std::vector<AABB> freshBvhData(trianglesCount - 1);
+
+		const auto buildStart = std::chrono::high_resolution_clock::now();
+		CpuBVHBuilder::ConstructLBVH(triangleAABB.data(), trianglesCount,
+		                             freshSortedTriangleIndices.data(), freshInternalNodes.data(), freshLeafNodes.data(), freshBvhData.data());
+		const double buildTime = GetMilliseconds(buildStart);
+
+		const float freshSAHCost = CpuBVHBuilder::ComputeSAHCost(
+			freshSortedTriangleIndices.data(), triangleAABB.data(), trianglesCount,
+			freshLeafNodes.data(), freshBvhData.data());
+
+		// Both trees cover the same triangles, so root bounds must be the same
+		if (!IsEqual(bvhData[0], freshBvhData[0]))
+		{
+			Logger::Log("BVH refit: root bounds differ from a fresh build\n");
+			isValid = false;
+		}
+
+		Logger::LogFormat("BVH refit %u of %u triangles: refit %.3f ms, rebuild %.3f ms, SAH cost refit %.2f, fresh %.2f, degradation %.2f, %s\n",
+		                  static_cast<uint32_t>(movedTriangles.size()),
+		                  trianglesCount,
+		                  refitTime,
+		                  buildTime,
+		                  refitSAHCost,
+		                  freshSAHCost,
+		                  refitter.GetDegradation(),
+		                  isValid ? "valid" : "INVALID");
+
+		return isValid;
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef CPU_BVH_REFITTER_H
+#define CPU_BVH_REFITTER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace JoyEngine
+{
+	// Keeps the tree up to date with moving triangles without changing its topology.
+	// Bounds are propagated from the changed leaf to the root and the walk stops at the first node whose bounds didn't change.
+	// SAH cost is updated incrementally, its growth since the last build tells when the tree has to be rebuilt.
+	class CpuBVHRefitter
+	{
+	public:
+		CpuBVHRefitter() = delete;
+
+		// Arrays are owned by the caller and must outlive the refitter
+		CpuBVHRefitter(
+			const uint32_t* sortedTriangleIndices,
+			AABB* triangleAABB,
+			uint32_t trianglesCount,
+			const InternalNode* internalNodes,
+			const LeafNode* leafNodes,
+			AABB* bvhData,
+			float rebuildThreshold = 1.5f);
+
+		// Must be called after every full build of the tree
+		void OnTreeBuilt();
+
+		void UpdateTriangle(uint32_t triangleIndex, const AABB& aabb);
+
+		[[nodiscard]] float GetSAHCost() const;
+		// SAH cost relative to the cost right after the build
+		[[nodiscard]] float GetDegradation() const { return GetSAHCost() / m_builtSAHCost; }
+		[[nodiscard]] bool IsRebuildRequired() const { return GetDegradation() > m_rebuildThreshold; }
+
+		// Returns false if no internal node was changed since the last call
+		[[nodiscard]] bool PopChangedNodesRange(uint32_t& firstNode, uint32_t& nodesCount);
+
+		// Moves part of random triangles, refits and checks the result against a fresh build of the moved triangles
+		[[nodiscard]] static bool Test(uint32_t trianglesCount, float movedTrianglesFraction = 0.1f);
+
+	private:
+		const uint32_t* m_sortedTriangleIndices;
+		AABB* m_triangleAABB;
+		uint32_t m_trianglesCount;
+		const InternalNode* m_internalNodes;
+		const LeafNode* m_leafNodes;
+		AABB* m_bvhData;
+		const float m_rebuildThreshold;
+
+		std::vector<uint32_t> m_triangleLeaves;
+
+		double m_areaSum = 0;
+		float m_builtSAHCost = 1;
+
+		uint32_t m_firstChangedNode = MAX_UINT;
+		uint32_t m_lastChangedNode = 0;
+	};
+}
+#endif // CPU_BVH_REFITTER_H
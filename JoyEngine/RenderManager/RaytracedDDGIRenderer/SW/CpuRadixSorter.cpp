@@ -0,0 +1,216 @@
+#include "CpuRadixSorter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <emmintrin.h>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "Benchmarks/BenchmarkSuite.h"
+#include "ThreadManager/ParallelFor.h"
+
+namespace JoyEngine
+{
+	template <typename KeyType>
+	CpuRadixSorter<KeyType>::CpuRadixSorter(uint32_t dataLength, KeyType* keys, uint32_t* values, uint32_t threadsCount) :
+		m_dataLength(dataLength),
+		m_keys(keys),
+		m_values(values),
+		m_threadsCount(std::min(threadsCount == 0 ? GetWorkerThreadsCount() : threadsCount, std::max(dataLength, 1u))),
+		m_tmpKeys(dataLength),
+		m_tmpValues(dataLength),
+		m_histograms(m_threadsCount * PASSES_COUNT * BUCKET_SIZE)
+	{
+	}
+
+	// Every thread counts digits of the passes from passMask for its own contiguous range.
+	// Digits of 4 (or 2 for 64 bit keys) keys are extracted at once with sse2, the counters themselves are scalar.
+	template <typename KeyType>
+	void CpuRadixSorter<KeyType>::BuildHistograms(const KeyType* keys, uint32_t passMask)
+	{
+		std::fill(m_histograms.begin(), m_histograms.end(), 0);
+
+		ParallelForRange(m_dataLength, [&](uint32_t begin, uint32_t end, uint32_t threadIndex)
+		{
+			uint32_t* threadHistograms = m_histograms.data() + threadIndex * PASSES_COUNT * BUCKET_SIZE;
+			constexpr uint32_t keysPerVector = sizeof(__m128i) / sizeof(KeyType);
+			const __m128i digitMask = _mm_set1_epi32(BUCKET_SIZE - 1);
+
+			for (uint32_t pass = 0; pass < PASSES_COUNT; pass++)
+			{
+				if ((passMask & (1 << pass)) == 0) continue;
+
+				uint32_t* histogram = threadHistograms + pass * BUCKET_SIZE;
+				const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(pass * RADIX));
+
+				uint32_t i = begin;
+				alignas(16) uint32_t digits[4];
+				for (; i + keysPerVector <= end; i += keysPerVector)
+				{
+					const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+					if constexpr (std::is_same_v<KeyType, uint32_t>)
+					{
+						_mm_store_si128(reinterpret_cast<__m128i*>(digits), _mm_and_si128(_mm_srl_epi32(k, shift), digitMask));
+						histogram[digits[0]]++;
+						histogram[digits[1]]++;
+						histogram[digits[2]]++;
+						histogram[digits[3]]++;
+					}
+					else
+					{
+						// Digit of every 64 bit key lands in its lower 32 bit lane
+						_mm_store_si128(reinterpret_cast<__m128i*>(digits), _mm_and_si128(_mm_srl_epi64(k, shift), digitMask));
+						histogram[digits[0]]++;
+						histogram[digits[2]]++;
+					}
+				}
+				for (; i < end; i++)
+				{
+					histogram[(keys[i] >> (pass * RADIX)) & (BUCKET_SIZE - 1)]++;
+				}
+			}
+		}, m_threadsCount);
+	}
+
+	template <typename KeyType>
+	void CpuRadixSorter<KeyType>::Sort()
+	{
+		if (m_dataLength < 2) return;
+
+		// Digit counts over the whole array don't depend on the order,
+		// so one histogram of all the passes tells which passes can be skipped
+		BuildHistograms(m_keys, (1 << PASSES_COUNT) - 1);
+
+		uint32_t passMask = 0;
+		for (uint32_t pass = 0; pass < PASSES_COUNT; pass++)
+		{
+			for (uint32_t bucket = 0; bucket < BUCKET_SIZE; bucket++)
+			{
+				uint32_t total = 0;
+				for (uint32_t thread = 0; thread < m_threadsCount; thread++)
+				{
+					total += m_histograms[(thread * PASSES_COUNT + pass) * BUCKET_SIZE + bucket];
+				}
+				if (total != 0)
+				{
+					if (total != m_dataLength)
+					{
+						passMask |= 1 << pass;
+					}
+					break;
+				}
+			}
+		}
+
+		KeyType* srcKeys = m_keys;
+		uint32_t* srcValues = m_values;
+		KeyType* dstKeys = m_tmpKeys.data();
+		uint32_t* dstValues = m_tmpValues.data();
+		bool isFirstPass = true;
+
+		for (uint32_t pass = 0; pass < PASSES_COUNT; pass++)
+		{
+			if ((passMask & (1 << pass)) == 0) continue;
+
+			// Thread ranges of the first pass are the same as in the initial histogram
+			if (!isFirstPass)
+			{
+				BuildHistograms(srcKeys, 1 << pass);
+			}
+			isFirstPass = false;
+
+			// Exclusive scan in bucket-major, thread-minor order turns counts into scatter offsets and keeps the sort stable
+			uint32_t offset = 0;
+			for (uint32_t bucket = 0; bucket < BUCKET_SIZE; bucket++)
+			{
+				for (uint32_t thread = 0; thread < m_threadsCount; thread++)
+				{
+					uint32_t& count = m_histograms[(thread * PASSES_COUNT + pass) * BUCKET_SIZE + bucket];
+					const uint32_t bucketCount = count;
+					count = offset;
+					offset += bucketCount;
+				}
+			}
+
+			const uint32_t bitOffset = pass * RADIX;
+			ParallelForRange(m_dataLength, [&](uint32_t begin, uint32_t end, uint32_t threadIndex)
+			{
+				uint32_t* offsets = m_histograms.data() + (threadIndex * PASSES_COUNT + pass) * BUCKET_SIZE;
+				for (uint32_t i = begin; i < end; i++)
+				{
+					const KeyType key = srcKeys[i];
+					const uint32_t dstIndex = offsets[(key >> bitOffset) & (BUCKET_SIZE - 1)]++;
+					dstKeys[dstIndex] = key;
+					dstValues[dstIndex] = srcValues[i];
+				}
+			}, m_threadsCount);
+
+			std::swap(srcKeys, dstKeys);
+			std::swap(srcValues, dstValues);
+		}
+
+		if (srcKeys != m_keys)
+		{
+			memcpy(m_keys, srcKeys, m_dataLength * sizeof(KeyType));
+			memcpy(m_values, srcValues, m_dataLength * sizeof(uint32_t));
+		}
+	}
+
+	template <typename KeyType>
+	void CpuRadixSorter<KeyType>::AddBenchmarks(BenchmarkSuite& suite)
+	{
+		constexpr uint32_t fullKeyBits = sizeof(KeyType) * 8;
+		constexpr uint32_t threadsCount = 1; // results shouldn't depend on the machine load
+
+		struct SortData
+		{
+			std::vector<KeyType> sourceKeys = std::vector<KeyType>(DATA_ARRAY_COUNT);
+			std::vector<KeyType> keys = std::vector<KeyType>(DATA_ARRAY_COUNT);
+			std::vector<uint32_t> values = std::vector<uint32_t>(DATA_ARRAY_COUNT);
+			std::vector<std::pair<KeyType, uint32_t>> pairs = std::vector<std::pair<KeyType, uint32_t>>(DATA_ARRAY_COUNT);
+			std::unique_ptr<CpuRadixSorter> sorter;
+		};
+
+		// Full range keys, morton-like keys where the upper pass is skipped, and short keys
+		for (const uint32_t keyBits : {fullKeyBits, fullKeyBits == 64 ? MORTON_CODE_BITS : 30u, 16u})
+		{
+			auto data = std::make_shared<SortData>();
+			data->sorter = std::make_unique<CpuRadixSorter>(DATA_ARRAY_COUNT, data->keys.data(), data->values.data(), threadsCount);
+
+			std::mt19937_64 generator(keyBits);
+			for (KeyType& key : data->sourceKeys)
+			{
+				key = static_cast<KeyType>(keyBits == fullKeyBits ? generator() : generator() & ((uint64_t(1) << keyBits) - 1));
+			}
+
+			const std::string name = "RadixSort/uint" + std::to_string(fullKeyBits) + "/" + std::to_string(keyBits) + "bits";
+			suite.Add(name.c_str(), DATA_ARRAY_COUNT, [data]()
+			{
+				data->sorter->Sort();
+			}, [data]()
+			{
+				for (uint32_t i = 0; i < DATA_ARRAY_COUNT; i++)
+				{
+					data->keys[i] = data->sourceKeys[i];
+					data->values[i] = i;
+				}
+			});
+
+			// Radix sort is stable and initial values are increasing, so std::sort on pairs gives the same order
+			suite.Add((name + "/std::sort").c_str(), DATA_ARRAY_COUNT, [data]()
+			{
+				std::sort(data->pairs.begin(), data->pairs.end());
+			}, [data]()
+			{
+				for (uint32_t i = 0; i < DATA_ARRAY_COUNT; i++)
+				{
+					data->pairs[i] = {data->sourceKeys[i], i};
+				}
+			});
+		}
+	}
+
+	template class CpuRadixSorter<uint32_t>;
+	template class CpuRadixSorter<uint64_t>;
+}
@@ -0,0 +1,49 @@
+#ifndef CPU_RADIX_SORTER_H
+#define CPU_RADIX_SORTER_H
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace JoyEngine
+{
+	class BenchmarkSuite;
+
+	// Cpu counterpart of BufferSorter: stable LSD radix sort of 32 or 64 bit keys by RADIX bits per pass,
+	// values are moved together with keys. Passes whose digit is the same for all the keys are skipped,
+	// so 63 bit morton codes cost only the passes their bits actually differ in.
+	template <typename KeyType>
+	class CpuRadixSorter
+	{
+	public:
+		static_assert(std::is_same_v<KeyType, uint32_t> || std::is_same_v<KeyType, uint64_t>);
+
+		CpuRadixSorter() = delete;
+		explicit CpuRadixSorter(uint32_t dataLength, KeyType* keys, uint32_t* values, uint32_t threadsCount = 0);
+		void Sort();
+
+		// Sort of DATA_ARRAY_COUNT random pairs with full range, morton-like and short keys, and std::sort of the same pairs
+		static void AddBenchmarks(BenchmarkSuite& suite);
+	private:
+		static constexpr uint32_t PASSES_COUNT = sizeof(KeyType) * 8 / RADIX;
+
+		void BuildHistograms(const KeyType* keys, uint32_t passMask);
+
+		uint32_t m_dataLength;
+		KeyType* m_keys;
+		uint32_t* m_values;
+		uint32_t m_threadsCount;
+
+		std::vector<KeyType> m_tmpKeys;
+		std::vector<uint32_t> m_tmpValues;
+
+		// [thread][pass][bucket]
+		std::vector<uint32_t> m_histograms;
+	};
+
+	extern template class CpuRadixSorter<uint32_t>;
+	extern template class CpuRadixSorter<uint64_t>;
+}
+#endif // CPU_RADIX_SORTER_H
@@ -0,0 +1,533 @@
+#include "CpuSAHBVHBuilder.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "BVHUtils.h"
+#include "CpuBVHBuilder.h"
+#include "Benchmarks/BenchmarkSuite.h"
+#include "Benchmarks/TestSuite.h"
+#include "Utils/Assert.h"
+#include "ThreadManager/ParallelFor.h"
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		constexpr uint32_t BINS_COUNT = 32;
+		constexpr uint32_t MIN_SUBTREE_TASK_SIZE = 1024;
+
+		struct SubtreeTask
+		{
+			uint32_t first;
+			uint32_t last;
+			uint32_t nodeIndex;
+			uint32_t depth;
+		};
+
+		struct Bin
+		{
+			AABB aabb;
+			uint32_t count;
+		};
+
+		const AABB g_emptyAABB = {
+			.min = jmath::vec3(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()),
+			._dummy0 = 0,
+			.max = jmath::vec3(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()),
+			._dummy1 = 0,
+		};
+
+		void Grow(AABB& aabb, const jmath::vec3& min, const jmath::vec3& max)
+		{
+			aabb.min.x = std::min(aabb.min.x, min.x);
+			aabb.min.y = std::min(aabb.min.y, min.y);
+			aabb.min.z = std::min(aabb.min.z, min.z);
+			aabb.max.x = std::max(aabb.max.x, max.x);
+			aabb.max.y = std::max(aabb.max.y, max.y);
+			aabb.max.z = std::max(aabb.max.z, max.z);
+		}
+
+		float SurfaceArea(const AABB& aabb)
+		{
+			const float dx = aabb.max.x - aabb.min.x;
+			const float dy = aabb.max.y - aabb.min.y;
+			const float dz = aabb.max.z - aabb.min.z;
+			return 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+
+		// Node at depth d (root is at 0) may hold up to 2^(maxDepth - d) leaves and still fit into maxDepth levels with a balanced subtree
+		uint64_t GetMaxLeavesCount(uint32_t depth, uint32_t maxDepth)
+		{
+			const uint32_t levelsCount = maxDepth - std::min(depth, maxDepth);
+			return levelsCount >= 63 ? std::numeric_limits<uint64_t>::max() : uint64_t(1) << levelsCount;
+		}
+
+		double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		class SAHBuilder
+		{
+		public:
+			SAHBuilder(
+				const AABB* triangleAABB,
+				uint32_t trianglesCount,
+				uint32_t* sortedTriangleIndices,
+				InternalNode* internalNodes,
+				LeafNode* leafNodes,
+				AABB* bvhData,
+				uint32_t threadsCount,
+				uint32_t maxDepth) :
+				m_triangleAABB(triangleAABB),
+				m_indices(sortedTriangleIndices),
+				m_internalNodes(internalNodes),
+				m_leafNodes(leafNodes),
+				m_bvhData(bvhData),
+				m_centroids(trianglesCount),
+				m_maxDepth(maxDepth)
+			{
+				ParallelForRange(trianglesCount, [&](uint32_t begin, uint32_t end, uint32_t)
+				{
+					for (uint32_t i = begin; i < end; i++)
+					{
+						m_centroids[i] = (triangleAABB[i].min + triangleAABB[i].max) * 0.5f;
+						m_indices[i] = i;
+					}
+				}, threadsCount);
+
+				const uint32_t workersCount = threadsCount == 0 ? GetWorkerThreadsCount() : threadsCount;
+				m_subtreeTaskSize = workersCount == 1
+					                    ? trianglesCount
+					                    : std::max(trianglesCount / (workersCount * 8), MIN_SUBTREE_TASK_SIZE);
+			}
+
+			void Build(uint32_t trianglesCount, uint32_t threadsCount)
+			{
+				m_internalNodes[0].parent = MAX_UINT;
+				BuildNode(0, trianglesCount - 1, 0, 0, true);
+
+				// Biggest subtrees go first, so workers finish at about the same time
+				std::sort(m_subtreeTasks.begin(), m_subtreeTasks.end(), [](const SubtreeTask& a, const SubtreeTask& b)
+				{
+					return a.last - a.first > b.last - b.first;
+				});
+				ParallelFor(static_cast<uint32_t>(m_subtreeTasks.size()), [&](uint32_t taskIndex)
+				{
+					const SubtreeTask& task = m_subtreeTasks[taskIndex];
+					BuildNode(task.first, task.last, task.nodeIndex, task.depth, false);
+				}, threadsCount);
+
+				// Upper nodes were created before their children, so reverse order merges bounds bottom-up
+				for (auto it = m_upperNodes.rbegin(); it != m_upperNodes.rend(); ++it)
+				{
+					const InternalNode& node = m_internalNodes[*it];
+					m_bvhData[*it] = MergeAABB(
+						GetChildAABB(node.leftNode, node.leftNodeType),
+						GetChildAABB(node.rightNode, node.rightNodeType));
+				}
+			}
+
+		private:
+			const AABB& GetChildAABB(uint32_t id, uint32_t type) const
+			{
+				return type == INTERNAL_NODE ? m_bvhData[id] : m_triangleAABB[m_indices[id]];
+			}
+
+			// Builds node at depth over leaves [first, last], first < last. Returns node bounds,
+			// upper nodes defer their subtrees to the tasks list and get bounds later
+			AABB BuildNode(uint32_t first, uint32_t last, uint32_t nodeIndex, uint32_t depth, bool isUpperLevel)
+			{
+				if (isUpperLevel && last - first + 1 <= m_subtreeTaskSize)
+				{
+					m_subtreeTasks.push_back({first, last, nodeIndex, depth});
+					return g_emptyAABB;
+				}
+				if (isUpperLevel)
+				{
+					m_upperNodes.push_back(nodeIndex);
+				}
+
+				const uint32_t split = Split(first, last, depth);
+
+				InternalNode& node = m_internalNodes[nodeIndex];
+				node.index = nodeIndex;
+
+				const AABB leftAABB = BuildChild(first, split, nodeIndex, depth + 1, true, node.leftNode, node.leftNodeType, isUpperLevel);
+				const AABB rightAABB = BuildChild(split + 1, last, nodeIndex, depth + 1, false, node.rightNode, node.rightNodeType, isUpperLevel);
+
+				if (isUpperLevel) return g_emptyAABB;
+
+				m_bvhData[nodeIndex] = MergeAABB(leftAABB, rightAABB);
+				return m_bvhData[nodeIndex];
+			}
+
+			AABB BuildChild(uint32_t first, uint32_t last, uint32_t parent, uint32_t depth, bool isLeft, uint32_t& childId, uint32_t& childType, bool isUpperLevel)
+			{
+				// Left child takes index of its last leaf, right child - of its first one, same as in LBVH
+				childId = isLeft ? last : first;
+
+				if (first == last)
+				{
+					childType = LEAF_NODE;
+					m_leafNodes[first] = {.parent = parent, .index = first};
+					return m_triangleAABB[m_indices[first]];
+				}
+
+				childType = INTERNAL_NODE;
+				m_internalNodes[childId].parent = parent;
+				return BuildNode(first, last, childId, depth, isUpperLevel);
+			}
+
+			// Reorders leaves [first, last] of node at depth and returns split s, so children are [first, s] and [s + 1, last].
+			// SAH split that would make the tree deeper than maxDepth is replaced with the median one
+			uint32_t Split(uint32_t first, uint32_t last, uint32_t depth)
+			{
+				AABB centroidBounds = g_emptyAABB;
+				for (uint32_t i = first; i <= last; i++)
+				{
+					const jmath::vec3& c = m_centroids[m_indices[i]];
+					Grow(centroidBounds, c, c);
+				}
+
+				// Sweeping over bins costs more than binning itself for small nodes
+				const uint32_t binsCount = std::min(BINS_COUNT, last - first + 1);
+
+				float bestCost = std::numeric_limits<float>::max();
+				int bestAxis = -1;
+				uint32_t bestBin = 0;
+
+				for (int axis = 0; axis < 3; axis++)
+				{
+					const float minCentroid = centroidBounds.min[axis];
+					const float extent = centroidBounds.max[axis] - minCentroid;
+					if (extent <= 0) continue;
+
+					const float scale = binsCount / extent;
+
+					Bin bins[BINS_COUNT];
+					for (uint32_t i = 0; i < binsCount; i++)
+					{
+						bins[i] = {g_emptyAABB, 0};
+					}
+
+					for (uint32_t i = first; i <= last; i++)
+					{
+						const uint32_t triangleIndex = m_indices[i];
+						const uint32_t binIndex = std::min(binsCount - 1, static_cast<uint32_t>((m_centroids[triangleIndex][axis] - minCentroid) * scale));
+						Grow(bins[binIndex].aabb, m_triangleAABB[triangleIndex].min, m_triangleAABB[triangleIndex].max);
+						bins[binIndex].count++;
+					}
+
+					float rightArea[BINS_COUNT];
+					uint32_t rightCount[BINS_COUNT];
+					{
+						AABB aabb = g_emptyAABB;
+						uint32_t count = 0;
+						for (uint32_t i = binsCount - 1; i > 0; i--)
+						{
+							Grow(aabb, bins[i].aabb.min, bins[i].aabb.max);
+							count += bins[i].count;
+							rightArea[i] = count > 0 ? SurfaceArea(aabb) : 0;
+							rightCount[i] = count;
+						}
+					}
+
+					AABB leftAABB = g_emptyAABB;
+					uint32_t leftCount = 0;
+					for (uint32_t i = 0; i < binsCount - 1; i++)
+					{
+						Grow(leftAABB, bins[i].aabb.min, bins[i].aabb.max);
+						leftCount += bins[i].count;
+						if (leftCount == 0 || rightCount[i + 1] == 0) continue;
+
+						const float cost = SurfaceArea(leftAABB) * leftCount + rightArea[i + 1] * rightCount[i + 1];
+						if (cost < bestCost)
+						{
+							bestCost = cost;
+							bestAxis = axis;
+							bestBin = i;
+						}
+					}
+				}
+
+				// All the centroids are in one point, any split is as good as the other
+				if (bestAxis == -1)
+				{
+					return (first + last) / 2;
+				}
+
+				const float minCentroid = centroidBounds.min[bestAxis];
+				const float scale = binsCount / (centroidBounds.max[bestAxis] - minCentroid);
+				const uint32_t* middle = std::partition(m_indices + first, m_indices + last + 1, [&](uint32_t triangleIndex)
+				{
+					return std::min(binsCount - 1, static_cast<uint32_t>((m_centroids[triangleIndex][bestAxis] - minCentroid) * scale)) <= bestBin;
+				});
+				const uint32_t split = static_cast<uint32_t>(middle - m_indices) - 1;
+
+				const uint64_t maxChildLeavesCount = GetMaxLeavesCount(depth + 1, m_maxDepth);
+				if (split - first + 1 <= maxChildLeavesCount && last - split <= maxChildLeavesCount)
+				{
+					return split;
+				}
+
+				// Halves of the node fit into the limit whenever the node itself does
+				const uint32_t median = (first + last) / 2;
+				int widestAxis = 0;
+				for (int axis = 1; axis < 3; axis++)
+				{
+					if (centroidBounds.max[axis] - centroidBounds.min[axis] > centroidBounds.max[widestAxis] - centroidBounds.min[widestAxis])
+					{
+						widestAxis = axis;
+					}
+				}
+				std::nth_element(m_indices + first, m_indices + median, m_indices + last + 1, [&](uint32_t a, uint32_t b)
+				{
+					return m_centroids[a][widestAxis] < m_centroids[b][widestAxis];
+				});
+				return median;
+			}
+
+			const AABB* m_triangleAABB;
+			uint32_t* m_indices;
+			InternalNode* m_internalNodes;
+			LeafNode* m_leafNodes;
+			AABB* m_bvhData;
+
+			std::vector<jmath::vec3> m_centroids;
+			uint32_t m_maxDepth;
+			uint32_t m_subtreeTaskSize;
+
+			std::vector<SubtreeTask> m_subtreeTasks;
+			std::vector<uint32_t> m_upperNodes;
+		};
+	}
+
+	void CpuSAHBVHBuilder::Construct(
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		uint32_t* sortedTriangleIndices,
+		InternalNode* internalNodes,
+		LeafNode* leafNodes,
+		AABB* bvhData,
+		uint32_t threadsCount,
+		uint32_t maxDepth)
+	{
+		ASSERT(maxDepth > 0 && GetMaxLeavesCount(0, maxDepth) >= trianglesCount);
+		if (trianglesCount == 0) return;
+		if (trianglesCount == 1)
+		{
+			sortedTriangleIndices[0] = 0;
+			leafNodes[0] = {.parent = MAX_UINT, .index = 0};
+			return;
+		}
+
+		SAHBuilder builder(triangleAABB, trianglesCount, sortedTriangleIndices, internalNodes, leafNodes, bvhData, threadsCount, maxDepth);
+		builder.Build(trianglesCount, threadsCount);
+	}
+
+	bool CpuSAHBVHBuilder::CompareWithLBVH(
+		const jmath::vec3* triangleVertices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		uint32_t raysCount,
+		uint32_t threadsCount)
+	{
+		if (trianglesCount < 2) return true;
+
+		struct Tree
+		{
+			const char* name;
+			std::vector<uint32_t> sortedTriangleIndices;
+			std::vector<InternalNode> internalNodes;
+			std::vector<LeafNode> leafNodes;
+			std::vector<AABB> bvhData;
+			std::vector<uint32_t> hits;
+		};
+
+		Tree trees[2];
+		bool isCorrect = true;
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			Tree& tree = trees[i];
+			tree.name = i == 0 ? "LBVH" : "SAH";
+			tree.sortedTriangleIndices.resize(trianglesCount);
+			tree.internalNodes.resize(trianglesCount - 1);
+			tree.leafNodes.resize(trianglesCount);
+			tree.bvhData.resize(trianglesCount - 1);
+			tree.hits.resize(raysCount);
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			if (i == 0)
+			{
+				CpuBVHBuilder::ConstructLBVH(triangleAABB, trianglesCount,
+				                             tree.sortedTriangleIndices.data(), tree.internalNodes.data(), tree.leafNodes.data(), tree.bvhData.data(),
+				                             threadsCount);
+			}
+			else
+			{
+				Construct(triangleAABB, trianglesCount,
+				          tree.sortedTriangleIndices.data(), tree.internalNodes.data(), tree.leafNodes.data(), tree.bvhData.data(),
+				          threadsCount);
+			}
+			const double buildTime = GetMilliseconds(start);
+
+			const bool isValid = CpuBVHBuilder::Validate(
+				tree.sortedTriangleIndices.data(), triangleAABB, trianglesCount,
+				tree.internalNodes.data(), tree.leafNodes.data(), tree.bvhData.data());
+			isCorrect &= isValid;
+
+			// Broken tree may overflow traversal stack, so it isn't traced
+			const float sahCost = CpuBVHBuilder::ComputeSAHCost(
+				tree.sortedTriangleIndices.data(), triangleAABB, trianglesCount,
+				tree.leafNodes.data(), tree.bvhData.data());
+			const double raysPerSecond = isValid
+				                             ? CpuBVHBuilder::MeasureRaysPerSecond(
+					                             raysCount, triangleVertices,
+					                             tree.sortedTriangleIndices.data(), triangleAABB, trianglesCount,
+					                             tree.internalNodes.data(), tree.leafNodes.data(), tree.bvhData.data(),
+					                             tree.hits.data(), threadsCount)
+				                             : 0;
+
+			Logger::LogFormat("%s %u triangles: build %.3f ms, SAH cost %.2f, %.3f Mrays/s, %s\n",
+			                  tree.name,
+			                  trianglesCount,
+			                  buildTime,
+			                  sahCost,
+			                  raysPerSecond / 1000000.0,
+			                  isValid ? "valid" : "INVALID");
+		}
+
+		// Closest hit doesn't depend on the tree, only ties between equal distances may differ
+		uint32_t differentHits = 0;
+		for (uint32_t i = 0; i < raysCount; i++)
+		{
+			differentHits += trees[0].hits[i] != trees[1].hits[i] ? 1 : 0;
+		}
+		Logger::LogFormat("LBVH and SAH closest hits differ for %u of %u rays\n", differentHits, raysCount);
+		return isCorrect;
+	}
+
+	bool CpuSAHBVHBuilder::TestDepthLimit(uint32_t trianglesCount, uint32_t threadsCount)
+	{
+		if (trianglesCount < 2) return true;
+
+		std::vector<jmath::vec3> vertices(trianglesCount * 3);
+		std::vector<AABB> triangleAABB(trianglesCount);
+		GenerateRandomTriangles(trianglesCount, 0.01f, 20.0f, trianglesCount, vertices.data(), triangleAABB.data());
+
+		struct Tree
+		{
+			std::vector<uint32_t> sortedTriangleIndices;
+			std::vector<InternalNode> internalNodes;
+			std::vector<LeafNode> leafNodes;
+			std::vector<AABB> bvhData;
+		};
+		auto build = [&](uint32_t maxDepth)
+		{
+			Tree tree = {
+				.sortedTriangleIndices = std::vector<uint32_t>(trianglesCount),
+				.internalNodes = std::vector<InternalNode>(trianglesCount - 1),
+				.leafNodes = std::vector<LeafNode>(trianglesCount),
+				.bvhData = std::vector<AABB>(trianglesCount - 1),
+			};
+			Construct(triangleAABB.data(), trianglesCount,
+			          tree.sortedTriangleIndices.data(), tree.internalNodes.data(), tree.leafNodes.data(), tree.bvhData.data(),
+			          threadsCount, maxDepth);
+			return tree;
+		};
+
+		// Limit is set between the balanced depth and the natural SAH depth, so some of the splits have to fall back to the median
+		const Tree freeTree = build(CpuBVHBuilder::traversalStackSize);
+		const uint32_t freeDepth = CpuBVHBuilder::ComputeMaxDepth(trianglesCount, freeTree.internalNodes.data());
+		const uint32_t balancedDepth = std::bit_width(trianglesCount - 1);
+		const uint32_t maxDepth = (balancedDepth + freeDepth) / 2;
+		const Tree limitedTree = build(maxDepth);
+		const uint32_t limitedDepth = CpuBVHBuilder::ComputeMaxDepth(trianglesCount, limitedTree.internalNodes.data());
+
+		Logger::LogFormat("SAH depth limit: %u triangles, depth %u without limit, %u with limit %u\n",
+		                  trianglesCount, freeDepth, limitedDepth, maxDepth);
+
+		bool isPassed = true;
+		isPassed &= TEST_CHECK(freeDepth > balancedDepth + 1, "SAH tree over random triangles is balanced, depth limit isn't exercised");
+		isPassed &= TEST_CHECK(limitedDepth <= maxDepth, "tree is deeper than the limit");
+		isPassed &= TEST_CHECK(CpuBVHBuilder::Validate(
+			                       limitedTree.sortedTriangleIndices.data(), triangleAABB.data(), trianglesCount,
+			                       limitedTree.internalNodes.data(), limitedTree.leafNodes.data(), limitedTree.bvhData.data()),
+		                       "tree built with depth limit is invalid");
+		return isPassed;
+	}
+
+	void CpuSAHBVHBuilder::AddBenchmarks(BenchmarkSuite& suite)
+	{
+		constexpr uint32_t trianglesCount = 1 << 18;
+		constexpr uint32_t raysCount = 1 << 16;
+		constexpr uint32_t threadsCount = 1; // results shouldn't depend on the machine load
+
+		struct Tree
+		{
+			std::vector<uint32_t> sortedTriangleIndices = std::vector<uint32_t>(trianglesCount);
+			std::vector<InternalNode> internalNodes = std::vector<InternalNode>(trianglesCount - 1);
+			std::vector<LeafNode> leafNodes = std::vector<LeafNode>(trianglesCount);
+			std::vector<AABB> bvhData = std::vector<AABB>(trianglesCount - 1);
+		};
+
+		struct SAHData
+		{
+			std::vector<jmath::vec3> vertices = std::vector<jmath::vec3>(trianglesCount * 3);
+			std::vector<AABB> triangleAABB = std::vector<AABB>(trianglesCount);
+			std::vector<jmath::vec3> origins = std::vector<jmath::vec3>(raysCount);
+			std::vector<jmath::vec3> directions = std::vector<jmath::vec3>(raysCount);
+			std::vector<uint32_t> hits = std::vector<uint32_t>(raysCount);
+			Tree lbvh;
+			Tree sah;
+		};
+		auto data = std::make_shared<SAHData>();
+
+		// Mix of tiny and huge triangles is where LBVH suffers most
+		GenerateRandomTriangles(trianglesCount, 0.01f, 20.0f, trianglesCount, data->vertices.data(), data->triangleAABB.data());
+		GenerateRandomRays(raysCount, raysCount, data->origins.data(), data->directions.data());
+
+		const auto buildLBVH = [data]()
+		{
+			Tree& tree = data->lbvh;
+			CpuBVHBuilder::ConstructLBVH(data->triangleAABB.data(), trianglesCount,
+			                             tree.sortedTriangleIndices.data(), tree.internalNodes.data(), tree.leafNodes.data(), tree.bvhData.data(),
+			                             threadsCount);
+		};
+		const auto buildSAH = [data]()
+		{
+			Tree& tree = data->sah;
+			Construct(data->triangleAABB.data(), trianglesCount,
+			          tree.sortedTriangleIndices.data(), tree.internalNodes.data(), tree.leafNodes.data(), tree.bvhData.data(),
+			          threadsCount);
+		};
+		buildLBVH();
+		buildSAH();
+
+		suite.Add("SAHBVH/MixedSizes/ConstructLBVH", trianglesCount, buildLBVH);
+		suite.Add("SAHBVH/MixedSizes/Construct", trianglesCount, buildSAH);
+
+		for (const auto& [name, tree] : {std::pair{"SAHBVH/MixedSizes/TraceRayLBVH", &data->lbvh}, std::pair{"SAHBVH/MixedSizes/TraceRay", &data->sah}})
+		{
+			suite.Add(name, raysCount, [data, tree]()
+			{
+				for (uint32_t i = 0; i < raysCount; i++)
+				{
+					float distance;
+					data->hits[i] = CpuBVHBuilder::TraceRay(
+						data->origins[i], data->directions[i],
+						data->vertices.data(), tree->sortedTriangleIndices.data(), data->triangleAABB.data(), trianglesCount,
+						tree->internalNodes.data(), tree->leafNodes.data(), tree->bvhData.data(),
+						distance);
+				}
+			});
+		}
+	}
+}
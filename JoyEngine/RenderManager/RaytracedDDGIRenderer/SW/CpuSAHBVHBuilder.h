@@ -0,0 +1,50 @@
+#ifndef CPU_SAH_BVH_BUILDER_H
+#define CPU_SAH_BVH_BUILDER_H
+
+#include <cstdint>
+
+#include "CommonEngineStructs.h"
+#include "CpuBVHBuilder.h"
+
+namespace JoyEngine
+{
+	class BenchmarkSuite;
+
+	// Binned SAH builder with one triangle per leaf. Nodes are numbered the same way as in LBVH:
+	// a node over leaves [first, last] split after leaf s has children s and s + 1,
+	// so the result has exactly the layout Raytracing.hlsl expects. SAH splits that would make the tree
+	// deeper than the traversal stack of TraceRay are replaced with median splits.
+	// Upper levels are split on the calling thread, subtrees below are built in parallel.
+	class CpuSAHBVHBuilder
+	{
+	public:
+		// sortedTriangleIndices receives the leaves order, internalNodes and bvhData size = trianglesCount - 1.
+		// No path from the root has more than maxDepth internal nodes, trianglesCount has to fit into 2^maxDepth
+		static void Construct(
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			uint32_t* sortedTriangleIndices,
+			InternalNode* internalNodes,
+			LeafNode* leafNodes,
+			AABB* bvhData,
+			uint32_t threadsCount = 0,
+			uint32_t maxDepth = CpuBVHBuilder::traversalStackSize);
+
+		// Builds LBVH and SAH trees over the same triangles and logs build time, SAH cost and cpu rays per second of both.
+		// triangleVertices holds 3 vertices per triangle. Returns false when any tree is invalid
+		static bool CompareWithLBVH(
+			const jmath::vec3* triangleVertices,
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			uint32_t raysCount = 1 << 18,
+			uint32_t threadsCount = 0);
+
+		// Builds SAH trees over random triangles with and without a depth limit below the natural SAH depth.
+		// Returns false when the limited tree is invalid or deeper than the limit
+		static bool TestDepthLimit(uint32_t trianglesCount = 1 << 14, uint32_t threadsCount = 0);
+
+		// Build and ray traversal of SAH and LBVH trees over random triangles of very different sizes
+		static void AddBenchmarks(BenchmarkSuite& suite);
+	};
+}
+#endif // CPU_SAH_BVH_BUILDER_H
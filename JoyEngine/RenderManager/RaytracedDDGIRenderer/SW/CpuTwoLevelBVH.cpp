@@ -0,0 +1,419 @@
+#include "CpuTwoLevelBVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+
+#include "BVHUtils.h"
+#include "CpuSAHBVHBuilder.h"
+#include "Benchmarks/BenchmarkSuite.h"
+#include "RenderManager/TransformProvider.h"
+#include "ThreadManager/ParallelFor.h"
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		CpuBLAS BuildTree(const jmath::vec3* triangleVertices, uint32_t trianglesCount, uint32_t threadsCount)
+		{
+			CpuBLAS blas;
+			blas.triangleVertices.assign(triangleVertices, triangleVertices + trianglesCount * 3);
+			blas.triangleAABB.resize(trianglesCount);
+			blas.sortedTriangleIndices.resize(trianglesCount);
+			blas.internalNodes.resize(trianglesCount - 1);
+			blas.leafNodes.resize(trianglesCount);
+			blas.bvhData.resize(trianglesCount - 1);
+
+			for (uint32_t i = 0; i < trianglesCount; i++)
+			{
+				jmath::vec3 centroid;
+				GetCentroidAndAABB(triangleVertices[i * 3 + 0], triangleVertices[i * 3 + 1], triangleVertices[i * 3 + 2], &centroid, &blas.triangleAABB[i]);
+			}
+
+			CpuSAHBVHBuilder::Construct(
+				blas.triangleAABB.data(),
+				trianglesCount,
+				blas.sortedTriangleIndices.data(),
+				blas.internalNodes.data(),
+				blas.leafNodes.data(),
+				blas.bvhData.data(),
+				threadsCount);
+
+			blas.bounds = trianglesCount == 1 ? blas.triangleAABB[0] : blas.bvhData[0];
+			return blas;
+		}
+
+		AABB TransformAABB(const AABB& aabb, const jmath::mat4x4& matrix)
+		{
+			AABB result = {
+				.min = jmath::vec3(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()),
+				._dummy0 = 0,
+				.max = jmath::vec3(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()),
+				._dummy1 = 0,
+			};
+
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				const jmath::vec3 p = jmath::toVec3(jmath::mul(matrix, jmath::loadPosition(jmath::vec3(
+					corner & 1 ? aabb.max.x : aabb.min.x,
+					corner & 2 ? aabb.max.y : aabb.min.y,
+					corner & 4 ? aabb.max.z : aabb.min.z))));
+
+				result.min = jmath::vec3(std::min(result.min.x, p.x), std::min(result.min.y, p.y), std::min(result.min.z, p.z));
+				result.max = jmath::vec3(std::max(result.max.x, p.x), std::max(result.max.y, p.y), std::max(result.max.z, p.z));
+			}
+
+			return result;
+		}
+
+		template <typename T>
+		size_t GetVectorSize(const std::vector<T>& v)
+		{
+			return v.size() * sizeof(T);
+		}
+
+		uint32_t TraceClosestHit(const CpuBLAS& blas, const jmath::vec3& origin, const jmath::vec3& dir, float& distance)
+		{
+			return JoyEngine::TraceClosestHit(
+				origin, dir,
+				blas.triangleVertices.data(),
+				blas.sortedTriangleIndices.data(),
+				blas.triangleAABB.data(),
+				blas.GetTrianglesCount(),
+				blas.internalNodes.data(),
+				blas.leafNodes.data(),
+				blas.bvhData.data(),
+				distance);
+		}
+
+		double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+	}
+
+	size_t CpuBLAS::GetMemorySize() const noexcept
+	{
+		return GetVectorSize(triangleVertices) +
+			GetVectorSize(triangleAABB) +
+			GetVectorSize(sortedTriangleIndices) +
+			GetVectorSize(internalNodes) +
+			GetVectorSize(leafNodes) +
+			GetVectorSize(bvhData);
+	}
+
+	uint32_t CpuTwoLevelBVH::AddMesh(const jmath::vec3* triangleVertices, uint32_t trianglesCount, uint32_t threadsCount)
+	{
+		ASSERT(trianglesCount > 0);
+
+		m_blases.push_back(BuildTree(triangleVertices, trianglesCount, threadsCount));
+		return static_cast<uint32_t>(m_blases.size() - 1);
+	}
+
+	uint32_t CpuTwoLevelBVH::AddInstance(uint32_t blasIndex, uint32_t transformIndex)
+	{
+		ASSERT(blasIndex < m_blases.size());
+
+		m_instances.push_back({.blasIndex = blasIndex, .transformIndex = transformIndex});
+		return static_cast<uint32_t>(m_instances.size() - 1);
+	}
+
+	void CpuTwoLevelBVH::BuildTLAS(const jmath::mat4x4* instanceMatrices, uint32_t threadsCount)
+	{
+		const uint32_t instancesCount = GetInstancesCount();
+
+		m_objectToWorld.assign(instanceMatrices, instanceMatrices + instancesCount);
+		m_worldToObject.resize(instancesCount);
+		m_instanceAABB.resize(instancesCount);
+
+		for (uint32_t i = 0; i < instancesCount; i++)
+		{
+			m_worldToObject[i] = jmath::inverse(instanceMatrices[i]);
+			m_instanceAABB[i] = TransformAABB(m_blases[m_instances[i].blasIndex].bounds, instanceMatrices[i]);
+		}
+
+		m_sortedInstanceIndices.resize(instancesCount);
+		m_tlasLeafNodes.resize(instancesCount);
+		m_tlasInternalNodes.resize(std::max(instancesCount, 1u) - 1);
+		m_tlasBvhData.resize(std::max(instancesCount, 1u) - 1);
+
+		CpuSAHBVHBuilder::Construct(
+			m_instanceAABB.data(),
+			instancesCount,
+			m_sortedInstanceIndices.data(),
+			m_tlasInternalNodes.data(),
+			m_tlasLeafNodes.data(),
+			m_tlasBvhData.data(),
+			threadsCount);
+	}
+
+	void CpuTwoLevelBVH::BuildTLAS(TransformProvider& transformProvider, uint32_t threadsCount)
+	{
+		std::vector<jmath::mat4x4> instanceMatrices(m_instances.size());
+		for (size_t i = 0; i < m_instances.size(); i++)
+		{
+			instanceMatrices[i] = transformProvider.GetMatrix(m_instances[i].transformIndex);
+		}
+
+		BuildTLAS(instanceMatrices.data(), threadsCount);
+	}
+
+	uint32_t CpuTwoLevelBVH::TraceRay(jmath::vec3 origin, jmath::vec3 dir, float& distance, uint32_t& instanceIndex) const
+	{
+		distance = std::numeric_limits<float>::max();
+		instanceIndex = MAX_UINT;
+		uint32_t hitTriangle = MAX_UINT;
+
+		const jmath::vec3 invDir = jmath::vec3(1 / dir.x, 1 / dir.y, 1 / dir.z);
+
+		TraverseBVH(origin, invDir, distance,
+		         static_cast<uint32_t>(m_sortedInstanceIndices.size()),
+		         m_sortedInstanceIndices.data(),
+		         m_tlasInternalNodes.data(),
+		         m_tlasLeafNodes.data(),
+		         m_tlasBvhData.data(),
+		         [&](uint32_t instance)
+		         {
+			         if (RayBoxEntry(m_instanceAABB[instance], origin, invDir) >= distance) return;
+
+			         const jmath::mat4x4& worldToObject = m_worldToObject[instance];
+			         const jmath::vec3 objectOrigin = jmath::toVec3(jmath::mul(worldToObject, jmath::loadPosition(origin)));
+			         const jmath::vec3 objectDir = jmath::toVec3(jmath::mul(worldToObject, jmath::loadVec4(jmath::vec4(dir.x, dir.y, dir.z, 0))));
+
+			         const uint32_t triangle = TraceClosestHit(m_blases[m_instances[instance].blasIndex], objectOrigin, objectDir, distance);
+			         if (triangle != MAX_UINT)
+			         {
+				         hitTriangle = triangle;
+				         instanceIndex = instance;
+			         }
+		         });
+
+		return hitTriangle;
+	}
+
+	size_t CpuTwoLevelBVH::GetBLASMemorySize() const noexcept
+	{
+		size_t size = 0;
+		for (const auto& blas : m_blases)
+		{
+			size += blas.GetMemorySize();
+		}
+		return size;
+	}
+
+	size_t CpuTwoLevelBVH::GetTLASMemorySize() const noexcept
+	{
+		return GetVectorSize(m_instances) +
+			GetVectorSize(m_objectToWorld) +
+			GetVectorSize(m_worldToObject) +
+			GetVectorSize(m_instanceAABB) +
+			GetVectorSize(m_sortedInstanceIndices) +
+			GetVectorSize(m_tlasInternalNodes) +
+			GetVectorSize(m_tlasLeafNodes) +
+			GetVectorSize(m_tlasBvhData);
+	}
+
+	CpuBLAS CpuTwoLevelBVH::BuildFlatTree(uint32_t threadsCount) const
+	{
+		uint32_t flatTrianglesCount = 0;
+		for (const auto& instance : m_instances)
+		{
+			flatTrianglesCount += m_blases[instance.blasIndex].GetTrianglesCount();
+		}
+
+		std::vector<jmath::vec3> flatVertices(flatTrianglesCount * 3);
+		uint32_t vertexIndex = 0;
+		for (size_t i = 0; i < m_instances.size(); i++)
+		{
+			for (const jmath::vec3& v : m_blases[m_instances[i].blasIndex].triangleVertices)
+			{
+				flatVertices[vertexIndex++] = jmath::toVec3(jmath::mul(m_objectToWorld[i], jmath::loadPosition(v)));
+			}
+		}
+		return BuildTree(flatVertices.data(), flatTrianglesCount, threadsCount);
+	}
+
+	bool CpuTwoLevelBVH::CompareWithFlatBVH(uint32_t raysCount, uint32_t threadsCount)
+	{
+		if (m_instances.empty() || m_objectToWorld.size() != m_instances.size()) return true;
+
+		// Flat tree is what the scene needs today: every instance is copied to world space and any move rebuilds everything
+		auto start = std::chrono::high_resolution_clock::now();
+		const CpuBLAS flat = BuildFlatTree(threadsCount);
+		const double flatBuildTime = GetMilliseconds(start);
+		const uint32_t flatTrianglesCount = flat.GetTrianglesCount();
+
+		constexpr uint32_t tlasIterations = 10;
+		double tlasBuildTime;
+		{
+			const std::vector<jmath::mat4x4> instanceMatrices = m_objectToWorld;
+			start = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < tlasIterations; i++)
+			{
+				BuildTLAS(instanceMatrices.data(), threadsCount);
+			}
+			tlasBuildTime = GetMilliseconds(start) / tlasIterations;
+		}
+
+		std::vector<jmath::vec3> origins(raysCount);
+		std::vector<jmath::vec3> directions(raysCount);
+		GenerateRandomRays(raysCount, raysCount, origins.data(), directions.data());
+
+		std::vector<float> flatDistances(raysCount);
+		std::vector<float> twoLevelDistances(raysCount);
+
+		start = std::chrono::high_resolution_clock::now();
+		ParallelForRange(raysCount, [&](uint32_t begin, uint32_t end, uint32_t)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				flatDistances[i] = std::numeric_limits<float>::max();
+				TraceClosestHit(flat, origins[i], directions[i], flatDistances[i]);
+			}
+		}, threadsCount);
+		const double flatTraceTime = GetMilliseconds(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		ParallelForRange(raysCount, [&](uint32_t begin, uint32_t end, uint32_t)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				uint32_t instanceIndex;
+				TraceRay(origins[i], directions[i], twoLevelDistances[i], instanceIndex);
+			}
+		}, threadsCount);
+		const double twoLevelTraceTime = GetMilliseconds(start);
+
+		uint32_t differentHits = 0;
+		for (uint32_t i = 0; i < raysCount; i++)
+		{
+			const float a = flatDistances[i];
+			const float b = twoLevelDistances[i];
+			if (a != b && std::abs(a - b) > 1e-3f * std::max(1.0f, std::min(a, b)))
+			{
+				differentHits++;
+			}
+		}
+
+		uint32_t uniqueTrianglesCount = 0;
+		for (const auto& blas : m_blases)
+		{
+			uniqueTrianglesCount += blas.GetTrianglesCount();
+		}
+
+		Logger::LogFormat("Two level BVH: %u instances of %u meshes, %u triangles in world (%u unique)\n",
+		                  GetInstancesCount(), static_cast<uint32_t>(m_blases.size()), flatTrianglesCount, uniqueTrianglesCount);
+		Logger::LogFormat("    memory: flat %.2f MB, BLAS %.2f MB + TLAS %.2f KB\n",
+		                  flat.GetMemorySize() / (1024.0 * 1024.0),
+		                  GetBLASMemorySize() / (1024.0 * 1024.0),
+		                  GetTLASMemorySize() / 1024.0);
+		Logger::LogFormat("    rebuild on transform change: flat %.3f ms, TLAS %.3f ms\n", flatBuildTime, tlasBuildTime);
+		Logger::LogFormat("    cpu rays: flat %.2f Mrays/s, two level %.2f Mrays/s, %u of %u rays hit at different distance\n",
+		                  raysCount / (flatTraceTime * 1000.0),
+		                  raysCount / (twoLevelTraceTime * 1000.0),
+		                  differentHits, raysCount);
+		return differentHits == 0;
+	}
+
+	CpuTwoLevelBVH CpuTwoLevelBVH::CreateRandom(uint32_t meshesCount, uint32_t trianglesPerMesh, uint32_t instancesCount, uint32_t threadsCount)
+	{
+		CpuTwoLevelBVH bvh;
+		if (meshesCount == 0 || trianglesPerMesh == 0 || instancesCount == 0) return bvh;
+
+		{
+			std::vector<jmath::vec3> vertices(trianglesPerMesh * 3);
+			std::vector<AABB> triangleAABB(trianglesPerMesh);
+			for (uint32_t i = 0; i < meshesCount; i++)
+			{
+				// Random triangles in scene bounds shrunk to a mesh about 2 units wide
+				GenerateRandomTriangles(trianglesPerMesh, 1.0f, 10.0f, i + 1, vertices.data(), triangleAABB.data());
+				for (auto& v : vertices)
+				{
+					v = v * 0.02f;
+				}
+				bvh.AddMesh(vertices.data(), trianglesPerMesh, threadsCount);
+			}
+		}
+
+		std::vector<jmath::mat4x4> instanceMatrices(instancesCount);
+		{
+			std::mt19937 generator(instancesCount);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			for (uint32_t i = 0; i < instancesCount; i++)
+			{
+				const jmath::vec3 position = jmath::vec3(
+					g_sceneAabb.min.x + unit(generator) * (g_sceneAabb.max.x - g_sceneAabb.min.x),
+					g_sceneAabb.min.y + unit(generator) * (g_sceneAabb.max.y - g_sceneAabb.min.y),
+					g_sceneAabb.min.z + unit(generator) * (g_sceneAabb.max.z - g_sceneAabb.min.z));
+				const jmath::vec3 rotation = jmath::vec3(unit(generator) * 6.28f, unit(generator) * 6.28f, unit(generator) * 6.28f);
+				const float scale = 1.0f + unit(generator) * 3.0f;
+
+				instanceMatrices[i] = jmath::trs(
+					jmath::loadPosition(position),
+					jmath::eulerToQuat(rotation),
+					jmath::loadPosition(jmath::vec3(scale, scale, scale)));
+				bvh.AddInstance(i % meshesCount, i);
+			}
+		}
+
+		bvh.BuildTLAS(instanceMatrices.data(), threadsCount);
+		return bvh;
+	}
+
+	void CpuTwoLevelBVH::AddBenchmarks(BenchmarkSuite& suite)
+	{
+		constexpr uint32_t meshesCount = 16;
+		constexpr uint32_t trianglesPerMesh = 1024;
+		constexpr uint32_t instancesCount = 256;
+		constexpr uint32_t raysCount = 1 << 16;
+		constexpr uint32_t threadsCount = 1; // results shouldn't depend on the machine load
+
+		struct TwoLevelData
+		{
+			CpuTwoLevelBVH bvh;
+			CpuBLAS flat;
+			std::vector<jmath::mat4x4> instanceMatrices;
+			std::vector<jmath::vec3> origins = std::vector<jmath::vec3>(raysCount);
+			std::vector<jmath::vec3> directions = std::vector<jmath::vec3>(raysCount);
+			std::vector<uint32_t> hits = std::vector<uint32_t>(raysCount);
+		};
+		auto data = std::make_shared<TwoLevelData>();
+		data->bvh = CreateRandom(meshesCount, trianglesPerMesh, instancesCount, threadsCount);
+		data->flat = data->bvh.BuildFlatTree(threadsCount);
+		data->instanceMatrices = data->bvh.m_objectToWorld;
+		GenerateRandomRays(raysCount, raysCount, data->origins.data(), data->directions.data());
+
+		// What a transform change costs with each tree
+		suite.Add("TwoLevelBVH/BuildTLAS", instancesCount, [data]()
+		{
+			data->bvh.BuildTLAS(data->instanceMatrices.data(), threadsCount);
+		});
+		suite.Add("TwoLevelBVH/BuildFlat", instancesCount, [data]()
+		{
+			data->flat = data->bvh.BuildFlatTree(threadsCount);
+		});
+
+		suite.Add("TwoLevelBVH/TraceRay", raysCount, [data]()
+		{
+			for (uint32_t i = 0; i < raysCount; i++)
+			{
+				float distance;
+				uint32_t instanceIndex;
+				data->hits[i] = data->bvh.TraceRay(data->origins[i], data->directions[i], distance, instanceIndex);
+			}
+		});
+		suite.Add("TwoLevelBVH/TraceRayFlat", raysCount, [data]()
+		{
+			for (uint32_t i = 0; i < raysCount; i++)
+			{
+				float distance = std::numeric_limits<float>::max();
+				data->hits[i] = TraceClosestHit(data->flat, data->origins[i], data->directions[i], distance);
+			}
+		});
+	}
+}
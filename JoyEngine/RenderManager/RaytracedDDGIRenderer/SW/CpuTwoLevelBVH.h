@@ -0,0 +1,91 @@
+#ifndef CPU_TWO_LEVEL_BVH_H
+#define CPU_TWO_LEVEL_BVH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+
+namespace JoyEngine
+{
+	class BenchmarkSuite;
+	class TransformProvider;
+
+	// Bottom level tree of one mesh in object space, shared by all instances of the mesh
+	struct CpuBLAS
+	{
+		std::vector<jmath::vec3> triangleVertices; // 3 vertices per triangle
+		std::vector<AABB> triangleAABB;
+		std::vector<uint32_t> sortedTriangleIndices;
+		std::vector<InternalNode> internalNodes;
+		std::vector<LeafNode> leafNodes;
+		std::vector<AABB> bvhData;
+		AABB bounds;
+
+		[[nodiscard]] uint32_t GetTrianglesCount() const noexcept { return static_cast<uint32_t>(triangleAABB.size()); }
+		[[nodiscard]] size_t GetMemorySize() const noexcept;
+	};
+
+	struct CpuBLASInstance
+	{
+		uint32_t blasIndex;
+		uint32_t transformIndex; // index of object matrix in TransformProvider
+	};
+
+	// Two level alternative to the flat scene tree: BLAS is built once per unique mesh,
+	// small TLAS over instances is rebuilt from object matrices whenever they change.
+	// At TLAS leaves the ray is moved to object space and continues in the instance BLAS.
+	// Direction is not normalized after the transform, so hit distances stay in world units.
+	// Both levels have the same node layout as the flat tree and are built with CpuSAHBVHBuilder
+	class CpuTwoLevelBVH
+	{
+	public:
+		// triangleVertices are in object space, 3 vertices per triangle. Returns BLAS index
+		uint32_t AddMesh(const jmath::vec3* triangleVertices, uint32_t trianglesCount, uint32_t threadsCount = 0);
+
+		// Returns instance index
+		uint32_t AddInstance(uint32_t blasIndex, uint32_t transformIndex);
+
+		// instanceMatrices holds object to world matrix of every instance
+		void BuildTLAS(const jmath::mat4x4* instanceMatrices, uint32_t threadsCount = 0);
+
+		// Takes object to world matrices of instances from the provider by their transform index
+		void BuildTLAS(TransformProvider& transformProvider, uint32_t threadsCount = 0);
+
+		// Returns closest hit triangle index inside the BLAS of instanceIndex or MAX_UINT
+		uint32_t TraceRay(jmath::vec3 origin, jmath::vec3 dir, float& distance, uint32_t& instanceIndex) const;
+
+		[[nodiscard]] size_t GetBLASMemorySize() const noexcept;
+		[[nodiscard]] size_t GetTLASMemorySize() const noexcept;
+		[[nodiscard]] uint32_t GetInstancesCount() const noexcept { return static_cast<uint32_t>(m_instances.size()); }
+		[[nodiscard]] const CpuBLASInstance& GetInstance(uint32_t instanceIndex) const { return m_instances[instanceIndex]; }
+
+		// Builds flat SAH tree over pre-transformed triangles of all instances with the matrices of the last BuildTLAS.
+		// Logs memory, flat rebuild time against TLAS rebuild time, cpu rays per second and count of rays with different hits.
+		// Returns false when any ray hits at different distance
+		bool CompareWithFlatBVH(uint32_t raysCount = 1 << 18, uint32_t threadsCount = 0);
+
+		// Random meshes scattered as randomly rotated and scaled instances over the scene bounds, TLAS is built
+		static CpuTwoLevelBVH CreateRandom(uint32_t meshesCount, uint32_t trianglesPerMesh, uint32_t instancesCount, uint32_t threadsCount = 0);
+
+		// TLAS rebuild against flat tree rebuild and ray traversal of both over a random instanced scene
+		static void AddBenchmarks(BenchmarkSuite& suite);
+
+	private:
+		// SAH tree over triangles of all instances moved to world space with the matrices of the last BuildTLAS
+		[[nodiscard]] CpuBLAS BuildFlatTree(uint32_t threadsCount) const;
+
+		std::vector<CpuBLAS> m_blases;
+		std::vector<CpuBLASInstance> m_instances;
+
+		std::vector<jmath::mat4x4> m_objectToWorld;
+		std::vector<jmath::mat4x4> m_worldToObject;
+		std::vector<AABB> m_instanceAABB;
+
+		std::vector<uint32_t> m_sortedInstanceIndices;
+		std::vector<InternalNode> m_tlasInternalNodes;
+		std::vector<LeafNode> m_tlasLeafNodes;
+		std::vector<AABB> m_tlasBvhData;
+	};
+}
+#endif // CPU_TWO_LEVEL_BVH_H
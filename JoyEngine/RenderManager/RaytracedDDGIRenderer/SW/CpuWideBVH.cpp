@@ -0,0 +1,870 @@
+#include "CpuWideBVH.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+
+// AVX2 kernels are compiled without /arch:AVX2 or -mavx2, marked with JMATH_TARGET_AVX2
+// and called only when jmath::getSupportedSimdLevel() allows
+#include <immintrin.h>
+
+#include "BVHUtils.h"
+#include "CpuBVHBuilder.h"
+#include "CpuSAHBVHBuilder.h"
+#include "Benchmarks/BenchmarkSuite.h"
+#include "Common/Math/MathBatch.h"
+#include "ThreadManager/ParallelFor.h"
+#include "Utils/Assert.h"
+#include "Utils/Log.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		// Every wide node is reached through at most Width - 1 pushed siblings per level
+		template <uint32_t Width>
+		constexpr uint32_t stackSize = CpuBVHBuilder::traversalStackSize * (Width - 1) + 1;
+
+		struct StackEntry
+		{
+			uint32_t child;
+			float distance; // near distance of the child box, for packets the lanes mask is kept in bits
+		};
+
+		// Children are pushed far to near, so the nearest one is traversed first
+		template <uint32_t Width>
+		void PushOrdered(StackEntry* entries, uint32_t count, StackEntry* stack, uint32_t& stackIndex)
+		{
+			for (uint32_t i = 1; i < count; i++)
+			{
+				const StackEntry entry = entries[i];
+				uint32_t j = i;
+				for (; j > 0 && entries[j - 1].distance < entry.distance; j--)
+				{
+					entries[j] = entries[j - 1];
+				}
+				entries[j] = entry;
+			}
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				stack[stackIndex++] = entries[i];
+			}
+		}
+
+		// Zero direction components would give 0 * inf in the slab test
+		jmath::vec3 SafeInvDir(const jmath::vec3& dir)
+		{
+			auto safeInv = [](float d)
+			{
+				return 1 / (std::abs(d) < 1e-12f ? std::copysign(1e-12f, d) : d);
+			};
+			return jmath::vec3(safeInv(dir.x), safeInv(dir.y), safeInv(dir.z));
+		}
+
+		float SurfaceArea(const AABB& aabb)
+		{
+			const float dx = aabb.max.x - aabb.min.x;
+			const float dy = aabb.max.y - aabb.min.y;
+			const float dz = aabb.max.z - aabb.min.z;
+			return 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+
+		float Component(const jmath::vec3& v, uint32_t axis)
+		{
+			return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+		}
+
+		// Quantized bounds of 8 or 4 children to floats
+		JMATH_TARGET_AVX2 __m256 LoadQuantized8(const uint8_t* q)
+		{
+			return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(q))));
+		}
+
+		JMATH_TARGET_AVX2 __m128 LoadQuantized4(const uint8_t* q)
+		{
+			int32_t packed;
+			memcpy(&packed, q, sizeof(packed));
+			return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+		}
+
+		// Quantized children distances to the node slabs, near plane is chosen by the ray direction sign
+		template <uint32_t Width>
+		JMATH_TARGET_AVX2 uint32_t IntersectChildrenAVX2(
+			const typename CpuWideBVH<Width>::Node& node,
+			const jmath::vec3& origin,
+			const jmath::vec3& invDir,
+			float distance,
+			float* nearDistances)
+		{
+			if constexpr (Width == 8)
+			{
+				__m256 tNear = _mm256_setzero_ps();
+				__m256 tFar = _mm256_set1_ps(distance);
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					const float inv = Component(invDir, axis);
+					const __m256 a = _mm256_set1_ps(node.scale[axis] * inv);
+					const __m256 b = _mm256_set1_ps((node.origin[axis] - Component(origin, axis)) * inv);
+					const bool isNegative = inv < 0;
+					tNear = _mm256_max_ps(tNear, _mm256_fmadd_ps(LoadQuantized8(isNegative ? node.qmax[axis] : node.qmin[axis]), a, b));
+					tFar = _mm256_min_ps(tFar, _mm256_fmadd_ps(LoadQuantized8(isNegative ? node.qmin[axis] : node.qmax[axis]), a, b));
+				}
+
+				_mm256_storeu_ps(nearDistances, tNear);
+				return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ)));
+			}
+			else
+			{
+				__m128 tNear = _mm_setzero_ps();
+				__m128 tFar = _mm_set1_ps(distance);
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					const float inv = Component(invDir, axis);
+					const __m128 a = _mm_set1_ps(node.scale[axis] * inv);
+					const __m128 b = _mm_set1_ps((node.origin[axis] - Component(origin, axis)) * inv);
+					const bool isNegative = inv < 0;
+					tNear = _mm_max_ps(tNear, _mm_fmadd_ps(LoadQuantized4(isNegative ? node.qmax[axis] : node.qmin[axis]), a, b));
+					tFar = _mm_min_ps(tFar, _mm_fmadd_ps(LoadQuantized4(isNegative ? node.qmin[axis] : node.qmax[axis]), a, b));
+				}
+
+				_mm_storeu_ps(nearDistances, tNear);
+				return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)));
+			}
+		}
+
+		struct RayPacket
+		{
+			__m256 origin[3];
+			__m256 dir[3];
+			__m256 invDir[3];
+		};
+
+		JMATH_TARGET_AVX2 __m256 Dot8(const __m256* a, const __m256* b)
+		{
+			return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[0], b[0]), _mm256_mul_ps(a[1], b[1])), _mm256_mul_ps(a[2], b[2]));
+		}
+
+		JMATH_TARGET_AVX2 void Cross8(const __m256* a, const __m256* b, __m256* result)
+		{
+			result[0] = _mm256_sub_ps(_mm256_mul_ps(a[1], b[2]), _mm256_mul_ps(a[2], b[1]));
+			result[1] = _mm256_sub_ps(_mm256_mul_ps(a[2], b[0]), _mm256_mul_ps(a[0], b[2]));
+			result[2] = _mm256_sub_ps(_mm256_mul_ps(a[0], b[1]), _mm256_mul_ps(a[1], b[0]));
+		}
+
+		// RayTriangleIntersection for 8 rays, returns mask of lanes with a hit in (0, distance)
+		JMATH_TARGET_AVX2 uint32_t IntersectTriangle8(const RayPacket& packet, const jmath::vec3* v, __m256 distance, __m256& hitDistance)
+		{
+			const __m256 v0[3] = {_mm256_set1_ps(v[0].x), _mm256_set1_ps(v[0].y), _mm256_set1_ps(v[0].z)};
+			const __m256 e1[3] = {_mm256_set1_ps(v[1].x - v[0].x), _mm256_set1_ps(v[1].y - v[0].y), _mm256_set1_ps(v[1].z - v[0].z)};
+			const __m256 e2[3] = {_mm256_set1_ps(v[2].x - v[0].x), _mm256_set1_ps(v[2].y - v[0].y), _mm256_set1_ps(v[2].z - v[0].z)};
+
+			__m256 pvec[3];
+			Cross8(packet.dir, e2, pvec);
+			const __m256 det = Dot8(e1, pvec);
+
+			const __m256 one = _mm256_set1_ps(1.0f);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 epsilon = _mm256_set1_ps(1e-8f);
+
+			__m256 valid = _mm256_or_ps(_mm256_cmp_ps(det, epsilon, _CMP_GE_OQ), _mm256_cmp_ps(det, _mm256_sub_ps(zero, epsilon), _CMP_LE_OQ));
+			const __m256 invDet = _mm256_div_ps(one, det);
+
+			const __m256 tvec[3] = {_mm256_sub_ps(packet.origin[0], v0[0]), _mm256_sub_ps(packet.origin[1], v0[1]), _mm256_sub_ps(packet.origin[2], v0[2])};
+			const __m256 u = _mm256_mul_ps(Dot8(tvec, pvec), invDet);
+
+			__m256 qvec[3];
+			Cross8(tvec, e1, qvec);
+			const __m256 w = _mm256_mul_ps(Dot8(packet.dir, qvec), invDet);
+
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(w, zero, _CMP_GE_OQ));
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(_mm256_add_ps(u, w), one, _CMP_LE_OQ));
+
+			hitDistance = _mm256_mul_ps(Dot8(e2, qvec), invDet);
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(hitDistance, zero, _CMP_GT_OQ));
+			valid = _mm256_and_ps(valid, _mm256_cmp_ps(hitDistance, distance, _CMP_LT_OQ));
+
+			return static_cast<uint32_t>(_mm256_movemask_ps(valid));
+		}
+
+		double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		// Rays of one packet share the origin of its first ray and deviate a bit from its direction
+		void MakeCoherentRays(
+			uint32_t raysCount,
+			uint32_t packetSize,
+			const jmath::vec3* origins,
+			const jmath::vec3* directions,
+			jmath::vec3* packetOrigins,
+			jmath::vec3* packetDirections)
+		{
+			std::mt19937 generator(raysCount);
+			std::uniform_real_distribution<float> jitter(-0.02f, 0.02f);
+			for (uint32_t i = 0; i < raysCount; i++)
+			{
+				const uint32_t first = i / packetSize * packetSize;
+				packetOrigins[i] = origins[first];
+
+				const jmath::vec3 dir = jmath::vec3(
+					directions[first].x + jitter(generator),
+					directions[first].y + jitter(generator),
+					directions[first].z + jitter(generator));
+				packetDirections[i] = dir * (1.0f / std::sqrt(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z));
+			}
+		}
+	}
+
+	template <uint32_t Width>
+	CpuWideBVH<Width>::CpuWideBVH(
+		const jmath::vec3* triangleVertices,
+		const uint32_t* sortedTriangleIndices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		const AABB* bvhData):
+		m_useAVX2(IsAVX2Supported())
+	{
+		if (trianglesCount == 0) return;
+
+		m_triangleVertices.reserve(trianglesCount * 3);
+		m_triangleIndices.reserve(trianglesCount);
+
+		const BinaryTree tree = {
+			.triangleVertices = triangleVertices,
+			.sortedTriangleIndices = sortedTriangleIndices,
+			.triangleAABB = triangleAABB,
+			.internalNodes = internalNodes,
+			.leafNodes = leafNodes,
+			.bvhData = bvhData,
+		};
+
+		// Single triangle tree has no internal nodes, the root is the leaf itself
+		Collapse(tree, {.index = 0, .type = trianglesCount == 1 ? static_cast<uint32_t>(LEAF_NODE) : static_cast<uint32_t>(INTERNAL_NODE)}, 1);
+
+		ASSERT(m_maxDepth <= CpuBVHBuilder::traversalStackSize);
+	}
+
+	template <uint32_t Width>
+	uint32_t CpuWideBVH<Width>::Collapse(const BinaryTree& tree, ChildRef ref, uint32_t depth)
+	{
+		m_maxDepth = std::max(m_maxDepth, depth);
+
+		auto getBounds = [&tree](const ChildRef& child) -> const AABB&
+		{
+			return child.type == INTERNAL_NODE
+				       ? tree.bvhData[child.index]
+				       : tree.triangleAABB[tree.sortedTriangleIndices[tree.leafNodes[child.index].index]];
+		};
+
+		ChildRef children[Width];
+		uint32_t childrenCount = 0;
+		if (ref.type == LEAF_NODE)
+		{
+			children[childrenCount++] = ref;
+		}
+		else
+		{
+			const InternalNode& node = tree.internalNodes[ref.index];
+			children[childrenCount++] = {.index = node.leftNode, .type = node.leftNodeType};
+			children[childrenCount++] = {.index = node.rightNode, .type = node.rightNodeType};
+		}
+
+		while (childrenCount < Width)
+		{
+			int32_t best = -1;
+			float bestArea = -1;
+			for (uint32_t i = 0; i < childrenCount; i++)
+			{
+				if (children[i].type != INTERNAL_NODE) continue;
+
+				const float area = SurfaceArea(tree.bvhData[children[i].index]);
+				if (area > bestArea)
+				{
+					bestArea = area;
+					best = static_cast<int32_t>(i);
+				}
+			}
+			if (best < 0) break;
+
+			const InternalNode& node = tree.internalNodes[children[best].index];
+			children[best] = {.index = node.leftNode, .type = node.leftNodeType};
+			children[childrenCount++] = {.index = node.rightNode, .type = node.rightNodeType};
+		}
+
+		const uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+		m_nodes.emplace_back();
+
+		AABB bounds = getBounds(children[0]);
+		for (uint32_t i = 1; i < childrenCount; i++)
+		{
+			bounds = MergeAABB(bounds, getBounds(children[i]));
+		}
+
+		{
+			Node& node = m_nodes[nodeIndex];
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				const float extent = Component(bounds.max, axis) - Component(bounds.min, axis);
+				int exponent = 0;
+				std::frexp(extent / 255.0f, &exponent);
+
+				node.origin[axis] = Component(bounds.min, axis);
+				node.scale[axis] = extent > 0 ? std::ldexp(1.0f, exponent) : 1.0f;
+				memset(node.qmin[axis], 255, Width);
+				memset(node.qmax[axis], 0, Width);
+			}
+			for (uint32_t i = 0; i < Width; i++)
+			{
+				node.children[i] = emptyChild;
+			}
+		}
+
+		for (uint32_t i = 0; i < childrenCount; i++)
+		{
+			uint32_t child;
+			if (children[i].type == LEAF_NODE)
+			{
+				const uint32_t triangleIndex = tree.sortedTriangleIndices[tree.leafNodes[children[i].index].index];
+				child = leafFlag | static_cast<uint32_t>(m_triangleIndices.size());
+				m_triangleIndices.push_back(triangleIndex);
+				m_triangleVertices.insert(m_triangleVertices.end(), tree.triangleVertices + triangleIndex * 3, tree.triangleVertices + triangleIndex * 3 + 3);
+			}
+			else
+			{
+				child = Collapse(tree, children[i], depth + 1);
+			}
+
+			// Recursion may reallocate nodes
+			Node& node = m_nodes[nodeIndex];
+			const AABB& childBounds = getBounds(children[i]);
+			node.children[i] = child;
+
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				const float origin = node.origin[axis];
+				const float scale = node.scale[axis];
+				const float childMin = Component(childBounds.min, axis);
+				const float childMax = Component(childBounds.max, axis);
+
+				int32_t qmin = std::clamp(static_cast<int32_t>(std::floor((childMin - origin) / scale)), 0, 255);
+				while (qmin > 0 && origin + qmin * scale > childMin) qmin--;
+				int32_t qmax = std::clamp(static_cast<int32_t>(std::ceil((childMax - origin) / scale)), 0, 255);
+				while (qmax < 255 && origin + qmax * scale < childMax) qmax++;
+
+				node.qmin[axis][i] = static_cast<uint8_t>(qmin);
+				node.qmax[axis][i] = static_cast<uint8_t>(qmax);
+			}
+		}
+
+		return nodeIndex;
+	}
+
+	template <uint32_t Width>
+	uint32_t CpuWideBVH<Width>::TraceRay(jmath::vec3 origin, jmath::vec3 dir, float& distance) const
+	{
+		distance = std::numeric_limits<float>::max();
+		if (m_nodes.empty()) return MAX_UINT;
+
+		return m_useAVX2 ? TraceRayAVX2(origin, dir, distance) : TraceRayScalar(origin, dir, distance);
+	}
+
+	template <uint32_t Width>
+	uint32_t CpuWideBVH<Width>::TraceRayScalar(const jmath::vec3& origin, const jmath::vec3& dir, float& distance) const
+	{
+		const jmath::vec3 invDir = SafeInvDir(dir);
+		uint32_t hitTriangle = MAX_UINT;
+
+		StackEntry stack[stackSize<Width>];
+		uint32_t stackIndex = 0;
+		stack[stackIndex++] = {.child = 0, .distance = 0};
+
+		while (stackIndex != 0)
+		{
+			const StackEntry entry = stack[--stackIndex];
+			if (entry.distance >= distance) continue;
+
+			if (entry.child & leafFlag)
+			{
+				const uint32_t position = entry.child & ~leafFlag;
+				const float newDistance = RayTriangleIntersection(
+					origin, dir,
+					m_triangleVertices[position * 3 + 0],
+					m_triangleVertices[position * 3 + 1],
+					m_triangleVertices[position * 3 + 2]);
+				if (newDistance > 0 && newDistance < distance)
+				{
+					distance = newDistance;
+					hitTriangle = m_triangleIndices[position];
+				}
+				continue;
+			}
+
+			const Node& node = m_nodes[entry.child];
+			StackEntry hits[Width];
+			uint32_t hitsCount = 0;
+
+			for (uint32_t i = 0; i < Width; i++)
+			{
+				if (node.children[i] == emptyChild) continue;
+
+				float tNear = 0;
+				float tFar = distance;
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					const float inv = Component(invDir, axis);
+					const float a = node.scale[axis] * inv;
+					const float b = (node.origin[axis] - Component(origin, axis)) * inv;
+					const bool isNegative = inv < 0;
+					tNear = std::max(tNear, (isNegative ? node.qmax[axis][i] : node.qmin[axis][i]) * a + b);
+					tFar = std::min(tFar, (isNegative ? node.qmin[axis][i] : node.qmax[axis][i]) * a + b);
+				}
+
+				if (tNear <= tFar)
+				{
+					hits[hitsCount++] = {.child = node.children[i], .distance = tNear};
+				}
+			}
+
+			PushOrdered<Width>(hits, hitsCount, stack, stackIndex);
+		}
+
+		return hitTriangle;
+	}
+
+	template <uint32_t Width>
+	JMATH_TARGET_AVX2 uint32_t CpuWideBVH<Width>::TraceRayAVX2(const jmath::vec3& origin, const jmath::vec3& dir, float& distance) const
+	{
+		const jmath::vec3 invDir = SafeInvDir(dir);
+		uint32_t hitTriangle = MAX_UINT;
+
+		StackEntry stack[stackSize<Width>];
+		uint32_t stackIndex = 0;
+		stack[stackIndex++] = {.child = 0, .distance = 0};
+
+		while (stackIndex != 0)
+		{
+			const StackEntry entry = stack[--stackIndex];
+			if (entry.distance >= distance) continue;
+
+			if (entry.child & leafFlag)
+			{
+				const uint32_t position = entry.child & ~leafFlag;
+				const float newDistance = RayTriangleIntersection(
+					origin, dir,
+					m_triangleVertices[position * 3 + 0],
+					m_triangleVertices[position * 3 + 1],
+					m_triangleVertices[position * 3 + 2]);
+				if (newDistance > 0 && newDistance < distance)
+				{
+					distance = newDistance;
+					hitTriangle = m_triangleIndices[position];
+				}
+				continue;
+			}
+
+			const Node& node = m_nodes[entry.child];
+
+			alignas(32) float nearDistances[Width];
+			uint32_t mask = IntersectChildrenAVX2<Width>(node, origin, invDir, distance, nearDistances);
+
+			StackEntry hits[Width];
+			uint32_t hitsCount = 0;
+			while (mask != 0)
+			{
+				const uint32_t i = std::countr_zero(mask);
+				mask &= mask - 1;
+				hits[hitsCount++] = {.child = node.children[i], .distance = nearDistances[i]};
+			}
+
+			PushOrdered<Width>(hits, hitsCount, stack, stackIndex);
+		}
+
+		return hitTriangle;
+	}
+
+	template <uint32_t Width>
+	void CpuWideBVH<Width>::TracePacket(const jmath::vec3* origins, const jmath::vec3* directions, float* distances, uint32_t* hits) const
+	{
+		if (m_useAVX2 && !m_nodes.empty())
+		{
+			TracePacketAVX2(origins, directions, distances, hits);
+			return;
+		}
+
+		for (uint32_t i = 0; i < packetSize; i++)
+		{
+			hits[i] = TraceRay(origins[i], directions[i], distances[i]);
+		}
+	}
+
+	template <uint32_t Width>
+	JMATH_TARGET_AVX2 void CpuWideBVH<Width>::TracePacketAVX2(const jmath::vec3* origins, const jmath::vec3* directions, float* distances, uint32_t* hits) const
+	{
+		RayPacket packet;
+		{
+			alignas(32) float values[9][packetSize];
+			for (uint32_t lane = 0; lane < packetSize; lane++)
+			{
+				const jmath::vec3 invDir = SafeInvDir(directions[lane]);
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					values[axis][lane] = Component(origins[lane], axis);
+					values[3 + axis][lane] = Component(directions[lane], axis);
+					values[6 + axis][lane] = Component(invDir, axis);
+				}
+			}
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				packet.origin[axis] = _mm256_load_ps(values[axis]);
+				packet.dir[axis] = _mm256_load_ps(values[3 + axis]);
+				packet.invDir[axis] = _mm256_load_ps(values[6 + axis]);
+			}
+		}
+
+		__m256 hitDistances = _mm256_set1_ps(std::numeric_limits<float>::max());
+		alignas(32) uint32_t hitPositions[packetSize];
+		std::fill_n(hitPositions, packetSize, MAX_UINT);
+
+		// Lanes mask of every entry is stored in the distance bits
+		StackEntry stack[stackSize<Width>];
+		uint32_t stackIndex = 0;
+		stack[stackIndex++] = {.child = 0, .distance = std::bit_cast<float>((1u << packetSize) - 1)};
+
+		while (stackIndex != 0)
+		{
+			const StackEntry entry = stack[--stackIndex];
+			const uint32_t lanes = std::bit_cast<uint32_t>(entry.distance);
+
+			if (entry.child & leafFlag)
+			{
+				const uint32_t position = entry.child & ~leafFlag;
+				__m256 newDistances;
+				uint32_t mask = IntersectTriangle8(packet, &m_triangleVertices[position * 3], hitDistances, newDistances) & lanes;
+				if (mask == 0) continue;
+
+				const __m256 blendMask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(
+					_mm256_and_si256(_mm256_set1_epi32(static_cast<int32_t>(mask)), _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)),
+					_mm256_setzero_si256()));
+				hitDistances = _mm256_blendv_ps(hitDistances, newDistances, blendMask);
+				while (mask != 0)
+				{
+					hitPositions[std::countr_zero(mask)] = position;
+					mask &= mask - 1;
+				}
+				continue;
+			}
+
+			const Node& node = m_nodes[entry.child];
+			StackEntry children[Width];
+			float childDistances[Width];
+			uint32_t childrenCount = 0;
+
+			for (uint32_t i = 0; i < Width; i++)
+			{
+				if (node.children[i] == emptyChild) continue;
+
+				__m256 tNear = _mm256_setzero_ps();
+				__m256 tFar = hitDistances;
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					const float scale = node.scale[axis];
+					const __m256 lo = _mm256_set1_ps(node.origin[axis] + node.qmin[axis][i] * scale);
+					const __m256 hi = _mm256_set1_ps(node.origin[axis] + node.qmax[axis][i] * scale);
+					const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(lo, packet.origin[axis]), packet.invDir[axis]);
+					const __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(hi, packet.origin[axis]), packet.invDir[axis]);
+					tNear = _mm256_max_ps(tNear, _mm256_min_ps(t1, t2));
+					tFar = _mm256_min_ps(tFar, _mm256_max_ps(t1, t2));
+				}
+
+				const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ))) & lanes;
+				if (mask == 0) continue;
+
+				// Packet visits children in order of the nearest entry among its lanes
+				alignas(32) float nearDistances[packetSize];
+				_mm256_store_ps(nearDistances, tNear);
+				float nearest = std::numeric_limits<float>::max();
+				for (uint32_t bits = mask; bits != 0; bits &= bits - 1)
+				{
+					nearest = std::min(nearest, nearDistances[std::countr_zero(bits)]);
+				}
+
+				children[childrenCount] = {.child = node.children[i], .distance = std::bit_cast<float>(mask)};
+				childDistances[childrenCount] = nearest;
+				childrenCount++;
+			}
+
+			// Far to near
+			for (uint32_t i = 1; i < childrenCount; i++)
+			{
+				const StackEntry child = children[i];
+				const float childDistance = childDistances[i];
+				uint32_t j = i;
+				for (; j > 0 && childDistances[j - 1] < childDistance; j--)
+				{
+					children[j] = children[j - 1];
+					childDistances[j] = childDistances[j - 1];
+				}
+				children[j] = child;
+				childDistances[j] = childDistance;
+			}
+			for (uint32_t i = 0; i < childrenCount; i++)
+			{
+				stack[stackIndex++] = children[i];
+			}
+		}
+
+		_mm256_storeu_ps(distances, hitDistances);
+		for (uint32_t lane = 0; lane < packetSize; lane++)
+		{
+			hits[lane] = hitPositions[lane] == MAX_UINT ? MAX_UINT : m_triangleIndices[hitPositions[lane]];
+		}
+	}
+
+	template <uint32_t Width>
+	size_t CpuWideBVH<Width>::GetMemorySize() const noexcept
+	{
+		return m_nodes.size() * sizeof(Node) +
+			m_triangleVertices.size() * sizeof(jmath::vec3) +
+			m_triangleIndices.size() * sizeof(uint32_t);
+	}
+
+	template <uint32_t Width>
+	bool CpuWideBVH<Width>::IsAVX2Supported()
+	{
+		return jmath::getSupportedSimdLevel() == jmath::SimdLevel::AVX2;
+	}
+
+	template <uint32_t Width>
+	bool CpuWideBVH<Width>::CompareWithBinary(
+		const jmath::vec3* triangleVertices,
+		const uint32_t* sortedTriangleIndices,
+		const AABB* triangleAABB,
+		uint32_t trianglesCount,
+		const InternalNode* internalNodes,
+		const LeafNode* leafNodes,
+		const AABB* bvhData,
+		uint32_t raysCount,
+		uint32_t threadsCount)
+	{
+		raysCount = raysCount / packetSize * packetSize;
+		if (trianglesCount < 2 || raysCount == 0) return true;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		const CpuWideBVH wideBVH(triangleVertices, sortedTriangleIndices, triangleAABB, trianglesCount, internalNodes, leafNodes, bvhData);
+		const double collapseTime = GetMilliseconds(start);
+
+		// Incoherent rays from random points, and coherent packets
+		std::vector<jmath::vec3> origins(raysCount);
+		std::vector<jmath::vec3> directions(raysCount);
+		GenerateRandomRays(raysCount, raysCount, origins.data(), directions.data());
+
+		std::vector<jmath::vec3> packetOrigins(raysCount);
+		std::vector<jmath::vec3> packetDirections(raysCount);
+		MakeCoherentRays(raysCount, packetSize, origins.data(), directions.data(), packetOrigins.data(), packetDirections.data());
+
+		std::vector<float> binaryDistances(raysCount);
+		std::vector<float> wideDistances(raysCount);
+		uint32_t differentHits = 0;
+		auto countDifferentHits = [&]()
+		{
+			for (uint32_t i = 0; i < raysCount; i++)
+			{
+				const float a = binaryDistances[i];
+				const float b = wideDistances[i];
+				if (a != b && std::abs(a - b) > 1e-3f * std::max(1.0f, std::min(a, b)))
+				{
+					differentHits++;
+				}
+			}
+		};
+
+		auto measureBinary = [&](const std::vector<jmath::vec3>& rayOrigins, const std::vector<jmath::vec3>& rayDirections)
+		{
+			const auto measureStart = std::chrono::high_resolution_clock::now();
+			ParallelForRange(raysCount, [&](uint32_t begin, uint32_t end, uint32_t)
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					binaryDistances[i] = std::numeric_limits<float>::max();
+					TraceClosestHit(
+						rayOrigins[i], rayDirections[i],
+						triangleVertices, sortedTriangleIndices, triangleAABB, trianglesCount,
+						internalNodes, leafNodes, bvhData,
+						binaryDistances[i]);
+				}
+			}, threadsCount);
+			return raysCount / (GetMilliseconds(measureStart) * 1000.0);
+		};
+
+		auto measureWide = [&](const std::vector<jmath::vec3>& rayOrigins, const std::vector<jmath::vec3>& rayDirections)
+		{
+			const auto measureStart = std::chrono::high_resolution_clock::now();
+			ParallelForRange(raysCount, [&](uint32_t begin, uint32_t end, uint32_t)
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					wideBVH.TraceRay(rayOrigins[i], rayDirections[i], wideDistances[i]);
+				}
+			}, threadsCount);
+			const double raysPerSecond = raysCount / (GetMilliseconds(measureStart) * 1000.0);
+			countDifferentHits();
+			return raysPerSecond;
+		};
+
+		const double binaryIncoherent = measureBinary(origins, directions);
+		const double wideIncoherent = measureWide(origins, directions);
+		const double binaryCoherent = measureBinary(packetOrigins, packetDirections);
+		const double wideCoherent = measureWide(packetOrigins, packetDirections);
+
+		double widePackets;
+		{
+			start = std::chrono::high_resolution_clock::now();
+			ParallelForRange(raysCount / packetSize, [&](uint32_t begin, uint32_t end, uint32_t)
+			{
+				uint32_t packetHits[packetSize];
+				for (uint32_t i = begin; i < end; i++)
+				{
+					wideBVH.TracePacket(&packetOrigins[i * packetSize], &packetDirections[i * packetSize], &wideDistances[i * packetSize], packetHits);
+				}
+			}, threadsCount);
+			widePackets = raysCount / (GetMilliseconds(start) * 1000.0);
+			countDifferentHits();
+		}
+
+		const size_t binaryMemory =
+			trianglesCount * (3 * sizeof(jmath::vec3) + sizeof(uint32_t) + sizeof(AABB) + sizeof(LeafNode)) +
+			(trianglesCount - 1) * (sizeof(InternalNode) + sizeof(AABB));
+
+		Logger::LogFormat("BVH%u %u triangles, %s kernels: collapse %.3f ms, %u nodes, %.2f MB (binary %.2f MB)\n",
+		                  Width, trianglesCount, wideBVH.m_useAVX2 ? "AVX2" : "scalar",
+		                  collapseTime, wideBVH.GetNodesCount(),
+		                  wideBVH.GetMemorySize() / (1024.0 * 1024.0),
+		                  binaryMemory / (1024.0 * 1024.0));
+		Logger::LogFormat("    incoherent Mrays/s: binary %.2f, BVH%u %.2f\n", binaryIncoherent, Width, wideIncoherent);
+		Logger::LogFormat("    coherent Mrays/s: binary %.2f, BVH%u %.2f, BVH%u packets of %u %.2f\n",
+		                  binaryCoherent, Width, wideCoherent, Width, packetSize, widePackets);
+		Logger::LogFormat("    %u of %u rays hit at different distance\n", differentHits, raysCount * 3);
+		return differentHits == 0;
+	}
+
+	template <uint32_t Width>
+	void CpuWideBVH<Width>::AddBenchmarks(BenchmarkSuite& suite)
+	{
+		constexpr uint32_t trianglesCount = 1 << 18;
+		constexpr uint32_t raysCount = 1 << 16;
+		constexpr uint32_t threadsCount = 1; // results shouldn't depend on the machine load
+
+		struct WideData
+		{
+			// Member initializers of a local class in a template can't use the constants of the function
+			WideData(uint32_t triangles, uint32_t rays) :
+				vertices(triangles * 3),
+				triangleAABB(triangles),
+				sortedTriangleIndices(triangles),
+				internalNodes(triangles - 1),
+				leafNodes(triangles),
+				bvhData(triangles - 1),
+				origins(rays),
+				directions(rays),
+				packetOrigins(rays),
+				packetDirections(rays),
+				distances(rays),
+				hits(rays)
+			{
+			}
+
+			std::vector<jmath::vec3> vertices;
+			std::vector<AABB> triangleAABB;
+			std::vector<uint32_t> sortedTriangleIndices;
+			std::vector<InternalNode> internalNodes;
+			std::vector<LeafNode> leafNodes;
+			std::vector<AABB> bvhData;
+			std::unique_ptr<CpuWideBVH> wideBVH;
+
+			std::vector<jmath::vec3> origins;
+			std::vector<jmath::vec3> directions;
+			std::vector<jmath::vec3> packetOrigins;
+			std::vector<jmath::vec3> packetDirections;
+			std::vector<float> distances;
+			std::vector<uint32_t> hits;
+
+			void Collapse()
+			{
+				wideBVH = std::make_unique<CpuWideBVH>(
+					vertices.data(), sortedTriangleIndices.data(), triangleAABB.data(), static_cast<uint32_t>(triangleAABB.size()),
+					internalNodes.data(), leafNodes.data(), bvhData.data());
+			}
+		};
+		auto data = std::make_shared<WideData>(trianglesCount, raysCount);
+
+		GenerateRandomTriangles(trianglesCount, 0.1f, 5.0f, trianglesCount, data->vertices.data(), data->triangleAABB.data());
+		CpuSAHBVHBuilder::Construct(
+			data->triangleAABB.data(), trianglesCount,
+			data->sortedTriangleIndices.data(), data->internalNodes.data(), data->leafNodes.data(), data->bvhData.data(),
+			threadsCount);
+		data->Collapse();
+		GenerateRandomRays(raysCount, raysCount, data->origins.data(), data->directions.data());
+		MakeCoherentRays(raysCount, packetSize, data->origins.data(), data->directions.data(), data->packetOrigins.data(), data->packetDirections.data());
+
+		const std::string prefix = "WideBVH" + std::to_string(Width) + "/";
+		suite.Add((prefix + "Collapse").c_str(), trianglesCount, [data]()
+		{
+			data->Collapse();
+		});
+
+		for (const bool isCoherent : {false, true})
+		{
+			const std::string rays = isCoherent ? "Coherent" : "";
+			const jmath::vec3* origins = isCoherent ? data->packetOrigins.data() : data->origins.data();
+			const jmath::vec3* directions = isCoherent ? data->packetDirections.data() : data->directions.data();
+
+			suite.Add((prefix + "TraceRay" + rays).c_str(), raysCount, [data, origins, directions]()
+			{
+				for (uint32_t i = 0; i < raysCount; i++)
+				{
+					data->hits[i] = data->wideBVH->TraceRay(origins[i], directions[i], data->distances[i]);
+				}
+			});
+
+			// Binary traversal is the same for both widths
+			if constexpr (Width == 8)
+			{
+				suite.Add((prefix + "TraceRay" + rays + "Binary").c_str(), raysCount, [data, origins, directions]()
+				{
+					for (uint32_t i = 0; i < raysCount; i++)
+					{
+						data->distances[i] = std::numeric_limits<float>::max();
+						data->hits[i] = TraceClosestHit(
+							origins[i], directions[i],
+							data->vertices.data(), data->sortedTriangleIndices.data(), data->triangleAABB.data(), trianglesCount,
+							data->internalNodes.data(), data->leafNodes.data(), data->bvhData.data(),
+							data->distances[i]);
+					}
+				});
+			}
+		}
+
+		suite.Add((prefix + "TracePacketCoherent").c_str(), raysCount, [data]()
+		{
+			for (uint32_t i = 0; i < raysCount; i += packetSize)
+			{
+				data->wideBVH->TracePacket(&data->packetOrigins[i], &data->packetDirections[i], &data->distances[i], &data->hits[i]);
+			}
+		});
+	}
+
+	template class CpuWideBVH<4>;
+	template class CpuWideBVH<8>;
+}
@@ -0,0 +1,115 @@
+#ifndef CPU_WIDE_BVH_H
+#define CPU_WIDE_BVH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "CommonEngineStructs.h"
+#include "Common/Math/MathBatch.h"
+
+namespace JoyEngine
+{
+	class BenchmarkSuite;
+
+	// Binary scene tree collapsed to Width children per node for cpu ray queries.
+	// Child bounds are stored per axis (SoA) and quantized to 8 bits relative to the node bounds,
+	// so one node is tested against a ray with a few vector instructions.
+	// Kernels use AVX2 when the cpu supports it and fall back to scalar code otherwise.
+	template <uint32_t Width>
+	class CpuWideBVH
+	{
+	public:
+		static_assert(Width == 4 || Width == 8);
+
+		static constexpr uint32_t packetSize = 8;
+		static constexpr uint32_t leafFlag = 1u << 31;
+		static constexpr uint32_t emptyChild = MAX_UINT;
+
+		// Child c bounds are origin + q[axis][c] * scale. Scales are powers of two,
+		// so decoding is exact and the quantized bounds always contain the original ones.
+		// Empty slots have min 255 and max 0, they never pass the slab test
+		struct alignas(64) Node
+		{
+			float origin[3];
+			float scale[3];
+			uint8_t qmin[3][Width];
+			uint8_t qmax[3][Width];
+			uint32_t children[Width]; // wide node index, leafFlag | triangle position or emptyChild
+		};
+
+		CpuWideBVH() = delete;
+
+		// Collapses the binary tree. Triangles are copied in leaf order, triangleVertices holds 3 vertices per triangle
+		CpuWideBVH(
+			const jmath::vec3* triangleVertices,
+			const uint32_t* sortedTriangleIndices,
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			const InternalNode* internalNodes,
+			const LeafNode* leafNodes,
+			const AABB* bvhData);
+
+		// Closest hit in front of the origin, same result as TraceClosestHit on the binary tree.
+		// Returns original triangle index or MAX_UINT
+		uint32_t TraceRay(jmath::vec3 origin, jmath::vec3 dir, float& distance) const;
+
+		// packetSize rays traversed together, coherent rays share most of the nodes
+		void TracePacket(const jmath::vec3* origins, const jmath::vec3* directions, float* distances, uint32_t* hits) const;
+
+		[[nodiscard]] uint32_t GetNodesCount() const noexcept { return static_cast<uint32_t>(m_nodes.size()); }
+		[[nodiscard]] size_t GetMemorySize() const noexcept;
+
+		[[nodiscard]] static bool IsAVX2Supported();
+
+		// Logs collapse time, memory and cpu rays per second of binary and wide traversal
+		// for incoherent rays and for coherent packets. Returns false when any of them finds other hits than binary traversal
+		static bool CompareWithBinary(
+			const jmath::vec3* triangleVertices,
+			const uint32_t* sortedTriangleIndices,
+			const AABB* triangleAABB,
+			uint32_t trianglesCount,
+			const InternalNode* internalNodes,
+			const LeafNode* leafNodes,
+			const AABB* bvhData,
+			uint32_t raysCount = 1 << 18,
+			uint32_t threadsCount = 0);
+
+		// Collapse, single rays and packets against binary traversal, over SAH tree of random triangles about Sponza size
+		static void AddBenchmarks(BenchmarkSuite& suite);
+
+	private:
+		struct BinaryTree
+		{
+			const jmath::vec3* triangleVertices;
+			const uint32_t* sortedTriangleIndices;
+			const AABB* triangleAABB;
+			const InternalNode* internalNodes;
+			const LeafNode* leafNodes;
+			const AABB* bvhData;
+		};
+
+		struct ChildRef
+		{
+			uint32_t index;
+			uint32_t type; // INTERNAL_NODE or LEAF_NODE of the binary tree
+		};
+
+		// Opens binary children with the largest area until the wide node is full, returns wide node index
+		uint32_t Collapse(const BinaryTree& tree, ChildRef ref, uint32_t depth);
+
+		uint32_t TraceRayScalar(const jmath::vec3& origin, const jmath::vec3& dir, float& distance) const;
+		JMATH_TARGET_AVX2 uint32_t TraceRayAVX2(const jmath::vec3& origin, const jmath::vec3& dir, float& distance) const;
+		JMATH_TARGET_AVX2 void TracePacketAVX2(const jmath::vec3* origins, const jmath::vec3* directions, float* distances, uint32_t* hits) const;
+
+		std::vector<Node> m_nodes;
+		std::vector<jmath::vec3> m_triangleVertices; // in leaf order
+		std::vector<uint32_t> m_triangleIndices; // leaf order to original triangle index
+		uint32_t m_maxDepth = 0;
+
+		const bool m_useAVX2;
+	};
+
+	extern template class CpuWideBVH<4>;
+	extern template class CpuWideBVH<8>;
+}
+#endif // CPU_WIDE_BVH_H
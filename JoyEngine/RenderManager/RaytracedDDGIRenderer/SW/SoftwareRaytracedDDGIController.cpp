@@ -1,12 +1,23 @@
 #include "SoftwareRaytracedDDGIController.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "BVHUtils.h"
+#include "CpuBVHBuilder.h"
+#include "CpuBVHRefitter.h"
+#include "CpuSAHBVHBuilder.h"
 #include "Common/HashDefs.h"
 #include "ResourceManager/ResourceManager.h"
 #include "Components/MeshRenderer.h"
 #include "DescriptorManager/DescriptorManager.h"
 #include "EngineDataProvider/EngineDataProvider.h"
 #include "SceneManager/GameObject.h"
+#include "SceneManager/Scene.h"
 #include "SceneManager/Transform.h"
+#include "SceneManager/WorldManager.h"
+#include "Utils/Assert.h"
 #include "Utils/GraphicsUtils.h"
 #include "Utils/Log.h"
 #include "Utils/TimeCounter.h"
@@ -15,61 +26,23 @@
 
 namespace JoyEngine
 {
-	const AABB g_sceneAabb = {
-		.min = jmath::vec3(-50.0f, -30.0f, -50.0f),
-		.max = jmath::vec3(50.0f, 50.0f, 50.0f),
-	};
-
-	uint32_t ExpandBits(uint32_t v)
-	{
-		v = (v * 0x00010001) & 0xFF0000FF;
-		v = (v * 0x00000101) & 0x0F00F00F;
-		v = (v * 0x00000011) & 0xC30C30C3;
-		v = (v * 0x00000005) & 0x49249249;
-		return v;
-	}
-
-	uint32_t Morton3D(float x, float y, float z)
-	{
-		x = std::min(std::max(x * 1024.0f, 0.0f), 1023.0f);
-		y = std::min(std::max(y * 1024.0f, 0.0f), 1023.0f);
-		z = std::min(std::max(z * 1024.0f, 0.0f), 1023.0f);
-		uint32_t xx = ExpandBits(static_cast<uint32_t>(x));
-		uint32_t yy = ExpandBits(static_cast<uint32_t>(y));
-		uint32_t zz = ExpandBits(static_cast<uint32_t>(z));
-		return xx * 4 + yy * 2 + zz;
-	}
-
-	void GetCentroidAndAABB(jmath::vec3 a, jmath::vec3 b, jmath::vec3 c, jmath::vec3* centroid, AABB* aabb)
-	{
-		jmath::vec3 min = jmath::vec3(
-			std::min(std::min(a.x, b.x), c.x) - 0.001f,
-			std::min(std::min(a.y, b.y), c.y) - 0.001f,
-			std::min(std::min(a.z, b.z), c.z) - 0.001f
-		);
-		jmath::vec3 max = jmath::vec3(
-			std::max(std::max(a.x, b.x), c.x) + 0.001f,
-			std::max(std::max(a.y, b.y), c.y) + 0.001f,
-			std::max(std::max(a.z, b.z), c.z) + 0.001f
-		);
-
-		*centroid = (min + max) * 0.5f;
-		*aabb = {
-			.min = min,
-			.max = max,
-		};
-	}
-
-	jmath::vec3 NormalizeCentroid(jmath::vec3 centroid)
+	namespace
 	{
-		jmath::vec3 ret = centroid;
-		ret.x -= g_sceneAabb.min.x;
-		ret.y -= g_sceneAabb.min.y;
-		ret.z -= g_sceneAabb.min.z;
-		ret.x /= (g_sceneAabb.max.x - g_sceneAabb.min.x);
-		ret.y /= (g_sceneAabb.max.y - g_sceneAabb.min.y);
-		ret.z /= (g_sceneAabb.max.z - g_sceneAabb.min.z);
-		return ret;
+		void GetTriangleVertices(const Mesh* mesh, const jmath::mat4x4& modelMatrix, uint32_t triangle, jmath::vec3& a, jmath::vec3& b, jmath::vec3& c)
+		{
+			const Vertex* vertices = mesh->GetVertices();
+			const uint32_t* indices = mesh->GetIndices();
+
+			a = jmath::toVec3(jmath::mul(
+				modelMatrix,
+				jmath::loadPosition(jmath::toVec3(vertices[indices[triangle * 3 + 0]].pos))));
+			b = jmath::toVec3(jmath::mul(
+				modelMatrix,
+				jmath::loadPosition(jmath::toVec3(vertices[indices[triangle * 3 + 1]].pos))));
+			c = jmath::toVec3(jmath::mul(
+				modelMatrix,
+				jmath::loadPosition(jmath::toVec3(vertices[indices[triangle * 3 + 2]].pos))));
+		}
 	}
 
 	SoftwareRaytracedDDGIController::SoftwareRaytracedDDGIController(
@@ -83,38 +56,13 @@ namespace JoyEngine
 		m_raytracedTextureWidth(width),
 		m_raytracedTextureHeight(height)
 #else
-		m_raytracedTextureWidth(g_raytracedProbesData.gridX * g_raytracedProbesData.gridY * g_raytracedProbesData.gridZ),
+		m_raytracedTextureWidth(ProbeCascades::GetProbesCount(g_raytracedProbesData)),
 		m_raytracedTextureHeight(DDGI_RAYS_COUNT)
 #endif
 	{
 		static_assert(sizeof(TrianglePayload) == 16);
 		static_assert(sizeof(AABB) == 32);
 
-		m_keysBuffer = std::make_unique<DataBuffer<uint32_t>>(DATA_ARRAY_COUNT, MAX_UINT);
-		m_triangleIndexBuffer = std::make_unique<DataBuffer<uint32_t>>(DATA_ARRAY_COUNT, MAX_UINT);
-		m_triangleAABBBuffer = std::make_unique<DataBuffer<AABB>>(DATA_ARRAY_COUNT);
-
-		m_bvhDataBuffer = std::make_unique<DataBuffer<AABB>>(DATA_ARRAY_COUNT);
-		m_bvhLeafNodesBuffer = std::make_unique<DataBuffer<LeafNode>>(DATA_ARRAY_COUNT);
-		m_bvhInternalNodesBuffer = std::make_unique<DataBuffer<InternalNode>>(DATA_ARRAY_COUNT);
-
-		m_bufferSorter = std::make_unique<BufferSorter>(
-			m_trianglesLength,
-			m_keysBuffer.get(),
-			m_triangleIndexBuffer.get(),
-			m_dataContainer.GetDispatcher());
-
-		m_bvhConstructor = std::make_unique<BVHConstructor>(
-			m_keysBuffer.get(),
-			m_triangleIndexBuffer.get(),
-			m_triangleAABBBuffer.get(),
-			m_bvhInternalNodesBuffer.get(),
-			m_bvhLeafNodesBuffer.get(),
-			m_bvhDataBuffer.get(),
-			m_dataContainer.GetDispatcher(),
-			&m_bvhConstructionData
-		);
-
 		// Raytracing texture resources
 		// TODO move to Data container
 		{
@@ -127,7 +75,7 @@ namespace JoyEngine
 
 			m_probeIrradianceTexture = std::make_unique<UAVTexture>(
 				g_raytracedProbesData.gridX * g_raytracedProbesData.gridY * (DDGI_PROBE_DATA_RESOLUTION + 2),
-				g_raytracedProbesData.gridZ * (DDGI_PROBE_DATA_RESOLUTION + 2),
+				g_raytracedProbesData.gridZ * DDGI_CASCADES_COUNT * (DDGI_PROBE_DATA_RESOLUTION + 2),
 				DXGI_FORMAT_R11G11B10_FLOAT,
 				D3D12_RESOURCE_STATE_GENERIC_READ,
 				D3D12_HEAP_TYPE_DEFAULT
@@ -135,7 +83,7 @@ namespace JoyEngine
 
 			m_probeDepthTexture = std::make_unique<UAVTexture>(
 				g_raytracedProbesData.gridX * g_raytracedProbesData.gridY * (DDGI_PROBE_DATA_RESOLUTION + 2),
-				g_raytracedProbesData.gridZ * (DDGI_PROBE_DATA_RESOLUTION + 2),
+				g_raytracedProbesData.gridZ * DDGI_CASCADES_COUNT * (DDGI_PROBE_DATA_RESOLUTION + 2),
 				DXGI_FORMAT_R16G16_FLOAT,
 				D3D12_RESOURCE_STATE_GENERIC_READ,
 				D3D12_HEAP_TYPE_DEFAULT
@@ -176,84 +124,318 @@ namespace JoyEngine
 	}
 
 
+	void SoftwareRaytracedDDGIController::AllocateSceneBuffers()
+	{
+		uint32_t trianglesCount = 0;
+		for (const MeshRenderer* mr : m_dataContainer.GetRaytracedMeshRenderers())
+		{
+			trianglesCount += mr->GetMesh()->GetIndexCount() / 3;
+		}
+
+		// Buffers hold trianglesCount elements, internal nodes and their bounds one less.
+		// At least one element each, so views can be created for an empty scene
+		const uint32_t leavesCount = std::max(trianglesCount, 1u);
+		const uint32_t internalNodesCount = std::max(trianglesCount, 2u) - 1;
+
+		m_keysBuffer = std::make_unique<DataBuffer<uint64_t>>(leavesCount, std::numeric_limits<uint64_t>::max());
+		m_triangleIndexBuffer = std::make_unique<DataBuffer<uint32_t>>(leavesCount, MAX_UINT);
+		m_triangleAABBBuffer = std::make_unique<DataBuffer<AABB>>(leavesCount);
+
+		m_bvhDataBuffer = std::make_unique<DataBuffer<AABB>>(internalNodesCount);
+		m_bvhLeafNodesBuffer = std::make_unique<DataBuffer<LeafNode>>(leavesCount);
+		m_bvhInternalNodesBuffer = std::make_unique<DataBuffer<InternalNode>>(internalNodesCount);
+
+		m_bufferSorter = std::make_unique<BufferSorter>(
+			trianglesCount,
+			m_keysBuffer.get(),
+			m_triangleIndexBuffer.get(),
+			m_dataContainer.GetDispatcher(),
+			MORTON_CODE_BITS);
+
+		m_bvhConstructor = std::make_unique<BVHConstructor>(
+			trianglesCount,
+			m_keysBuffer.get(),
+			m_triangleIndexBuffer.get(),
+			m_triangleAABBBuffer.get(),
+			m_bvhInternalNodesBuffer.get(),
+			m_bvhLeafNodesBuffer.get(),
+			m_bvhDataBuffer.get(),
+			m_dataContainer.GetDispatcher(),
+			&m_bvhConstructionData
+		);
+	}
+
 	void SoftwareRaytracedDDGIController::UploadSceneData()
 	{
 		{
 			TIME_PERF("Uploading software DDGI scene data")
 
-			for (auto const& sm : m_dataContainer.GetSceneSharedMaterials())
-			{
-				for (const auto& mr : sm->GetMeshRenderers())
-				{
-					if (!mr->IsStatic()) continue;
+			m_trianglesLength = 0;
+			m_dynamicMeshes.clear();
 
-					const uint32_t meshTrianglesLength = mr->GetMesh()->GetIndexCount() / 3;
+			AllocateSceneBuffers();
 
-					const Vertex* vertices = mr->GetMesh()->GetVertices();
-					const uint32_t* indices = mr->GetMesh()->GetIndices();
+			for (const MeshRenderer* mr : m_dataContainer.GetRaytracedMeshRenderers())
+			{
+				const uint32_t meshTrianglesLength = mr->GetMesh()->GetIndexCount() / 3;
+				const auto& modelMatrix = mr->GetGameObject().GetTransform().GetModelMatrix();
 
-					const auto& modelMatrix = mr->GetGameObject().GetTransform().GetModelMatrix();
+				if (!mr->IsStatic())
+				{
+					m_dynamicMeshes.push_back({
+						.meshRenderer = mr,
+						.firstTriangle = m_trianglesLength,
+						.trianglesCount = meshTrianglesLength,
+						.modelMatrix = modelMatrix
+					});
+				}
 
-					for (uint32_t i = 0; i < meshTrianglesLength; i++, m_trianglesLength++)
-					{
-						jmath::vec3 a = jmath::toVec3(jmath::mul(
-							modelMatrix,
-							jmath::loadPosition(jmath::toVec3(vertices[indices[i * 3 + 0]].pos))));
-						jmath::vec3 b = jmath::toVec3(jmath::mul(
-							modelMatrix,
-							jmath::loadPosition(jmath::toVec3(vertices[indices[i * 3 + 1]].pos))));
-						jmath::vec3 c = jmath::toVec3(jmath::mul(
-							modelMatrix,
-							jmath::loadPosition(jmath::toVec3(vertices[indices[i * 3 + 2]].pos))));
-
-						jmath::vec3 centroid;
-						AABB aabb = {};
-
-						GetCentroidAndAABB(a, b, c, &centroid, &aabb);
-						centroid = NormalizeCentroid(centroid);
-						const uint32_t mortonCode = Morton3D(centroid.x, centroid.y, centroid.z);
-						m_keysBuffer->GetLocalData()[m_trianglesLength] = mortonCode;
-						m_triangleIndexBuffer->GetLocalData()[m_trianglesLength] = m_trianglesLength;
-						m_triangleAABBBuffer->GetLocalData()[m_trianglesLength] = aabb;
-					}
+				for (uint32_t i = 0; i < meshTrianglesLength; i++, m_trianglesLength++)
+				{
+					jmath::vec3 a, b, c;
+					GetTriangleVertices(mr->GetMesh(), modelMatrix, i, a, b, c);
+
+					jmath::vec3 centroid;
+					GetCentroidAndAABB(a, b, c, &centroid, &m_triangleAABBBuffer->GetLocalData()[m_trianglesLength]);
 				}
 			}
 
-			m_keysBuffer->UploadCpuData();
-			m_triangleIndexBuffer->UploadCpuData();
 			m_triangleAABBBuffer->UploadCpuData();
 			m_bvhConstructionData.SetData({.trianglesCount = m_trianglesLength});
 		}
 
-		Logger::LogFormat("Triangles length %d\n", m_trianglesLength);
+		Logger::LogFormat("Triangles length %d, dynamic meshes %d\n", m_trianglesLength, static_cast<uint32_t>(m_dynamicMeshes.size()));
+
+		m_bvhBuilderType = WorldManager::Get()->GetScene()->GetBVHBuilderType();
+
+		m_bvhRefitter = m_dynamicMeshes.empty()
+			                ? nullptr
+			                : std::make_unique<CpuBVHRefitter>(
+				                m_triangleIndexBuffer->GetLocalData(),
+				                m_triangleAABBBuffer->GetLocalData(),
+				                m_trianglesLength,
+				                m_bvhInternalNodesBuffer->GetLocalData(),
+				                m_bvhLeafNodesBuffer->GetLocalData(),
+				                m_bvhDataBuffer->GetLocalData());
+
+		// Refit changes dynamic triangles and at most every node in a frame
+		if (m_bvhRefitter != nullptr)
+		{
+			m_sceneDataUploadRing = std::make_unique<UploadRingBuffer>(
+				sizeof(AABB) * (m_trianglesLength - m_dynamicMeshes.front().firstTriangle + m_trianglesLength - 1),
+				WorldManager::Get()->GetRenderer().GetFrameCount());
+		}
+
+		BuildBVH();
+	}
+
+	bool SoftwareRaytracedDDGIController::ValidateSceneData()
+	{
+		if (m_trianglesLength < 2) return true;
+
+		TIME_PERF("Validating software DDGI BVH")
 
+		// Readback overwrites cpu data, so refit of this frame has to reach gpu first. Gpu is idle, blocking upload is fine
+		if (m_isSceneDataChanged)
 		{
-			TIME_PERF("Prepare Scene BVH")
+			const uint32_t firstDynamicTriangle = m_dynamicMeshes.front().firstTriangle;
+			m_triangleAABBBuffer->UploadCpuData(firstDynamicTriangle, m_trianglesLength - firstDynamicTriangle);
 
-			m_bufferSorter->Sort();
+			uint32_t firstNode, nodesCount;
+			if (m_bvhRefitter->PopChangedNodesRange(firstNode, nodesCount))
+			{
+				m_bvhDataBuffer->UploadCpuData(firstNode, nodesCount);
+			}
+			m_isSceneDataChanged = false;
+		}
+
+		m_keysBuffer->ReadbackGpuData();
+		m_triangleIndexBuffer->ReadbackGpuData();
+		m_bvhInternalNodesBuffer->ReadbackGpuData();
+		m_bvhLeafNodesBuffer->ReadbackGpuData();
+		m_bvhDataBuffer->ReadbackGpuData();
 
+		bool isValid = CpuBVHBuilder::Validate(
+			m_triangleIndexBuffer->GetLocalData(),
+			m_triangleAABBBuffer->GetLocalData(),
+			m_trianglesLength,
+			m_bvhInternalNodesBuffer->GetLocalData(),
+			m_bvhLeafNodesBuffer->GetLocalData(),
+			m_bvhDataBuffer->GetLocalData());
+
+		// Gpu LBVH has to be the same tree as cpu one built from the same sorted keys
+		if (m_bvhBuilderType == BVHBuilderType::LBVH)
+		{
+			std::vector<InternalNode> cpuInternalNodes(m_trianglesLength - 1);
+			std::vector<LeafNode> cpuLeafNodes(m_trianglesLength);
+			std::vector<AABB> cpuBvhData(m_trianglesLength - 1);
+
+			CpuBVHBuilder::ConstructTree(
+				m_keysBuffer->GetLocalData(),
+				m_trianglesLength,
+				cpuInternalNodes.data(),
+				cpuLeafNodes.data());
+			CpuBVHBuilder::ConstructBVH(
+				m_triangleIndexBuffer->GetLocalData(),
+				m_triangleAABBBuffer->GetLocalData(),
+				m_trianglesLength,
+				cpuInternalNodes.data(),
+				cpuLeafNodes.data(),
+				cpuBvhData.data());
+
+			isValid &= CpuBVHBuilder::Compare(
+				m_trianglesLength,
+				cpuInternalNodes.data(),
+				cpuLeafNodes.data(),
+				cpuBvhData.data(),
+				m_bvhInternalNodesBuffer->GetLocalData(),
+				m_bvhLeafNodesBuffer->GetLocalData(),
+				m_bvhDataBuffer->GetLocalData()) == 0;
+		}
+
+		Logger::LogFormat(isValid ? LogLevel::Info : LogLevel::Error, "Software DDGI BVH of %u triangles: depth %u, SAH %.2f, %s\n",
+		                  m_trianglesLength,
+		                  CpuBVHBuilder::ComputeMaxDepth(m_trianglesLength, m_bvhInternalNodesBuffer->GetLocalData()),
+		                  CpuBVHBuilder::ComputeSAHCost(
+			                  m_triangleIndexBuffer->GetLocalData(),
+			                  m_triangleAABBBuffer->GetLocalData(),
+			                  m_trianglesLength,
+			                  m_bvhLeafNodesBuffer->GetLocalData(),
+			                  m_bvhDataBuffer->GetLocalData()),
+		                  isValid ? "valid" : "INVALID");
+		return isValid;
+	}
+
+	void SoftwareRaytracedDDGIController::UpdateSceneData()
+	{
+		if (m_bvhRefitter == nullptr || m_isSceneRebuildRequired) return;
+
+		bool isChanged = false;
+		for (DynamicMesh& dm : m_dynamicMeshes)
+		{
+			const auto& modelMatrix = dm.meshRenderer->GetGameObject().GetTransform().GetModelMatrix();
+			if (memcmp(&modelMatrix, &dm.modelMatrix, sizeof(jmath::mat4x4)) == 0) continue;
+
+			dm.modelMatrix = modelMatrix;
+			isChanged = true;
+
+			for (uint32_t i = 0; i < dm.trianglesCount; i++)
 			{
-				// Update keys array. Now we guarantee all the elements are unique
-				m_keysBuffer->ReadbackGpuData();
+				jmath::vec3 a, b, c;
+				GetTriangleVertices(dm.meshRenderer->GetMesh(), modelMatrix, i, a, b, c);
 
-				uint32_t* keysArray = m_keysBuffer->GetLocalData();
+				jmath::vec3 centroid;
+				AABB aabb;
+				GetCentroidAndAABB(a, b, c, &centroid, &aabb);
+				m_bvhRefitter->UpdateTriangle(dm.firstTriangle + i, aabb);
+			}
+		}
 
-				uint32_t newCurrentValue = 0;
-				uint32_t oldCurrentValue = keysArray[0];
-				keysArray[0] = newCurrentValue;
+		if (!isChanged) return;
 
-				for (uint32_t i = 1; i < m_trianglesLength; i++)
-				{
-					newCurrentValue += std::max(keysArray[i] - oldCurrentValue, 1u);
-					oldCurrentValue = keysArray[i];
-					keysArray[i] = newCurrentValue;
-				}
+		if (m_bvhRefitter->IsRebuildRequired())
+		{
+			Logger::LogFormat("Software DDGI BVH degraded to %.2f of built SAH cost, rebuilding\n", m_bvhRefitter->GetDegradation());
+			m_isSceneRebuildRequired = true;
+			return;
+		}
+
+		m_isSceneDataChanged = true;
+	}
 
-				m_keysBuffer->UploadCpuData();
+	void SoftwareRaytracedDDGIController::RecordSceneDataUpload(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex)
+	{
+		if (!m_isSceneDataChanged) return;
+		m_isSceneDataChanged = false;
+
+		// Part of the ring is free, renderer waited for the fence of the frame that used it.
+		// Copies go after the reads of frames in flight on the queue, so none of them sees a mix of old and new bounds
+		m_sceneDataUploadRing->BeginFrame(frameIndex);
+
+		// Dynamic meshes triangles are the last ones
+		const uint32_t firstDynamicTriangle = m_dynamicMeshes.front().firstTriangle;
+		bool isRecorded = m_triangleAABBBuffer->UploadCpuData(
+			*m_sceneDataUploadRing, commandList,
+			firstDynamicTriangle, m_trianglesLength - firstDynamicTriangle);
+
+		uint32_t firstNode, nodesCount;
+		if (m_bvhRefitter->PopChangedNodesRange(firstNode, nodesCount))
+		{
+			isRecorded &= m_bvhDataBuffer->UploadCpuData(*m_sceneDataUploadRing, commandList, firstNode, nodesCount);
+		}
+		ASSERT_DESC(isRecorded, "Scene data upload ring is smaller than refit data");
+	}
+
+	void SoftwareRaytracedDDGIController::RebuildSceneData()
+	{
+		TIME_PERF("Rebuilding software DDGI BVH")
+
+		// Whole bounds buffer goes to gpu, changed nodes are reset by the build
+		m_triangleAABBBuffer->UploadCpuData();
+		BuildBVH();
+		m_isSceneRebuildRequired = false;
+		m_isSceneDataChanged = false;
+	}
+
+	void SoftwareRaytracedDDGIController::BuildBVH()
+	{
+		// Keys and indices are computed from the current triangle bounds, so rebuild after refit sees moved triangles
+		{
+			uint64_t* keys = m_keysBuffer->GetLocalData();
+			uint32_t* triangleIndices = m_triangleIndexBuffer->GetLocalData();
+			const AABB* triangleAABB = m_triangleAABBBuffer->GetLocalData();
+			for (uint32_t i = 0; i < m_trianglesLength; i++)
+			{
+				const jmath::vec3 centroid = NormalizeCentroid((triangleAABB[i].min + triangleAABB[i].max) * 0.5f);
+				keys[i] = Morton3D64(centroid.x, centroid.y, centroid.z);
+				triangleIndices[i] = i;
 			}
+		}
+
+		if (m_bvhBuilderType == BVHBuilderType::SAH)
+		{
+			TIME_PERF("Prepare Scene BVH (SAH)")
+
+			CpuSAHBVHBuilder::Construct(
+				m_triangleAABBBuffer->GetLocalData(),
+				m_trianglesLength,
+				m_triangleIndexBuffer->GetLocalData(),
+				m_bvhInternalNodesBuffer->GetLocalData(),
+				m_bvhLeafNodesBuffer->GetLocalData(),
+				m_bvhDataBuffer->GetLocalData());
+
+			m_triangleIndexBuffer->UploadCpuData();
+			m_bvhInternalNodesBuffer->UploadCpuData();
+			m_bvhLeafNodesBuffer->UploadCpuData();
+			m_bvhDataBuffer->UploadCpuData();
+		}
+		else
+		{
+			TIME_PERF("Prepare Scene BVH (LBVH)")
+
+			m_keysBuffer->UploadCpuData();
+			m_triangleIndexBuffer->UploadCpuData();
+
+			// Keys may repeat, tree construction tells equal keys apart by their index,
+			// so sorted keys go to the tree constructor without a round trip to cpu
+			m_bufferSorter->Sort();
 
 			m_bvhConstructor->ConstructTree();
 			m_bvhConstructor->ConstructBVH();
+
+			// Refit works on cpu copy of the tree
+			if (m_bvhRefitter != nullptr)
+			{
+				m_triangleIndexBuffer->ReadbackGpuData();
+				m_bvhInternalNodesBuffer->ReadbackGpuData();
+				m_bvhLeafNodesBuffer->ReadbackGpuData();
+				m_bvhDataBuffer->ReadbackGpuData();
+			}
+		}
+
+		if (m_bvhRefitter != nullptr)
+		{
+			m_bvhRefitter->OnTreeBuilt();
 		}
 	}
 
@@ -281,6 +463,10 @@ namespace JoyEngine
 			GraphicsUtils::AttachView(commandList, m_raytracingPipeline.get(), "objectVertices", EngineDataProvider::Get()->GetMeshContainer()->GetVertexBufferSRV());
 			GraphicsUtils::AttachView(commandList, m_raytracingPipeline.get(), "objectIndices", EngineDataProvider::Get()->GetMeshContainer()->GetIndexBufferSRV());
 			GraphicsUtils::AttachView(commandList, m_raytracingPipeline.get(), "raytracedProbesData", m_dataContainer.GetProbesDataView(frameIndex));
+#if !defined(CAMERA_TRACE)
+			GraphicsUtils::AttachView(commandList, m_raytracingPipeline.get(), "scheduledProbes", m_dataContainer.GetScheduledProbesView(frameIndex));
+			GraphicsUtils::AttachView(commandList, m_raytracingPipeline.get(), "probeRelocationData", m_dataContainer.GetProbeRelocationView(frameIndex));
+#endif
 
 			GraphicsUtils::ProcessEngineBindings(
 				commandList,
@@ -292,7 +478,7 @@ namespace JoyEngine
 #if defined(CAMERA_TRACE)
 		commandList->Dispatch((m_raytracedTextureWidth / 32) + 1, (m_raytracedTextureHeight / 32) + 1, 1);
 #else
-		commandList->Dispatch(g_raytracedProbesData.gridX, g_raytracedProbesData.gridY, g_raytracedProbesData.gridZ);
+		commandList->Dispatch(m_dataContainer.GetScheduledProbesCount(), 1, 1);
 #endif
 
 		m_gbuffer->BarrierColorToRead(commandList);
@@ -336,7 +522,7 @@ namespace JoyEngine
 
 		commandList->DrawInstanced(
 			24,
-			DATA_ARRAY_COUNT,
+			m_trianglesLength > 1 ? m_trianglesLength - 1 : 0,
 			0, 0);
 	}
 
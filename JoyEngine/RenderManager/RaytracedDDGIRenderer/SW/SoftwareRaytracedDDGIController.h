@@ -4,13 +4,17 @@
 #include <d3d12.h>
 
 #include <memory>
+#include <vector>
+
 #include "CommonEngineStructs.h"
 #include "BufferSorter.h"
 #include "BVHConstructor.h"
+#include "CpuBVHRefitter.h"
 #include "RenderManager/GBuffer.h"
 #include "RenderManager/RaytracedDDGIRenderer/AbstractRaytracedDDGIController.h"
 #include "RenderManager/RaytracedDDGIRenderer/RaytracedDDGIDataContainer.h"
 #include "ResourceManager/SharedMaterial.h"
+#include "SceneManager/Scene.h"
 
 namespace JoyEngine
 {
@@ -26,6 +30,12 @@ namespace JoyEngine
 			uint32_t height);
 
 		void UploadSceneData() override;
+		void UpdateSceneData() override;
+		void RecordSceneDataUpload(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex) override;
+		[[nodiscard]] bool IsSceneRebuildRequired() const noexcept override { return m_isSceneRebuildRequired; }
+		void RebuildSceneData() override;
+		// Reads the scene tree back from gpu, checks its bounds and compares gpu LBVH with cpu one. Gpu has to be idle
+		[[nodiscard]] bool ValidateSceneData();
 		void ProcessRaytracing(ID3D12GraphicsCommandList4* commandList, const uint32_t frameIndex) const override;
 		void GenerateProbeIrradiance(ID3D12GraphicsCommandList4* commandList, uint32_t frameIndex) const override;
 		void DebugDrawRaytracedImage(ID3D12GraphicsCommandList* commandList) const override;
@@ -43,6 +53,17 @@ namespace JoyEngine
 		[[nodiscard]] uint32_t GetRaytracedTextureHeight() const noexcept override { return m_raytracedTextureHeight; }
 
 	private:
+		struct DynamicMesh
+		{
+			const MeshRenderer* meshRenderer;
+			uint32_t firstTriangle;
+			uint32_t trianglesCount;
+			jmath::mat4x4 modelMatrix; // matrix the triangle bounds were computed with
+		};
+
+		void AllocateSceneBuffers();
+		void BuildBVH();
+
 		const RaytracedDDGIDataContainer& m_dataContainer;
 
 		uint32_t m_raytracedTextureWidth;
@@ -50,13 +71,20 @@ namespace JoyEngine
 
 		uint32_t m_trianglesLength = 0;
 
+		BVHBuilderType m_bvhBuilderType = BVHBuilderType::LBVH;
+		std::vector<DynamicMesh> m_dynamicMeshes;
+		std::unique_ptr<CpuBVHRefitter> m_bvhRefitter;
+		bool m_isSceneRebuildRequired = false;
+		bool m_isSceneDataChanged = false; // refit data is not recorded for upload yet
+		std::unique_ptr<UploadRingBuffer> m_sceneDataUploadRing;
+
 		std::unique_ptr<UAVGbuffer> m_gbuffer;
 		std::unique_ptr<RenderTexture> m_shadedRenderTexture;
 		std::unique_ptr<UAVTexture> m_probeIrradianceTexture; // octohedral irradince per-probe storage
 		std::unique_ptr<UAVTexture> m_probeDepthTexture; // octohedral depth per-probe storage
 
 
-		std::unique_ptr<DataBuffer<uint32_t>> m_keysBuffer;
+		std::unique_ptr<DataBuffer<uint64_t>> m_keysBuffer;
 		std::unique_ptr<DataBuffer<uint32_t>> m_triangleIndexBuffer;
 		std::unique_ptr<DataBuffer<AABB>> m_triangleAABBBuffer;
 
@@ -12,6 +12,13 @@
 
 namespace JoyEngine
 {
+	namespace
+	{
+		constexpr ShaderPreloadArgs hdrDownscaleFirstPassShader = {"shaders/hdrDownscaleFirstPass.hlsl", JoyShaderTypeCompute};
+		constexpr ShaderPreloadArgs hdrDownscaleSecondPassShader = {"shaders/hdrDownscaleSecondPass.hlsl", JoyShaderTypeCompute};
+		constexpr ShaderPreloadArgs hdrToLdrTransitionShader = {"shaders/hdrToLdrTransition.hlsl", JoyShaderTypeVertex | JoyShaderTypePixel};
+	}
+
 	Tonemapping::Tonemapping(
 		IRenderer* renderManager,
 		RenderTexture* hdrRenderTarget,
@@ -30,7 +37,7 @@ namespace JoyEngine
 		{
 			m_hdrDownscaleFirstPassComputePipeline = std::make_unique<ComputePipeline>(ComputePipelineArgs
 				{
-					"shaders/hdrDownscaleFirstPass.hlsl",
+					hdrDownscaleFirstPassShader.shaderPath,
 				});
 		}
 
@@ -38,7 +45,7 @@ namespace JoyEngine
 		{
 			m_hdrDownscaleSecondPassComputePipeline = std::make_unique<ComputePipeline>(ComputePipelineArgs
 				{
-					"shaders/hdrDownscaleSecondPass.hlsl",
+					hdrDownscaleSecondPassShader.shaderPath,
 				});
 		}
 
@@ -46,8 +53,8 @@ namespace JoyEngine
 		{
 			m_hdrToLdrTransitionGraphicsPipeline = std::make_unique<GraphicsPipeline>(GraphicsPipelineArgs
 				{
-					"shaders/hdrToLdrTransition.hlsl",
-					JoyShaderTypeVertex | JoyShaderTypePixel,
+					hdrToLdrTransitionShader.shaderPath,
+					hdrToLdrTransitionShader.shaderTypes,
 					false,
 					false,
 					false,
@@ -156,4 +163,9 @@ namespace JoyEngine
 		HDRDownScaleConstants* ptr = m_constantsBuffer->GetPtr(frameIndex);
 		*ptr = m_constantsValues;
 	}
+
+	std::vector<ShaderPreloadArgs> Tonemapping::GetPreloadShaders()
+	{
+		return {hdrDownscaleFirstPassShader, hdrDownscaleSecondPassShader, hdrToLdrTransitionShader};
+	}
 }
@@ -3,10 +3,12 @@
 
 #include <dxgiformat.h>
 #include <memory>
+#include <vector>
 
 #include "CommonEngineStructs.h"
 #include "ResourceManager/Buffers/DynamicCpuBuffer.h"
 #include "ResourceManager/Buffers/UAVGpuBuffer.h"
+#include "ResourceManager/ResourceManager.h"
 #include "ResourceManager/Pipelines/GraphicsPipeline.h"
 
 
@@ -37,6 +39,9 @@ namespace JoyEngine
 		void Render(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex, const RenderTexture* currentBackBuffer) const;
 		HDRDownScaleConstants* GetConstantsPtr() noexcept { return &m_constantsValues; }
 		void UpdateConstants(uint32_t frameIndex) const;
+
+		// Shaders of the pipelines created in constructor, for renderers preloading them
+		[[nodiscard]] static std::vector<ShaderPreloadArgs> GetPreloadShaders();
 	private:
 		std::unique_ptr<ComputePipeline> m_hdrDownscaleFirstPassComputePipeline;
 		std::unique_ptr<ComputePipeline> m_hdrDownscaleSecondPassComputePipeline;
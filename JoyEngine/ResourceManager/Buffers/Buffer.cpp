@@ -13,6 +13,12 @@ namespace JoyEngine
 	MappedAreaHandle::MappedAreaHandle(const Buffer* buffer) :
 		m_buffer(buffer)
 	{
+		if (m_buffer->m_headlessData != nullptr)
+		{
+			m_bufferPtr = m_buffer->m_headlessData.get();
+			return;
+		}
+
 		const D3D12_RANGE readRange{
 			.Begin = 0,
 			.End = m_buffer->GetSizeInBytes()
@@ -23,7 +29,10 @@ namespace JoyEngine
 	MappedAreaHandle::~MappedAreaHandle()
 	{
 		if (m_buffer == nullptr) return;
-		m_buffer->GetBufferResource()->Unmap(0, nullptr);
+		if (m_buffer->m_headlessData == nullptr)
+		{
+			m_buffer->GetBufferResource()->Unmap(0, nullptr);
+		}
 
 		m_bufferPtr = nullptr;
 		m_buffer = nullptr;
@@ -69,7 +78,14 @@ namespace JoyEngine
 		m_buffer = MemoryManager::Get()->CreateResource(
 			properties,
 			&bufferResourceDesc,
-			m_currentResourceState);
+			m_currentResourceState,
+			m_memoryAllocation);
+
+		if (m_buffer == nullptr && m_properties.IsCPUAccessible())
+		{
+			ASSERT(GraphicsManager::Get()->IsHeadless());
+			m_headlessData = std::make_unique<uint8_t[]>(m_sizeInBytes);
+		}
 	}
 
 	void Buffer::SetCPUData(const void* dataPtr, uint64_t offset, uint64_t size) const
@@ -90,4 +106,9 @@ namespace JoyEngine
 	{
 		return m_buffer;
 	}
+
+	D3D12_GPU_VIRTUAL_ADDRESS Buffer::GetGPUVirtualAddress() const noexcept
+	{
+		return m_buffer != nullptr ? m_buffer->GetGPUVirtualAddress() : 0;
+	}
 }
@@ -5,6 +5,7 @@
 
 #include "d3dx12.h"
 #include "Common/Resource.h"
+#include "Utils/MemoryTracker.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -59,16 +60,22 @@ namespace JoyEngine
 		[[nodiscard]] MappedAreaHandle Map() const;
 
 		[[nodiscard]] ComPtr<ID3D12Resource> GetBufferResource() const noexcept;
+		// 0 for the headless buffers without resource
+		[[nodiscard]] D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress() const noexcept;
 		[[nodiscard]] bool IsLoaded() const noexcept override { return true; }
 
 		[[nodiscard]] D3D12_RESOURCE_STATES GetCurrentResourceState() const noexcept { return m_currentResourceState; }
 		void SetCurrentResourceState(D3D12_RESOURCE_STATES newState) noexcept { m_currentResourceState = newState; }
 
 	private:
+		friend class MappedAreaHandle;
+
 		uint64_t m_sizeInBytes = 0;
 		D3D12_RESOURCE_STATES m_currentResourceState;
 		CD3DX12_HEAP_PROPERTIES m_properties;
 		ComPtr<ID3D12Resource> m_buffer;
+		std::unique_ptr<uint8_t[]> m_headlessData; // mapped instead of the upload and readback resources without device
+		MemoryAllocation m_memoryAllocation;
 	};
 }
 
@@ -24,7 +24,7 @@ namespace JoyEngine
 			);
 
 			D3D12_CONSTANT_BUFFER_VIEW_DESC desc = {
-				m_buffer->GetBufferResource()->GetGPUVirtualAddress(),
+				m_buffer->GetGPUVirtualAddress(),
 				m_size
 			};
 			m_resourceView = std::make_unique<ResourceView>(desc);
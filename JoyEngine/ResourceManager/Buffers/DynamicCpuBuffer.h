@@ -36,7 +36,7 @@ namespace JoyEngine
 				for (uint32_t i = 0; i < m_frameCount; i++)
 				{
 					D3D12_CONSTANT_BUFFER_VIEW_DESC desc = {
-						m_buffer->GetBufferResource()->GetGPUVirtualAddress() + (m_alignedStride * ElemCount) * i,
+						m_buffer->GetGPUVirtualAddress() + (m_alignedStride * ElemCount) * i,
 						m_alignedStride * ElemCount
 					};
 					m_resourceViews[i] = std::make_unique<ResourceView>(desc);
@@ -0,0 +1,67 @@
+#include "UploadRingBuffer.h"
+
+#include <cstring>
+
+#include "Utils/Assert.h"
+#include "Utils/GraphicsUtils.h"
+
+namespace JoyEngine
+{
+	UploadRingBuffer::UploadRingBuffer(uint64_t frameSize, uint32_t frameCount) :
+		m_frameSize(frameSize),
+		m_frameCount(frameCount)
+	{
+		ASSERT(m_frameSize > 0 && m_frameCount > 0);
+
+		m_buffer = std::make_unique<Buffer>(
+			m_frameSize * m_frameCount,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			D3D12_HEAP_TYPE_UPLOAD
+		);
+
+		// keep it always mapped
+		m_mappedArea = m_buffer->Map();
+	}
+
+	void UploadRingBuffer::BeginFrame(uint32_t frameIndex)
+	{
+		ASSERT(frameIndex < m_frameCount);
+		m_frameIndex = frameIndex;
+		m_frameOffset = 0;
+	}
+
+	bool UploadRingBuffer::Upload(
+		ID3D12GraphicsCommandList* commandList,
+		const void* data,
+		uint64_t size,
+		const Buffer* gpuBuffer,
+		uint64_t bufferOffset)
+	{
+		ASSERT(bufferOffset + size <= gpuBuffer->GetSizeInBytes());
+		if (m_frameOffset + size > m_frameSize) return false;
+
+		const uint64_t ringOffset = m_frameSize * m_frameIndex + m_frameOffset;
+		memcpy(static_cast<uint8_t*>(m_mappedArea.GetPtr()) + ringOffset, data, size);
+		m_frameOffset += size;
+
+		const D3D12_RESOURCE_STATES state = gpuBuffer->GetCurrentResourceState();
+
+		// Barrier also waits for the previous frames on the queue which read the buffer
+		GraphicsUtils::Barrier(commandList, gpuBuffer->GetBufferResource().Get(),
+		                       state,
+		                       D3D12_RESOURCE_STATE_COPY_DEST);
+
+		commandList->CopyBufferRegion(
+			gpuBuffer->GetBufferResource().Get(),
+			bufferOffset,
+			m_buffer->GetBufferResource().Get(),
+			ringOffset,
+			size);
+
+		GraphicsUtils::Barrier(commandList, gpuBuffer->GetBufferResource().Get(),
+		                       D3D12_RESOURCE_STATE_COPY_DEST,
+		                       state);
+
+		return true;
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef UPLOAD_RING_BUFFER_H
+#define UPLOAD_RING_BUFFER_H
+
+#include <cstdint>
+#include <memory>
+
+#include "Buffer.h"
+
+namespace JoyEngine
+{
+	// Always mapped upload buffer with a part per frame in flight. Data is copied into the part of the frame
+	// and the copy to gpu buffer is recorded on the frame command list, so the queue is never waited for.
+	// Part is reused when its frame index comes again, after the renderer waited for the frame fence
+	class UploadRingBuffer
+	{
+	public:
+		UploadRingBuffer() = delete;
+		UploadRingBuffer(uint64_t frameSize, uint32_t frameCount);
+
+		void BeginFrame(uint32_t frameIndex);
+
+		// Returns false and records nothing when the frame part is full
+		bool Upload(
+			ID3D12GraphicsCommandList* commandList,
+			const void* data,
+			uint64_t size,
+			const Buffer* gpuBuffer,
+			uint64_t bufferOffset);
+
+		[[nodiscard]] uint64_t GetFrameSize() const noexcept { return m_frameSize; }
+
+	private:
+		std::unique_ptr<Buffer> m_buffer;
+		MappedAreaHandle m_mappedArea;
+		uint64_t m_frameSize;
+		uint32_t m_frameCount;
+
+		uint32_t m_frameIndex = 0;
+		uint64_t m_frameOffset = 0;
+	};
+}
+#endif // UPLOAD_RING_BUFFER_H
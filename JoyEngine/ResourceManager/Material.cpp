@@ -79,7 +79,7 @@ namespace JoyEngine
 							srv = m_textures.back()->GetSRV();
 						}
 
-						m_rootParams.insert({
+						m_rootParams.push_back({
 							m_sharedMaterial->GetGraphicsPipeline()->GetBindingIndexByName(name),
 							srv
 						});
@@ -107,7 +107,7 @@ namespace JoyEngine
 							break;
 						}
 
-						m_rootParams.insert({
+						m_rootParams.push_back({
 							m_sharedMaterial->GetGraphicsPipeline()->GetBindingIndexByName(name),
 							samplerView
 						});
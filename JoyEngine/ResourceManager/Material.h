@@ -34,7 +34,7 @@ namespace JoyEngine
 		[[nodiscard]] SharedMaterial* GetSharedMaterial() const noexcept;
 
 		[[nodiscard]] bool IsLoaded() const noexcept override;
-		[[nodiscard]] const std::map<uint32_t, ResourceView*>& GetRootParams() { return m_rootParams; }
+		[[nodiscard]] const std::vector<std::pair<uint32_t, ResourceView*>>& GetRootParams() { return m_rootParams; }
 		[[nodiscard]] uint32_t GetMaterialIndex() const noexcept { return m_materialIndex; }
 
 	private:
@@ -43,7 +43,7 @@ namespace JoyEngine
 	private :
 		uint32_t m_materialIndex;
 		ResourceHandle<SharedMaterial> m_sharedMaterial;
-		std::map<uint32_t, ResourceView*> m_rootParams;
+		std::vector<std::pair<uint32_t, ResourceView*>> m_rootParams; // root index -> view
 
 		std::vector<ResourceHandle<Texture>> m_textures;
 		std::vector<std::unique_ptr<Buffer>> m_buffers;
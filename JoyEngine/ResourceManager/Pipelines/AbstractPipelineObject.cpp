@@ -9,7 +9,7 @@ namespace JoyEngine
 		ShaderTypeFlags shaderTypes,
 		D3D12_ROOT_SIGNATURE_FLAGS flags)
 	{
-		m_shader = ResourceManager::Get()->LoadResource<Shader>(shaderPath, shaderTypes);
+		m_shader = ResourceManager::Get()->LoadShader(shaderPath, shaderTypes);
 		m_inputContainer.InitContainer(m_shader.Get()->GetInputMap(), flags);
 	}
 
@@ -34,7 +34,7 @@ namespace JoyEngine
 			return m_inputContainer.GetBindingIndexByHash(hash);
 		}
 
-		[[nodiscard]] const std::map<uint32_t, EngineBindingType>& GetEngineBindings() const
+		[[nodiscard]] std::span<const EngineBinding> GetEngineBindings() const
 		{
 			return m_inputContainer.GetEngineBindings();
 		}
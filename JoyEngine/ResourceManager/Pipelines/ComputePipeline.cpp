@@ -11,6 +11,9 @@ namespace JoyEngine
 			JoyShaderTypeCompute,
 			D3D12_ROOT_SIGNATURE_FLAG_NONE)
 	{
+		// Shader is compiled for its inputs, the pipeline state needs the device
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		const D3D12_COMPUTE_PIPELINE_STATE_DESC computePipelineStateDesc = {
 			m_inputContainer.GetRootSignature().Get(),
 			CD3DX12_SHADER_BYTECODE(m_shader->GetComputeShadeModule().Get()),
@@ -39,6 +39,9 @@ namespace JoyEngine
 		m_depthComparisonFunc(args.depthComparisonFunc),
 		m_cullMode(args.cullMode)
 	{
+		// Shader is compiled for its inputs, the pipeline state needs the device
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		// Create the vertex input layout
 
 		CD3DX12_RASTERIZER_DESC rasterizerDesc = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
@@ -33,7 +33,7 @@ namespace JoyEngine
 
 	RaytracingPipeline::RaytracingPipeline(const RaytracingPipelineArgs& args)
 	{
-		m_raytracingShader = ResourceManager::Get()->LoadResource<Shader>(
+		m_raytracingShader = ResourceManager::Get()->LoadShader(
 			args.shaderPath,
 			JoyShaderTypeRaytracing
 		);
@@ -39,7 +39,7 @@ namespace JoyEngine
 		{
 			return &m_localInputContainers.at(type);
 		}
-		[[nodiscard]] const std::map<uint32_t, EngineBindingType>& GetEngineBindings() const
+		[[nodiscard]] std::span<const EngineBinding> GetEngineBindings() const
 		{
 			return m_globalInputContainer.GetEngineBindings();
 		}
@@ -0,0 +1,128 @@
+#include "ShaderBindingTable.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "Benchmarks/BenchmarkSuite.h"
+#include "Utils/Assert.h"
+
+namespace JoyEngine
+{
+	void ShaderBindingTable::AddBinding(uint32_t hash, uint32_t rootIndex)
+	{
+		const auto it = std::lower_bound(m_hashes.begin(), m_hashes.end(), hash);
+		ASSERT_DESC(it == m_hashes.end() || *it != hash, "Shader parameter names hash collision");
+
+		const auto position = it - m_hashes.begin();
+		m_hashes.insert(it, hash);
+		m_rootIndices.insert(m_rootIndices.begin() + position, rootIndex);
+	}
+
+	void ShaderBindingTable::AddEngineBinding(uint32_t rootIndex, EngineBindingType type)
+	{
+		ASSERT(m_engineBindingsCount < m_engineBindings.size());
+		m_engineBindings[m_engineBindingsCount++] = {rootIndex, type};
+	}
+
+	uint32_t ShaderBindingTable::FindBinding(uint32_t hash) const
+	{
+		const auto it = std::lower_bound(m_hashes.begin(), m_hashes.end(), hash);
+		if (it == m_hashes.end() || *it != hash)
+		{
+			return InvalidIndex;
+		}
+		return m_rootIndices[it - m_hashes.begin()];
+	}
+
+	void ShaderBindingTable::AddBenchmarks(BenchmarkSuite& suite)
+	{
+		constexpr uint32_t drawsCount = 1 << 12;
+
+		// Bindings of a typical pass: views attached by name, material params and engine bindings
+		static constexpr ShaderBindingName names[] = {
+			"data",
+			"keysData",
+			"valuesData",
+			"sortedBlocksKeysData",
+			"sortedBlocksValuesData",
+			"offsetsData",
+			"sizesData",
+		};
+		constexpr uint32_t materialParamsCount = 3;
+		constexpr uint32_t engineBindingsCount = static_cast<uint32_t>(EngineBindingType::Count);
+
+		struct BindingData
+		{
+			// Names go through a runtime string like they went through const char* into AttachView
+			std::vector<std::string> runtimeNames;
+			std::map<uint32_t, uint32_t> rootIndicesMap;
+			std::map<uint32_t, EngineBindingType> engineBindingsMap;
+			std::map<uint32_t, uint32_t> materialParamsMap;
+			ShaderBindingTable table;
+			std::vector<std::pair<uint32_t, uint32_t>> materialParams;
+			uint64_t sum = 0;
+		};
+		auto data = std::make_shared<BindingData>();
+
+		uint32_t rootIndex = 0;
+		for (const ShaderBindingName& name : names)
+		{
+			data->runtimeNames.emplace_back(name.name);
+			data->rootIndicesMap.insert({name.hash, rootIndex});
+			data->table.AddBinding(name.hash, rootIndex);
+			rootIndex++;
+		}
+		for (uint32_t i = 0; i < materialParamsCount; i++)
+		{
+			data->materialParamsMap.insert({rootIndex, i});
+			data->materialParams.emplace_back(rootIndex, i);
+			rootIndex++;
+		}
+		for (uint32_t i = 0; i < engineBindingsCount; i++)
+		{
+			data->engineBindingsMap.insert({rootIndex, static_cast<EngineBindingType>(i)});
+			data->table.AddEngineBinding(rootIndex, static_cast<EngineBindingType>(i));
+			rootIndex++;
+		}
+
+		suite.Add("ShaderBindingTable/ResolveDraw", drawsCount, [data]()
+		{
+			for (uint32_t draw = 0; draw < drawsCount; draw++)
+			{
+				for (const ShaderBindingName& name : names)
+				{
+					data->sum += data->table.FindBinding(name.hash);
+				}
+				for (const auto& pair : data->materialParams)
+				{
+					data->sum += pair.first + pair.second;
+				}
+				for (const EngineBinding& binding : data->table.GetEngineBindings())
+				{
+					data->sum += binding.rootIndex + static_cast<uint32_t>(binding.type);
+				}
+			}
+		});
+
+		suite.Add("ShaderBindingTable/ResolveDrawStdMap", drawsCount, [data]()
+		{
+			for (uint32_t draw = 0; draw < drawsCount; draw++)
+			{
+				for (const std::string& name : data->runtimeNames)
+				{
+					data->sum += data->rootIndicesMap.find(StrHash32(name.c_str()))->second;
+				}
+				for (const auto& pair : data->materialParamsMap)
+				{
+					data->sum += pair.first + pair.second;
+				}
+				for (const auto& pair : data->engineBindingsMap)
+				{
+					data->sum += pair.first + static_cast<uint32_t>(pair.second);
+				}
+			}
+		});
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef SHADER_BINDING_TABLE_H
+#define SHADER_BINDING_TABLE_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Common/HashDefs.h"
+
+namespace JoyEngine
+{
+	class BenchmarkSuite;
+
+	enum class EngineBindingType : uint32_t
+	{
+		ObjectIndexData,
+		ModelMatrixData,
+		ViewProjectionMatrixData,
+		EngineData,
+
+		Count
+	};
+
+	struct EngineBinding
+	{
+		uint32_t rootIndex;
+		EngineBindingType type;
+	};
+
+	// Shader parameter name hashed at compile time, string literals convert to it implicitly
+	struct ShaderBindingName
+	{
+		consteval ShaderBindingName(const char* name) :
+			name(name),
+			hash(StrHash32(name))
+		{
+		}
+
+		const char* name;
+		uint32_t hash;
+	};
+
+	// Root indices of one root signature, resolved once when it is created.
+	// Hashes are kept sorted in a flat array with root indices next to them, engine bindings are a small fixed array
+	class ShaderBindingTable
+	{
+	public:
+		static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+		ShaderBindingTable() = default;
+
+		void AddBinding(uint32_t hash, uint32_t rootIndex);
+		void AddEngineBinding(uint32_t rootIndex, EngineBindingType type);
+
+		[[nodiscard]] uint32_t FindBinding(uint32_t hash) const;
+		[[nodiscard]] std::span<const EngineBinding> GetEngineBindings() const
+		{
+			return {m_engineBindings.data(), m_engineBindingsCount};
+		}
+
+		// Cpu cost of resolving bindings of draws: the table against string hashing and std::map lookups
+		static void AddBenchmarks(BenchmarkSuite& suite);
+
+	private:
+		std::vector<uint32_t> m_hashes;
+		std::vector<uint32_t> m_rootIndices;
+
+		std::array<EngineBinding, static_cast<uint32_t>(EngineBindingType::Count)> m_engineBindings = {};
+		uint32_t m_engineBindingsCount = 0;
+	};
+}
+#endif // SHADER_BINDING_TABLE_H
@@ -14,23 +14,19 @@ namespace JoyEngine
 {
 	uint32_t ShaderInputContainer::GetBindingIndexByName(const std::string& name) const
 	{
-		ASSERT(m_rootIndices.contains(StrHash32(name.c_str())));
-		return m_rootIndices.find(StrHash32(name.c_str()))->second;
+		const uint32_t rootIndex = m_bindings.FindBinding(StrHash32(name.c_str()));
+		ASSERT(rootIndex != ShaderBindingTable::InvalidIndex);
+		return rootIndex;
 	}
 
 	uint32_t ShaderInputContainer::GetBindingIndexByHash(const uint32_t hash) const
 	{
-		if (!m_rootIndices.contains(hash))
+		const uint32_t rootIndex = m_bindings.FindBinding(hash);
+		if (rootIndex == ShaderBindingTable::InvalidIndex)
 		{
-			Logger::LogFormat("Warning: pipeline doesn't contain hash %d", hash);
-			return -1;
+			Logger::LogFormat(LogLevel::Warning, "Warning: pipeline doesn't contain hash %d", hash);
 		}
-		return m_rootIndices.find(hash)->second;
-	}
-
-	const std::map<uint32_t, EngineBindingType>& ShaderInputContainer::GetEngineBindings() const
-	{
-		return m_engineBindings;
+		return rootIndex;
 	}
 
 	void ShaderInputContainer::InitContainer(
@@ -47,93 +43,106 @@ namespace JoyEngine
 		{
 			const std::string& name = pair.first;
 			const ShaderInput& input = pair.second;
+			const uint32_t nameHash = StrHash32(name.c_str());
 
-			if (name == "objectIndex")
-			{
-				params[paramsIndex].InitAsConstants(
-					sizeof(uint32_t) / 4, input.BindPoint, input.Space, input.Visibility);
-				m_engineBindings.insert({paramsIndex, EngineBindingType::ObjectIndexData});
-				paramsIndex++;
-			}
-			else if (name == "viewProjectionData")
-			{
-				params[paramsIndex].InitAsConstants(
-					sizeof(ViewProjectionMatrixData) / 4, input.BindPoint, input.Space, input.Visibility);
-
-				m_engineBindings.insert({paramsIndex, EngineBindingType::ViewProjectionMatrixData});
-				paramsIndex++;
-			}
-			else if (name == "objectMatricesData")
+			switch (nameHash)
 			{
-				ranges[rangesIndex].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, input.BindPoint, input.Space,
-				                         D3D12_DESCRIPTOR_RANGE_FLAG_NONE);
-				params[paramsIndex].InitAsDescriptorTable(1, &ranges[rangesIndex], input.Visibility);
-				m_engineBindings.insert({paramsIndex, EngineBindingType::ModelMatrixData});
-				rangesIndex++;
-				paramsIndex++;
-			}
-			else if (name == "engineData")
-			{
-				ranges[rangesIndex].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, input.BindPoint, input.Space,
-				                         D3D12_DESCRIPTOR_RANGE_FLAG_NONE);
-				params[paramsIndex].InitAsDescriptorTable(1, &ranges[rangesIndex], input.Visibility);
-				m_engineBindings.insert({paramsIndex, EngineBindingType::EngineData});
-				rangesIndex++;
-				paramsIndex++;
-			}
-			else if (name == "g_SceneAccelerationStructure")
-			{
-				params[paramsIndex].InitAsShaderResourceView(input.BindPoint, input.Space);
-				m_rootIndices.insert({StrHash32(name.c_str()), paramsIndex});
-				paramsIndex++;
-			}
-			else
-			{
-				D3D12_DESCRIPTOR_RANGE_TYPE type;
-				switch (input.Type)
+			case StrHash32("objectIndex"):
 				{
-				case D3D_SIT_CBUFFER:
-					type = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+					params[paramsIndex].InitAsConstants(
+						sizeof(uint32_t) / 4, input.BindPoint, input.Space, input.Visibility);
+					m_bindings.AddEngineBinding(paramsIndex, EngineBindingType::ObjectIndexData);
+					paramsIndex++;
 					break;
+				}
+			case StrHash32("viewProjectionData"):
+				{
+					params[paramsIndex].InitAsConstants(
+						sizeof(ViewProjectionMatrixData) / 4, input.BindPoint, input.Space, input.Visibility);
 
-				case D3D_SIT_STRUCTURED:
-				case D3D_SIT_TEXTURE:
-					type = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+					m_bindings.AddEngineBinding(paramsIndex, EngineBindingType::ViewProjectionMatrixData);
+					paramsIndex++;
 					break;
-				case D3D_SIT_SAMPLER:
-					type = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+				}
+			case StrHash32("objectMatricesData"):
+				{
+					ranges[rangesIndex].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, input.BindPoint, input.Space,
+					                         D3D12_DESCRIPTOR_RANGE_FLAG_NONE);
+					params[paramsIndex].InitAsDescriptorTable(1, &ranges[rangesIndex], input.Visibility);
+					m_bindings.AddEngineBinding(paramsIndex, EngineBindingType::ModelMatrixData);
+					rangesIndex++;
+					paramsIndex++;
 					break;
-
-				case D3D_SIT_UAV_RWTYPED:
-				case D3D_SIT_UAV_RWSTRUCTURED:
-				case D3D_SIT_UAV_RWBYTEADDRESS:
-				case D3D_SIT_UAV_APPEND_STRUCTURED:
-				case D3D_SIT_UAV_CONSUME_STRUCTURED:
-				case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
-				case D3D_SIT_UAV_FEEDBACKTEXTURE:
-					type = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+				}
+			case StrHash32("engineData"):
+				{
+					ranges[rangesIndex].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, input.BindPoint, input.Space,
+					                         D3D12_DESCRIPTOR_RANGE_FLAG_NONE);
+					params[paramsIndex].InitAsDescriptorTable(1, &ranges[rangesIndex], input.Visibility);
+					m_bindings.AddEngineBinding(paramsIndex, EngineBindingType::EngineData);
+					rangesIndex++;
+					paramsIndex++;
+					break;
+				}
+			case StrHash32("g_SceneAccelerationStructure"):
+				{
+					params[paramsIndex].InitAsShaderResourceView(input.BindPoint, input.Space);
+					m_bindings.AddBinding(nameHash, paramsIndex);
+					paramsIndex++;
+					break;
+				}
+			default:
+				{
+					D3D12_DESCRIPTOR_RANGE_TYPE type;
+					switch (input.Type)
+					{
+					case D3D_SIT_CBUFFER:
+						type = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+						break;
+
+					case D3D_SIT_STRUCTURED:
+					case D3D_SIT_TEXTURE:
+						type = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+						break;
+					case D3D_SIT_SAMPLER:
+						type = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+						break;
+
+					case D3D_SIT_UAV_RWTYPED:
+					case D3D_SIT_UAV_RWSTRUCTURED:
+					case D3D_SIT_UAV_RWBYTEADDRESS:
+					case D3D_SIT_UAV_APPEND_STRUCTURED:
+					case D3D_SIT_UAV_CONSUME_STRUCTURED:
+					case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+					case D3D_SIT_UAV_FEEDBACKTEXTURE:
+						type = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+						break;
+
+					case D3D_SIT_TBUFFER:
+					case D3D_SIT_BYTEADDRESS:
+					case D3D_SIT_RTACCELERATIONSTRUCTURE:
+					default:
+						ASSERT(false);
+						throw;
+					}
+					ranges[rangesIndex].Init(
+						type,
+						input.BindCount == 0 ? UINT_MAX : input.BindCount,
+						input.BindPoint,
+						input.Space,
+						input.BindCount == 0 ? D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE : D3D12_DESCRIPTOR_RANGE_FLAG_NONE);
+					params[paramsIndex].InitAsDescriptorTable(1, &ranges[rangesIndex], input.Visibility);
+					m_bindings.AddBinding(nameHash, paramsIndex);
+					rangesIndex++;
+					paramsIndex++;
 					break;
-
-				case D3D_SIT_TBUFFER:
-				case D3D_SIT_BYTEADDRESS:
-				case D3D_SIT_RTACCELERATIONSTRUCTURE:
-				default:
-					ASSERT(false);
-					throw;
 				}
-				ranges[rangesIndex].Init(
-					type,
-					input.BindCount == 0 ? UINT_MAX : input.BindCount,
-					input.BindPoint,
-					input.Space,
-					input.BindCount == 0 ? D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE : D3D12_DESCRIPTOR_RANGE_FLAG_NONE);
-				params[paramsIndex].InitAsDescriptorTable(1, &ranges[rangesIndex], input.Visibility);
-				m_rootIndices.insert({StrHash32(name.c_str()), paramsIndex});
-				rangesIndex++;
-				paramsIndex++;
 			}
 		}
 
+		// Bindings are all the headless materials need
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		// TODO should I make compatibility with 1.0?
 		ASSERT(GraphicsManager::Get()->GetHighestRootSignatureVersion() == D3D_ROOT_SIGNATURE_VERSION_1_1);
 		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
@@ -1,18 +1,11 @@
 #ifndef SHADER_INPUT_CONTAINER_H
 #define SHADER_INPUT_CONTAINER_H
 
+#include "ShaderBindingTable.h"
 #include "ResourceManager/ShaderCompiler.h"
 
 namespace JoyEngine
 {
-	enum class EngineBindingType
-	{
-		ObjectIndexData,
-		ModelMatrixData,
-		ViewProjectionMatrixData,
-		EngineData,
-	};
-
 	class ShaderInputContainer
 	{
 	public:
@@ -28,12 +21,11 @@ namespace JoyEngine
 		[[nodiscard]] ComPtr<ID3D12RootSignature> GetRootSignature() const noexcept { return m_rootSignature; }
 		[[nodiscard]] uint32_t GetBindingIndexByName(const std::string&) const;
 		[[nodiscard]] uint32_t GetBindingIndexByHash(const uint32_t hash) const;
-		[[nodiscard]] const std::map<uint32_t, EngineBindingType>& GetEngineBindings() const;
+		[[nodiscard]] std::span<const EngineBinding> GetEngineBindings() const { return m_bindings.GetEngineBindings(); }
 
 	private:
 		ComPtr<ID3D12RootSignature> m_rootSignature;
-		std::map<uint32_t, uint32_t> m_rootIndices; // hash(paramName) -> rootIndex
-		std::map<uint32_t, EngineBindingType> m_engineBindings; // hash(paramName) -> engine binding type
+		ShaderBindingTable m_bindings;
 	};
 }
 #endif // SHADER_INPUT_CONTAINER_H
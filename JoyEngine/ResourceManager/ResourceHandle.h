@@ -1,24 +1,26 @@
 #ifndef RESOURCE_HANDLE_H
 #define RESOURCE_HANDLE_H
 
-#include <functional>
-
+#include "ResourceTable.h"
 #include "Common/Resource.h"
 
 namespace JoyEngine
 {
+	// Implemented by ResourceManager, the last release deletes the resource
+	void AddResourceRef(ResourceSlotHandle slot);
+	void ReleaseResourceRef(ResourceSlotHandle slot);
+
 	template <typename T>
 	class ResourceHandle
 	{
 	public:
 		ResourceHandle() = default;
 
-		explicit ResourceHandle(T* ptr, std::function<void(uint64_t)>* unregisterResourceAction)
-			: m_unregisterResourceAction(unregisterResourceAction)
+		// Takes the reference the resource manager has already added
+		explicit ResourceHandle(T* ptr, ResourceSlotHandle slot) :
+			m_ptr(ptr),
+			m_slot(slot)
 		{
-			const Resource* resource = static_cast<Resource*>(ptr);
-			m_ptr = ptr;
-			m_guid = resource->GetResourceId();
 		}
 
 		// copy
@@ -36,14 +38,22 @@ namespace JoyEngine
 		// copy assignment
 		ResourceHandle<T>& operator=(const ResourceHandle<T>& other) noexcept
 		{
-			Copy(other);
+			if (this != &other)
+			{
+				Release();
+				Copy(other);
+			}
 			return *this;
 		}
 
 		// move assignment
 		ResourceHandle<T>& operator=(ResourceHandle<T>&& other) noexcept
 		{
-			Move(other);
+			if (this != &other)
+			{
+				Release();
+				Move(other);
+			}
 			return *this;
 		}
 
@@ -73,44 +83,33 @@ namespace JoyEngine
 		}
 
 	private:
-		uint64_t m_guid;
 		T* m_ptr = nullptr;
-		std::function<void(uint64_t)>* m_unregisterResourceAction;
-
+		ResourceSlotHandle m_slot;
 
 		void Copy(const ResourceHandle<T>& other)
 		{
-			m_guid = other.m_guid;
-			m_unregisterResourceAction = other.m_unregisterResourceAction;
+			m_ptr = other.m_ptr;
+			m_slot = other.m_slot;
 
-			if (other.m_ptr != nullptr)
+			if (m_ptr != nullptr)
 			{
-				m_ptr = other.m_ptr;
-				Resource* resource = static_cast<Resource*>(m_ptr);
-				resource->AddRef();
+				AddResourceRef(m_slot);
 			}
 		}
 
 		void Move(ResourceHandle<T>& other)
 		{
-			Copy(other);
+			m_ptr = other.m_ptr;
+			m_slot = other.m_slot;
 
-			other.Release();
+			other.m_ptr = nullptr;
 		}
 
 		void Release()
 		{
 			if (m_ptr != nullptr)
 			{
-				Resource* resource = static_cast<Resource*>(m_ptr);
-				resource->RemoveRef();
-
-				if (resource->GetRefCount() == 0)
-				{
-					delete m_ptr;
-					m_unregisterResourceAction->operator()(m_guid);
-				}
-
+				ReleaseResourceRef(m_slot);
 				m_ptr = nullptr;
 			}
 		}
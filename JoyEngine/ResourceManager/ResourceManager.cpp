@@ -1,5 +1,94 @@
 #include "ResourceManager.h"
 
+#include <algorithm>
+#include <chrono>
+
+#include "Shader.h"
+#include "GraphicsManager/GraphicsManager.h"
+#include "ThreadManager/ParallelFor.h"
+#include "Utils/Log.h"
+
 namespace JoyEngine
 {
+	void AddResourceRef(ResourceSlotHandle slot)
+	{
+		ResourceManager::Get()->m_resources.AddRef(slot);
+	}
+
+	void ReleaseResourceRef(ResourceSlotHandle slot)
+	{
+		Resource* resource = ResourceManager::Get()->m_resources.Release(slot);
+		if (resource == nullptr) return;
+
+		// Frames in flight may still use its buffers and descriptors
+		GraphicsManager::Get()->GetReleaseQueue().Enqueue([resource]()
+		{
+			delete resource;
+		});
+	}
+
+	ResourceHandle<Shader> ResourceManager::LoadShader(const char* shaderPath, uint32_t shaderTypes)
+	{
+		return AcquireOrCreate<Shader>(Shader::GetShaderId(shaderPath, shaderTypes), [&]()
+		{
+			MEMORY_TAG_SCOPE(shaderPath)
+			return new Shader(shaderPath, shaderTypes);
+		});
+	}
+
+	std::vector<ResourceHandle<Shader>> ResourceManager::PreloadShaders(const std::vector<ShaderPreloadArgs>& shaders)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		std::vector<ShaderPreloadArgs> compileList;
+		for (const auto& args : shaders)
+		{
+			const uint64_t id = Shader::GetShaderId(args.shaderPath, args.shaderTypes);
+			const bool isScheduled = std::ranges::any_of(compileList, [id](const ShaderPreloadArgs& scheduled)
+			{
+				return Shader::GetShaderId(scheduled.shaderPath, scheduled.shaderTypes) == id;
+			});
+			if (!IsResourceLoaded(id) && !isScheduled)
+			{
+				compileList.push_back(args);
+			}
+		}
+
+		// Shader constructor is independent of the resource manager and other shaders,
+		// all the registration happens later on this thread
+		std::vector<Shader*> compiledShaders(compileList.size(), nullptr);
+		std::vector<double> compileTimes(compileList.size(), 0);
+		ParallelFor(static_cast<uint32_t>(compileList.size()), [&](uint32_t i)
+		{
+			const auto shaderStartTime = std::chrono::high_resolution_clock::now();
+			compiledShaders[i] = new Shader(compileList[i].shaderPath, compileList[i].shaderTypes);
+			compileTimes[i] = std::chrono::duration<double, std::chrono::seconds::period>(
+				std::chrono::high_resolution_clock::now() - shaderStartTime).count();
+		});
+
+		double compileTimeSum = 0;
+		// keep compiled shaders alive until the returned handles reference them
+		std::vector<ResourceHandle<Shader>> compiledHandles;
+		compiledHandles.reserve(compileList.size());
+		for (size_t i = 0; i < compileList.size(); i++)
+		{
+			Logger::LogFormat("Shader %s compiled in %.3f\n", compileList[i].shaderPath, compileTimes[i]);
+			compileTimeSum += compileTimes[i];
+			compiledHandles.push_back(InsertResource<Shader>(compiledShaders[i]->GetResourceId(), compiledShaders[i]));
+		}
+
+		std::vector<ResourceHandle<Shader>> handles;
+		handles.reserve(shaders.size());
+		for (const auto& args : shaders)
+		{
+			handles.push_back(LoadShader(args.shaderPath, args.shaderTypes));
+		}
+
+		const double wallTime = std::chrono::duration<double, std::chrono::seconds::period>(
+			std::chrono::high_resolution_clock::now() - startTime).count();
+		Logger::LogFormat("Preloaded %zu shaders in %.3f, sequential compile time %.3f\n",
+		                  compileList.size(), wallTime, compileTimeSum);
+
+		return handles;
+	}
 }
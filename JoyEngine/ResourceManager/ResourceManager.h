@@ -1,63 +1,52 @@
 #ifndef RESOURCE_MANAGER_H
 #define RESOURCE_MANAGER_H
 
-#include <functional>
-#include <map>
-#include <set>
+#include <vector>
 #include <Utils/Assert.h>
 
 #include "ResourceHandle.h"
+#include "ResourceTable.h"
 #include "Common/HashDefs.h"
 #include "Common/Resource.h"
 #include "Common/Singleton.h"
 #include "Common/JoyObject.h"
+#include "Utils/MemoryTracker.h"
 
 namespace JoyEngine
 {
+	class Shader;
+
+	struct ShaderPreloadArgs
+	{
+		const char* shaderPath;
+		uint32_t shaderTypes; // ShaderTypeFlags
+	};
+
 	class ResourceManager : public Singleton<ResourceManager>
 	{
 	public:
-		ResourceManager():
-			m_unregisterResourceAction([this](uint64_t id)
-			{
-				if (IsResourceLoaded(id))
-				{
-					m_isResourceInUse.erase(id);
-				}
-				else
-				{
-					ASSERT(false);
-				}
-			})
-		{
-		}
-
 		[[nodiscard]] bool IsResourceLoaded(uint64_t id) const
 		{
-			return m_isResourceInUse.contains(id);
+			return m_resources.Contains(id);
 		}
 
 		template <class T, typename... Args>
 		ResourceHandle<T> LoadResource(const char* path, Args&&... args)
 		{
-			uint64_t id = StrHash64(path);
-			if (!IsResourceLoaded(id))
+			return AcquireOrCreate<T>(StrHash64(path), [&]()
 			{
-				m_isResourceInUse.insert({id, new T(path, std::forward<Args>(args)...)});
-			}
-			m_isResourceInUse[id]->AddRef();
-			return ResourceHandle<T>(GetResource<T>(id), &m_unregisterResourceAction);
+				MEMORY_TAG_SCOPE(path)
+				return new T(path, std::forward<Args>(args)...);
+			});
 		}
 
 		template <class T, typename... Args>
 		ResourceHandle<T> LoadResource(uint64_t id, Args&&... args)
 		{
-			if (!IsResourceLoaded(id))
+			return AcquireOrCreate<T>(id, [&]()
 			{
-				m_isResourceInUse.insert({id, new T(id, std::forward<Args>(args)...)});
-			}
-			m_isResourceInUse.at(id)->AddRef();
-			return ResourceHandle<T>(GetResource<T>(id), &m_unregisterResourceAction);
+				return new T(id, std::forward<Args>(args)...);
+			});
 		}
 
 		template <class T>
@@ -65,23 +54,56 @@ namespace JoyEngine
 		{
 			Resource* res = static_cast<Resource*>(resource);
 			ASSERT(!IsResourceLoaded(res->GetResourceId()));
-			m_isResourceInUse.insert({res->GetResourceId(), res});
-			res->AddRef();
-			return ResourceHandle<T>(resource, &m_unregisterResourceAction);
+			return InsertResource<T>(res->GetResourceId(), res);
 		}
 
+		// Shaders are keyed by path and stages, see Shader::GetShaderId
+		ResourceHandle<Shader> LoadShader(const char* shaderPath, uint32_t shaderTypes);
+
+		// Compiles shaders simultaneously on worker threads and registers them.
+		// Returned handles keep the shaders alive until pipelines using them are created,
+		// so pipeline constructors only build root signature and PSO
+		[[nodiscard]] std::vector<ResourceHandle<Shader>> PreloadShaders(const std::vector<ShaderPreloadArgs>& shaders);
+
 	private:
+		// Already loaded resources are taken without locking, so handles can be loaded and released on any thread
+		template <class T, typename Create>
+		ResourceHandle<T> AcquireOrCreate(uint64_t id, Create&& create)
+		{
+			ResourceSlotHandle slot;
+			Resource* resource = m_resources.TryAcquire(id, slot);
+			if (resource != nullptr)
+			{
+				return ResourceHandle<T>(CastResource<T>(resource), slot);
+			}
+			return InsertResource<T>(id, create());
+		}
+
+		template <class T>
+		ResourceHandle<T> InsertResource(uint64_t id, Resource* created)
+		{
+			ResourceSlotHandle slot;
+			Resource* resource = m_resources.Insert(id, created, slot);
+			if (resource != created)
+			{
+				// another thread has loaded the same resource first
+				delete created;
+			}
+			return ResourceHandle<T>(CastResource<T>(resource), slot);
+		}
+
 		template <class T>
-		T* GetResource(const uint64_t id) const
+		static T* CastResource(Resource* resource)
 		{
-			ASSERT(IsResourceLoaded(id));
-			T* ptr = JoyCast<T>(m_isResourceInUse.at(id));
+			T* ptr = JoyCast<T>(resource);
 			ASSERT(ptr != nullptr);
 			return ptr;
 		}
 
-		std::map<uint64_t, Resource*> m_isResourceInUse;
-		std::function<void(uint64_t)> m_unregisterResourceAction;
+		friend void AddResourceRef(ResourceSlotHandle slot);
+		friend void ReleaseResourceRef(ResourceSlotHandle slot);
+
+		ResourceTable m_resources;
 	};
 }
 
@@ -0,0 +1,496 @@
+#include "ResourceTable.h"
+
+#include <map>
+#include <string>
+
+#include "Benchmarks/BenchmarkSuite.h"
+#include "Benchmarks/TestSuite.h"
+#include "Common/Resource.h"
+#include "ThreadManager/ParallelFor.h"
+#include "Utils/Assert.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		constexpr uint64_t EmptyId = 0;
+		constexpr uint64_t InvalidValue = UINT64_MAX;
+		constexpr uint32_t InitialMapCapacity = 1024;
+
+		uint64_t Pack(ResourceSlotHandle slot)
+		{
+			return static_cast<uint64_t>(slot.generation) << 32 | slot.index;
+		}
+
+		ResourceSlotHandle Unpack(uint64_t value)
+		{
+			return {static_cast<uint32_t>(value), static_cast<uint32_t>(value >> 32)};
+		}
+
+		uint32_t GetStateGeneration(uint64_t state)
+		{
+			return static_cast<uint32_t>(state >> 32);
+		}
+
+		uint32_t GetStateRefCount(uint64_t state)
+		{
+			return static_cast<uint32_t>(state);
+		}
+
+		// Ids are hashes already, this only spreads them over the low bits
+		uint32_t GetMapIndex(uint64_t id, uint32_t mask)
+		{
+			return static_cast<uint32_t>((id * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+		}
+
+		uint64_t FindMapValue(const auto* map, uint64_t id)
+		{
+			for (uint32_t i = GetMapIndex(id, map->mask);; i = (i + 1) & map->mask)
+			{
+				const uint64_t entryId = map->entries[i].id.load(std::memory_order_acquire);
+				if (entryId == id)
+				{
+					return map->entries[i].value.load(std::memory_order_acquire);
+				}
+				if (entryId == EmptyId)
+				{
+					return InvalidValue;
+				}
+			}
+		}
+
+		class TableTestResource : public Resource
+		{
+			DECLARE_JOY_OBJECT(TableTestResource, Resource);
+
+		public:
+			explicit TableTestResource(uint64_t id) : Resource(id)
+			{
+			}
+
+			[[nodiscard]] bool IsLoaded() const noexcept override { return true; }
+
+			int32_t mapRefCount = 0; // reference count of the std::map baseline in the benchmark
+		};
+	}
+
+	ResourceTable::Map::Map(uint32_t capacity) :
+		mask(capacity - 1),
+		entries(std::make_unique<MapEntry[]>(capacity))
+	{
+		ASSERT((capacity & mask) == 0);
+	}
+
+	ResourceTable::ResourceTable()
+	{
+		m_maps.push_back(std::make_unique<Map>(InitialMapCapacity));
+		m_map.store(m_maps.back().get(), std::memory_order_release);
+		for (auto& page : m_slotsPages)
+		{
+			page.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	ResourceTable::~ResourceTable()
+	{
+		for (auto& page : m_slotsPages)
+		{
+			delete[] page.load(std::memory_order_relaxed);
+		}
+	}
+
+	ResourceTable::Slot* ResourceTable::GetSlot(uint32_t index) const
+	{
+		return m_slotsPages[index / SlotsPageSize].load(std::memory_order_acquire) + index % SlotsPageSize;
+	}
+
+	bool ResourceTable::TryAddRef(ResourceSlotHandle slot) const
+	{
+		std::atomic<uint64_t>& state = GetSlot(slot.index)->state;
+		uint64_t current = state.load(std::memory_order_relaxed);
+		while (true)
+		{
+			// zero references means the resource is being released, it can't be brought back
+			if (GetStateGeneration(current) != slot.generation || GetStateRefCount(current) == 0)
+			{
+				return false;
+			}
+			if (state.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+	}
+
+	Resource* ResourceTable::TryAcquire(uint64_t id, ResourceSlotHandle& slot) const
+	{
+		ASSERT(id != EmptyId);
+		const uint64_t value = FindMapValue(m_map.load(std::memory_order_acquire), id);
+		if (value == InvalidValue || !TryAddRef(Unpack(value)))
+		{
+			return nullptr;
+		}
+		slot = Unpack(value);
+		return GetSlot(slot.index)->resource;
+	}
+
+	Resource* ResourceTable::Insert(uint64_t id, Resource* resource, ResourceSlotHandle& slot)
+	{
+		ASSERT(id != EmptyId && resource != nullptr);
+		std::lock_guard lock(m_mutex);
+
+		const uint64_t value = FindMapValue(m_map.load(std::memory_order_relaxed), id);
+		if (value != InvalidValue && TryAddRef(Unpack(value)))
+		{
+			slot = Unpack(value);
+			return GetSlot(slot.index)->resource;
+		}
+
+		slot = AllocateSlot();
+		Slot* newSlot = GetSlot(slot.index);
+		newSlot->resource = resource;
+		newSlot->id = id;
+		newSlot->state.store(static_cast<uint64_t>(slot.generation) << 32 | 1, std::memory_order_release);
+
+		SetMapValue(id, Pack(slot));
+		m_resourcesCount.fetch_add(1, std::memory_order_relaxed);
+		return resource;
+	}
+
+	void ResourceTable::AddRef(ResourceSlotHandle slot) const
+	{
+		[[maybe_unused]] const uint64_t previous = GetSlot(slot.index)->state.fetch_add(1, std::memory_order_relaxed);
+		ASSERT(GetStateGeneration(previous) == slot.generation && GetStateRefCount(previous) > 0);
+	}
+
+	Resource* ResourceTable::Release(ResourceSlotHandle slot)
+	{
+		Slot* releasedSlot = GetSlot(slot.index);
+		const uint64_t previous = releasedSlot->state.fetch_sub(1, std::memory_order_acq_rel);
+		ASSERT(GetStateGeneration(previous) == slot.generation && GetStateRefCount(previous) > 0);
+		if (GetStateRefCount(previous) != 1)
+		{
+			return nullptr;
+		}
+
+		std::lock_guard lock(m_mutex);
+
+		Resource* resource = releasedSlot->resource;
+		releasedSlot->resource = nullptr;
+		releasedSlot->state.store(static_cast<uint64_t>(slot.generation + 1) << 32, std::memory_order_release);
+
+		// the id might be loaded again into another slot while this one had zero references
+		ClearMapValue(releasedSlot->id, Pack(slot));
+
+		releasedSlot->nextFreeIndex = m_freeSlotIndex;
+		m_freeSlotIndex = slot.index;
+		m_resourcesCount.fetch_sub(1, std::memory_order_relaxed);
+		return resource;
+	}
+
+	bool ResourceTable::Contains(uint64_t id) const
+	{
+		const uint64_t value = FindMapValue(m_map.load(std::memory_order_acquire), id);
+		return value != InvalidValue && GetRefCount(Unpack(value)) > 0;
+	}
+
+	uint32_t ResourceTable::GetRefCount(ResourceSlotHandle slot) const
+	{
+		if (slot.index >= MaxSlotsPagesCount * SlotsPageSize || m_slotsPages[slot.index / SlotsPageSize].load(std::memory_order_acquire) == nullptr)
+		{
+			return 0;
+		}
+		const uint64_t state = GetSlot(slot.index)->state.load(std::memory_order_acquire);
+		return GetStateGeneration(state) == slot.generation ? GetStateRefCount(state) : 0;
+	}
+
+	ResourceSlotHandle ResourceTable::AllocateSlot()
+	{
+		if (m_freeSlotIndex != UINT32_MAX)
+		{
+			const uint32_t index = m_freeSlotIndex;
+			Slot* slot = GetSlot(index);
+			m_freeSlotIndex = slot->nextFreeIndex;
+			return {index, GetStateGeneration(slot->state.load(std::memory_order_relaxed))};
+		}
+
+		const uint32_t index = m_slotsCount++;
+		if (index % SlotsPageSize == 0)
+		{
+			ASSERT_DESC(index / SlotsPageSize < MaxSlotsPagesCount, "Resource table is full");
+			m_slotsPages[index / SlotsPageSize].store(new Slot[SlotsPageSize], std::memory_order_release);
+		}
+		return {index, 0};
+	}
+
+	void ResourceTable::SetMapValue(uint64_t id, uint64_t value)
+	{
+		Map* map = m_map.load(std::memory_order_relaxed);
+
+		uint32_t i = GetMapIndex(id, map->mask);
+		for (;; i = (i + 1) & map->mask)
+		{
+			const uint64_t entryId = map->entries[i].id.load(std::memory_order_relaxed);
+			if (entryId == id)
+			{
+				map->entries[i].value.store(value, std::memory_order_release);
+				return;
+			}
+			if (entryId == EmptyId) break;
+		}
+
+		// Keep the map at most half full, released ids are dropped when it is rebuilt
+		if ((map->idsCount + 1) * 2 > map->mask + 1)
+		{
+			uint32_t aliveCount = 1;
+			for (uint32_t j = 0; j <= map->mask; j++)
+			{
+				aliveCount += map->entries[j].id.load(std::memory_order_relaxed) != EmptyId &&
+					map->entries[j].value.load(std::memory_order_relaxed) != InvalidValue;
+			}
+			uint32_t capacity = map->mask + 1;
+			while (aliveCount * 4 > capacity)
+			{
+				capacity *= 2;
+			}
+
+			auto newMap = std::make_unique<Map>(capacity);
+			for (uint32_t j = 0; j <= map->mask; j++)
+			{
+				const uint64_t entryId = map->entries[j].id.load(std::memory_order_relaxed);
+				const uint64_t entryValue = map->entries[j].value.load(std::memory_order_relaxed);
+				if (entryId == EmptyId || entryValue == InvalidValue) continue;
+
+				uint32_t k = GetMapIndex(entryId, newMap->mask);
+				while (newMap->entries[k].id.load(std::memory_order_relaxed) != EmptyId)
+				{
+					k = (k + 1) & newMap->mask;
+				}
+				newMap->entries[k].id.store(entryId, std::memory_order_relaxed);
+				newMap->entries[k].value.store(entryValue, std::memory_order_relaxed);
+				newMap->idsCount++;
+			}
+
+			map = newMap.get();
+			m_maps.push_back(std::move(newMap));
+			m_map.store(map, std::memory_order_release);
+
+			i = GetMapIndex(id, map->mask);
+			while (map->entries[i].id.load(std::memory_order_relaxed) != EmptyId)
+			{
+				i = (i + 1) & map->mask;
+			}
+		}
+
+		// value goes first, so a reader that sees the id sees the value too
+		map->entries[i].value.store(value, std::memory_order_relaxed);
+		map->entries[i].id.store(id, std::memory_order_release);
+		map->idsCount++;
+	}
+
+	void ResourceTable::ClearMapValue(uint64_t id, uint64_t value)
+	{
+		const Map* map = m_map.load(std::memory_order_relaxed);
+		for (uint32_t i = GetMapIndex(id, map->mask);; i = (i + 1) & map->mask)
+		{
+			const uint64_t entryId = map->entries[i].id.load(std::memory_order_relaxed);
+			if (entryId == id)
+			{
+				uint64_t expected = value;
+				map->entries[i].value.compare_exchange_strong(expected, InvalidValue, std::memory_order_release, std::memory_order_relaxed);
+				return;
+			}
+			if (entryId == EmptyId) return;
+		}
+	}
+
+	bool ResourceTable::Test()
+	{
+		bool isCorrect = true;
+
+		ResourceTable table;
+		TableTestResource first(1);
+		TableTestResource second(1);
+		ResourceSlotHandle slot;
+
+		isCorrect &= TEST_CHECK(table.TryAcquire(1, slot) == nullptr && !table.Contains(1), "empty table");
+		isCorrect &= TEST_CHECK(table.Insert(1, &first, slot) == &first && table.Contains(1), "insert");
+		const ResourceSlotHandle firstSlot = slot;
+
+		ResourceSlotHandle otherSlot;
+		isCorrect &= TEST_CHECK(table.TryAcquire(1, otherSlot) == &first && otherSlot.index == firstSlot.index, "acquire");
+		isCorrect &= TEST_CHECK(table.Insert(1, &second, otherSlot) == &first, "insert of loaded id");
+		table.AddRef(firstSlot);
+		isCorrect &= TEST_CHECK(table.GetRefCount(firstSlot) == 4, "reference count");
+
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			isCorrect &= TEST_CHECK(table.Release(firstSlot) == nullptr, "release of referenced");
+		}
+		isCorrect &= TEST_CHECK(table.Release(firstSlot) == &first, "release of last reference");
+		isCorrect &= TEST_CHECK(!table.Contains(1) && table.GetRefCount(firstSlot) == 0 && table.TryAcquire(1, slot) == nullptr, "released");
+
+		isCorrect &= TEST_CHECK(table.Insert(1, &second, slot) == &second, "insert of released id");
+		isCorrect &= TEST_CHECK(slot.index == firstSlot.index && slot.generation == firstSlot.generation + 1, "slot reuse");
+		isCorrect &= TEST_CHECK(table.GetRefCount(firstSlot) == 0, "stale handle");
+		isCorrect &= TEST_CHECK(table.Release(slot) == &second && table.GetResourcesCount() == 0, "release of reused");
+
+		// Enough ids to grow the map and to take several slot pages
+		constexpr uint32_t count = SlotsPageSize * 3;
+		std::vector<std::unique_ptr<TableTestResource>> resources;
+		std::vector<ResourceSlotHandle> slots(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			resources.push_back(std::make_unique<TableTestResource>(StrHash64(std::to_string(i).c_str())));
+			isCorrect &= TEST_CHECK(table.Insert(resources[i]->GetResourceId(), resources[i].get(), slots[i]) == resources[i].get(), "insert of many");
+		}
+
+		// Threads acquire and release everything while every resource keeps one reference
+		std::atomic<uint32_t> failedCount = 0;
+		ParallelFor(count, [&](uint32_t i)
+		{
+			for (uint32_t j = i; j < i + 64; j++)
+			{
+				const TableTestResource* resource = resources[j % count].get();
+				ResourceSlotHandle acquiredSlot;
+				if (table.TryAcquire(resource->GetResourceId(), acquiredSlot) != resource ||
+					table.Release(acquiredSlot) != nullptr)
+				{
+					failedCount++;
+				}
+			}
+		});
+		isCorrect &= TEST_CHECK(failedCount == 0, "concurrent acquire");
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			isCorrect &= TEST_CHECK(table.GetRefCount(slots[i]) == 1 && table.Release(slots[i]) == resources[i].get(), "release of many");
+		}
+		isCorrect &= TEST_CHECK(table.GetResourcesCount() == 0, "empty after release");
+
+		return isCorrect;
+	}
+
+	void ResourceTable::AddBenchmarks(BenchmarkSuite& suite)
+	{
+		constexpr uint32_t resourcesCount = 100000;
+
+		struct TableData
+		{
+			std::vector<std::unique_ptr<TableTestResource>> resources;
+			std::vector<ResourceSlotHandle> slots = std::vector<ResourceSlotHandle>(resourcesCount);
+			std::unique_ptr<ResourceTable> table;
+			std::map<uint64_t, Resource*> map;
+
+			void Load()
+			{
+				for (uint32_t i = 0; i < resourcesCount; i++)
+				{
+					const uint64_t id = resources[i]->GetResourceId();
+					if (table->TryAcquire(id, slots[i]) == nullptr)
+					{
+						(void)table->Insert(id, resources[i].get(), slots[i]);
+					}
+				}
+			}
+
+			// What ResourceManager did before: std::map searches and a plain reference count in the resource
+			void LoadMap()
+			{
+				for (const auto& resource : resources)
+				{
+					const uint64_t id = resource->GetResourceId();
+					if (!map.contains(id))
+					{
+						map.insert({id, resource.get()});
+					}
+					static_cast<TableTestResource*>(map.at(id))->mapRefCount++;
+				}
+			}
+
+			void Reset()
+			{
+				table = std::make_unique<ResourceTable>();
+				map.clear();
+				for (const auto& resource : resources)
+				{
+					resource->mapRefCount = 0;
+				}
+			}
+		};
+		auto data = std::make_shared<TableData>();
+		data->resources.reserve(resourcesCount);
+		for (uint32_t i = 0; i < resourcesCount; i++)
+		{
+			data->resources.push_back(std::make_unique<TableTestResource>(StrHash64(("resource" + std::to_string(i)).c_str())));
+		}
+
+		const auto reset = [data]() { data->Reset(); };
+		const auto resetAndLoad = [data]()
+		{
+			data->Reset();
+			data->Load();
+			data->LoadMap();
+		};
+
+		suite.Add("ResourceTable/Load", resourcesCount, [data]() { data->Load(); }, reset);
+		suite.Add("ResourceTable/LoadStdMap", resourcesCount, [data]() { data->LoadMap(); }, reset);
+
+		suite.Add("ResourceTable/Lookup", resourcesCount, [data]()
+		{
+			for (const auto& resource : data->resources)
+			{
+				ResourceSlotHandle slot;
+				if (data->table->TryAcquire(resource->GetResourceId(), slot) != nullptr)
+				{
+					(void)data->table->Release(slot);
+				}
+			}
+		}, resetAndLoad);
+		suite.Add("ResourceTable/LookupParallel", resourcesCount, [data]()
+		{
+			ParallelForRange(resourcesCount, [&](uint32_t begin, uint32_t end, uint32_t)
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					ResourceSlotHandle slot;
+					if (data->table->TryAcquire(data->resources[i]->GetResourceId(), slot) != nullptr)
+					{
+						(void)data->table->Release(slot);
+					}
+				}
+			});
+		}, resetAndLoad);
+		suite.Add("ResourceTable/LookupStdMap", resourcesCount, [data]()
+		{
+			for (const auto& resource : data->resources)
+			{
+				const uint64_t id = resource->GetResourceId();
+				if (data->map.contains(id))
+				{
+					TableTestResource* found = static_cast<TableTestResource*>(data->map.at(id));
+					found->mapRefCount++;
+					found->mapRefCount--;
+				}
+			}
+		}, resetAndLoad);
+
+		suite.Add("ResourceTable/Release", resourcesCount, [data]()
+		{
+			for (const ResourceSlotHandle& slot : data->slots)
+			{
+				(void)data->table->Release(slot);
+			}
+		}, resetAndLoad);
+		suite.Add("ResourceTable/ReleaseStdMap", resourcesCount, [data]()
+		{
+			for (const auto& resource : data->resources)
+			{
+				if (--resource->mapRefCount == 0)
+				{
+					data->map.erase(resource->GetResourceId());
+				}
+			}
+		}, resetAndLoad);
+	}
+}
@@ -0,0 +1,103 @@
+#ifndef RESOURCE_TABLE_H
+#define RESOURCE_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace JoyEngine
+{
+	class BenchmarkSuite;
+	class Resource;
+
+	// Slot of a resource in ResourceTable and generation of the slot when the resource was put there
+	struct ResourceSlotHandle
+	{
+		uint32_t index = UINT32_MAX;
+		uint32_t generation = 0;
+	};
+
+	// Reference counted resources by id.
+	// Ids are found in an open addressing hash map that points to slots. A slot keeps its generation and reference count
+	// in one atomic, the generation grows when the resource is released, so stale handles and map entries never take the slot's next resource.
+	// Acquiring a resource that is alive takes no lock. Inserting and releasing the last reference lock a mutex,
+	// replaced maps and slot pages are kept until the table is destroyed because readers might still look at them.
+	class ResourceTable
+	{
+	public:
+		ResourceTable();
+		~ResourceTable();
+
+		ResourceTable(const ResourceTable&) = delete;
+		ResourceTable& operator=(const ResourceTable&) = delete;
+
+		// Adds a reference to the alive resource with this id, nullptr if there is none
+		[[nodiscard]] Resource* TryAcquire(uint64_t id, ResourceSlotHandle& slot) const;
+
+		// Puts resource with one reference. If another thread has put a resource with the same id first,
+		// that one gets the reference and is returned, then the passed resource is not owned by the table
+		[[nodiscard]] Resource* Insert(uint64_t id, Resource* resource, ResourceSlotHandle& slot);
+
+		void AddRef(ResourceSlotHandle slot) const;
+
+		// Returns the resource when its last reference is released, the caller deletes it
+		[[nodiscard]] Resource* Release(ResourceSlotHandle slot);
+
+		[[nodiscard]] bool Contains(uint64_t id) const;
+		[[nodiscard]] uint32_t GetRefCount(ResourceSlotHandle slot) const;
+		[[nodiscard]] uint32_t GetResourcesCount() const { return m_resourcesCount.load(std::memory_order_relaxed); }
+
+		static bool Test();
+
+		// Load, lookup and release against std::map with plain reference counts
+		static void AddBenchmarks(BenchmarkSuite& suite);
+
+	private:
+		static constexpr uint32_t SlotsPageSize = 4096;
+		static constexpr uint32_t MaxSlotsPagesCount = 1024;
+
+		struct MapEntry
+		{
+			std::atomic<uint64_t> id; // 0 is empty
+			std::atomic<uint64_t> value; // packed ResourceSlotHandle
+		};
+
+		struct Map
+		{
+			explicit Map(uint32_t capacity);
+
+			const uint32_t mask;
+			uint32_t idsCount = 0; // including ids whose resources are released, written under the mutex only
+			std::unique_ptr<MapEntry[]> entries;
+		};
+
+		struct Slot
+		{
+			std::atomic<uint64_t> state; // generation << 32 | reference count
+			Resource* resource = nullptr;
+			uint64_t id = 0;
+			uint32_t nextFreeIndex = UINT32_MAX;
+		};
+
+		[[nodiscard]] Slot* GetSlot(uint32_t index) const;
+		[[nodiscard]] bool TryAddRef(ResourceSlotHandle slot) const;
+		[[nodiscard]] ResourceSlotHandle AllocateSlot();
+		void SetMapValue(uint64_t id, uint64_t value);
+		void ClearMapValue(uint64_t id, uint64_t value);
+
+		std::atomic<Map*> m_map;
+		std::vector<std::unique_ptr<Map>> m_maps; // the last one is current
+
+		std::array<std::atomic<Slot*>, MaxSlotsPagesCount> m_slotsPages;
+		uint32_t m_slotsCount = 0;
+		uint32_t m_freeSlotIndex = UINT32_MAX;
+
+		std::atomic<uint32_t> m_resourcesCount = 0;
+		std::mutex m_mutex;
+	};
+}
+
+#endif // RESOURCE_TABLE_H
@@ -12,6 +12,8 @@ namespace JoyEngine
 	{
 		DescriptorManager::Get()->AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_DSV, m_descriptorIndex, m_cpuHandle, m_gpuHandle);
 
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		GraphicsManager::Get()->GetDevice()->CreateDepthStencilView(
 			resource,
 			&desc,
@@ -23,6 +25,8 @@ namespace JoyEngine
 	{
 		DescriptorManager::Get()->AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, m_descriptorIndex, m_cpuHandle, m_gpuHandle);
 
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		GraphicsManager::Get()->GetDevice()->CreateSampler(
 			&desc,
 			m_cpuHandle);
@@ -33,6 +37,8 @@ namespace JoyEngine
 	{
 		DescriptorManager::Get()->AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_descriptorIndex, m_cpuHandle, m_gpuHandle);
 
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		GraphicsManager::Get()->GetDevice()->CreateConstantBufferView(
 			&desc,
 			m_cpuHandle);
@@ -43,6 +49,8 @@ namespace JoyEngine
 	{
 		DescriptorManager::Get()->AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_descriptorIndex, m_cpuHandle, m_gpuHandle);
 
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		GraphicsManager::Get()->GetDevice()->CreateUnorderedAccessView(
 			resource,
 			nullptr,
@@ -55,6 +63,8 @@ namespace JoyEngine
 	{
 		DescriptorManager::Get()->AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_RTV, m_descriptorIndex, m_cpuHandle, m_gpuHandle);
 
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		GraphicsManager::Get()->GetDevice()->CreateRenderTargetView(
 			resource,
 			&desc,
@@ -66,10 +76,19 @@ namespace JoyEngine
 	{
 		DescriptorManager::Get()->AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, m_descriptorIndex, m_cpuHandle, m_gpuHandle);
 
+		if (GraphicsManager::Get()->IsHeadless()) return;
+
 		GraphicsManager::Get()->GetDevice()->CreateShaderResourceView(
 			resource,
 			&desc,
 			m_cpuHandle);
 	}
 
+	ResourceView::~ResourceView()
+	{
+		if (DescriptorManager::Get() != nullptr)
+		{
+			DescriptorManager::Get()->FreeDescriptor(m_type, m_descriptorIndex);
+		}
+	}
 }
@@ -11,7 +11,10 @@ namespace JoyEngine
 	{
 	public:
 		ResourceView() = delete;
-		~ResourceView() = default;
+		~ResourceView();
+
+		ResourceView(const ResourceView&) = delete;
+		ResourceView& operator=(const ResourceView&) = delete;
 
 		explicit ResourceView(const D3D12_DEPTH_STENCIL_VIEW_DESC& desc, ID3D12Resource* resource);
 		explicit ResourceView(const D3D12_SAMPLER_DESC&);
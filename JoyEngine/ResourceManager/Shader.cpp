@@ -6,7 +6,7 @@
 namespace JoyEngine
 {
 	Shader::Shader(const char* shaderPath, ShaderTypeFlags shaderType):
-		Resource(shaderPath),
+		Resource(GetShaderId(shaderPath, shaderType)),
 		m_shaderType(shaderType)
 	{
 		const std::vector<char> shaderData = DataManager::Get()->GetData(shaderPath);
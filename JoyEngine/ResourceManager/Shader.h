@@ -21,6 +21,12 @@ namespace JoyEngine
 
 		explicit Shader(const char* shaderPath, ShaderTypeFlags shaderType);
 
+		// One file can be compiled for different stages, so stages are a part of the resource id
+		[[nodiscard]] static uint64_t GetShaderId(const char* shaderPath, ShaderTypeFlags shaderType) noexcept
+		{
+			return MemHash64(&shaderType, sizeof(shaderType), StrHash64(shaderPath));
+		}
+
 		~Shader() final = default;
 
 		[[nodiscard]] ShaderTypeFlags GetShaderType() const noexcept { return m_shaderType; }
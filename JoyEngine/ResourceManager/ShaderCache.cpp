@@ -0,0 +1,470 @@
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <set>
+
+#include "Benchmarks/TestSuite.h"
+#include "Common/HashDefs.h"
+#include "Utils/Assert.h"
+#include "Utils/FileUtils.h"
+#include "Utils/Log.h"
+
+#define SHADER_CACHE_MAGIC 0x4353594A // 'JYSC'
+#define SHADER_CACHE_FORMAT_VERSION 1
+
+namespace JoyEngine
+{
+	namespace
+	{
+		template <typename T>
+		void WriteValue(std::vector<char>& data, const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			const char* ptr = reinterpret_cast<const char*>(&value);
+			data.insert(data.end(), ptr, ptr + sizeof(T));
+		}
+
+		void WriteBytes(std::vector<char>& data, const void* bytes, size_t size)
+		{
+			const char* ptr = static_cast<const char*>(bytes);
+			data.insert(data.end(), ptr, ptr + size);
+		}
+
+		class CacheReader
+		{
+		public:
+			explicit CacheReader(const std::vector<char>& data) :
+				m_data(data)
+			{
+			}
+
+			template <typename T>
+			bool Read(T& value)
+			{
+				static_assert(std::is_trivially_copyable_v<T>);
+				return ReadBytes(&value, sizeof(T));
+			}
+
+			bool ReadBytes(void* bytes, size_t size)
+			{
+				if (m_offset + size > m_data.size()) return false;
+				memcpy(bytes, m_data.data() + m_offset, size);
+				m_offset += size;
+				return true;
+			}
+
+			[[nodiscard]] bool IsFinished() const noexcept { return m_offset == m_data.size(); }
+
+		private:
+			const std::vector<char>& m_data;
+			size_t m_offset = 0;
+		};
+	}
+
+	ShaderIncludeCache::ShaderIncludeCache(std::filesystem::path shadersFolderPath, std::filesystem::path commonEngineStructsPath) :
+		m_shadersFolderPath(std::move(shadersFolderPath)),
+		m_commonEngineStructsPath(std::move(commonEngineStructsPath))
+	{
+	}
+
+	const std::vector<char>& ShaderIncludeCache::GetInclude(const std::string& includeName)
+	{
+		std::lock_guard lock(m_mutex);
+
+		const auto it = m_includes.find(includeName);
+		if (it != m_includes.end())
+		{
+			return it->second;
+		}
+
+		const std::filesystem::path includePath = includeName == "CommonEngineStructs.h"
+			                                          ? m_commonEngineStructsPath
+			                                          : m_shadersFolderPath / std::filesystem::path(includeName);
+
+		// std::map nodes are stable, so the reference stays valid while other threads add includes
+		return m_includes.insert({includeName, ReadFile(includePath.generic_string(), 0)}).first->second;
+	}
+
+	void ShaderIncludeCache::CollectIncludes(const std::vector<char>& source, std::vector<std::string>& includes)
+	{
+		std::set<std::string> visited;
+		std::vector<std::string> stack;
+		ParseIncludeDirectives(source, stack);
+
+		while (!stack.empty())
+		{
+			std::string includeName = std::move(stack.back());
+			stack.pop_back();
+
+			if (visited.contains(includeName)) continue;
+
+			ParseIncludeDirectives(GetInclude(includeName), stack);
+			visited.insert(std::move(includeName));
+		}
+
+		includes.assign(visited.begin(), visited.end());
+	}
+
+	std::string ShaderIncludeCache::NormalizeIncludeName(const std::wstring& includeName)
+	{
+		// include names are plain ASCII paths relative to the shaders folder
+		std::string name(includeName.begin(), includeName.end());
+		std::ranges::replace(name, '\\', '/');
+		while (name.starts_with("./"))
+		{
+			name = name.substr(2);
+		}
+		return name;
+	}
+
+	// Very small preprocessor: finds every #include "..." line. Conditional includes are collected too,
+	// which only makes the cache key a bit more conservative.
+	void ShaderIncludeCache::ParseIncludeDirectives(const std::vector<char>& source, std::vector<std::string>& includes)
+	{
+		const std::string_view text(source.data(), source.size());
+		size_t lineStart = 0;
+
+		while (lineStart < text.size())
+		{
+			size_t lineEnd = text.find('\n', lineStart);
+			if (lineEnd == std::string_view::npos) lineEnd = text.size();
+
+			std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+			lineStart = lineEnd + 1;
+
+			const size_t hashPos = line.find_first_not_of(" \t");
+			if (hashPos == std::string_view::npos || line[hashPos] != '#') continue;
+
+			line = line.substr(hashPos + 1);
+			const size_t directivePos = line.find_first_not_of(" \t");
+			if (directivePos == std::string_view::npos || !line.substr(directivePos).starts_with("include")) continue;
+
+			const size_t openPos = line.find_first_of("\"<", directivePos);
+			if (openPos == std::string_view::npos) continue;
+			const size_t closePos = line.find_first_of("\">", openPos + 1);
+			if (closePos == std::string_view::npos) continue;
+
+			const std::string_view name = line.substr(openPos + 1, closePos - openPos - 1);
+			includes.push_back(NormalizeIncludeName(std::wstring(name.begin(), name.end())));
+		}
+	}
+
+	ShaderCache::ShaderCache(std::filesystem::path cacheFolderPath) :
+		m_cacheFolderPath(std::move(cacheFolderPath))
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_cacheFolderPath, error);
+		if (error)
+		{
+			Logger::LogFormat(LogLevel::Warning, "Cannot create shader cache folder %s\n", m_cacheFolderPath.generic_string().c_str());
+		}
+	}
+
+	bool ShaderCache::Load(uint64_t key, ShaderCacheEntry& entry) const
+	{
+		const std::filesystem::path path = GetEntryPath(key);
+		if (!std::filesystem::exists(path))
+		{
+			return false;
+		}
+
+		const std::vector<char> data = ReadFile(path.generic_string(), 0);
+		if (!Deserialize(key, data, entry))
+		{
+			Logger::LogFormat("Shader cache entry %s is corrupted, recompiling\n", path.generic_string().c_str());
+			entry = {};
+			return false;
+		}
+		return true;
+	}
+
+	void ShaderCache::Store(uint64_t key, const ShaderCacheEntry& entry) const
+	{
+		std::vector<char> data;
+		Serialize(key, entry, data);
+
+		// write to the temporary file first, so nobody can read half written entry
+		const std::filesystem::path path = GetEntryPath(key);
+		std::filesystem::path tempPath = path;
+		tempPath += ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				Logger::LogFormat(LogLevel::Warning, "Cannot write shader cache entry %s\n", tempPath.generic_string().c_str());
+				return;
+			}
+			file.write(data.data(), static_cast<std::streamsize>(data.size()));
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, path, error);
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+		}
+	}
+
+	uint64_t ShaderCache::ComputeKey(
+		ShaderType type,
+		const std::wstring& entryPoint,
+		const std::wstring& target,
+		const std::wstring& arguments,
+		uint64_t compilerVersion,
+		const std::vector<char>& source,
+		ShaderIncludeCache& includeCache)
+	{
+		uint64_t hash = val_64_const;
+		hash = MemHash64(&type, sizeof(type), hash);
+		hash = MemHash64(entryPoint.data(), entryPoint.size() * sizeof(wchar_t), hash);
+		hash = MemHash64(target.data(), target.size() * sizeof(wchar_t), hash);
+		hash = MemHash64(arguments.data(), arguments.size() * sizeof(wchar_t), hash);
+		hash = MemHash64(&compilerVersion, sizeof(compilerVersion), hash);
+
+		const uint64_t sourceSize = source.size();
+		hash = MemHash64(&sourceSize, sizeof(sourceSize), hash);
+		hash = MemHash64(source.data(), source.size(), hash);
+
+		std::vector<std::string> includes;
+		includeCache.CollectIncludes(source, includes);
+		for (const auto& includeName : includes)
+		{
+			const std::vector<char>& includeData = includeCache.GetInclude(includeName);
+			const uint64_t includeSize = includeData.size();
+			hash = MemHash64(includeName.data(), includeName.size() + 1, hash);
+			hash = MemHash64(&includeSize, sizeof(includeSize), hash);
+			hash = MemHash64(includeData.data(), includeData.size(), hash);
+		}
+
+		return hash;
+	}
+
+	void ShaderCache::Serialize(uint64_t key, const ShaderCacheEntry& entry, std::vector<char>& data)
+	{
+		data.clear();
+
+		WriteValue(data, static_cast<uint32_t>(SHADER_CACHE_MAGIC));
+		WriteValue(data, static_cast<uint32_t>(SHADER_CACHE_FORMAT_VERSION));
+		WriteValue(data, key);
+
+		WriteValue(data, static_cast<uint64_t>(entry.bytecode.size()));
+		WriteBytes(data, entry.bytecode.data(), entry.bytecode.size());
+
+		WriteValue(data, static_cast<uint32_t>(entry.bindings.size()));
+		for (const auto& binding : entry.bindings)
+		{
+			WriteValue(data, binding.tableType);
+			WriteValue(data, static_cast<uint32_t>(binding.name.size()));
+			WriteBytes(data, binding.name.data(), binding.name.size());
+			WriteValue(data, static_cast<int32_t>(binding.input.Type));
+			WriteValue(data, binding.input.BindPoint);
+			WriteValue(data, binding.input.BindCount);
+			WriteValue(data, binding.input.Space);
+			WriteValue(data, static_cast<int32_t>(binding.input.Visibility));
+		}
+
+		WriteValue(data, static_cast<uint32_t>(entry.functions.size()));
+		for (const auto& function : entry.functions)
+		{
+			WriteValue(data, static_cast<int32_t>(function.kind));
+			WriteValue(data, static_cast<int32_t>(function.tableType));
+			WriteValue(data, static_cast<uint32_t>(function.name.size()));
+			// function names are stored as utf-16 code units independently of wchar_t size
+			for (const wchar_t c : function.name)
+			{
+				WriteValue(data, static_cast<uint16_t>(c));
+			}
+		}
+	}
+
+	bool ShaderCache::Deserialize(uint64_t key, const std::vector<char>& data, ShaderCacheEntry& entry)
+	{
+		CacheReader reader(data);
+
+		uint32_t magic, formatVersion;
+		uint64_t storedKey;
+		if (!reader.Read(magic) || magic != SHADER_CACHE_MAGIC) return false;
+		if (!reader.Read(formatVersion) || formatVersion != SHADER_CACHE_FORMAT_VERSION) return false;
+		if (!reader.Read(storedKey) || storedKey != key) return false;
+
+		uint64_t bytecodeSize;
+		if (!reader.Read(bytecodeSize) || bytecodeSize > data.size()) return false;
+		entry.bytecode.resize(bytecodeSize);
+		if (!reader.ReadBytes(entry.bytecode.data(), bytecodeSize)) return false;
+
+		uint32_t bindingsCount;
+		if (!reader.Read(bindingsCount) || bindingsCount > data.size()) return false;
+		entry.bindings.resize(bindingsCount);
+		for (auto& binding : entry.bindings)
+		{
+			uint32_t nameSize;
+			int32_t inputType, visibility;
+			if (!reader.Read(binding.tableType)) return false;
+			if (!reader.Read(nameSize) || nameSize > data.size()) return false;
+			binding.name.resize(nameSize);
+			if (!reader.ReadBytes(binding.name.data(), nameSize)) return false;
+			if (!reader.Read(inputType)) return false;
+			if (!reader.Read(binding.input.BindPoint)) return false;
+			if (!reader.Read(binding.input.BindCount)) return false;
+			if (!reader.Read(binding.input.Space)) return false;
+			if (!reader.Read(visibility)) return false;
+			binding.input.Type = static_cast<D3D_SHADER_INPUT_TYPE>(inputType);
+			binding.input.Visibility = static_cast<D3D12_SHADER_VISIBILITY>(visibility);
+		}
+
+		uint32_t functionsCount;
+		if (!reader.Read(functionsCount) || functionsCount > data.size()) return false;
+		entry.functions.resize(functionsCount);
+		for (auto& function : entry.functions)
+		{
+			int32_t kind, tableType;
+			uint32_t nameSize;
+			if (!reader.Read(kind)) return false;
+			if (!reader.Read(tableType)) return false;
+			if (!reader.Read(nameSize) || nameSize > data.size()) return false;
+			function.kind = static_cast<D3D12_SHADER_VERSION_TYPE>(kind);
+			function.tableType = static_cast<ShaderTableType>(tableType);
+			function.name.resize(nameSize);
+			for (auto& c : function.name)
+			{
+				uint16_t codeUnit;
+				if (!reader.Read(codeUnit)) return false;
+				c = static_cast<wchar_t>(codeUnit);
+			}
+		}
+
+		return reader.IsFinished();
+	}
+
+	void ShaderCache::ApplyReflection(
+		const ShaderCacheEntry& entry,
+		ShaderInputMap& globalInputMap,
+		std::map<ShaderTableType, ShaderInputMap>& localInputMaps,
+		std::map<D3D12_SHADER_VERSION_TYPE, std::wstring>& typeFunctionNameMap)
+	{
+		for (const auto& function : entry.functions)
+		{
+			typeFunctionNameMap.insert({function.kind, function.name});
+			if (!localInputMaps.contains(function.tableType))
+			{
+				localInputMaps.insert({function.tableType, {}});
+			}
+		}
+
+		for (const auto& binding : entry.bindings)
+		{
+			ShaderInputMap& inputMap = binding.tableType == ShaderBindingRecord::GlobalTable
+				                           ? globalInputMap
+				                           : localInputMaps.at(static_cast<ShaderTableType>(binding.tableType));
+
+			// same input used by several stages is visible for all of them
+			if (!inputMap.contains(binding.name))
+			{
+				inputMap.insert({binding.name, binding.input});
+			}
+			else
+			{
+				inputMap[binding.name].Visibility = D3D12_SHADER_VISIBILITY_ALL;
+			}
+		}
+	}
+
+	std::filesystem::path ShaderCache::GetEntryPath(uint64_t key) const
+	{
+		char fileName[32];
+		snprintf(fileName, sizeof(fileName), "%016llx.shc", static_cast<unsigned long long>(key));
+		return m_cacheFolderPath / fileName;
+	}
+
+	bool ShaderCache::Test()
+	{
+		bool isPassed = true;
+
+		ShaderCacheEntry entry;
+		entry.bytecode = {'D', 'X', 'B', 'C', 0, 1, 2, 3, 4};
+		entry.bindings.push_back({ShaderBindingRecord::GlobalTable, "objectMatrices", {D3D_SIT_STRUCTURED, 1, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX}});
+		entry.bindings.push_back({ShaderTableHitGroup, "hitData", {D3D_SIT_CBUFFER, 0, 1, 2, D3D12_SHADER_VISIBILITY_ALL}});
+		entry.functions.push_back({D3D12_SHVER_RAY_GENERATION_SHADER, ShaderTableRaygen, L"RayGen"});
+		constexpr uint64_t key = 0x0123456789abcdef;
+
+		const auto isSameEntry = [&entry](const ShaderCacheEntry& loaded)
+		{
+			if (loaded.bytecode != entry.bytecode ||
+				loaded.bindings.size() != entry.bindings.size() ||
+				loaded.functions.size() != entry.functions.size())
+			{
+				return false;
+			}
+			for (size_t i = 0; i < entry.bindings.size(); i++)
+			{
+				const ShaderBindingRecord& a = loaded.bindings[i];
+				const ShaderBindingRecord& b = entry.bindings[i];
+				if (a.tableType != b.tableType || a.name != b.name ||
+					a.input.Type != b.input.Type || a.input.BindPoint != b.input.BindPoint || a.input.BindCount != b.input.BindCount ||
+					a.input.Space != b.input.Space || a.input.Visibility != b.input.Visibility)
+				{
+					return false;
+				}
+			}
+			for (size_t i = 0; i < entry.functions.size(); i++)
+			{
+				const ShaderFunctionRecord& a = loaded.functions[i];
+				const ShaderFunctionRecord& b = entry.functions[i];
+				if (a.kind != b.kind || a.tableType != b.tableType || a.name != b.name)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		std::vector<char> data;
+		Serialize(key, entry, data);
+
+		// Through a file, the folder is removed after the test
+		const std::filesystem::path folderPath = std::filesystem::temp_directory_path() / "JoyEngineShaderCacheTest";
+		{
+			const ShaderCache cache(folderPath);
+			cache.Store(key, entry);
+
+			ShaderCacheEntry loaded;
+			isPassed &= TEST_CHECK(cache.Load(key, loaded) && isSameEntry(loaded), "entry is not the same after store and load");
+			isPassed &= TEST_CHECK(!cache.Load(key + 1, loaded), "missing entry is loaded");
+
+			{
+				std::ofstream file(cache.GetEntryPath(key), std::ios::binary | std::ios::trunc);
+				file.write(data.data(), static_cast<std::streamsize>(data.size() / 2));
+			}
+			isPassed &= TEST_CHECK(!cache.Load(key, loaded), "truncated file is loaded");
+			isPassed &= TEST_CHECK(loaded.bytecode.empty(), "rejected entry is not cleared");
+		}
+		std::error_code error;
+		std::filesystem::remove_all(folderPath, error);
+
+		bool isTruncatedRead = false;
+		for (size_t size = 0; size < data.size(); size++)
+		{
+			ShaderCacheEntry loaded;
+			isTruncatedRead |= Deserialize(key, std::vector<char>(data.begin(), data.begin() + static_cast<ptrdiff_t>(size)), loaded);
+		}
+		isPassed &= TEST_CHECK(!isTruncatedRead, "truncated data is read");
+
+		// magic, format version, key and bytecode size
+		for (const size_t offset : {size_t(0), size_t(4), size_t(8), size_t(16 + 7)})
+		{
+			std::vector<char> corrupted = data;
+			corrupted[offset] = static_cast<char>(~corrupted[offset]);
+			ShaderCacheEntry loaded;
+			isPassed &= TEST_CHECK(!Deserialize(key, corrupted, loaded), "corrupted header is read");
+		}
+
+		std::vector<char> extended = data;
+		extended.push_back(0);
+		ShaderCacheEntry loaded;
+		isPassed &= TEST_CHECK(!Deserialize(key, extended, loaded), "data with trailing bytes is read");
+
+		return isPassed;
+	}
+}
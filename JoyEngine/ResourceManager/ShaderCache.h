@@ -0,0 +1,106 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <d3d12shader.h>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ShaderDefs.h"
+
+namespace JoyEngine
+{
+	// Shader inputs are kept in the order reflection reported them,
+	// so replaying them gives exactly the same merged input maps as a real compile.
+	struct ShaderBindingRecord
+	{
+		static constexpr int32_t GlobalTable = -1;
+
+		int32_t tableType = GlobalTable;
+		std::string name;
+		ShaderInput input;
+	};
+
+	struct ShaderFunctionRecord
+	{
+		D3D12_SHADER_VERSION_TYPE kind;
+		ShaderTableType tableType;
+		std::wstring name;
+	};
+
+	struct ShaderCacheEntry
+	{
+		std::vector<char> bytecode;
+		std::vector<ShaderBindingRecord> bindings;
+		std::vector<ShaderFunctionRecord> functions;
+	};
+
+	// Keeps include files in memory, so every compile after the first one doesn't touch the disk.
+	// CommonEngineStructs.h lives in the engine folder, other includes are taken from JoyData/shaders
+	class ShaderIncludeCache
+	{
+	public:
+		ShaderIncludeCache() = delete;
+
+		ShaderIncludeCache(std::filesystem::path shadersFolderPath, std::filesystem::path commonEngineStructsPath);
+
+		[[nodiscard]] const std::vector<char>& GetInclude(const std::string& includeName);
+
+		// Fills sorted unique list of all the includes reachable from the source
+		void CollectIncludes(const std::vector<char>& source, std::vector<std::string>& includes);
+
+		[[nodiscard]] static std::string NormalizeIncludeName(const std::wstring& includeName);
+
+	private:
+		static void ParseIncludeDirectives(const std::vector<char>& source, std::vector<std::string>& includes);
+
+		const std::filesystem::path m_shadersFolderPath;
+		const std::filesystem::path m_commonEngineStructsPath;
+
+		std::mutex m_mutex;
+		std::map<std::string, std::vector<char>> m_includes;
+	};
+
+	class ShaderCache
+	{
+	public:
+		ShaderCache() = delete;
+
+		explicit ShaderCache(std::filesystem::path cacheFolderPath);
+
+		[[nodiscard]] bool Load(uint64_t key, ShaderCacheEntry& entry) const;
+
+		void Store(uint64_t key, const ShaderCacheEntry& entry) const;
+
+		[[nodiscard]] static uint64_t ComputeKey(
+			ShaderType type,
+			const std::wstring& entryPoint,
+			const std::wstring& target,
+			const std::wstring& arguments,
+			uint64_t compilerVersion,
+			const std::vector<char>& source,
+			ShaderIncludeCache& includeCache);
+
+		static void Serialize(uint64_t key, const ShaderCacheEntry& entry, std::vector<char>& data);
+
+		[[nodiscard]] static bool Deserialize(uint64_t key, const std::vector<char>& data, ShaderCacheEntry& entry);
+
+		static void ApplyReflection(
+			const ShaderCacheEntry& entry,
+			ShaderInputMap& globalInputMap,
+			std::map<ShaderTableType, ShaderInputMap>& localInputMaps,
+			std::map<D3D12_SHADER_VERSION_TYPE, std::wstring>& typeFunctionNameMap);
+
+		// Round trips an entry through a cache file in the temp folder and checks that truncated
+		// and corrupted data is rejected. Doesn't need the compiler
+		static bool Test();
+
+	private:
+		[[nodiscard]] std::filesystem::path GetEntryPath(uint64_t key) const;
+
+		const std::filesystem::path m_cacheFolderPath;
+	};
+}
+#endif // SHADER_CACHE_H
@@ -4,7 +4,9 @@
 #include <d3d12.h>
 #include <D3Dcompiler.h>
 #include <functional>
+#include <mutex>
 
+#include "Common/HashDefs.h"
 #include "DataManager/DataManager.h"
 #include "Utils/Log.h"
 
@@ -52,45 +54,28 @@ namespace JoyEngine
 		return tableType;
 	}
 
-	ShaderSystemIncludeHandler::ShaderSystemIncludeHandler() :
-		m_shadersFolderPath(std::filesystem::absolute(R"(JoyData/shaders)").generic_string())
+	ShaderSystemIncludeHandler::ShaderSystemIncludeHandler(ShaderIncludeCache* includeCache) :
+		m_includeCache(includeCache)
 	{
-		const std::vector<char> commonEngineStructsData = ReadFile(
-			std::filesystem::absolute(R"(JoyEngine/CommonEngineStructs.h)").generic_string(),
-			0);
-		ASSERT_SUCC(ShaderCompiler::s_dxcUtils->CreateBlob(
-			commonEngineStructsData.data(),
-			commonEngineStructsData.size(),
-			0,
-			&m_commonEngineStructsDataBlob));
 	}
 
 	// CommonEngineStructs.h is the header for the shader system and for the engine code.
 	// The meaning of this is to use same structs in both places to reduce number of errors
-	// This header is in the engine folder and we load it separately and cache.
-	// Other shaders use JoyData/shaders as the include folder
+	// This header is in the engine folder, other shaders use JoyData/shaders as the include folder.
+	// All of them are read once and kept in the include cache.
 	HRESULT ShaderSystemIncludeHandler::LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource)
 	{
-		if (wcscmp(L"./CommonEngineStructs.h", pFilename) == 0)
-		{
-			m_commonEngineStructsDataBlob->AddRef();
-			*ppIncludeSource = m_commonEngineStructsDataBlob.Get();
-		}
-		else
-		{
-			ComPtr<IDxcBlobEncoding> includeBlob;
-			const std::vector<char> includeData = ReadFile(
-				(std::filesystem::absolute(m_shadersFolderPath) /
-					std::filesystem::path(pFilename)).generic_string(),
-				0);
-			ASSERT_SUCC(ShaderCompiler::s_dxcUtils->CreateBlob(
-				includeData.data(),
-				includeData.size(),
-				0,
-				&includeBlob));
-			includeBlob->AddRef();
-			*ppIncludeSource = includeBlob.Get();
-		}
+		const std::vector<char>& includeData = m_includeCache->GetInclude(ShaderIncludeCache::NormalizeIncludeName(pFilename));
+
+		ComPtr<IDxcBlobEncoding> includeBlob;
+		ASSERT_SUCC(ShaderCompiler::s_dxcUtils->CreateBlob(
+			includeData.data(),
+			static_cast<uint32_t>(includeData.size()),
+			0,
+			&includeBlob));
+		includeBlob->AddRef();
+		*ppIncludeSource = includeBlob.Get();
+
 		return S_OK;
 	}
 
@@ -101,30 +86,23 @@ namespace JoyEngine
 	DxcCreateInstanceProc dxc_create_func = nullptr;
 
 
-	void ShaderCompiler::Compile(
-		ShaderType type,
-		const std::wstring& shaderName,
-		const std::vector<char>& shaderData,
-		ID3DBlob** module,
-		ShaderInputMap& globalInputMap,
-		std::map<ShaderTableType, ShaderInputMap>& localInputMaps,
-		std::map<D3D12_SHADER_VERSION_TYPE, std::wstring>& typeFunctionNameMap)
+	std::once_flag g_dxcModulesLoaded;
+	std::once_flag g_shaderCachesCreated;
+
+	void ShaderCompiler::InitCompiler()
 	{
-		if (dxil_module == nullptr)
+		std::call_once(g_dxcModulesLoaded, []()
 		{
 			dxil_module = LoadLibrary(L"ThirdParty/dxc/bin/x64/dxil.dll");
 			ASSERT(dxil_module != nullptr);
 			dxil_create_func = (DxcCreateInstanceProc)GetProcAddress(dxil_module, "DxcCreateInstance");
 			ASSERT(dxil_create_func != nullptr);
-		}
 
-		if (dxc_module == nullptr)
-		{
 			dxc_module = LoadLibrary(L"ThirdParty/dxc/bin/x64/dxcompiler.dll");
 			ASSERT(dxc_module != nullptr);
 			dxc_create_func = (DxcCreateInstanceProc)GetProcAddress(dxc_module, "DxcCreateInstance");
 			ASSERT(dxc_create_func != nullptr);
-		}
+		});
 
 		if (s_dxcUtils == nullptr)
 		{
@@ -149,9 +127,42 @@ namespace JoyEngine
 
 		if (m_includeHandler == nullptr)
 		{
-			m_includeHandler = std::make_unique<ShaderSystemIncludeHandler>();
+			m_includeHandler = std::make_unique<ShaderSystemIncludeHandler>(s_includeCache.get());
 		}
+	}
 
+	// Compiler binaries are identified by their size and write time,
+	// so the cache is invalidated after dxc update without loading it
+	uint64_t ShaderCompiler::GetCompilerVersion()
+	{
+		uint64_t version = val_64_const;
+		for (const char* path : {"ThirdParty/dxc/bin/x64/dxcompiler.dll", "ThirdParty/dxc/bin/x64/dxil.dll"})
+		{
+			std::error_code error;
+			const uint64_t fileSize = std::filesystem::file_size(path, error);
+			const auto writeTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+			version = MemHash64(&fileSize, sizeof(fileSize), version);
+			version = MemHash64(&writeTime, sizeof(writeTime), version);
+		}
+		return version;
+	}
+
+	void ShaderCompiler::Compile(
+		ShaderType type,
+		const std::wstring& shaderName,
+		const std::vector<char>& shaderData,
+		ID3DBlob** module,
+		ShaderInputMap& globalInputMap,
+		std::map<ShaderTableType, ShaderInputMap>& localInputMaps,
+		std::map<D3D12_SHADER_VERSION_TYPE, std::wstring>& typeFunctionNameMap)
+	{
+		std::call_once(g_shaderCachesCreated, []()
+		{
+			s_includeCache = std::make_unique<ShaderIncludeCache>(
+				std::filesystem::absolute(R"(JoyData/shaders)"),
+				std::filesystem::absolute(R"(JoyEngine/CommonEngineStructs.h)"));
+			s_shaderCache = std::make_unique<ShaderCache>(std::filesystem::absolute(R"(JoyData/shaders_cache)"));
+		});
 
 		LPCWSTR entryPointL = nullptr;
 		LPCWSTR targetL = nullptr;
@@ -189,18 +200,6 @@ namespace JoyEngine
 		}
 
 
-		DxcDefine Shader_Macros[] = {{L"SHADER", L"1"}, nullptr, nullptr};
-		IDxcIncludeHandler* includeHandler = m_includeHandler.get();
-
-		ComPtr<IDxcBlobEncoding> sourceBlob;
-		ComPtr<IDxcOperationResult> dxcOperationResult;
-
-		ASSERT_SUCC(s_dxcUtils->CreateBlobFromPinned(
-			shaderData.data(),
-			shaderData.size(),
-			0,
-			&sourceBlob));
-
 #if defined(_DEBUG)
 		// Enable better shader debugging with the graphics debugging tools.
 		LPCWSTR arguments[] = {
@@ -214,6 +213,47 @@ namespace JoyEngine
 		uint32_t argCount = 0;
 #endif
 
+		DxcDefine Shader_Macros[] = {{L"SHADER", L"1"}, nullptr, nullptr};
+
+		std::wstring argumentsKey = L"-DSHADER=1";
+		for (uint32_t i = 0; i < argCount; i++)
+		{
+			argumentsKey += L" ";
+			argumentsKey += arguments[i];
+		}
+
+		const uint64_t cacheKey = ShaderCache::ComputeKey(
+			type,
+			entryPointL,
+			targetL,
+			argumentsKey,
+			GetCompilerVersion(),
+			shaderData,
+			*s_includeCache);
+
+		ShaderCacheEntry cacheEntry;
+		if (s_shaderCache->Load(cacheKey, cacheEntry))
+		{
+			ASSERT_SUCC(D3DCreateBlob(cacheEntry.bytecode.size(), module));
+			memcpy((*module)->GetBufferPointer(), cacheEntry.bytecode.data(), cacheEntry.bytecode.size());
+
+			ShaderCache::ApplyReflection(cacheEntry, globalInputMap, localInputMaps, typeFunctionNameMap);
+			return;
+		}
+
+		InitCompiler();
+
+		IDxcIncludeHandler* includeHandler = m_includeHandler.get();
+
+		ComPtr<IDxcBlobEncoding> sourceBlob;
+		ComPtr<IDxcOperationResult> dxcOperationResult;
+
+		ASSERT_SUCC(s_dxcUtils->CreateBlobFromPinned(
+			shaderData.data(),
+			shaderData.size(),
+			0,
+			&sourceBlob));
+
 		HRESULT res = s_dxcCompiler->Compile(
 			sourceBlob.Get(), // pSource
 			shaderName.c_str(), // pSourceName
@@ -234,7 +274,7 @@ namespace JoyEngine
 			if (SUCCEEDED(res) && errorsBlob)
 			{
 				const char* errorMsg = static_cast<const char*>(errorsBlob->GetBufferPointer());
-				Logger::Log(errorMsg);
+				Logger::Log(LogLevel::Error, errorMsg);
 			}
 		}
 		ASSERT_SUCC(res);
@@ -243,14 +283,15 @@ namespace JoyEngine
 
 		s_validator->Validate(reinterpret_cast<IDxcBlob*>(*module), 0, &dxcOperationResult);
 		dxcOperationResult->GetStatus(&res);
-		if (FAILED(res))
+		const bool isValid = SUCCEEDED(res);
+		if (!isValid)
 		{
 			ComPtr<IDxcBlobEncoding> errorsBlob;
 			res = dxcOperationResult->GetErrorBuffer(&errorsBlob);
 			if (SUCCEEDED(res) && errorsBlob)
 			{
 				const char* errorMsg = static_cast<const char*>(errorsBlob->GetBufferPointer());
-				Logger::Log(errorMsg);
+				Logger::Log(LogLevel::Error, errorMsg);
 			}
 		}
 
@@ -258,26 +299,19 @@ namespace JoyEngine
 
 		uint32_t shaderId;
 		ASSERT_SUCC(s_dxcReflection->FindFirstPartKind(DXIL_FOURCC('D', 'X', 'I', 'L'), &shaderId));
-		auto processShaderInputBindDesc = [&](ShaderInputMap& inputMap, D3D12_SHADER_INPUT_BIND_DESC& inputBindDesc)
+		auto processShaderInputBindDesc = [&](int32_t tableType, D3D12_SHADER_INPUT_BIND_DESC& inputBindDesc)
 		{
-			const std::string name = inputBindDesc.Name;
-			if (!inputMap.contains(name))
-			{
-				inputMap.insert({
-					inputBindDesc.Name,
-					{
-						inputBindDesc.Type,
-						inputBindDesc.BindPoint,
-						inputBindDesc.BindCount,
-						inputBindDesc.Space,
-						visibility
-					}
-				});
-			}
-			else
-			{
-				inputMap[name].Visibility = D3D12_SHADER_VISIBILITY_ALL;
-			}
+			cacheEntry.bindings.push_back({
+				tableType,
+				inputBindDesc.Name,
+				{
+					inputBindDesc.Type,
+					inputBindDesc.BindPoint,
+					inputBindDesc.BindCount,
+					inputBindDesc.Space,
+					visibility
+				}
+			});
 		};
 
 		if (type == JoyShaderTypeRaytracing)
@@ -321,14 +355,9 @@ namespace JoyEngine
 				// https://github.com/microsoft/DirectXShaderCompiler/blob/bae2325380a69d16ca244dc01dbe284946778b27/include/dxc/DxilContainer/DxilContainer.h#L562
 				// https://learn.microsoft.com/en-us/windows/win32/api/d3d12shader/ne-d3d12shader-d3d12_shader_version_type
 				auto kind = static_cast<D3D12_SHADER_VERSION_TYPE>(D3D12_SHVER_GET_TYPE(functionDesc.Version));
-				typeFunctionNameMap.insert({kind, unmangledName});
-
 				ShaderTableType tableType = ShaderKindToShaderTableType(kind);
 
-				if (!localInputMaps.contains(tableType))
-				{
-					localInputMaps.insert({tableType, {}});
-				}
+				cacheEntry.functions.push_back({kind, tableType, unmangledName});
 
 				for (uint32_t j = 0; j < functionDesc.BoundResources; j++)
 				{
@@ -338,11 +367,11 @@ namespace JoyEngine
 					const char* localPrefix = "local_";
 					if (strncmp(inputBindDesc.Name, localPrefix, 6) != 0)
 					{
-						processShaderInputBindDesc(globalInputMap, inputBindDesc);
+						processShaderInputBindDesc(ShaderBindingRecord::GlobalTable, inputBindDesc);
 					}
 					else
 					{
-						processShaderInputBindDesc(localInputMaps.at(tableType), inputBindDesc);
+						processShaderInputBindDesc(tableType, inputBindDesc);
 					}
 				}
 			}
@@ -360,8 +389,18 @@ namespace JoyEngine
 				D3D12_SHADER_INPUT_BIND_DESC inputBindDesc;
 				shaderReflection->GetResourceBindingDesc(i, &inputBindDesc);
 
-				processShaderInputBindDesc(globalInputMap, inputBindDesc);
+				processShaderInputBindDesc(ShaderBindingRecord::GlobalTable, inputBindDesc);
 			}
 		}
+
+		const char* bytecode = static_cast<const char*>((*module)->GetBufferPointer());
+		cacheEntry.bytecode.assign(bytecode, bytecode + (*module)->GetBufferSize());
+		// invalid shaders are not cached to keep validation errors visible on the next start
+		if (isValid)
+		{
+			s_shaderCache->Store(cacheKey, cacheEntry);
+		}
+
+		ShaderCache::ApplyReflection(cacheEntry, globalInputMap, localInputMaps, typeFunctionNameMap);
 	}
 }
@@ -10,13 +10,18 @@
 #include <xstring>
 #include <wrl/client.h>
 
+#include "ShaderCache.h"
+#include "ShaderDefs.h"
+
 using Microsoft::WRL::ComPtr;
 
 namespace JoyEngine
 {
 	struct ShaderSystemIncludeHandler final : IDxcIncludeHandler
 	{
-		ShaderSystemIncludeHandler();
+		ShaderSystemIncludeHandler() = delete;
+
+		explicit ShaderSystemIncludeHandler(ShaderIncludeCache* includeCache);
 
 		~ShaderSystemIncludeHandler() = default;
 
@@ -27,43 +32,9 @@ namespace JoyEngine
 		ULONG Release() override { return 0; }
 
 	private:
-		const std::string m_shadersFolderPath;
-		ComPtr<IDxcBlobEncoding> m_commonEngineStructsDataBlob;
-	};
-
-	enum ShaderType
-	{
-		JoyShaderTypeVertex = 1 << 0,
-		JoyShaderTypeHull = 1 << 1,
-		JoyShaderTypeDomain = 1 << 2,
-		JoyShaderTypeGeometry = 1 << 3,
-		JoyShaderTypePixel = 1 << 4,
-		JoyShaderTypeAmplification = 1 << 5,
-		JoyShaderTypeMesh = 1 << 6,
-		JoyShaderTypeCompute = 1 << 7,
-		JoyShaderTypeRaytracing = 1 << 8
-	};
-
-	enum ShaderTableType
-	{
-		ShaderTableRaygen = 0,
-		ShaderTableMiss,
-		ShaderTableHitGroup,
-		ShaderTableCallable,
+		ShaderIncludeCache* m_includeCache = nullptr;
 	};
 
-	struct ShaderInput
-	{
-		D3D_SHADER_INPUT_TYPE Type; // Type of resource (e.g. texture, cbuffer, etc.)
-		uint32_t BindPoint; // Starting bind point
-		uint32_t BindCount; // Number of contiguous bind points (for arrays)
-		uint32_t Space; // Register space
-		D3D12_SHADER_VISIBILITY Visibility;
-	};
-
-	typedef uint32_t ShaderTypeFlags;
-	typedef std::map<std::string, ShaderInput> ShaderInputMap;
-
 	ShaderTableType ShaderKindToShaderTableType(D3D12_SHADER_VERSION_TYPE kind);
 
 	class ShaderCompiler
@@ -79,12 +50,20 @@ namespace JoyEngine
 			std::map<D3D12_SHADER_VERSION_TYPE, std::wstring>& typeFunctionNameMap
 		);
 
+	private:
+		static void InitCompiler();
+		static uint64_t GetCompilerVersion();
+
+	public:
+		// dxc objects are not thread safe, every compiling thread has its own set
+		inline static thread_local ComPtr<IDxcUtils> s_dxcUtils;
+		inline static thread_local ComPtr<IDxcCompiler> s_dxcCompiler;
+		inline static thread_local ComPtr<IDxcContainerReflection> s_dxcReflection;
+		inline static thread_local ComPtr<IDxcValidator> s_validator;
+		inline static thread_local std::unique_ptr<ShaderSystemIncludeHandler> m_includeHandler;
 
-		inline static ComPtr<IDxcUtils> s_dxcUtils;
-		inline static ComPtr<IDxcCompiler> s_dxcCompiler;
-		inline static ComPtr<IDxcContainerReflection> s_dxcReflection;
-		inline static ComPtr<IDxcValidator> s_validator;
-		inline static std::unique_ptr<ShaderSystemIncludeHandler> m_includeHandler;
+		inline static std::unique_ptr<ShaderIncludeCache> s_includeCache;
+		inline static std::unique_ptr<ShaderCache> s_shaderCache;
 	};
 }
 #endif // SHADER_COMPILER_H
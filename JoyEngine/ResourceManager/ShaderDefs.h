@@ -0,0 +1,44 @@
+#ifndef SHADER_DEFS_H
+#define SHADER_DEFS_H
+
+#include <d3d12.h>
+#include <d3dcommon.h>
+#include <map>
+#include <string>
+
+namespace JoyEngine
+{
+	enum ShaderType
+	{
+		JoyShaderTypeVertex = 1 << 0,
+		JoyShaderTypeHull = 1 << 1,
+		JoyShaderTypeDomain = 1 << 2,
+		JoyShaderTypeGeometry = 1 << 3,
+		JoyShaderTypePixel = 1 << 4,
+		JoyShaderTypeAmplification = 1 << 5,
+		JoyShaderTypeMesh = 1 << 6,
+		JoyShaderTypeCompute = 1 << 7,
+		JoyShaderTypeRaytracing = 1 << 8
+	};
+
+	enum ShaderTableType
+	{
+		ShaderTableRaygen = 0,
+		ShaderTableMiss,
+		ShaderTableHitGroup,
+		ShaderTableCallable,
+	};
+
+	struct ShaderInput
+	{
+		D3D_SHADER_INPUT_TYPE Type; // Type of resource (e.g. texture, cbuffer, etc.)
+		uint32_t BindPoint; // Starting bind point
+		uint32_t BindCount; // Number of contiguous bind points (for arrays)
+		uint32_t Space; // Register space
+		D3D12_SHADER_VISIBILITY Visibility;
+	};
+
+	typedef uint32_t ShaderTypeFlags;
+	typedef std::map<std::string, ShaderInput> ShaderInputMap;
+}
+#endif // SHADER_DEFS_H
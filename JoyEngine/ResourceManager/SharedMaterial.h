@@ -1,6 +1,8 @@
 #ifndef SHARED_MATERIAL_H
 #define SHARED_MATERIAL_H
 
+#include <set>
+
 #include "Common/Resource.h"
 #include "Texture.h"
 #include "Pipelines/GraphicsPipeline.h"
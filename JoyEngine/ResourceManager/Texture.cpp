@@ -243,6 +243,7 @@ namespace JoyEngine
 			m_memoryPropertiesFlags.Type,
 			&textureDesc,
 			m_usageFlags,
+			m_memoryAllocation,
 			isDepthTarget || allowRenderTarget ? &optimizedClearValue : nullptr);
 	}
 
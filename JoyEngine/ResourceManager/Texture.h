@@ -12,6 +12,7 @@ using Microsoft::WRL::ComPtr;
 
 #include "Common/Resource.h"
 #include "ResourceManager/ResourceView.h"
+#include "Utils/MemoryTracker.h"
 
 
 namespace JoyEngine
@@ -54,6 +55,7 @@ namespace JoyEngine
 		CD3DX12_HEAP_PROPERTIES m_memoryPropertiesFlags;
 
 		ComPtr<ID3D12Resource> m_texture;
+		MemoryAllocation m_memoryAllocation;
 	};
 
 	class AbstractSingleTexture : public AbstractTextureResource
@@ -214,6 +214,19 @@ namespace JoyEngine
 			WorldManager::Get()->GetTransformProvider().Allocate(),
 			WorldManager::Get()->GetTransformProvider())
 	{
+		if (json.HasMember("bvh_builder"))
+		{
+			const std::string bvhBuilder = json["bvh_builder"].GetString();
+			if (bvhBuilder == "sah")
+			{
+				m_bvhBuilderType = BVHBuilderType::SAH;
+			}
+			else
+			{
+				ASSERT(bvhBuilder == "lbvh");
+			}
+		}
+
 		rapidjson::Value& val = json["objects"];
 		for (auto& obj : val.GetArray())
 		{
@@ -7,6 +7,13 @@
 
 namespace JoyEngine
 {
+	// How software raytracing BVH of the scene static geometry is built
+	enum class BVHBuilderType : uint8_t
+	{
+		LBVH, // gpu morton codes based builder, fast to build
+		SAH, // cpu binned SAH builder, slower to build, faster to trace
+	};
+
 	class Scene : public GameObject
 	{
 	public :
@@ -14,6 +21,11 @@ namespace JoyEngine
 
 		explicit Scene(rapidjson::Value& json);
 		void Update();
+
+		[[nodiscard]] BVHBuilderType GetBVHBuilderType() const noexcept { return m_bvhBuilderType; }
+
+	private:
+		BVHBuilderType m_bvhBuilderType = BVHBuilderType::LBVH;
 	};
 }
 
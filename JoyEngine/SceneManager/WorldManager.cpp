@@ -3,8 +3,12 @@
 #include <rapidjson/document.h>
 
 #include "DataManager/DataManager.h"
+#include "GraphicsManager/GraphicsManager.h"
 #include "RenderManager/BasicRenderer/BasicRenderer.h"
+#include "RenderManager/NullRenderer/NullRenderer.h"
 #include "RenderManager/RaytracedDDGIRenderer/RaytracedDDGIRenderer.h"
+#include "Utils/MemoryTracker.h"
+#include "Utils/Profiler.h"
 #include "Utils/TimeCounter.h"
 
 
@@ -12,7 +16,15 @@ namespace JoyEngine
 {
 	WorldManager::WorldManager(HWND gameWindowHandle)
 	{
-		m_renderManager = std::make_unique<BasicRenderer>(gameWindowHandle);
+		MEMORY_TAG_SCOPE("Renderer")
+		if (gameWindowHandle == nullptr)
+		{
+			m_renderManager = std::make_unique<NullRenderer>();
+		}
+		else
+		{
+			m_renderManager = std::make_unique<BasicRenderer>(gameWindowHandle);
+		}
 		m_transformProvider = std::make_unique<TransformProvider>(m_renderManager->GetFrameCount());
 	}
 
@@ -20,13 +32,16 @@ namespace JoyEngine
 	{
 		TIME_PERF("WorldManager init");
 		rapidjson::Document json = DataManager::Get()->GetSerializedData(
-			"scenes/test_scene.scene",
+			m_scenePath,
 			AssetType::World
 		);
 		m_skybox = std::make_unique<Skybox>(json["skybox"]["texture"].GetString());
 
 		// creating render resources
-		m_renderManager->Init(m_skybox.get());
+		{
+			MEMORY_TAG_SCOPE("Renderer")
+			m_renderManager->Init(m_skybox.get());
+		}
 
 		m_scene = m_sceneTree.Create<Scene>(json["scene"]);
 		m_transformProvider->Init();
@@ -40,12 +55,22 @@ namespace JoyEngine
 
 	void WorldManager::Update()
 	{
-		m_renderManager->PreUpdate();
-
-		m_scene->Update();
-		m_transformProvider->Update();
-
-		m_renderManager->Update();
+		{
+			PROFILE_ZONE("Render PreUpdate")
+			m_renderManager->PreUpdate();
+		}
+		{
+			PROFILE_ZONE("Scene Update")
+			m_scene->Update();
+		}
+		{
+			PROFILE_ZONE("Transforms Update")
+			m_transformProvider->Update();
+		}
+		{
+			PROFILE_ZONE("Render Update")
+			m_renderManager->Update();
+		}
 	}
 
 
@@ -54,6 +79,8 @@ namespace JoyEngine
 		m_renderManager->Stop();
 
 		m_sceneTree.Clear();
+		// GPU is idle after the renderer stop. Shared materials unregister from the renderer, so it has to be alive
+		GraphicsManager::Get()->GetReleaseQueue().CollectAll();
 	}
 
 	WorldManager::~WorldManager()
@@ -17,6 +17,7 @@ namespace JoyEngine
 	public:
 		WorldManager() = delete;
 
+		// Without window the scene is run by NullRenderer, the engine has no device then
 		explicit WorldManager(HWND gameWindowHandle);
 
 		void Init();
@@ -31,6 +32,9 @@ namespace JoyEngine
 
 		[[nodiscard]] TransformProvider& GetTransformProvider() const noexcept { return *m_transformProvider; }
 		[[nodiscard]] IRenderer& GetRenderer() const noexcept { return *m_renderManager; }
+		[[nodiscard]] Scene* GetScene() const noexcept { return m_scene; }
+		// Relative to the data folder, data baked for the scene is stored next to it
+		[[nodiscard]] const std::string& GetScenePath() const noexcept { return m_scenePath; }
 
 		void Stop();
 
@@ -41,6 +45,7 @@ namespace JoyEngine
 	private:
 		TreeStorage<GameObject, 512> m_sceneTree;
 		Scene* m_scene = nullptr;
+		std::string m_scenePath = "scenes/test_scene.scene";
 
 		std::unique_ptr<TransformProvider> m_transformProvider;
 		std::unique_ptr<Skybox> m_skybox;
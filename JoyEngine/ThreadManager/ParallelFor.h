@@ -0,0 +1,58 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+#include "WorkerPool.h"
+
+namespace JoyEngine
+{
+	inline uint32_t GetWorkerThreadsCount()
+	{
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Runs func(index) for every index in [0, count) on the calling thread and the workers of WorkerPool.
+	// Indices are taken one by one, so it suits both heavy uneven tasks (shader compilation)
+	// and big loops when called with batched indices.
+	template <typename Func>
+	void ParallelFor(uint32_t count, Func&& func, uint32_t threadsCount = 0)
+	{
+		if (count == 0) return;
+
+		threadsCount = std::min(threadsCount == 0 ? GetWorkerThreadsCount() : threadsCount, count);
+		if (threadsCount == 1)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				func(i);
+			}
+			return;
+		}
+
+		WorkerPool::Get().Run(count, threadsCount - 1, [&func](uint32_t i) { func(i); });
+	}
+
+	// Splits [0, count) into contiguous ranges, func(begin, end, threadIndex) is called once per range.
+	template <typename Func>
+	void ParallelForRange(uint32_t count, Func&& func, uint32_t threadsCount = 0)
+	{
+		if (count == 0) return;
+
+		threadsCount = std::min(threadsCount == 0 ? GetWorkerThreadsCount() : threadsCount, count);
+		const uint32_t rangeSize = (count + threadsCount - 1) / threadsCount;
+
+		ParallelFor(threadsCount, [&](uint32_t threadIndex)
+		{
+			const uint32_t begin = threadIndex * rangeSize;
+			const uint32_t end = std::min(begin + rangeSize, count);
+			if (begin < end)
+			{
+				func(begin, end, threadIndex);
+			}
+		}, threadsCount);
+	}
+}
+#endif // PARALLEL_FOR_H
@@ -4,6 +4,10 @@ namespace JoyEngine
 {
 	void ThreadManager::Stop()
 	{
-		m_worker.join();
+		// there is no worker when frames are run on the calling thread
+		if (m_worker.joinable())
+		{
+			m_worker.join();
+		}
 	}
 }
@@ -0,0 +1,126 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+#include "Benchmarks/TestSuite.h"
+
+namespace JoyEngine
+{
+	WorkerPool::WorkerPool(uint32_t threadsCount)
+	{
+		m_threads.reserve(threadsCount);
+		for (uint32_t i = 0; i < threadsCount; i++)
+		{
+			m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_isRunning = false;
+		}
+		m_jobCondition.notify_all();
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	WorkerPool& WorkerPool::Get()
+	{
+		static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+		return pool;
+	}
+
+	void WorkerPool::Run(uint32_t count, uint32_t workersCount, const std::function<void(uint32_t)>& task)
+	{
+		const uint32_t workerSlots = std::min(workersCount, GetThreadsCount());
+		Job job{.task = task, .count = count, .freeWorkerSlots = workerSlots};
+
+		if (workerSlots > 0)
+		{
+			{
+				std::lock_guard lock(m_mutex);
+				m_jobs.push_back(&job);
+			}
+			if (workerSlots == 1)
+			{
+				m_jobCondition.notify_one();
+			}
+			else
+			{
+				m_jobCondition.notify_all();
+			}
+		}
+
+		Execute(job);
+
+		// Indices are all taken, workers that joined finish theirs and the job is not given to others
+		std::unique_lock lock(m_mutex);
+		if (const auto it = std::ranges::find(m_jobs, &job); it != m_jobs.end())
+		{
+			m_jobs.erase(it);
+		}
+		m_doneCondition.wait(lock, [&job]() { return job.activeWorkersCount == 0; });
+	}
+
+	void WorkerPool::Execute(Job& job)
+	{
+		for (uint32_t i = job.nextIndex++; i < job.count; i = job.nextIndex++)
+		{
+			job.task(i);
+		}
+	}
+
+	void WorkerPool::WorkerLoop()
+	{
+		std::unique_lock lock(m_mutex);
+		while (true)
+		{
+			m_jobCondition.wait(lock, [this]() { return !m_isRunning || !m_jobs.empty(); });
+			if (m_jobs.empty()) return;
+
+			Job* job = m_jobs.front();
+			job->activeWorkersCount++;
+			if (--job->freeWorkerSlots == 0)
+			{
+				m_jobs.pop_front();
+			}
+
+			lock.unlock();
+			Execute(*job);
+			lock.lock();
+
+			if (--job->activeWorkersCount == 0)
+			{
+				m_doneCondition.notify_all();
+			}
+		}
+	}
+
+	bool WorkerPool::Test()
+	{
+		bool isPassed = true;
+
+		WorkerPool pool(3);
+		constexpr uint32_t count = 1000;
+		for (const uint32_t workersCount : {0u, 1u, 3u, 8u})
+		{
+			std::vector<std::atomic<uint32_t>> calls(count);
+			pool.Run(count, workersCount, [&calls](uint32_t i) { calls[i]++; });
+			isPassed &= TEST_CHECK(std::ranges::all_of(calls, [](const auto& c) { return c == 1; }), "index is not run exactly once");
+		}
+
+		constexpr uint32_t outerCount = 16;
+		std::vector<std::atomic<uint32_t>> nestedCalls(outerCount * count);
+		pool.Run(outerCount, 3, [&](uint32_t outer)
+		{
+			pool.Run(count, 3, [&](uint32_t inner) { nestedCalls[outer * count + inner]++; });
+		});
+		isPassed &= TEST_CHECK(std::ranges::all_of(nestedCalls, [](const auto& c) { return c == 1; }), "nested index is not run exactly once");
+
+		return isPassed;
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace JoyEngine
+{
+	// Threads that live until the process exits and run indices of ParallelFor loops.
+	// The calling thread works on its loop too, so loops started from inside a loop never wait for a free worker
+	class WorkerPool
+	{
+	public:
+		explicit WorkerPool(uint32_t threadsCount);
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		// Created on the first use with a worker per hardware thread except the calling one
+		static WorkerPool& Get();
+
+		[[nodiscard]] uint32_t GetThreadsCount() const noexcept { return static_cast<uint32_t>(m_threads.size()); }
+
+		// Runs task(index) for every index in [0, count) on the calling thread and at most workersCount workers,
+		// returns when all of them are done
+		void Run(uint32_t count, uint32_t workersCount, const std::function<void(uint32_t)>& task);
+
+		// Every index runs once, also in loops started from inside a loop
+		[[nodiscard]] static bool Test();
+
+	private:
+		struct Job
+		{
+			const std::function<void(uint32_t)>& task;
+			const uint32_t count;
+			std::atomic<uint32_t> nextIndex = 0;
+			uint32_t freeWorkerSlots; // guarded by m_mutex, like the ones below
+			uint32_t activeWorkersCount = 0;
+		};
+
+		static void Execute(Job& job);
+		void WorkerLoop();
+
+		std::vector<std::thread> m_threads;
+		std::deque<Job*> m_jobs; // with free worker slots
+		std::mutex m_mutex;
+		std::condition_variable m_jobCondition;
+		std::condition_variable m_doneCondition;
+		bool m_isRunning = true;
+	};
+}
+#endif // WORKER_POOL_H
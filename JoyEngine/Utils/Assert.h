@@ -8,22 +8,27 @@
 #include <intrin.h>
 #include <intsafe.h>
 #define DEBUG_BREAK __debugbreak()
+#elif defined(__GNUC__) || defined(__clang__)
+#define DEBUG_BREAK __builtin_trap()
 #else
 #error Unsupported compiler
 #endif
 
+// The log is flushed before the break, so the message is in the sinks even if the program doesn't continue
 #define BREAK(expr) \
-	Logger::LogFormat("Error: %s %s:%d\n", #expr, __FILE__, __LINE__); \
+	Logger::LogFormat(LogLevel::Error, "Error: %s %s:%d\n", #expr, __FILE__, __LINE__); \
+	Logger::Flush(); \
 	DEBUG_BREAK;
 #define ASSERT(expr) if (expr) {} else { BREAK(expr) }
 #define ASSERT_DESC(expr, message) \
 if (expr) {} else {\
-	Logger::LogFormat("Error: %s %s %s:%d\n", message, #expr, __FILE__, __LINE__);\
+	Logger::LogFormat(LogLevel::Error, "Error: %s %s %s:%d\n", message, #expr, __FILE__, __LINE__);\
+	Logger::Flush();\
 	DEBUG_BREAK;}
 #define ASSERT_SUCC(expr) {\
 HRESULT expressionResult = expr; \
 if (FAILED(expressionResult)) {\
-	Logger::LogFormat("HRESULT: %X\n", expressionResult);\
+	Logger::LogFormat(LogLevel::Error, "HRESULT: %X\n", expressionResult);\
 	BREAK(expr);\
 }}
 
@@ -56,12 +56,12 @@ namespace JoyEngine
 	void GraphicsUtils::AttachView(
 		ID3D12GraphicsCommandList* commandList,
 		const GraphicsPipeline* pipeline,
-		const char* paramName,
+		ShaderBindingName paramName,
 		const ResourceView* view
 	)
 	{
-		const uint32_t rootParamIndex = pipeline->GetBindingIndexByHash(StrHash32(paramName));
-		if (rootParamIndex == -1) return;
+		const uint32_t rootParamIndex = pipeline->GetBindingIndexByHash(paramName.hash);
+		if (rootParamIndex == ShaderBindingTable::InvalidIndex) return;
 
 		AttachView(commandList, pipeline, rootParamIndex, view);
 	}
@@ -74,21 +74,21 @@ namespace JoyEngine
 	void GraphicsUtils::AttachView(
 		ID3D12GraphicsCommandList* commandList,
 		const ComputePipeline* pipeline,
-		const char* paramName,
+		ShaderBindingName paramName,
 		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle)
 	{
-		commandList->SetComputeRootDescriptorTable(pipeline->GetBindingIndexByHash(StrHash32(paramName)), gpuHandle);
+		commandList->SetComputeRootDescriptorTable(pipeline->GetBindingIndexByHash(paramName.hash), gpuHandle);
 	}
 
 
 	void GraphicsUtils::AttachView(
 		ID3D12GraphicsCommandList* commandList,
 		const ComputePipeline* pipeline,
-		const char* paramName,
+		ShaderBindingName paramName,
 		const ResourceView* view)
 	{
-		const uint32_t rootParamIndex = pipeline->GetBindingIndexByHash(StrHash32(paramName));
-		if (rootParamIndex == -1) return;
+		const uint32_t rootParamIndex = pipeline->GetBindingIndexByHash(paramName.hash);
+		if (rootParamIndex == ShaderBindingTable::InvalidIndex) return;
 
 		AttachView(commandList, pipeline, rootParamIndex, view);
 	}
@@ -98,26 +98,26 @@ namespace JoyEngine
 		commandList->SetComputeRootDescriptorTable(rootParamIndex, view->GetGPUHandle());
 	}
 
-	void GraphicsUtils::AttachView(ID3D12GraphicsCommandList* commandList, const RaytracingPipeline* pipeline, const char* paramName, const ResourceView* view)
+	void GraphicsUtils::AttachView(ID3D12GraphicsCommandList* commandList, const RaytracingPipeline* pipeline, ShaderBindingName paramName, const ResourceView* view)
 	{
-		const uint32_t rootParamIndex = pipeline->GetGlobalInputContainer()->GetBindingIndexByHash(StrHash32(paramName));
-		if (rootParamIndex == -1) return;
+		const uint32_t rootParamIndex = pipeline->GetGlobalInputContainer()->GetBindingIndexByHash(paramName.hash);
+		if (rootParamIndex == ShaderBindingTable::InvalidIndex) return;
 
 		commandList->SetComputeRootDescriptorTable(rootParamIndex, view->GetGPUHandle());
 	}
 
-	void GraphicsUtils::AttachView(ID3D12GraphicsCommandList* commandList, const RaytracingPipeline* pipeline, const char* paramName, D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle)
+	void GraphicsUtils::AttachView(ID3D12GraphicsCommandList* commandList, const RaytracingPipeline* pipeline, ShaderBindingName paramName, D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle)
 	{
-		const uint32_t rootParamIndex = pipeline->GetGlobalInputContainer()->GetBindingIndexByHash(StrHash32(paramName));
-		if (rootParamIndex == -1) return;
+		const uint32_t rootParamIndex = pipeline->GetGlobalInputContainer()->GetBindingIndexByHash(paramName.hash);
+		if (rootParamIndex == ShaderBindingTable::InvalidIndex) return;
 
 		commandList->SetComputeRootDescriptorTable(rootParamIndex, gpuHandle);
 	}
 
-	void GraphicsUtils::AttachView(const RaytracingPipeline* pipeline, ShaderTableType shaderTableType, const char* paramName, const ResourceView* view)
+	void GraphicsUtils::AttachView(const RaytracingPipeline* pipeline, ShaderTableType shaderTableType, ShaderBindingName paramName, const ResourceView* view)
 	{
 		pipeline->GetShaderTableByType(shaderTableType)->SetRootParam(
-			pipeline->GetLocalInputContainer(shaderTableType)->GetBindingIndexByName(paramName),
+			pipeline->GetLocalInputContainer(shaderTableType)->GetBindingIndexByHash(paramName.hash),
 			view->GetGPUHandle()
 		);
 	}
@@ -153,10 +153,10 @@ namespace JoyEngine
 		const ViewProjectionMatrixData* viewProjectionMatrix
 	)
 	{
-		for (const auto& pair : pipeline->GetEngineBindings())
+		for (const EngineBinding& binding : pipeline->GetEngineBindings())
 		{
-			const auto type = pair.second;
-			const auto rootIndex = pair.first;
+			const auto type = binding.type;
+			const auto rootIndex = binding.rootIndex;
 
 			switch (type)
 			{
@@ -209,10 +209,10 @@ namespace JoyEngine
 		const uint32_t* modelIndex,
 		const ViewProjectionMatrixData* viewProjectionMatrix)
 	{
-		for (const auto& pair : pipeline->GetEngineBindings())
+		for (const EngineBinding& binding : pipeline->GetEngineBindings())
 		{
-			const auto type = pair.second;
-			const auto rootIndex = pair.first;
+			const auto type = binding.type;
+			const auto rootIndex = binding.rootIndex;
 
 			switch (type)
 			{
@@ -16,16 +16,16 @@ namespace JoyEngine
 	class GraphicsUtils
 	{
 	public:
-		static void AttachView(ID3D12GraphicsCommandList* commandList, const GraphicsPipeline* pipeline, const char* paramName, const ResourceView* view);
+		static void AttachView(ID3D12GraphicsCommandList* commandList, const GraphicsPipeline* pipeline, ShaderBindingName paramName, const ResourceView* view);
 		static void AttachView(ID3D12GraphicsCommandList* commandList, const GraphicsPipeline* pipeline, uint32_t rootParamIndex, const ResourceView* view);
 
-		static void AttachView(ID3D12GraphicsCommandList* commandList, const ComputePipeline* pipeline, const char* paramName, D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle);
-		static void AttachView(ID3D12GraphicsCommandList* commandList, const ComputePipeline* pipeline, const char* paramName, const ResourceView* view);
+		static void AttachView(ID3D12GraphicsCommandList* commandList, const ComputePipeline* pipeline, ShaderBindingName paramName, D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle);
+		static void AttachView(ID3D12GraphicsCommandList* commandList, const ComputePipeline* pipeline, ShaderBindingName paramName, const ResourceView* view);
 		static void AttachView(ID3D12GraphicsCommandList* commandList, const ComputePipeline* pipeline, uint32_t rootParamIndex, const ResourceView* view);
 
-		static void AttachView(ID3D12GraphicsCommandList* commandList, const RaytracingPipeline* pipeline, const char* paramName, const ResourceView* view);
-		static void AttachView(ID3D12GraphicsCommandList* commandList, const RaytracingPipeline* pipeline, const char* paramName, D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle);
-		static void AttachView(const RaytracingPipeline* pipeline, ShaderTableType shaderTableType, const char* paramName, const ResourceView* view);
+		static void AttachView(ID3D12GraphicsCommandList* commandList, const RaytracingPipeline* pipeline, ShaderBindingName paramName, const ResourceView* view);
+		static void AttachView(ID3D12GraphicsCommandList* commandList, const RaytracingPipeline* pipeline, ShaderBindingName paramName, D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle);
+		static void AttachView(const RaytracingPipeline* pipeline, ShaderTableType shaderTableType, ShaderBindingName paramName, const ResourceView* view);
 
 		static void Barrier(ID3D12GraphicsCommandList* commandList, ID3D12Resource* pResource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter);
 		static void UAVBarrier(ID3D12GraphicsCommandList* commandList, ID3D12Resource* pResource);
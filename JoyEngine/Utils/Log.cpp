@@ -1,36 +1,134 @@
 #include "Log.h"
 
+#include <cstdarg>
 #include <cstdio>
 
+#include "LogQueue.h"
+
+#ifdef _WIN32
 #include "Windows.h"
+#endif
+
+namespace
+{
+	LogQueue* CreateDefaultQueue()
+	{
+		LogQueue* queue = new LogQueue();
+		queue->AddSink(std::make_unique<DebuggerLogSink>());
+		queue->AddSink(std::make_unique<StdoutLogSink>());
+		return queue;
+	}
+
+	// Never deleted, so threads can log from static destructors after the log thread is stopped
+	LogQueue& GetQueue()
+	{
+		static LogQueue* queue = CreateDefaultQueue();
+		return *queue;
+	}
+
+	// Writes what is left in the rings when the program exits
+	struct LogQueueShutdown
+	{
+		~LogQueueShutdown()
+		{
+			GetQueue().Stop();
+		}
+	} g_logQueueShutdown;
+}
+
+void DebuggerLogSink::Write(LogLevel level, const std::string& text)
+{
+#ifdef _WIN32
+	OutputDebugStringA(text.c_str());
+#endif
+}
+
+void StdoutLogSink::Write(LogLevel level, const std::string& text)
+{
+	fwrite(text.data(), 1, text.size(), level >= LogLevel::Warning ? stderr : stdout);
+}
+
+void StdoutLogSink::Flush()
+{
+	fflush(stdout);
+}
+
+FileLogSink::FileLogSink(const char* path) :
+	m_file(path, std::ios::trunc | std::ios::binary)
+{
+	if (!m_file.is_open())
+	{
+		Logger::LogFormat(LogLevel::Warning, "Cannot open log file %s\n", path);
+	}
+}
 
-#define MAX_LOG_SIZE 2048
+void FileLogSink::Write(LogLevel level, const std::string& text)
+{
+	if (!m_file.is_open()) return;
+	m_file.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
 
-char g_logData[MAX_LOG_SIZE];
+void FileLogSink::Flush()
+{
+	if (!m_file.is_open()) return;
+	m_file.flush();
+}
 
 void Logger::Log(const char* message)
 {
-	_snprintf_s(g_logData, MAX_LOG_SIZE, MAX_LOG_SIZE, "%s", message);
-	OutputDebugStringA(g_logData);
+	GetQueue().Write(LogLevel::Info, message);
+}
+
+void Logger::Log(LogLevel level, const char* message)
+{
+	GetQueue().Write(level, message);
 }
 
 void Logger::LogFormat(const char* format, ...)
 {
 	va_list argptr;
 	va_start(argptr, format);
-	vsnprintf_s(g_logData, MAX_LOG_SIZE, MAX_LOG_SIZE, format, argptr);
+	GetQueue().WriteFormatList(LogLevel::Info, format, argptr);
 	va_end(argptr);
+}
 
-	OutputDebugStringA(g_logData);
+void Logger::LogFormat(LogLevel level, const char* format, ...)
+{
+	va_list argptr;
+	va_start(argptr, format);
+	GetQueue().WriteFormatList(level, format, argptr);
+	va_end(argptr);
 }
 
 void Logger::LogUintArray(uint32_t* array, size_t size, uint32_t count)
 {
-	size_t numbers = size < count ? size : count;
+	// Few big messages instead of a message per number
+	std::string message;
+	const size_t numbers = size < count ? size : count;
 	for (size_t i = 0; i < numbers; i++)
 	{
-		_snprintf_s(g_logData, MAX_LOG_SIZE, MAX_LOG_SIZE, "%d ", array[i]);
-		OutputDebugStringA(g_logData);
+		message += std::to_string(array[i]) + " ";
+		if (message.size() > LogQueue::MaxMessageSize - 16)
+		{
+			GetQueue().Write(LogLevel::Info, message.c_str());
+			message.clear();
+		}
 	}
-	OutputDebugStringA("\n");
+	message += "\n";
+	GetQueue().Write(LogLevel::Info, message.c_str());
+}
+
+void Logger::AddSink(std::unique_ptr<LogSink> sink)
+{
+	GetQueue().AddSink(std::move(sink));
+}
+
+void Logger::SetLevel(LogLevel level)
+{
+	GetQueue().SetLevel(level);
+}
+
+void Logger::Flush()
+{
+	GetQueue().Flush();
 }
@@ -1,12 +1,72 @@
 #ifndef LOG_H
 #define LOG_H
 #include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
 
+enum class LogLevel : uint8_t
+{
+	Debug,
+	Info,
+	Warning,
+	Error
+};
+
+// Receives whole messages from the log thread, so sinks don't need to be thread safe
+class LogSink
+{
+public:
+	virtual ~LogSink() = default;
+	virtual void Write(LogLevel level, const std::string& text) = 0;
+	virtual void Flush() {}
+};
+
+// OutputDebugString, does nothing on other platforms
+class DebuggerLogSink final : public LogSink
+{
+public:
+	void Write(LogLevel level, const std::string& text) override;
+};
+
+// Warnings and errors go to stderr
+class StdoutLogSink final : public LogSink
+{
+public:
+	void Write(LogLevel level, const std::string& text) override;
+	void Flush() override;
+};
+
+class FileLogSink final : public LogSink
+{
+public:
+	explicit FileLogSink(const char* path);
+
+	[[nodiscard]] bool IsOpen() const noexcept { return m_file.is_open(); }
+
+	void Write(LogLevel level, const std::string& text) override;
+	void Flush() override;
+
+private:
+	std::ofstream m_file;
+};
+
+// Messages are queued by the calling thread and written to sinks by the log thread, see LogQueue.
+// Messages without level are Info
 class Logger
 {
 public:
 	static void Log(const char* message);
+	static void Log(LogLevel level, const char* message);
 	static void LogFormat(const char* format...);
+	static void LogFormat(LogLevel level, const char* format...);
 	static void LogUintArray(uint32_t* array, size_t size, uint32_t count = 1024);
+
+	// Debugger and stdout sinks are added by default
+	static void AddSink(std::unique_ptr<LogSink> sink);
+	static void SetLevel(LogLevel level); // messages below the level are skipped
+
+	// Writes queued messages of all threads to sinks before return
+	static void Flush();
 };
 #endif // LOG_H
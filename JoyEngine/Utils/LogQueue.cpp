@@ -0,0 +1,411 @@
+#include "LogQueue.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "Benchmarks/TestSuite.h"
+
+namespace
+{
+	std::atomic<uint64_t> g_nextQueueId = 0;
+
+	// Alive queues. Spin lock and list are trivially destructible and constant initialized, so queues may be
+	// created and destroyed in static constructors and destructors. Both happen rarely
+	std::atomic_flag g_queuesLock = ATOMIC_FLAG_INIT;
+	LogQueue* g_firstQueue = nullptr;
+
+	struct QueuesLock
+	{
+		QueuesLock()
+		{
+			while (g_queuesLock.test_and_set(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		~QueuesLock()
+		{
+			g_queuesLock.clear(std::memory_order_release);
+		}
+	};
+
+	// Rings of the thread in the last used queues. Trivially destructible, so it works in static destructors too
+	struct ThreadRingCache
+	{
+		uint64_t queueId;
+		void* ring;
+	};
+
+	constexpr uint32_t ThreadRingCacheSize = 4;
+	thread_local ThreadRingCache t_ringCache[ThreadRingCacheSize];
+	thread_local uint32_t t_ringCacheCount = 0;
+
+	// Gives the rings back to their queues when the thread exits
+	struct ThreadRingReleaser
+	{
+		bool isArmed = false;
+
+		~ThreadRingReleaser()
+		{
+			for (uint32_t i = 0; i < t_ringCacheCount; i++)
+			{
+				LogQueue::ReleaseThreadRing(t_ringCache[i].queueId, t_ringCache[i].ring);
+			}
+			t_ringCacheCount = 0;
+		}
+	};
+
+	thread_local ThreadRingReleaser t_ringReleaser;
+
+	char GetLevelLetter(LogLevel level)
+	{
+		switch (level)
+		{
+		case LogLevel::Debug:
+			return 'D';
+		case LogLevel::Info:
+			return 'I';
+		case LogLevel::Warning:
+			return 'W';
+		case LogLevel::Error:
+			return 'E';
+		default:
+			return '?';
+		}
+	}
+}
+
+LogQueue::LogQueue() :
+	m_id(g_nextQueueId.fetch_add(1, std::memory_order_relaxed) + 1),
+	m_startTime(std::chrono::steady_clock::now())
+{
+	{
+		QueuesLock lock;
+		m_nextQueue = g_firstQueue;
+		g_firstQueue = this;
+	}
+
+	m_logThread = std::thread(&LogQueue::LogThreadLoop, this);
+}
+
+LogQueue::~LogQueue()
+{
+	Stop();
+
+	// Exiting threads don't see the queue after that
+	QueuesLock lock;
+	for (LogQueue** queue = &g_firstQueue; *queue != nullptr; queue = &(*queue)->m_nextQueue)
+	{
+		if (*queue == this)
+		{
+			*queue = m_nextQueue;
+			break;
+		}
+	}
+}
+
+void LogQueue::AddSink(std::unique_ptr<LogSink> sink)
+{
+	std::lock_guard lock(m_drainMutex);
+	m_sinks.push_back(std::move(sink));
+}
+
+void LogQueue::Write(LogLevel level, const char* message)
+{
+	if (level < GetLevel()) return;
+	Push(level, message, std::min<size_t>(strlen(message), MaxMessageSize - 1));
+}
+
+void LogQueue::WriteFormat(LogLevel level, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	WriteFormatList(level, format, args);
+	va_end(args);
+}
+
+void LogQueue::WriteFormatList(LogLevel level, const char* format, va_list args)
+{
+	if (level < GetLevel()) return;
+
+	thread_local char t_message[MaxMessageSize];
+	const int length = vsnprintf(t_message, MaxMessageSize, format, args);
+	if (length < 0) return;
+	Push(level, t_message, std::min<size_t>(length, MaxMessageSize - 1));
+}
+
+LogQueue::Ring* LogQueue::GetThreadRing()
+{
+	for (uint32_t i = 0; i < t_ringCacheCount; i++)
+	{
+		if (t_ringCache[i].queueId == m_id)
+		{
+			return static_cast<Ring*>(t_ringCache[i].ring);
+		}
+	}
+
+	Ring* ring;
+	{
+		std::lock_guard lock(m_ringsMutex);
+		if (!m_freeRings.empty())
+		{
+			ring = m_freeRings.back();
+			m_freeRings.pop_back();
+		}
+		else
+		{
+			ring = m_rings.emplace_back(std::make_unique<Ring>(static_cast<uint32_t>(m_rings.size()))).get();
+		}
+		m_activeRings.push_back(ring);
+	}
+
+	// A thread rarely logs to more than a couple of queues, the oldest one is evicted and gets a new ring when it's used again
+	if (t_ringCacheCount == ThreadRingCacheSize)
+	{
+		ReleaseThreadRing(t_ringCache[ThreadRingCacheSize - 1].queueId, t_ringCache[ThreadRingCacheSize - 1].ring);
+	}
+	else
+	{
+		t_ringCacheCount++;
+	}
+	std::move_backward(t_ringCache, t_ringCache + t_ringCacheCount - 1, t_ringCache + t_ringCacheCount);
+	t_ringCache[0] = {m_id, ring};
+	t_ringReleaser.isArmed = true;
+	return ring;
+}
+
+void LogQueue::ReleaseThreadRing(uint64_t queueId, void* ring)
+{
+	QueuesLock lock;
+	for (LogQueue* queue = g_firstQueue; queue != nullptr; queue = queue->m_nextQueue)
+	{
+		if (queue->m_id == queueId)
+		{
+			// Records written before are seen by the consumer that sees the flag
+			static_cast<Ring*>(ring)->isReleased.store(true, std::memory_order_release);
+			queue->WakeLogThread();
+			return;
+		}
+	}
+}
+
+void LogQueue::Push(LogLevel level, const char* text, size_t length)
+{
+	Ring* ring = GetThreadRing();
+
+	const uint32_t recordsCount = std::max(1u, static_cast<uint32_t>((length + RecordTextSize - 1) / RecordTextSize));
+	const uint32_t writeIndex = ring->writeIndex.load(std::memory_order_relaxed);
+	while (writeIndex - ring->readIndex.load(std::memory_order_acquire) + recordsCount > RingCapacity)
+	{
+		if (!m_isRunning.load(std::memory_order_acquire))
+		{
+			Flush();
+		}
+		else if (level < LogLevel::Warning)
+		{
+			ring->droppedCount.fetch_add(1, std::memory_order_relaxed);
+			WakeLogThread();
+			return;
+		}
+		else
+		{
+			WakeLogThread();
+			std::this_thread::yield();
+		}
+	}
+
+	const int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+	for (uint32_t i = 0; i < recordsCount; i++)
+	{
+		Record& record = ring->records[(writeIndex + i) & (RingCapacity - 1)];
+		const size_t offset = static_cast<size_t>(i) * RecordTextSize;
+		record.time = time;
+		record.level = level;
+		record.continues = i + 1 < recordsCount;
+		record.length = static_cast<uint8_t>(std::min<size_t>(length - offset, RecordTextSize));
+		memcpy(record.text, text + offset, record.length);
+	}
+	ring->writeIndex.store(writeIndex + recordsCount, std::memory_order_release);
+
+	if (!m_isRunning.load(std::memory_order_acquire))
+	{
+		Flush();
+	}
+	else if (level >= LogLevel::Warning || writeIndex + recordsCount - ring->readIndex.load(std::memory_order_relaxed) > RingCapacity / 2)
+	{
+		WakeLogThread();
+	}
+}
+
+void LogQueue::WakeLogThread()
+{
+	// The log thread also wakes up by itself every DrainInterval, so a wake up lost in a race only delays the messages
+	if (!m_isWakeRequested.exchange(true, std::memory_order_acq_rel))
+	{
+		m_wakeCondition.notify_one();
+	}
+}
+
+void LogQueue::LogThreadLoop()
+{
+	std::unique_lock lock(m_wakeMutex);
+	while (m_isRunning.load(std::memory_order_acquire))
+	{
+		m_wakeCondition.wait_for(lock, DrainInterval, [this]()
+		{
+			return m_isWakeRequested.load(std::memory_order_acquire) || !m_isRunning.load(std::memory_order_acquire);
+		});
+		m_isWakeRequested.store(false, std::memory_order_release);
+
+		lock.unlock();
+		Flush();
+		lock.lock();
+	}
+}
+
+void LogQueue::Flush()
+{
+	std::lock_guard drainLock(m_drainMutex);
+
+	std::vector<Ring*> rings;
+	{
+		std::lock_guard ringsLock(m_ringsMutex);
+		rings = m_activeRings;
+	}
+
+	bool hasWritten = false;
+	std::vector<Ring*> drainedRings;
+	for (Ring* ring : rings)
+	{
+		const bool isReleased = ring->isReleased.load(std::memory_order_acquire);
+		uint32_t readIndex = ring->readIndex.load(std::memory_order_relaxed);
+		const uint32_t writeIndex = ring->writeIndex.load(std::memory_order_acquire);
+		while (readIndex != writeIndex)
+		{
+			const Record& first = ring->records[readIndex & (RingCapacity - 1)];
+			m_message.clear();
+			if (ring->isAtLineStart)
+			{
+				char prefix[48];
+				const int prefixLength = snprintf(prefix, sizeof(prefix), "[%10.3f][%c][%u] ",
+				                                  static_cast<double>(first.time) / 1e9,
+				                                  GetLevelLetter(first.level),
+				                                  ring->threadIndex);
+				m_message.append(prefix, std::max(prefixLength, 0));
+			}
+
+			const LogLevel level = first.level;
+			bool continues;
+			do
+			{
+				const Record& record = ring->records[readIndex & (RingCapacity - 1)];
+				m_message.append(record.text, record.length);
+				continues = record.continues;
+				readIndex++;
+			}
+			while (continues);
+			ring->readIndex.store(readIndex, std::memory_order_release);
+
+			ring->isAtLineStart = m_message.empty() || m_message.back() == '\n';
+			for (const auto& sink : m_sinks)
+			{
+				sink->Write(level, m_message);
+			}
+			hasWritten = true;
+		}
+
+		if (isReleased)
+		{
+			drainedRings.push_back(ring);
+		}
+	}
+
+	if (!drainedRings.empty())
+	{
+		std::lock_guard ringsLock(m_ringsMutex);
+		for (Ring* ring : drainedRings)
+		{
+			ring->isReleased.store(false, std::memory_order_relaxed);
+			ring->isAtLineStart = true;
+			m_activeRings.erase(std::find(m_activeRings.begin(), m_activeRings.end(), ring));
+			m_freeRings.push_back(ring);
+		}
+	}
+
+	const uint64_t droppedCount = GetDroppedCount();
+	if (droppedCount != m_reportedDroppedCount)
+	{
+		m_message = "Log: " + std::to_string(droppedCount - m_reportedDroppedCount) + " messages are dropped, log rings are full\n";
+		for (const auto& sink : m_sinks)
+		{
+			sink->Write(LogLevel::Warning, m_message);
+		}
+		m_reportedDroppedCount = droppedCount;
+		hasWritten = true;
+	}
+
+	if (hasWritten)
+	{
+		for (const auto& sink : m_sinks)
+		{
+			sink->Flush();
+		}
+	}
+}
+
+void LogQueue::Stop()
+{
+	{
+		std::lock_guard lock(m_wakeMutex);
+		m_isRunning.store(false, std::memory_order_release);
+	}
+	m_wakeCondition.notify_one();
+	if (m_logThread.joinable())
+	{
+		m_logThread.join();
+	}
+	Flush();
+}
+
+uint64_t LogQueue::GetDroppedCount() const
+{
+	std::lock_guard lock(m_ringsMutex);
+	uint64_t droppedCount = 0;
+	for (const auto& ring : m_rings)
+	{
+		droppedCount += ring->droppedCount.load(std::memory_order_relaxed);
+	}
+	return droppedCount;
+}
+
+uint32_t LogQueue::GetRingsCount() const
+{
+	std::lock_guard lock(m_ringsMutex);
+	return static_cast<uint32_t>(m_activeRings.size());
+}
+
+bool LogQueue::Test()
+{
+	bool isPassed = true;
+
+	LogQueue queue;
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		std::thread thread([&queue, i]()
+		{
+			queue.WriteFormat(LogLevel::Info, "message %u\n", i);
+		});
+		thread.join();
+		queue.Flush();
+		isPassed &= TEST_CHECK(queue.GetRingsCount() == 0, "ring of the exited thread is not released");
+	}
+	isPassed &= TEST_CHECK(queue.m_rings.size() == 1, "released ring is not reused");
+
+	queue.Write(LogLevel::Info, "message\n");
+	queue.Flush();
+	isPassed &= TEST_CHECK(queue.GetRingsCount() == 1, "ring of the alive thread is released");
+
+	return isPassed;
+}
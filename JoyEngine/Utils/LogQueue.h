@@ -0,0 +1,113 @@
+#ifndef LOG_QUEUE_H
+#define LOG_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Log.h"
+
+// Every thread formats messages into its own ring, the log thread drains the rings to sinks.
+// Debug and Info messages are dropped when the ring of the thread is full, warnings and errors wait for space.
+// Drops are reported to the sinks as a warning. Ring of an exited thread is reused by a new one after it's drained
+class LogQueue
+{
+public:
+	static constexpr uint32_t RingCapacity = 512; // records per thread
+	static constexpr uint32_t RecordTextSize = 112; // longer messages take several records
+	static constexpr uint32_t MaxMessageSize = 2048; // longer formatted messages are cut
+	static constexpr std::chrono::milliseconds DrainInterval{2};
+
+	LogQueue();
+	~LogQueue(); // stops the log thread and writes what is left
+
+	LogQueue(const LogQueue&) = delete;
+	LogQueue& operator=(const LogQueue&) = delete;
+
+	void AddSink(std::unique_ptr<LogSink> sink);
+	void SetLevel(LogLevel level) noexcept { m_level.store(level, std::memory_order_relaxed); }
+	[[nodiscard]] LogLevel GetLevel() const noexcept { return m_level.load(std::memory_order_relaxed); }
+
+	void Write(LogLevel level, const char* message);
+	void WriteFormat(LogLevel level, const char* format...);
+	void WriteFormatList(LogLevel level, const char* format, va_list args);
+
+	// Writes queued messages of all threads to sinks on the calling thread
+	void Flush();
+
+	// Joins the log thread, later messages are written to sinks by the threads that log them
+	void Stop();
+
+	[[nodiscard]] uint64_t GetDroppedCount() const;
+	[[nodiscard]] uint32_t GetRingsCount() const; // rings of threads that are alive or not drained yet
+
+	// Called when the thread stops using the ring, on thread exit or when the ring leaves the thread cache.
+	// Does nothing if the queue is already destroyed
+	static void ReleaseThreadRing(uint64_t queueId, void* ring);
+
+	// Rings of exited threads are drained and reused
+	[[nodiscard]] static bool Test();
+
+private:
+	struct Record
+	{
+		int64_t time; // ns since the queue creation
+		LogLevel level;
+		bool continues; // message continues in the next record
+		uint8_t length;
+		char text[RecordTextSize];
+	};
+
+	// Single producer single consumer, the consumer is whoever holds m_drainMutex
+	struct Ring
+	{
+		explicit Ring(uint32_t threadIndex) :
+			threadIndex(threadIndex),
+			records(std::make_unique<Record[]>(RingCapacity))
+		{
+		}
+
+		const uint32_t threadIndex;
+		std::unique_ptr<Record[]> records;
+		std::atomic<uint32_t> writeIndex = 0;
+		std::atomic<uint32_t> readIndex = 0;
+		std::atomic<uint32_t> droppedCount = 0;
+		std::atomic<bool> isReleased = false; // producer thread is gone, the ring goes to m_freeRings when drained
+		bool isAtLineStart = true; // consumer only, the prefix is written at line starts
+	};
+
+	Ring* GetThreadRing();
+	void Push(LogLevel level, const char* text, size_t length);
+	void WakeLogThread();
+	void LogThreadLoop();
+
+	const uint64_t m_id; // rings of the thread are cached by the queue id
+	const std::chrono::steady_clock::time_point m_startTime;
+	std::atomic<LogLevel> m_level = LogLevel::Debug;
+
+	std::vector<std::unique_ptr<Ring>> m_rings;
+	std::vector<Ring*> m_activeRings; // the ones Flush drains
+	std::vector<Ring*> m_freeRings;
+	mutable std::mutex m_ringsMutex;
+	LogQueue* m_nextQueue = nullptr; // list of alive queues, for the rings released at thread exit
+
+	std::vector<std::unique_ptr<LogSink>> m_sinks;
+	std::string m_message; // consumer only
+	uint64_t m_reportedDroppedCount = 0; // consumer only
+	std::mutex m_drainMutex;
+
+	std::atomic<bool> m_isRunning = true;
+	std::atomic<bool> m_isWakeRequested = false;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	std::thread m_logThread;
+};
+
+#endif // LOG_QUEUE_H
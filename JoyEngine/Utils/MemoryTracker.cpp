@@ -0,0 +1,484 @@
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+#include "imgui.h"
+
+#include "Log.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		template <typename T>
+		void UpdateMax(std::atomic<T>& value, T candidate)
+		{
+			T current = value.load(std::memory_order_relaxed);
+			while (current < candidate && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		std::string FormatBytes(uint64_t bytes)
+		{
+			constexpr const char* units[] = {"B", "KB", "MB", "GB"};
+			double value = static_cast<double>(bytes);
+			uint32_t unit = 0;
+			while (value >= 1024.0 && unit < std::size(units) - 1)
+			{
+				value /= 1024.0;
+				unit++;
+			}
+			char buffer[32];
+			snprintf(buffer, sizeof(buffer), unit == 0 ? "%.0f %s" : "%.2f %s", value, units[unit]);
+			return buffer;
+		}
+
+		std::string FormatBytesChange(int64_t bytes)
+		{
+			return (bytes < 0 ? "-" : "+") + FormatBytes(static_cast<uint64_t>(std::llabs(bytes)));
+		}
+
+		void WriteJsonString(std::ofstream& file, const std::string& str)
+		{
+			file << '"';
+			for (const char c : str)
+			{
+				if (c == '"' || c == '\\') file << '\\';
+				file << c;
+			}
+			file << '"';
+		}
+
+		void WriteJsonTags(std::ofstream& file, const MemorySnapshot& snapshot)
+		{
+			file << '[';
+			for (size_t i = 0; i < snapshot.tags.size(); i++)
+			{
+				const auto& [name, stats] = snapshot.tags[i];
+				file << (i == 0 ? "\n" : ",\n") << R"({"name":)";
+				WriteJsonString(file, name);
+				file << R"(,"liveBytes":)" << stats.liveBytes
+					<< R"(,"peakBytes":)" << stats.peakBytes
+					<< R"(,"largestBytes":)" << stats.largestBytes
+					<< R"(,"liveCount":)" << stats.liveCount
+					<< R"(,"peakCount":)" << stats.peakCount
+					<< R"(,"allocations":)" << stats.allocationsCount << '}';
+			}
+			file << ']';
+		}
+
+		using TagStats = std::pair<std::string, MemoryTagStats>;
+
+		struct DomainStats
+		{
+			const TagStats* domain;
+			std::vector<const TagStats*> owners; // sorted by live bytes
+		};
+
+		// Domains with their "domain/owner" tags, both sorted by live bytes. Tags never allocated are skipped
+		std::vector<DomainStats> GroupByDomain(const MemorySnapshot& snapshot)
+		{
+			std::vector<DomainStats> domains;
+			std::map<std::string, size_t> domainIndices;
+			for (const TagStats& tag : snapshot.tags)
+			{
+				if (tag.second.allocationsCount == 0 || tag.first.find('/') != std::string::npos) continue;
+				domainIndices[tag.first] = domains.size();
+				domains.push_back({&tag, {}});
+			}
+			for (const TagStats& tag : snapshot.tags)
+			{
+				const size_t slash = tag.first.find('/');
+				if (tag.second.allocationsCount == 0 || slash == std::string::npos) continue;
+				const auto it = domainIndices.find(tag.first.substr(0, slash));
+				if (it != domainIndices.end())
+				{
+					domains[it->second].owners.push_back(&tag);
+				}
+			}
+
+			const auto byLiveBytes = [](const TagStats* a, const TagStats* b)
+			{
+				return a->second.liveBytes > b->second.liveBytes;
+			};
+			for (DomainStats& domain : domains)
+			{
+				std::sort(domain.owners.begin(), domain.owners.end(), byLiveBytes);
+			}
+			std::sort(domains.begin(), domains.end(), [&byLiveBytes](const DomainStats& a, const DomainStats& b)
+			{
+				return byLiveBytes(a.domain, b.domain);
+			});
+			return domains;
+		}
+	}
+
+	MemoryAllocation::MemoryAllocation(MemoryTag tag, uint64_t bytes) :
+		m_tag(tag),
+		m_bytes(bytes)
+	{
+		if (m_tag != InvalidMemoryTag && MemoryTracker::Get() != nullptr)
+		{
+			MemoryTracker::Get()->OnAllocate(m_tag, m_bytes);
+		}
+	}
+
+	MemoryAllocation::~MemoryAllocation()
+	{
+		Release();
+	}
+
+	MemoryAllocation::MemoryAllocation(MemoryAllocation&& other) noexcept :
+		m_tag(std::exchange(other.m_tag, InvalidMemoryTag)),
+		m_bytes(std::exchange(other.m_bytes, 0))
+	{
+	}
+
+	MemoryAllocation& MemoryAllocation::operator=(MemoryAllocation&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Release();
+			m_tag = std::exchange(other.m_tag, InvalidMemoryTag);
+			m_bytes = std::exchange(other.m_bytes, 0);
+		}
+		return *this;
+	}
+
+	void MemoryAllocation::Release()
+	{
+		if (m_tag != InvalidMemoryTag && MemoryTracker::Get() != nullptr)
+		{
+			MemoryTracker::Get()->OnFree(m_tag, m_bytes);
+		}
+		m_tag = InvalidMemoryTag;
+		m_bytes = 0;
+	}
+
+	MemoryTracker::MemoryTracker() :
+		m_tags(std::make_unique<TagEntry[]>(MaxTagsCount))
+	{
+		const std::lock_guard lock(m_registrationMutex);
+		RegisterTagLocked("Other");
+	}
+
+	MemoryTracker::~MemoryTracker()
+	{
+		// Allocations that outlive the tracker don't report their frees
+		m_instance = nullptr;
+	}
+
+	MemoryTag MemoryTracker::RegisterTag(const std::string& name)
+	{
+		const std::lock_guard lock(m_registrationMutex);
+		return RegisterTagLocked(name);
+	}
+
+	MemoryTag MemoryTracker::RegisterTagLocked(const std::string& name)
+	{
+		if (const auto it = m_tagsByName.find(name); it != m_tagsByName.end())
+		{
+			return it->second;
+		}
+
+		const size_t slash = name.find('/');
+		const MemoryTag domain = slash != std::string::npos ? RegisterTagLocked(name.substr(0, slash)) : InvalidMemoryTag;
+
+		const MemoryTag tag = m_tagsCount.load(std::memory_order_relaxed);
+		if (tag == MaxTagsCount)
+		{
+			return OtherTag;
+		}
+
+		m_tags[tag].name = name;
+		m_tags[tag].domain = domain;
+		m_tagsByName.emplace(name, tag);
+		m_tagsCount.store(tag + 1, std::memory_order_release);
+		return tag;
+	}
+
+	uint32_t MemoryTracker::RegisterScope(const char* name)
+	{
+		const std::lock_guard lock(m_registrationMutex);
+		const auto [it, isInserted] = m_scopesByName.try_emplace(name, static_cast<uint32_t>(m_scopeNames.size()));
+		if (isInserted)
+		{
+			m_scopeNames.emplace_back(name);
+		}
+		return it->second;
+	}
+
+	MemoryAllocation MemoryTracker::Track(const char* domain, uint64_t bytes)
+	{
+		MemoryTracker* tracker = Get();
+		if (tracker == nullptr)
+		{
+			return {};
+		}
+
+		MemoryTag tag;
+		{
+			const std::lock_guard lock(tracker->m_registrationMutex);
+			const std::string& owner = t_scope < tracker->m_scopeNames.size() ? tracker->m_scopeNames[t_scope] : "Untagged";
+			tag = tracker->RegisterTagLocked(std::string(domain) + "/" + owner);
+		}
+		return {tag, bytes};
+	}
+
+	void MemoryTracker::UpdateTag(TagEntry& entry, int64_t bytes, int32_t count)
+	{
+		const uint64_t liveBytes = entry.liveBytes.fetch_add(static_cast<uint64_t>(bytes), std::memory_order_relaxed) + bytes;
+		const uint32_t liveCount = entry.liveCount.fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed) + count;
+		if (count > 0)
+		{
+			UpdateMax(entry.peakBytes, liveBytes);
+			UpdateMax(entry.peakCount, liveCount);
+			UpdateMax(entry.largestBytes, static_cast<uint64_t>(bytes));
+			entry.allocationsCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	void MemoryTracker::OnAllocate(MemoryTag tag, uint64_t bytes)
+	{
+		if (tag >= m_tagsCount.load(std::memory_order_acquire)) return;
+
+		TagEntry& entry = m_tags[tag];
+		UpdateTag(entry, static_cast<int64_t>(bytes), 1);
+		if (entry.domain != InvalidMemoryTag)
+		{
+			UpdateTag(m_tags[entry.domain], static_cast<int64_t>(bytes), 1);
+		}
+	}
+
+	void MemoryTracker::OnFree(MemoryTag tag, uint64_t bytes)
+	{
+		if (tag >= m_tagsCount.load(std::memory_order_acquire)) return;
+
+		TagEntry& entry = m_tags[tag];
+		UpdateTag(entry, -static_cast<int64_t>(bytes), -1);
+		if (entry.domain != InvalidMemoryTag)
+		{
+			UpdateTag(m_tags[entry.domain], -static_cast<int64_t>(bytes), -1);
+		}
+	}
+
+	MemoryTagStats MemoryTracker::GetStats(MemoryTag tag) const
+	{
+		const TagEntry& entry = m_tags[tag];
+		return {
+			.liveBytes = entry.liveBytes.load(std::memory_order_relaxed),
+			.peakBytes = entry.peakBytes.load(std::memory_order_relaxed),
+			.largestBytes = entry.largestBytes.load(std::memory_order_relaxed),
+			.liveCount = entry.liveCount.load(std::memory_order_relaxed),
+			.peakCount = entry.peakCount.load(std::memory_order_relaxed),
+			.allocationsCount = entry.allocationsCount.load(std::memory_order_relaxed),
+		};
+	}
+
+	MemorySnapshot MemoryTracker::TakeSnapshot() const
+	{
+		MemorySnapshot snapshot;
+		snapshot.frame = m_frame;
+
+		const uint32_t tagsCount = m_tagsCount.load(std::memory_order_acquire);
+		snapshot.tags.reserve(tagsCount);
+		for (MemoryTag tag = 0; tag < tagsCount; tag++)
+		{
+			snapshot.tags.emplace_back(m_tags[tag].name, GetStats(tag));
+		}
+		std::sort(snapshot.tags.begin(), snapshot.tags.end(), [](const TagStats& a, const TagStats& b)
+		{
+			return a.first < b.first;
+		});
+		return snapshot;
+	}
+
+	std::vector<MemorySnapshotDiff> MemoryTracker::Diff(const MemorySnapshot& older, const MemorySnapshot& newer)
+	{
+		std::vector<MemorySnapshotDiff> diffs;
+
+		const auto addDiff = [&diffs](const std::string& name, const MemoryTagStats& olderStats, const MemoryTagStats& newerStats)
+		{
+			const int64_t liveBytes = static_cast<int64_t>(newerStats.liveBytes) - static_cast<int64_t>(olderStats.liveBytes);
+			const int32_t liveCount = static_cast<int32_t>(newerStats.liveCount) - static_cast<int32_t>(olderStats.liveCount);
+			if (liveBytes != 0 || liveCount != 0)
+			{
+				diffs.push_back({name, liveBytes, liveCount});
+			}
+		};
+
+		// Both are sorted by name
+		size_t olderIndex = 0;
+		size_t newerIndex = 0;
+		while (olderIndex < older.tags.size() || newerIndex < newer.tags.size())
+		{
+			if (newerIndex == newer.tags.size() ||
+				(olderIndex < older.tags.size() && older.tags[olderIndex].first < newer.tags[newerIndex].first))
+			{
+				addDiff(older.tags[olderIndex].first, older.tags[olderIndex].second, {});
+				olderIndex++;
+			}
+			else if (olderIndex == older.tags.size() || newer.tags[newerIndex].first < older.tags[olderIndex].first)
+			{
+				addDiff(newer.tags[newerIndex].first, {}, newer.tags[newerIndex].second);
+				newerIndex++;
+			}
+			else
+			{
+				addDiff(newer.tags[newerIndex].first, older.tags[olderIndex].second, newer.tags[newerIndex].second);
+				olderIndex++;
+				newerIndex++;
+			}
+		}
+
+		std::sort(diffs.begin(), diffs.end(), [](const MemorySnapshotDiff& a, const MemorySnapshotDiff& b)
+		{
+			return std::llabs(a.liveBytes) > std::llabs(b.liveBytes);
+		});
+		return diffs;
+	}
+
+	void MemoryTracker::Update()
+	{
+		m_frame++;
+		if (m_frame % SnapshotInterval != 0) return;
+
+		m_snapshots.push_back(TakeSnapshot());
+		if (m_snapshots.size() > SnapshotsCount)
+		{
+			m_snapshots.pop_front();
+		}
+	}
+
+	void MemoryTracker::DrawGui()
+	{
+		const MemorySnapshot snapshot = TakeSnapshot();
+		const std::vector<DomainStats> domains = GroupByDomain(snapshot);
+
+		std::map<std::string, int64_t> changes;
+		if (m_hasGuiSnapshot)
+		{
+			for (const MemorySnapshotDiff& diff : Diff(m_guiSnapshot, snapshot))
+			{
+				changes[diff.name] = diff.liveBytes;
+			}
+		}
+
+		ImGui::Begin("Memory:");
+		if (ImGui::Button("Take snapshot"))
+		{
+			m_guiSnapshot = snapshot;
+			m_hasGuiSnapshot = true;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Save JSON"))
+		{
+			WriteJson("memory.json");
+		}
+		if (m_hasGuiSnapshot)
+		{
+			ImGui::SameLine();
+			ImGui::Text("Changes since frame %llu", static_cast<unsigned long long>(m_guiSnapshot.frame));
+		}
+
+		const auto drawRow = [&changes](const TagStats& tag, const char* label, bool isDomain) -> bool
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			const ImGuiTreeNodeFlags flags = isDomain ? ImGuiTreeNodeFlags_SpanFullWidth : ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+			const bool isOpen = ImGui::TreeNodeEx(tag.first.c_str(), flags, "%s", label);
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", FormatBytes(tag.second.liveBytes).c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", FormatBytes(tag.second.peakBytes).c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", tag.second.liveCount);
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", FormatBytes(tag.second.largestBytes).c_str());
+			ImGui::TableNextColumn();
+			const auto change = changes.find(tag.first);
+			ImGui::Text("%s", change != changes.end() ? FormatBytesChange(change->second).c_str() : "");
+			return isDomain && isOpen;
+		};
+
+		constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+		if (ImGui::BeginTable("Tags", 6, tableFlags))
+		{
+			ImGui::TableSetupScrollFreeze(0, 1);
+			ImGui::TableSetupColumn("Tag", ImGuiTableColumnFlags_NoHide);
+			ImGui::TableSetupColumn("live", ImGuiTableColumnFlags_WidthFixed, 65);
+			ImGui::TableSetupColumn("peak", ImGuiTableColumnFlags_WidthFixed, 65);
+			ImGui::TableSetupColumn("count", ImGuiTableColumnFlags_WidthFixed, 40);
+			ImGui::TableSetupColumn("largest", ImGuiTableColumnFlags_WidthFixed, 65);
+			ImGui::TableSetupColumn("change", ImGuiTableColumnFlags_WidthFixed, 65);
+			ImGui::TableHeadersRow();
+			for (const DomainStats& domain : domains)
+			{
+				if (!drawRow(*domain.domain, domain.domain->first.c_str(), true)) continue;
+
+				const size_t domainLength = domain.domain->first.size() + 1;
+				for (const TagStats* owner : domain.owners)
+				{
+					drawRow(*owner, owner->first.c_str() + domainLength, false);
+				}
+				ImGui::TreePop();
+			}
+			ImGui::EndTable();
+		}
+		ImGui::End();
+	}
+
+	void MemoryTracker::LogStats() const
+	{
+		const MemorySnapshot snapshot = TakeSnapshot();
+		for (const DomainStats& domain : GroupByDomain(snapshot))
+		{
+			const auto logTag = [](const TagStats& tag, const char* indent)
+			{
+				Logger::LogFormat("%s%-48s live %10s (%u), peak %10s (%u), largest %10s\n",
+				                  indent,
+				                  tag.first.c_str(),
+				                  FormatBytes(tag.second.liveBytes).c_str(),
+				                  tag.second.liveCount,
+				                  FormatBytes(tag.second.peakBytes).c_str(),
+				                  tag.second.peakCount,
+				                  FormatBytes(tag.second.largestBytes).c_str());
+			};
+
+			logTag(*domain.domain, "");
+			for (const TagStats* owner : domain.owners)
+			{
+				logTag(*owner, "    ");
+			}
+		}
+	}
+
+	bool MemoryTracker::WriteJson(const std::string& path) const
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file)
+		{
+			Logger::LogFormat(LogLevel::Warning, "Cannot write memory stats to %s\n", path.c_str());
+			return false;
+		}
+
+		file << R"({"frame":)" << m_frame << R"(,"tags":)";
+		WriteJsonTags(file, TakeSnapshot());
+		file << R"(,"snapshots":[)";
+		for (size_t i = 0; i < m_snapshots.size(); i++)
+		{
+			file << (i == 0 ? "\n" : ",\n") << R"({"frame":)" << m_snapshots[i].frame << R"(,"tags":)";
+			WriteJsonTags(file, m_snapshots[i]);
+			file << '}';
+		}
+		file << "]}\n";
+
+		Logger::LogFormat("Memory stats are written to %s\n", path.c_str());
+		return true;
+	}
+}
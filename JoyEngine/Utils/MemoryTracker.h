@@ -0,0 +1,169 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Common/Singleton.h"
+
+#define MEMORY_TRACKER_CONCAT_IMPL(a, b) a##b
+#define MEMORY_TRACKER_CONCAT(a, b) MEMORY_TRACKER_CONCAT_IMPL(a, b)
+
+// Memory tracked on this thread inside the scope is tagged with name, the innermost scope wins
+#define MEMORY_TAG_SCOPE(name) const ::JoyEngine::MemoryTagScope MEMORY_TRACKER_CONCAT(memoryTagScope, __LINE__)(name);
+
+namespace JoyEngine
+{
+	using MemoryTag = uint32_t;
+	inline constexpr MemoryTag InvalidMemoryTag = UINT32_MAX;
+
+	struct MemoryTagStats
+	{
+		uint64_t liveBytes = 0;
+		uint64_t peakBytes = 0; // high-water mark of liveBytes
+		uint64_t largestBytes = 0; // biggest single allocation
+		uint32_t liveCount = 0;
+		uint32_t peakCount = 0;
+		uint32_t allocationsCount = 0; // all the time
+	};
+
+	struct MemorySnapshot
+	{
+		uint64_t frame = 0;
+		std::vector<std::pair<std::string, MemoryTagStats>> tags; // sorted by name
+	};
+
+	struct MemorySnapshotDiff
+	{
+		std::string name;
+		int64_t liveBytes; // newer minus older
+		int32_t liveCount;
+	};
+
+	// Tracked memory of one owner, the free is reported when the allocation is destroyed or reassigned
+	class MemoryAllocation
+	{
+	public:
+		MemoryAllocation() = default;
+		MemoryAllocation(MemoryTag tag, uint64_t bytes);
+		~MemoryAllocation();
+
+		MemoryAllocation(const MemoryAllocation&) = delete;
+		MemoryAllocation& operator=(const MemoryAllocation&) = delete;
+		MemoryAllocation(MemoryAllocation&& other) noexcept;
+		MemoryAllocation& operator=(MemoryAllocation&& other) noexcept;
+
+		[[nodiscard]] MemoryTag GetTag() const noexcept { return m_tag; }
+		[[nodiscard]] uint64_t GetBytes() const noexcept { return m_bytes; }
+
+	private:
+		void Release();
+
+		MemoryTag m_tag = InvalidMemoryTag;
+		uint64_t m_bytes = 0;
+	};
+
+	// Live and peak bytes and counts per tag. Tags are "domain/owner": the domain is the kind of memory (GPU textures, descriptors, CPU...),
+	// the owner is the subsystem or asset from MEMORY_TAG_SCOPE. Tracking is thread safe,
+	// Update, DrawGui and snapshots are called from the update thread
+	class MemoryTracker : public Singleton<MemoryTracker>
+	{
+	public:
+		static constexpr uint32_t MaxTagsCount = 4096;
+		static constexpr uint32_t SnapshotInterval = 600; // frames
+		static constexpr uint32_t SnapshotsCount = 16;
+
+		MemoryTracker();
+		~MemoryTracker();
+
+		// Same name gives the same tag. "domain/owner" tag also counts its memory in "domain" tag.
+		// Tags over MaxTagsCount are tracked as "Other"
+		MemoryTag RegisterTag(const std::string& name);
+
+		// Allocation of "domain/owner" with the owner of the current scope, empty allocation if there is no tracker
+		static MemoryAllocation Track(const char* domain, uint64_t bytes);
+
+		void OnAllocate(MemoryTag tag, uint64_t bytes);
+		void OnFree(MemoryTag tag, uint64_t bytes);
+
+		[[nodiscard]] MemorySnapshot TakeSnapshot() const;
+		// Tags whose live bytes or count are different, sorted by the biggest change of bytes
+		[[nodiscard]] static std::vector<MemorySnapshotDiff> Diff(const MemorySnapshot& older, const MemorySnapshot& newer);
+
+		// Keeps a snapshot every SnapshotInterval frames, the last SnapshotsCount of them
+		void Update();
+
+		void DrawGui();
+		void LogStats() const;
+
+		// Current stats and periodic snapshots
+		bool WriteJson(const std::string& path) const;
+
+	private:
+		friend class MemoryTagScope;
+
+		struct TagEntry
+		{
+			std::string name;
+			MemoryTag domain = InvalidMemoryTag;
+			std::atomic<uint64_t> liveBytes = 0;
+			std::atomic<uint64_t> peakBytes = 0;
+			std::atomic<uint64_t> largestBytes = 0;
+			std::atomic<uint32_t> liveCount = 0;
+			std::atomic<uint32_t> peakCount = 0;
+			std::atomic<uint32_t> allocationsCount = 0;
+		};
+
+		static inline thread_local uint32_t t_scope = UINT32_MAX; // index of scope name
+
+		static constexpr MemoryTag OtherTag = 0;
+
+		MemoryTag RegisterTagLocked(const std::string& name);
+		uint32_t RegisterScope(const char* name);
+		void UpdateTag(TagEntry& entry, int64_t bytes, int32_t count);
+		[[nodiscard]] MemoryTagStats GetStats(MemoryTag tag) const;
+
+		std::unique_ptr<TagEntry[]> m_tags;
+		std::atomic<uint32_t> m_tagsCount = 0; // entries below are initialized
+		std::unordered_map<std::string, MemoryTag> m_tagsByName;
+		std::vector<std::string> m_scopeNames;
+		std::unordered_map<std::string, uint32_t> m_scopesByName;
+		mutable std::mutex m_registrationMutex;
+
+		uint64_t m_frame = 0;
+		std::deque<MemorySnapshot> m_snapshots;
+		MemorySnapshot m_guiSnapshot; // taken with the button, the panel shows changes since it
+		bool m_hasGuiSnapshot = false;
+	};
+
+	class MemoryTagScope
+	{
+	public:
+		explicit MemoryTagScope(const char* name) :
+			m_previousScope(MemoryTracker::t_scope)
+		{
+			if (MemoryTracker::Get() == nullptr) return;
+			MemoryTracker::t_scope = MemoryTracker::Get()->RegisterScope(name);
+		}
+
+		~MemoryTagScope()
+		{
+			MemoryTracker::t_scope = m_previousScope;
+		}
+
+		MemoryTagScope(const MemoryTagScope&) = delete;
+		MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+	private:
+		const uint32_t m_previousScope;
+	};
+}
+
+#endif // MEMORY_TRACKER_H
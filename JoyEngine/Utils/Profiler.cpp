@@ -0,0 +1,431 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "imgui.h"
+
+#include "Log.h"
+#include "Benchmarks/BenchmarkSuite.h"
+
+namespace JoyEngine
+{
+	namespace
+	{
+		void WriteJsonString(std::ofstream& file, const char* str)
+		{
+			file << '"';
+			for (; *str != 0; str++)
+			{
+				if (*str == '"' || *str == '\\') file << '\\';
+				file << *str;
+			}
+			file << '"';
+		}
+	}
+
+	thread_local Profiler::ThreadBufferHandle Profiler::t_threadBuffer;
+
+	Profiler::ThreadBufferHandle::~ThreadBufferHandle()
+	{
+		if (buffer == nullptr) return;
+
+		std::lock_guard lock(s_instanceMutex);
+		if (m_instance != nullptr && m_instance->m_id == profilerId)
+		{
+			buffer->Release();
+		}
+	}
+
+	Profiler::Profiler() :
+		m_id(s_nextId.fetch_add(1, std::memory_order_relaxed) + 1),
+		m_startTicks(GetTicks()),
+		m_startTime(std::chrono::steady_clock::now()),
+		m_lastFrameTicks(m_startTicks)
+	{
+	}
+
+	Profiler::~Profiler()
+	{
+		std::lock_guard lock(s_instanceMutex);
+		m_instance = nullptr;
+	}
+
+	ProfilerThreadBuffer* Profiler::RegisterThread()
+	{
+		std::lock_guard lock(m_threadBuffersMutex);
+		uint32_t threadIndex = static_cast<uint32_t>(m_threadBuffers.size());
+		if (!m_freeThreadIndices.empty())
+		{
+			threadIndex = m_freeThreadIndices.back();
+			m_freeThreadIndices.pop_back();
+		}
+		MEMORY_TAG_SCOPE("Profiler")
+		m_threadBuffers.push_back(std::make_unique<ProfilerThreadBuffer>(threadIndex, "Thread " + std::to_string(threadIndex)));
+		return m_threadBuffers.back().get();
+	}
+
+	uint32_t Profiler::FindOrAddChild(uint32_t parent, const char* name)
+	{
+		if (parent != InvalidNode)
+		{
+			for (const uint32_t child : m_nodes[parent].children)
+			{
+				// the same literal can have other address in other translation unit
+				if (m_nodes[child].name == name || strcmp(m_nodes[child].name, name) == 0)
+				{
+					return child;
+				}
+			}
+		}
+
+		const uint32_t node = static_cast<uint32_t>(m_nodes.size());
+		m_nodes.push_back({.name = name, .parent = parent});
+		if (parent != InvalidNode)
+		{
+			m_nodes[parent].children.push_back(node);
+		}
+		return node;
+	}
+
+	void Profiler::AggregateThread(uint32_t rootNode, std::vector<ProfilerEvent>& events)
+	{
+		// Zones are written when they close, so children come before parents
+		std::ranges::sort(events, [](const ProfilerEvent& a, const ProfilerEvent& b)
+		{
+			return a.start != b.start ? a.start < b.start : a.depth < b.depth;
+		});
+
+		// m_nodeStack[depth] is the parent of zones at this depth. Zones whose parent is still open
+		// or was closed in the previous frame go to the deepest known node
+		m_nodeStack.clear();
+		m_nodeStack.push_back(rootNode);
+		for (const ProfilerEvent& event : events)
+		{
+			if (m_nodeStack.size() > event.depth + 1)
+			{
+				m_nodeStack.resize(event.depth + 1);
+			}
+			const uint32_t node = FindOrAddChild(m_nodeStack.back(), event.name);
+			const double time = TicksToMilliseconds(event.end - event.start);
+			m_nodes[node].frameTime += time;
+			m_nodes[node].frameCallsCount++;
+			if (event.depth == 0)
+			{
+				m_nodes[rootNode].frameTime += time;
+				m_nodes[rootNode].frameCallsCount = 1;
+			}
+			m_nodeStack.push_back(node);
+		}
+	}
+
+	void Profiler::UpdateStats(Node& node)
+	{
+		if (node.frameCallsCount == 0)
+		{
+			node.stats.callsCount = 0;
+			return;
+		}
+
+		node.history[node.historyCount % HistorySize] = static_cast<float>(node.frameTime);
+		node.historyCount++;
+
+		const uint32_t count = std::min(node.historyCount, HistorySize);
+		std::array<float, HistorySize> sorted;
+		std::copy_n(node.history.begin(), count, sorted.begin());
+		const uint32_t p99Index = (count * 99 + 99) / 100 - 1;
+		std::nth_element(sorted.begin(), sorted.begin() + p99Index, sorted.begin() + count);
+
+		float sum = 0;
+		node.stats.min = node.history[0];
+		node.stats.max = node.history[0];
+		for (uint32_t i = 0; i < count; i++)
+		{
+			sum += node.history[i];
+			node.stats.min = std::min(node.stats.min, node.history[i]);
+			node.stats.max = std::max(node.stats.max, node.history[i]);
+		}
+		node.stats.last = static_cast<float>(node.frameTime);
+		node.stats.avg = sum / static_cast<float>(count);
+		node.stats.p99 = sorted[p99Index];
+		node.stats.callsCount = node.frameCallsCount;
+	}
+
+	void Profiler::EndFrame()
+	{
+		const uint64_t frameTicks = GetTicks();
+		const double elapsedTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+		if (elapsedTime > 0)
+		{
+			m_ticksPerMillisecond = static_cast<double>(frameTicks - m_startTicks) / elapsedTime;
+		}
+		m_frameTime = static_cast<float>(TicksToMilliseconds(frameTicks - m_lastFrameTicks));
+		m_lastFrameTicks = frameTicks;
+
+		for (Node& node : m_nodes)
+		{
+			node.frameTime = 0;
+			node.frameCallsCount = 0;
+		}
+
+		std::vector<ProfilerThreadBuffer*> threadBuffers;
+		{
+			std::lock_guard lock(m_threadBuffersMutex);
+			for (const auto& buffer : m_threadBuffers)
+			{
+				threadBuffers.push_back(buffer.get());
+			}
+		}
+
+		m_droppedCount = m_releasedDroppedCount;
+		for (const ProfilerThreadBuffer* buffer : threadBuffers)
+		{
+			m_droppedCount += buffer->GetDroppedCount();
+		}
+
+		std::vector<const ProfilerThreadBuffer*> releasedBuffers;
+		for (ProfilerThreadBuffer* buffer : threadBuffers)
+		{
+			// Read before draining, so zones of the exited thread are all drained
+			if (buffer->IsReleased())
+			{
+				releasedBuffers.push_back(buffer);
+			}
+
+			while (m_threadRootNodes.size() <= buffer->GetThreadIndex())
+			{
+				m_threadRootNodes.push_back(InvalidNode);
+			}
+			uint32_t& rootNode = m_threadRootNodes[buffer->GetThreadIndex()];
+			if (rootNode == InvalidNode)
+			{
+				rootNode = FindOrAddChild(InvalidNode, buffer->GetName().c_str());
+			}
+
+			m_frameEvents.clear();
+			buffer->Drain(m_frameEvents);
+			if (m_captureFramesLeft > 0)
+			{
+				for (const ProfilerEvent& event : m_frameEvents)
+				{
+					m_capturedEvents.push_back({event, buffer->GetThreadIndex()});
+				}
+			}
+			AggregateThread(rootNode, m_frameEvents);
+		}
+
+		if (!releasedBuffers.empty())
+		{
+			std::lock_guard lock(m_threadBuffersMutex);
+			for (const ProfilerThreadBuffer* buffer : releasedBuffers)
+			{
+				m_freeThreadIndices.push_back(buffer->GetThreadIndex());
+				m_releasedDroppedCount += buffer->GetDroppedCount();
+			}
+			std::erase_if(m_threadBuffers, [&releasedBuffers](const std::unique_ptr<ProfilerThreadBuffer>& buffer)
+			{
+				return std::ranges::find(releasedBuffers, buffer.get()) != releasedBuffers.end();
+			});
+		}
+
+		for (Node& node : m_nodes)
+		{
+			UpdateStats(node);
+		}
+
+		if (m_captureFramesLeft > 0)
+		{
+			m_captureFramesLeft--;
+			if (m_captureFramesLeft == 0)
+			{
+				WriteTrace();
+				m_capturedEvents.clear();
+			}
+		}
+	}
+
+	void Profiler::CaptureTrace(const std::string& path, uint32_t framesCount)
+	{
+		m_capturePath = path;
+		m_captureFramesLeft = framesCount;
+		m_capturedEvents.clear();
+	}
+
+	void Profiler::WriteTrace()
+	{
+		std::ofstream file(m_capturePath, std::ios::trunc);
+		if (!file)
+		{
+			Logger::LogFormat(LogLevel::Warning, "Cannot write profiler trace to %s\n", m_capturePath.c_str());
+			return;
+		}
+
+		file << "{\"traceEvents\":[\n";
+		bool isFirst = true;
+		std::lock_guard lock(m_threadBuffersMutex);
+		for (const auto& buffer : m_threadBuffers)
+		{
+			file << (isFirst ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << buffer->GetThreadIndex()
+				<< R"(,"args":{"name":)";
+			WriteJsonString(file, buffer->GetName().c_str());
+			file << "}}";
+			isFirst = false;
+		}
+		file.precision(3);
+		file << std::fixed;
+		for (const CapturedEvent& captured : m_capturedEvents)
+		{
+			// microseconds
+			file << (isFirst ? "" : ",\n") << R"({"name":)";
+			WriteJsonString(file, captured.event.name);
+			file << R"(,"ph":"X","pid":0,"tid":)" << captured.threadIndex
+				<< R"(,"ts":)" << TicksToMilliseconds(captured.event.start - m_startTicks) * 1000.0
+				<< R"(,"dur":)" << TicksToMilliseconds(captured.event.end - captured.event.start) * 1000.0 << "}";
+			isFirst = false;
+		}
+		file << "\n]}\n";
+
+		Logger::LogFormat("Profiler trace of %zu zones is written to %s\n", m_capturedEvents.size(), m_capturePath.c_str());
+	}
+
+	uint32_t Profiler::FindNode(const char* path) const
+	{
+		uint32_t node = InvalidNode;
+		const char* nameBegin = path;
+		while (true)
+		{
+			const char* nameEnd = strchr(nameBegin, '/');
+			const size_t nameLength = nameEnd == nullptr ? strlen(nameBegin) : nameEnd - nameBegin;
+
+			uint32_t foundNode = InvalidNode;
+			for (uint32_t i = 0; i < m_nodes.size(); i++)
+			{
+				if (m_nodes[i].parent == node &&
+					strncmp(m_nodes[i].name, nameBegin, nameLength) == 0 &&
+					m_nodes[i].name[nameLength] == 0)
+				{
+					foundNode = i;
+					break;
+				}
+			}
+			if (foundNode == InvalidNode || nameEnd == nullptr) return foundNode;
+			node = foundNode;
+			nameBegin = nameEnd + 1;
+		}
+	}
+
+	void Profiler::DrawNode(uint32_t nodeIndex) const
+	{
+		const Node& node = m_nodes[nodeIndex];
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_DefaultOpen;
+		if (node.children.empty())
+		{
+			flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+		}
+		const bool isOpen = ImGui::TreeNodeEx(reinterpret_cast<const void*>(static_cast<uintptr_t>(nodeIndex)), flags, "%s", node.name);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", node.stats.avg);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", node.stats.min);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", node.stats.max);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", node.stats.p99);
+		ImGui::TableNextColumn();
+		ImGui::Text("%u", node.stats.callsCount);
+
+		if (isOpen && !node.children.empty())
+		{
+			for (const uint32_t child : node.children)
+			{
+				DrawNode(child);
+			}
+			ImGui::TreePop();
+		}
+	}
+
+	void Profiler::DrawGui()
+	{
+		ImGui::Begin("Profiler:");
+		ImGui::Text("Frame %.3f ms, dropped zones %u", m_frameTime, m_droppedCount);
+		ImGui::SameLine();
+		if (m_captureFramesLeft > 0)
+		{
+			ImGui::Text("Capturing %u frames", m_captureFramesLeft);
+		}
+		else if (ImGui::Button("Save trace"))
+		{
+			CaptureTrace("profile.json", 120);
+		}
+
+		constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_BordersV | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+		if (ImGui::BeginTable("Zones", 6, tableFlags))
+		{
+			ImGui::TableSetupScrollFreeze(0, 1);
+			ImGui::TableSetupColumn("Zone", ImGuiTableColumnFlags_NoHide);
+			ImGui::TableSetupColumn("avg", ImGuiTableColumnFlags_WidthFixed, 45);
+			ImGui::TableSetupColumn("min", ImGuiTableColumnFlags_WidthFixed, 45);
+			ImGui::TableSetupColumn("max", ImGuiTableColumnFlags_WidthFixed, 45);
+			ImGui::TableSetupColumn("p99", ImGuiTableColumnFlags_WidthFixed, 45);
+			ImGui::TableSetupColumn("calls", ImGuiTableColumnFlags_WidthFixed, 35);
+			ImGui::TableHeadersRow();
+			for (const uint32_t rootNode : m_threadRootNodes)
+			{
+				if (rootNode != InvalidNode)
+				{
+					DrawNode(rootNode);
+				}
+			}
+			ImGui::EndTable();
+		}
+		ImGui::End();
+	}
+
+	void Profiler::LogNode(uint32_t nodeIndex, uint32_t depth) const
+	{
+		const Node& node = m_nodes[nodeIndex];
+		Logger::LogFormat("%*s%s: avg %.3f ms, min %.3f ms, max %.3f ms, p99 %.3f ms\n",
+		                  depth * 2, "",
+		                  node.name,
+		                  node.stats.avg,
+		                  node.stats.min,
+		                  node.stats.max,
+		                  node.stats.p99);
+		for (const uint32_t child : node.children)
+		{
+			LogNode(child, depth + 1);
+		}
+	}
+
+	void Profiler::LogStats() const
+	{
+		for (const uint32_t rootNode : m_threadRootNodes)
+		{
+			if (rootNode != InvalidNode)
+			{
+				LogNode(rootNode, 0);
+			}
+		}
+	}
+
+	void Profiler::AddBenchmarks(BenchmarkSuite& suite)
+	{
+		// Zones of one run fit into the ring and EndFrame drains it before the next run, so no zone is dropped
+		constexpr uint32_t zonesCount = ProfilerThreadBuffer::Capacity / 2;
+
+		suite.AddEngineCase("Profiler/Zone", zonesCount, []()
+		{
+			for (uint32_t i = 0; i < zonesCount; i++)
+			{
+				const ProfilerZone zone("Benchmark zone");
+			}
+		}, []()
+		{
+			Get()->EndFrame();
+		});
+	}
+}
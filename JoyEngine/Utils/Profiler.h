@@ -0,0 +1,261 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Common/Singleton.h"
+#include "Utils/MemoryTracker.h"
+
+// Zones are compiled out with JOY_PROFILER_ENABLED=0
+#ifndef JOY_PROFILER_ENABLED
+#define JOY_PROFILER_ENABLED 1
+#endif
+
+#define PROFILER_CONCAT_IMPL(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+
+#if JOY_PROFILER_ENABLED
+// Name is kept by pointer until the profiler is destroyed, so it should be a string literal
+#define PROFILE_ZONE(name) const ::JoyEngine::ProfilerZone PROFILER_CONCAT(profilerZone, __LINE__)(name);
+#else
+#define PROFILE_ZONE(name)
+#endif
+
+namespace JoyEngine
+{
+	class BenchmarkSuite;
+
+	struct ProfilerEvent
+	{
+		const char* name;
+		uint64_t start; // ticks
+		uint64_t end;
+		uint32_t depth;
+	};
+
+	// Ring of closed zones of one thread. Only the thread writes and only Profiler::EndFrame reads,
+	// events are dropped when the ring is full. EndFrame destroys the buffer after the thread exits and the ring is drained
+	class ProfilerThreadBuffer
+	{
+	public:
+		static constexpr uint32_t Capacity = 1 << 16;
+
+		ProfilerThreadBuffer(uint32_t threadIndex, std::string name) :
+			m_threadIndex(threadIndex),
+			m_name(std::move(name)),
+			m_events(std::make_unique<ProfilerEvent[]>(Capacity)),
+			m_eventsMemory(MemoryTracker::Track("CPU", Capacity * sizeof(ProfilerEvent)))
+		{
+		}
+
+		void Push(const ProfilerEvent& event)
+		{
+			const uint32_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+			if (writeIndex - m_readIndex.load(std::memory_order_acquire) == Capacity)
+			{
+				m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			m_events[writeIndex & (Capacity - 1)] = event;
+			m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+		}
+
+		void Drain(std::vector<ProfilerEvent>& events)
+		{
+			const uint32_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+			const uint32_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
+			for (uint32_t i = readIndex; i != writeIndex; i++)
+			{
+				events.push_back(m_events[i & (Capacity - 1)]);
+			}
+			m_readIndex.store(writeIndex, std::memory_order_release);
+		}
+
+		[[nodiscard]] uint32_t GetThreadIndex() const noexcept { return m_threadIndex; }
+		[[nodiscard]] const std::string& GetName() const noexcept { return m_name; }
+		[[nodiscard]] uint32_t GetDroppedCount() const noexcept { return m_droppedCount.load(std::memory_order_relaxed); }
+
+		// Zones written before are seen by the reader that sees the flag
+		void Release() noexcept { m_isReleased.store(true, std::memory_order_release); }
+		[[nodiscard]] bool IsReleased() const noexcept { return m_isReleased.load(std::memory_order_acquire); }
+
+		uint32_t depth = 0; // zones of the thread that are open now
+
+	private:
+		const uint32_t m_threadIndex;
+		const std::string m_name;
+		std::unique_ptr<ProfilerEvent[]> m_events;
+		MemoryAllocation m_eventsMemory;
+		std::atomic<uint32_t> m_writeIndex = 0;
+		std::atomic<uint32_t> m_readIndex = 0;
+		std::atomic<uint32_t> m_droppedCount = 0;
+		std::atomic<bool> m_isReleased = false;
+	};
+
+	struct ProfilerZoneStats
+	{
+		float last = 0; // ms
+		float min = 0;
+		float avg = 0;
+		float max = 0;
+		float p99 = 0;
+		uint32_t callsCount = 0; // in the last frame
+	};
+
+	// Zone tree of all threads aggregated per frame. Stats are kept for the last HistorySize frames where the zone was called.
+	// EndFrame, DrawGui and CaptureTrace are called from the update thread, zones can be opened on any thread
+	class Profiler : public Singleton<Profiler>
+	{
+	public:
+		static constexpr uint32_t HistorySize = 256;
+		static constexpr uint32_t InvalidNode = UINT32_MAX;
+
+		Profiler();
+		~Profiler();
+
+		static uint64_t GetTicks()
+		{
+#ifdef _MSC_VER
+			return __rdtsc();
+#else
+			return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+		}
+
+		static ProfilerThreadBuffer* GetThreadBuffer()
+		{
+			if (m_instance == nullptr) return nullptr;
+			// Buffer of a destroyed profiler is never used, the thread is registered in the new one
+			if (t_threadBuffer.profilerId != m_instance->m_id)
+			{
+				t_threadBuffer.buffer = m_instance->RegisterThread();
+				t_threadBuffer.profilerId = m_instance->m_id;
+			}
+			return t_threadBuffer.buffer;
+		}
+
+		void EndFrame();
+
+		// Writes zones of the next framesCount frames to Chrome trace JSON, it opens in chrome://tracing and Perfetto
+		void CaptureTrace(const std::string& path, uint32_t framesCount);
+
+		void DrawGui();
+
+		// Logs the zone tree with stats, for runs without GUI
+		void LogStats() const;
+
+		[[nodiscard]] uint32_t FindNode(const char* path) const; // "Thread 0/Frame/Update"
+		[[nodiscard]] const ProfilerZoneStats& GetStats(uint32_t node) const { return m_nodes[node].stats; }
+
+		// Cost of an empty zone
+		static void AddBenchmarks(BenchmarkSuite& suite);
+
+	private:
+		struct Node
+		{
+			const char* name;
+			uint32_t parent;
+			std::vector<uint32_t> children;
+			double frameTime = 0; // ms, while the frame is aggregated
+			uint32_t frameCallsCount = 0;
+			std::array<float, HistorySize> history = {};
+			uint32_t historyCount = 0;
+			ProfilerZoneStats stats;
+		};
+
+		struct CapturedEvent
+		{
+			ProfilerEvent event;
+			uint32_t threadIndex;
+		};
+
+		// Releases the buffer when the thread exits
+		struct ThreadBufferHandle
+		{
+			ProfilerThreadBuffer* buffer = nullptr;
+			uint64_t profilerId = 0;
+
+			~ThreadBufferHandle();
+		};
+
+		static thread_local ThreadBufferHandle t_threadBuffer;
+		static inline std::atomic<uint64_t> s_nextId = 0;
+		static inline std::mutex s_instanceMutex; // exiting threads release buffers while the profiler is alive
+
+		ProfilerThreadBuffer* RegisterThread();
+		uint32_t FindOrAddChild(uint32_t parent, const char* name);
+		void AggregateThread(uint32_t rootNode, std::vector<ProfilerEvent>& events);
+		void UpdateStats(Node& node);
+		void WriteTrace();
+		void DrawNode(uint32_t nodeIndex) const;
+		void LogNode(uint32_t nodeIndex, uint32_t depth) const;
+
+		[[nodiscard]] double TicksToMilliseconds(uint64_t ticks) const { return static_cast<double>(ticks) / m_ticksPerMillisecond; }
+
+		const uint64_t m_id;
+
+		std::vector<std::unique_ptr<ProfilerThreadBuffer>> m_threadBuffers;
+		std::vector<uint32_t> m_freeThreadIndices; // of exited threads, their zone tree is continued by new threads
+		std::mutex m_threadBuffersMutex;
+
+		std::vector<Node> m_nodes;
+		std::vector<uint32_t> m_threadRootNodes; // by thread index
+		std::vector<ProfilerEvent> m_frameEvents;
+		std::vector<uint32_t> m_nodeStack;
+
+		const uint64_t m_startTicks;
+		const std::chrono::steady_clock::time_point m_startTime;
+		double m_ticksPerMillisecond = 1e6;
+		uint64_t m_lastFrameTicks;
+		float m_frameTime = 0;
+		uint32_t m_droppedCount = 0;
+		uint32_t m_releasedDroppedCount = 0; // by destroyed buffers
+
+		std::string m_capturePath;
+		uint32_t m_captureFramesLeft = 0;
+		std::vector<CapturedEvent> m_capturedEvents;
+	};
+
+	class ProfilerZone
+	{
+	public:
+		explicit ProfilerZone(const char* name) :
+			m_buffer(Profiler::GetThreadBuffer()),
+			m_name(name)
+		{
+			if (m_buffer == nullptr) return;
+			m_depth = m_buffer->depth++;
+			m_start = Profiler::GetTicks();
+		}
+
+		~ProfilerZone()
+		{
+			if (m_buffer == nullptr) return;
+			const uint64_t end = Profiler::GetTicks();
+			m_buffer->depth--;
+			m_buffer->Push({m_name, m_start, end, m_depth});
+		}
+
+		ProfilerZone(const ProfilerZone&) = delete;
+		ProfilerZone& operator=(const ProfilerZone&) = delete;
+
+	private:
+		ProfilerThreadBuffer* const m_buffer;
+		const char* const m_name;
+		uint64_t m_start = 0;
+		uint32_t m_depth = 0;
+	};
+}
+
+#endif // PROFILER_H
@@ -3,9 +3,11 @@
 #include <chrono>
 
 #include "Log.h"
+#include "Profiler.h"
 
-#define TIME_PERF(message) const TimeCounter counter = TimeCounter(message);
-#define TIME_PERF_HIGHRES(message) const TimeCounter counter = TimeCounter(message, true);
+// Logs time of one-off scopes like initialization, the scope is a profiler zone too. Per frame code uses PROFILE_ZONE
+#define TIME_PERF(message) const TimeCounter counter = TimeCounter(message); PROFILE_ZONE(message)
+#define TIME_PERF_HIGHRES(message) const TimeCounter counter = TimeCounter(message, true); PROFILE_ZONE(message)
 
 namespace JoyEngine
 {
@@ -17,15 +17,78 @@
 
 #include "WindowHandler.h"
 
+#include <cwchar>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <string>
 
+#include "Benchmarks/BenchmarkSuite.h"
+#include "Benchmarks/TestSuite.h"
 #include "Utils/Log.h"
 
+namespace
+{
+	// Word after the option in the command line, empty if there is no option
+	std::string GetOptionValue(const wchar_t* cmdLine, const wchar_t* option)
+	{
+		const wchar_t* optionStart = wcsstr(cmdLine, option);
+		if (optionStart == nullptr) return {};
+
+		const wchar_t* valueStart = optionStart + wcslen(option);
+		while (*valueStart == L' ') valueStart++;
+		const wchar_t* valueEnd = valueStart;
+		while (*valueEnd != L' ' && *valueEnd != L'\0') valueEnd++;
+
+		return std::filesystem::path(std::wstring(valueStart, valueEnd)).string();
+	}
+}
+
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine, int nCmdShow)
 {
+	// JoyEngine.exe -log log.txt also writes the log to the file
+	if (const std::string logPath = GetOptionValue(pCmdLine, L"-log"); !logPath.empty())
+	{
+		Logger::AddSink(std::make_unique<FileLogSink>(logPath.c_str()));
+	}
+
+	// JoyEngine.exe -benchmark results.json [-baseline old_results.json] [-filter jmath] runs the benchmark suite without window,
+	// exit code is count of cases that are slower than in baseline. JoyEngineTests.exe does the same from the console
+	if (wcsstr(pCmdLine, L"-benchmark") != nullptr)
+	{
+		const std::string filter = GetOptionValue(pCmdLine, L"-filter");
+		return static_cast<int>(JoyEngine::BenchmarkSuite::RunEngineBenchmarks(
+			GetOptionValue(pCmdLine, L"-benchmark"),
+			GetOptionValue(pCmdLine, L"-baseline"),
+			filter.empty() ? nullptr : filter.c_str()));
+	}
+
+	// JoyEngine.exe -test [-filter Probe] runs the self-tests of engine modules without window, exit code is count of failed tests
+	if (wcsstr(pCmdLine, L"-test") != nullptr)
+	{
+		const std::string filter = GetOptionValue(pCmdLine, L"-filter");
+		return static_cast<int>(JoyEngine::TestSuite::RunEngineTests(filter.empty() ? nullptr : filter.c_str()));
+	}
+
+	// JoyEngine.exe -headless 1000 runs the scene for 1000 frames without window and D3D12 device on null renderer and logs timings
+	if (const wchar_t* headlessArg = wcsstr(pCmdLine, L"-headless"))
+	{
+		const uint32_t framesCount = wcstoul(headlessArg + wcslen(L"-headless"), nullptr, 10);
+
+		Logger::Log("=========== JOY ENGINE HEADLESS ===========\n");
+
+		JoyEngine::JoyEngine* headlessContext = new JoyEngine::JoyEngine(nullptr);
+		headlessContext->Init();
+		headlessContext->RunHeadless(framesCount > 0 ? framesCount : 1000);
+		headlessContext->Stop();
+
+		delete headlessContext;
+
+		return 0;
+	}
+
 	constexpr uint32_t windowWidth = 1280;
 	constexpr uint32_t windowHeight = 720;
 
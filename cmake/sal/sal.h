@@ -0,0 +1,40 @@
+// Empty source code annotations for DirectXMath on platforms without the Windows SDK sal.h.
+// CMakeLists.txt adds this directory to the include path only when the compiler doesn't have one
+
+#pragma once
+
+#define _In_
+#define _In_opt_
+#define _In_z_
+#define _In_reads_(size)
+#define _In_reads_opt_(size)
+#define _In_reads_bytes_(size)
+#define _In_reads_bytes_opt_(size)
+#define _In_range_(low, high)
+#define _Inout_
+#define _Inout_opt_
+#define _Inout_updates_(size)
+#define _Inout_updates_bytes_(size)
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(size)
+#define _Out_writes_opt_(size)
+#define _Out_writes_all_(size)
+#define _Out_writes_bytes_(size)
+#define _Out_writes_bytes_opt_(size)
+#define _Out_range_(low, high)
+#define _Outptr_
+#define _Outptr_opt_
+#define _Ret_maybenull_
+#define _Ret_notnull_
+#define _Check_return_
+#define _Success_(expr)
+#define _When_(expr, annotations)
+#define _Pre_
+#define _Post_
+#define _Notnull_
+#define _Maybenull_
+#define _Null_terminated_
+#define _Analysis_assume_(expr)
+#define _Use_decl_annotations_
+#define _Printf_format_string_